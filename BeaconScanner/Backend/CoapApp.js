@@ -5,6 +5,7 @@ const { Server } = require('socket.io');
 const path = require('path');
 const coap = require('coap');
 const fs = require('fs');
+const { LatencyHistograms, stamp, mountLatency } = require('./latency');
 
 // Express app for dashboard
 const app = express();
@@ -23,6 +24,10 @@ const LOG_PATH = path.join(__dirname, 'coap_events.log');
 let recentCoapEvents = [];
 const MAX_EVENTS = 100;
 
+// Stage latencies up to this dashboard (GET /latency, see latency.js)
+const latency = new LatencyHistograms('coap-dashboard');
+mountLatency(app, latency);
+
 // Serve dashboard
 app.get('/coapdashboard', (req, res) => {
   res.sendFile(DASHBOARD_PATH);
@@ -89,6 +94,8 @@ function subscribeToCoapServer() {
         
         // Process actual events
         if (event.eventType) {
+          stamp(event, 'delivered');
+          latency.observeTrace(event);
           logEvent(event);
           console.log('Received CoAP event:', event);
         }
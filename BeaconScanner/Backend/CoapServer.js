@@ -1,5 +1,6 @@
 // CoapServer.js - Pure CoAP server for beacon events
 const coap = require('coap');
+const { stamp } = require('./latency');
 
 const events = [];
 const server = coap.createServer();
@@ -9,16 +10,25 @@ server.on('request', (req, res) => {
   
   if (req.url === '/beacon/events') {
     if (req.method === 'POST') {
-      // Receive and store event from controller
+      // Receive and store one event from the controller, or a batch (JSON
+      // array, possibly sent in Block1 blocks) straight from the ESP32
       try {
-        const event = JSON.parse(req.payload.toString());
-        events.push(event);
-        console.log('CoAP Server received event:', event);
-        
-        // Notify all observers
-        server.emit('newEvent', event);
-        
-        res.end('Event received');
+        const body = JSON.parse(req.payload.toString());
+        const received = Array.isArray(body) ? body : [body];
+        received.forEach(event => {
+          // Straight from the ESP32, this server is the first hop (see latency.js)
+          if (!event.trace || event.trace.controller === undefined) {
+            stamp(event, 'controller');
+          }
+          stamp(event, 'published');
+          events.push(event);
+          console.log('CoAP Server received event:', event);
+
+          // Notify all observers
+          server.emit('newEvent', event);
+        });
+
+        res.end(received.length > 1 ? `${received.length} events received` : 'Event received');
       } catch (e) {
         console.error('Error parsing CoAP event:', e);
         res.code = '4.00';
@@ -5,6 +5,7 @@ const path = require('path');
 const express = require('express');
 const http = require('http');
 const { Server } = require('socket.io');
+const { LatencyHistograms, stamp, mountLatency } = require('./latency');
 
 const MQTT_BROKER = process.env.MQTT_BROKER || 'mqtt://localhost:1883';
 const MQTT_TOPIC = 'beacon/events';
@@ -22,6 +23,10 @@ app.get('/', (req, res) => {
 let recentEvents = [];
 const MAX_EVENTS = 100;
 
+// Stage latencies up to this dashboard (GET /latency, see latency.js)
+const latency = new LatencyHistograms('mqtt-dashboard');
+mountLatency(app, latency);
+
 const mqttClient = mqtt.connect(MQTT_BROKER);
 
 mqttClient.on('connect', () => {
@@ -43,13 +48,21 @@ mqttClient.on('message', (topic, message) => {
   } catch {
     eventObj = { raw: msgStr };
   }
-  eventObj.timestamp = new Date().toISOString();
+  // The event keeps its own timestamp (advertisement receipt on the ESP32)
+  eventObj.receivedAt = new Date().toISOString();
+  if (eventObj.timestamp === undefined) {
+    eventObj.timestamp = eventObj.receivedAt;
+  }
+  if (!eventObj.raw) {
+    stamp(eventObj, 'delivered');
+    latency.observeTrace(eventObj);
+  }
   recentEvents.push(eventObj);
   if (recentEvents.length > MAX_EVENTS) recentEvents = recentEvents.slice(-MAX_EVENTS);
   io.emit('mqtt_event', eventObj);
   // Save to file
   const logPath = path.join(__dirname, 'mttq_events.log');
-  const logEntry = `[${eventObj.timestamp}] ${topic}: ${msgStr}\n`;
+  const logEntry = `[${eventObj.receivedAt}] ${topic}: ${msgStr}\n`;
   fs.appendFile(logPath, logEntry, err => {
     if (err) console.error('Error writing to mttq_events.log:', err);
   });
@@ -7,6 +7,8 @@ const fs = require('fs');
 const path = require('path');
 const mqtt = require('mqtt');
 const coap = require('coap');
+const { CONTENT_TYPE: BINARY_EVENTS_TYPE, decodeBatch } = require('./eventCodec');
+const { LatencyHistograms, stamp, mountLatency } = require('./latency');
 
 const app = express();
 const PORT = process.env.CONTROLLER_PORT || 4000;
@@ -59,13 +61,32 @@ const COAP_RESOURCE = '/beacon/events';
 app.use(cors());
 app.use(express.json());
 
+// Stage latencies of traced events (GET /latency, see latency.js)
+const latency = new LatencyHistograms('controller');
+mountLatency(app, latency);
+
+// Stamps the event on receipt. The ESP32's timestamp (ms since 1970, taken
+// when the advertisement was received) is kept; events from firmware
+// without a synchronized clock get the receipt time instead.
+function receiveEvent(eventType, body) {
+  const event = stamp({ ...body, eventType, timestamp: body.timestamp ?? new Date().toISOString() }, 'controller');
+  latency.observeTrace(event);
+  return event;
+}
+
+// Copy of the event handed to a sink, and how long the sink took to acknowledge it
+function publishedCopy(event) {
+  return stamp({ ...event }, 'published');
+}
+
+function observeAck(event, sink) {
+  latency.observe('published_to_acked', { event: event.eventType, sink }, Date.now() - event.trace.published);
+}
+
 // Function to send event to CoAP server
-function sendCoapEvent(eventType, body) {
-  const payload = JSON.stringify({ 
-    eventType, 
-    ...body, 
-    timestamp: new Date().toISOString() 
-  });
+function sendCoapEvent(event) {
+  const coapEvent = publishedCopy(event);
+  const payload = JSON.stringify(coapEvent);
   
   console.log('Sending to CoAP server:', payload);
   
@@ -80,6 +101,7 @@ function sendCoapEvent(eventType, body) {
   req.write(payload);
   
   req.on('response', res => {
+    observeAck(coapEvent, 'coap');
     console.log('CoAP server response:', res.payload.toString());
   });
   
@@ -95,9 +117,9 @@ function sendCoapEvent(eventType, body) {
 }
 
 // Helper to log events to a file
-function logEvent(eventType, body) {
+function logEvent(event) {
   const logPath = path.join(__dirname, 'events.log');
-  const logEntry = `[${new Date().toISOString()}] ${eventType}: ${JSON.stringify(body)}\n`;
+  const logEntry = `[${new Date().toISOString()}] ${event.eventType}: ${JSON.stringify(event)}\n`;
   
   fs.appendFile(logPath, logEntry, err => {
     if (err) console.error('Error writing to log file:', err);
@@ -105,31 +127,39 @@ function logEvent(eventType, body) {
   
   // Publish to MQTT if enabled
   if (MQTT_ENABLED && mqttClient) {
-    const mqttPayload = JSON.stringify({ 
-      eventType, 
-      ...body, 
-      timestamp: new Date().toISOString() 
-    });
+    const mqttEvent = publishedCopy(event);
     
-    mqttClient.publish(MQTT_TOPIC, mqttPayload, err => {
+    mqttClient.publish(MQTT_TOPIC, JSON.stringify(mqttEvent), err => {
       if (err) console.error('Error publishing to MQTT:', err);
-      else console.log('Published to MQTT:', eventType);
+      else {
+        observeAck(mqttEvent, 'mqtt');
+        console.log('Published to MQTT:', event.eventType);
+      }
     });
   }
   
   // Send to CoAP server
-  sendCoapEvent(eventType, body);
+  sendCoapEvent(event);
+}
+
+// Forwards the event to the backend server (server.js)
+async function forwardEvent(event) {
+  const backendEvent = publishedCopy(event);
+  const response = await axios.post(`${BACKEND_URL}/beacon/${event.eventType}`, backendEvent, {
+    timeout: 5000
+  });
+  observeAck(backendEvent, 'backend');
+  return response;
 }
 
 // Forward arrival event
 app.post('/beacon/arrival', async (req, res) => {
   console.log('Received arrival event:', req.body);
-  logEvent('arrival', req.body);
+  const event = receiveEvent('arrival', req.body);
+  logEvent(event);
   
   try {
-    const response = await axios.post(`${BACKEND_URL}/beacon/arrival`, req.body, {
-      timeout: 5000
-    });
+    const response = await forwardEvent(event);
     res.status(response.status).json(response.data);
   } catch (err) {
     console.error('Error forwarding to backend:', err.message);
@@ -142,12 +172,11 @@ app.post('/beacon/arrival', async (req, res) => {
 // Forward departure event
 app.post('/beacon/departure', async (req, res) => {
   console.log('Received departure event:', req.body);
-  logEvent('departure', req.body);
+  const event = receiveEvent('departure', req.body);
+  logEvent(event);
   
   try {
-    const response = await axios.post(`${BACKEND_URL}/beacon/departure`, req.body, {
-      timeout: 5000
-    });
+    const response = await forwardEvent(event);
     res.status(response.status).json(response.data);
   } catch (err) {
     console.error('Error forwarding to backend:', err.message);
@@ -157,6 +186,51 @@ app.post('/beacon/departure', async (req, res) => {
   }
 });
 
+// Batched events from the ESP32: { deviceId, events: [...] } or a plain array in
+// JSON, or the compact binary format (Content-Type application/x-beacon-events).
+// Each event is fanned out to MQTT/CoAP and forwarded to the backend; the ESP32
+// gets its answer right away so the keep-alive connection is freed quickly.
+app.post('/beacon/batch', express.raw({ type: BINARY_EVENTS_TYPE, limit: '256kb' }), (req, res) => {
+  let body = req.body;
+
+  if (req.is(BINARY_EVENTS_TYPE)) {
+    try {
+      body = decodeBatch(body);
+    } catch (err) {
+      console.error('Invalid binary batch:', err.message);
+      return res.status(400).json({ success: false, error: err.message });
+    }
+  } else if (!req.is('application/json')) {
+    // Lets the ESP32 fall back to JSON
+    return res.status(415).json({ success: false, error: 'Unsupported Content-Type' });
+  }
+
+  const events = Array.isArray(body) ? body : body.events;
+
+  if (!Array.isArray(events)) {
+    return res.status(400).json({ success: false, error: 'Expected an events array' });
+  }
+
+  console.log(`Received batch of ${events.length} events from ${body.deviceId || 'unknown device'}`);
+
+  const forwards = events.map(event => {
+    const eventType = event.eventType === 'departure' ? 'departure' : 'arrival';
+    const fullEvent = receiveEvent(eventType, { deviceId: body.deviceId, ...event });
+
+    logEvent(fullEvent);
+    return forwardEvent(fullEvent);
+  });
+
+  Promise.allSettled(forwards).then(results => {
+    const failed = results.filter(r => r.status === 'rejected');
+    if (failed.length > 0) {
+      console.error(`Error forwarding ${failed.length}/${events.length} batched events to backend:`, failed[0].reason.message);
+    }
+  });
+
+  res.json({ success: true, received: events.length });
+});
+
 // Health check endpoint
 app.get('/health', (req, res) => {
   res.json({
@@ -173,7 +247,7 @@ app.get('/health', (req, res) => {
 // Test endpoint to simulate events
 app.post('/test/event', (req, res) => {
   const { eventType = 'test', ...body } = req.body;
-  logEvent(eventType, { ...body, test: true });
+  logEvent({ eventType, ...body, test: true });
   res.json({ message: 'Test event sent', eventType, body });
 });
 
@@ -182,6 +256,7 @@ app.listen(PORT, () => {
   console.log(`Forwarding events to backend at ${BACKEND_URL}`);
   console.log(`CoAP server at coap://${COAP_SERVER_HOST}:${COAP_SERVER_PORT}`);
   console.log(`Health check available at http://localhost:${PORT}/health`);
+  console.log(`Stage latencies available at http://localhost:${PORT}/latency`);
 });
 
 // Graceful shutdown
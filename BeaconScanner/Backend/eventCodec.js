@@ -0,0 +1,116 @@
+// eventCodec.js - Decoder for the compact binary event format sent by the ESP32
+// (see src/EventCodec.h for the layout)
+
+const CONTENT_TYPE = 'application/x-beacon-events';
+// Version 2 adds real time (ms since 1970), trace IDs and the receive delay;
+// version 1 frames from older firmware are still accepted
+const LAYOUTS = {
+  1: { headerSize: 15, eventSize: 16 },
+  2: { headerSize: 31, eventSize: 24 }
+};
+const FRAME_TYPES = ['none', 'ibeacon', 'altbeacon', 'eddystone-uid', 'eddystone-url', 'eddystone-tlm'];
+
+function hex(buffer, start, end, separator = '') {
+  const parts = [];
+  for (let i = start; i < end; i++) {
+    parts.push(buffer[i].toString(16).padStart(2, '0'));
+  }
+  return parts.join(separator);
+}
+
+function formatUuid(buffer, start) {
+  const h = hex(buffer, start, start + 16);
+  return `${h.slice(0, 8)}-${h.slice(8, 12)}-${h.slice(12, 16)}-${h.slice(16, 20)}-${h.slice(20)}`;
+}
+
+// HH:MM:SS.mmm rendering of millis() used by version 1 frames
+function formatTimestamp(ms) {
+  const pad = (value, width = 2) => String(value).padStart(width, '0');
+  const seconds = Math.floor(ms / 1000);
+  return `${pad(Math.floor(seconds / 3600) % 24)}:${pad(Math.floor(seconds / 60) % 60)}:${pad(seconds % 60)}.${pad(ms % 1000, 3)}`;
+}
+
+function readEpoch(buffer, pos) {
+  return Number(buffer.readBigUInt64LE(pos));
+}
+
+// Decodes a body made of one or more frames into { deviceId, events }.
+// Events carry the same fields as the JSON batch format.
+function decodeBatch(buffer) {
+  const events = [];
+  let deviceId = null;
+  let pos = 0;
+
+  while (pos < buffer.length) {
+    if (buffer.length - pos < 3 || buffer[pos] !== 0x42 || buffer[pos + 1] !== 0x53) {
+      throw new Error(`Invalid frame header at offset ${pos}`);
+    }
+    const version = buffer[pos + 2];
+    const layout = LAYOUTS[version];
+    if (!layout) {
+      throw new Error(`Unsupported frame version ${version}`);
+    }
+    if (buffer.length - pos < layout.headerSize) {
+      throw new Error(`Invalid frame header at offset ${pos}`);
+    }
+
+    const uuidCount = buffer[pos + 3];
+    deviceId = `ESP32_${hex(buffer, pos + 4, pos + 10).toUpperCase()}`;
+    let timestamp = buffer.readUInt32LE(pos + 10);
+    const eventCount = buffer[pos + 14];
+    // Real time of the base timestamp and of the send, 0 when unknown
+    const epochBase = version >= 2 ? readEpoch(buffer, pos + 15) - timestamp : 0;
+    const sentAt = version >= 2 ? readEpoch(buffer, pos + 23) : 0;
+    pos += layout.headerSize;
+
+    if (buffer.length - pos < uuidCount * 16 + eventCount * layout.eventSize) {
+      throw new Error('Truncated frame');
+    }
+
+    const uuids = [];
+    for (let k = 0; k < uuidCount; k++) {
+      uuids.push(formatUuid(buffer, pos));
+      pos += 16;
+    }
+
+    for (let i = 0; i < eventCount; i++) {
+      const flags = buffer[pos];
+      const uuidIndex = buffer[pos + 1];
+      timestamp += buffer.readUInt16LE(pos + 2);
+      const address = hex(buffer, pos + 4, pos + 10, ':');
+      const uuid = uuidIndex < uuids.length ? uuids[uuidIndex] : null;
+
+      const event = {
+        beaconId: uuid ? `${address}_${uuid}` : address,
+        eventType: (flags & 0x01) ? 'departure' : 'arrival',
+        frameType: FRAME_TYPES[flags >> 4] || 'unknown',
+        major: buffer.readUInt16LE(pos + 10),
+        minor: buffer.readUInt16LE(pos + 12),
+        rssi: buffer.readInt8(pos + 14),
+        txPower: buffer.readInt8(pos + 15),
+        deviceId
+      };
+
+      if (version === 1) {
+        event.timestamp = formatTimestamp(timestamp);
+      } else {
+        event.traceId = buffer.readUInt32LE(pos + 16).toString(16).padStart(8, '0');
+        if (epochBase > 0) {
+          const enqueued = epochBase + timestamp;
+          const received = enqueued - buffer.readUInt32LE(pos + 20);
+          event.timestamp = received;
+          event.trace = { received, enqueued };
+          if (sentAt > 0) {
+            event.trace.sent = sentAt;
+          }
+        }
+      }
+      events.push(event);
+      pos += layout.eventSize;
+    }
+  }
+
+  return { deviceId, events };
+}
+
+module.exports = { CONTENT_TYPE, decodeBatch, formatTimestamp };
@@ -0,0 +1,113 @@
+// eventCodec.test.js - Decodes the vectors shared with the firmware encoder
+// test (test/vectors/event_codec.txt, test/test_event_codec) and checks every
+// field against the events they were built from. Run with: npm test
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('fs');
+const path = require('path');
+const { decodeBatch, formatTimestamp } = require('./eventCodec');
+
+const VECTORS = path.join(__dirname, '..', 'test', 'vectors', 'event_codec.txt');
+
+// Same line format as the C++ test: see the header of the vector file
+function loadVectors() {
+  const vectors = [];
+  let current = null;
+  for (const raw of fs.readFileSync(VECTORS, 'utf8').split('\n')) {
+    const line = raw.trim();
+    if (!line || line.startsWith('#')) {
+      continue;
+    }
+    const [keyword, ...rest] = line.split(/\s+/);
+    switch (keyword) {
+      case 'vector':
+        current = { name: rest.join(' '), decodeOnly: false, device: null, sentAt: 0, events: [], hex: '' };
+        break;
+      case 'decode-only':
+        current.decodeOnly = true;
+        break;
+      case 'device':
+        current.device = rest[0];
+        break;
+      case 'clock':
+        current.sentAt = Number(rest[1]);
+        break;
+      case 'event': {
+        const event = { eventType: rest[0] };
+        for (const field of rest.slice(1)) {
+          const [key, value] = field.split('=');
+          event[key] = value;
+        }
+        current.events.push(event);
+        break;
+      }
+      case 'bytes':
+        current.hex += rest.join('');
+        break;
+      case 'end':
+        vectors.push(current);
+        break;
+      default:
+        break;
+    }
+  }
+  return vectors;
+}
+
+const vectors = loadVectors();
+
+test('vector file is loaded', () => {
+  assert.ok(vectors.length > 4);
+  for (const vector of vectors) {
+    assert.ok(vector.events.length > 0, vector.name);
+    assert.ok(vector.hex.length > 0, vector.name);
+  }
+});
+
+for (const vector of vectors) {
+  test(`decodes ${vector.name}`, () => {
+    const { deviceId, events } = decodeBatch(Buffer.from(vector.hex, 'hex'));
+    const expectedDevice = `ESP32_${vector.device.toUpperCase()}`;
+    assert.strictEqual(deviceId, expectedDevice);
+    assert.strictEqual(events.length, vector.events.length);
+
+    vector.events.forEach((expected, i) => {
+      const event = events[i];
+      const beaconId = expected.uuid ? `${expected.address}_${expected.uuid}` : expected.address;
+      assert.strictEqual(event.beaconId, beaconId);
+      assert.strictEqual(event.eventType, expected.eventType);
+      assert.strictEqual(event.frameType, expected.frame);
+      assert.strictEqual(event.major, Number(expected.major));
+      assert.strictEqual(event.minor, Number(expected.minor));
+      assert.strictEqual(event.rssi, Number(expected.rssi));
+      assert.strictEqual(event.txPower, Number(expected.tx));
+      assert.strictEqual(event.deviceId, expectedDevice);
+
+      if (vector.decodeOnly) {
+        // Version 1: millis() rendered as text, no trace
+        assert.strictEqual(event.timestamp, formatTimestamp(Number(expected.timestamp)));
+        assert.strictEqual(event.traceId, undefined);
+        return;
+      }
+      assert.strictEqual(event.traceId, expected.trace);
+      const enqueuedAt = Number(expected.enqueuedAt);
+      if (enqueuedAt === 0) {
+        assert.strictEqual(event.timestamp, undefined);
+        assert.strictEqual(event.trace, undefined);
+      } else {
+        assert.strictEqual(event.timestamp, Number(expected.receivedAt));
+        assert.strictEqual(event.trace.enqueued, enqueuedAt);
+        assert.strictEqual(event.trace.received, Number(expected.receivedAt));
+        assert.strictEqual(event.trace.sent, vector.sentAt);
+      }
+    });
+  });
+}
+
+test('rejects a truncated frame', () => {
+  const hex = vectors.find((vector) => !vector.decodeOnly).hex;
+  const buffer = Buffer.from(hex, 'hex');
+  assert.throws(() => decodeBatch(buffer.subarray(0, buffer.length - 1)), /Truncated frame/);
+  assert.throws(() => decodeBatch(buffer.subarray(0, 10)), /Invalid frame header/);
+});
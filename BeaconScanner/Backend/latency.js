@@ -0,0 +1,162 @@
+// latency.js - Per-stage latency histograms for traced beacon events
+//
+// Each event carries a traceId and a `trace` object of stage timestamps
+// (integers, ms since 1970) that every hop completes:
+//   received    advertisement received by the ESP32 (BLE callback)
+//   enqueued    event queued for the uplink on the ESP32
+//   sent        batch handed to the transport by the ESP32
+//   controller  received by controller.js (or CoapServer.js)
+//   published   published by controller.js to MQTT, CoAP or server.js,
+//               or notified to observers by CoapServer.js
+//   delivered   received by a dashboard backend (server.js, MttqApp.js,
+//               CoapApp.js)
+// Latencies are taken between consecutive stages present in the trace, plus
+// end_to_end from received to the last one. Stages stamped on different
+// hosts rely on their clocks (SNTP on the ESP32, NTP on the hosts): a
+// negative latency is counted as clock skew and recorded as 0.
+
+const STAGES = ['received', 'enqueued', 'sent', 'controller', 'published', 'delivered'];
+
+// Upper bounds (ms), last bucket +Inf
+const BOUNDS_MS = [1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000];
+
+class Histogram {
+  constructor() {
+    this.counts = new Array(BOUNDS_MS.length + 1).fill(0);
+    this.count = 0;
+    this.sum = 0;
+    this.max = 0;
+  }
+
+  observe(ms) {
+    let bucket = 0;
+    while (bucket < BOUNDS_MS.length && ms > BOUNDS_MS[bucket]) {
+      bucket++;
+    }
+    this.counts[bucket]++;
+    this.count++;
+    this.sum += ms;
+    this.max = Math.max(this.max, ms);
+  }
+
+  // Upper bound of the bucket holding the q-quantile (max for the last one)
+  quantile(q) {
+    const rank = q * this.count;
+    let cumulative = 0;
+    for (let i = 0; i < this.counts.length; i++) {
+      cumulative += this.counts[i];
+      if (cumulative >= rank && cumulative > 0) {
+        return i < BOUNDS_MS.length ? Math.min(BOUNDS_MS[i], this.max) : this.max;
+      }
+    }
+    return 0;
+  }
+
+  toJSON() {
+    return {
+      count: this.count,
+      meanMs: this.count ? Math.round(this.sum / this.count * 10) / 10 : 0,
+      p50Ms: this.quantile(0.5),
+      p95Ms: this.quantile(0.95),
+      p99Ms: this.quantile(0.99),
+      maxMs: this.max
+    };
+  }
+}
+
+class LatencyHistograms {
+  constructor(component) {
+    this.component = component;
+    this.histograms = new Map(); // "stage|label=value,..." -> { stage, labels, histogram }
+    this.skewed = 0;
+    this.traced = 0;
+  }
+
+  observe(stage, labels, ms) {
+    if (!Number.isFinite(ms)) {
+      return;
+    }
+    if (ms < 0) {
+      this.skewed++;
+      ms = 0;
+    }
+    const names = Object.keys(labels).sort();
+    const key = `${stage}|${names.map(name => `${name}=${labels[name]}`).join(',')}`;
+    let entry = this.histograms.get(key);
+    if (!entry) {
+      entry = { stage, labels, histogram: new Histogram() };
+      this.histograms.set(key, entry);
+    }
+    entry.histogram.observe(ms);
+  }
+
+  // Consecutive stages of event.trace, and end_to_end when it starts at received
+  observeTrace(event, labels = {}) {
+    const trace = event && event.trace;
+    if (!trace) {
+      return;
+    }
+    const all = { event: event.eventType === 'departure' ? 'departure' : 'arrival', ...labels };
+    const present = STAGES.filter(stage => Number.isFinite(trace[stage]));
+    for (let i = 1; i < present.length; i++) {
+      this.observe(`${present[i - 1]}_to_${present[i]}`, all, trace[present[i]] - trace[present[i - 1]]);
+    }
+    if (present.length > 1 && present[0] === 'received') {
+      this.observe('end_to_end', all, trace[present[present.length - 1]] - trace.received);
+    }
+    this.traced++;
+  }
+
+  toJSON() {
+    // Pipeline order, end_to_end last
+    const order = ({ stage }) => (stage === 'end_to_end' ? STAGES.length : STAGES.indexOf(stage.split('_to_')[0]));
+    const stages = [...this.histograms.values()]
+      .sort((a, b) => order(a) - order(b))
+      .map(({ stage, labels, histogram }) => ({ stage, ...labels, ...histogram.toJSON() }));
+    return { component: this.component, traced: this.traced, clockSkewed: this.skewed, stages };
+  }
+
+  // Prometheus text format (version 0.0.4), in seconds like the ESP32's /metrics
+  toPrometheus() {
+    const name = 'beacon_trace_latency_seconds';
+    const lines = [
+      `# HELP ${name} Latency between consecutive stages of traced beacon events`,
+      `# TYPE ${name} histogram`
+    ];
+    for (const { stage, labels, histogram } of this.histograms.values()) {
+      const base = [`component="${this.component}"`, `stage="${stage}"`,
+        ...Object.keys(labels).sort().map(label => `${label}="${labels[label]}"`)].join(',');
+      let cumulative = 0;
+      BOUNDS_MS.forEach((bound, i) => {
+        cumulative += histogram.counts[i];
+        lines.push(`${name}_bucket{${base},le="${bound / 1000}"} ${cumulative}`);
+      });
+      lines.push(`${name}_bucket{${base},le="+Inf"} ${histogram.count}`);
+      lines.push(`${name}_sum{${base}} ${histogram.sum / 1000}`);
+      lines.push(`${name}_count{${base}} ${histogram.count}`);
+    }
+    lines.push(`# HELP beacon_trace_clock_skew_total Negative stage latencies (host clocks out of sync)`);
+    lines.push(`# TYPE beacon_trace_clock_skew_total counter`);
+    lines.push(`beacon_trace_clock_skew_total{component="${this.component}"} ${this.skewed}`);
+    return lines.join('\n') + '\n';
+  }
+}
+
+// Adds the stage timestamp to event.trace (created if missing)
+function stamp(event, stage, at = Date.now()) {
+  event.trace = { ...(event.trace || {}), [stage]: at };
+  return event;
+}
+
+// GET /latency: JSON summary, or Prometheus text with ?format=prometheus
+function mountLatency(app, histograms) {
+  app.get('/latency', (req, res) => {
+    if (req.query.format === 'prometheus') {
+      res.type('text/plain; version=0.0.4').send(histograms.toPrometheus());
+    } else {
+      res.json(histograms.toJSON());
+    }
+  });
+}
+
+module.exports = { STAGES, BOUNDS_MS, LatencyHistograms, stamp, mountLatency };
@@ -0,0 +1,106 @@
+// latency.test.js - Stage latencies of traced events: a frame from the shared
+// codec vectors (test/vectors/event_codec.txt) is decoded, stamped by the
+// controller and a dashboard backend, then fed to LatencyHistograms.
+// Run with: npm test
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('fs');
+const path = require('path');
+const { decodeBatch } = require('./eventCodec');
+const { BOUNDS_MS, LatencyHistograms, stamp } = require('./latency');
+
+const VECTORS = path.join(__dirname, '..', 'test', 'vectors', 'event_codec.txt');
+
+// Frame bytes of one vector (see the header of the vector file)
+function vectorFrame(name) {
+  let hex = '';
+  let inside = false;
+  for (const line of fs.readFileSync(VECTORS, 'utf8').split('\n')) {
+    const [keyword, ...rest] = line.trim().split(/\s+/);
+    if (keyword === 'vector') {
+      inside = rest.join(' ') === name;
+    } else if (inside && keyword === 'bytes') {
+      hex += rest.join('');
+    } else if (inside && keyword === 'end') {
+      break;
+    }
+  }
+  return Buffer.from(hex, 'hex');
+}
+
+function stageOf(histograms, stage, event = 'arrival') {
+  return histograms.toJSON().stages.find((entry) => entry.stage === stage && entry.event === event);
+}
+
+test('decoded frame is traced through every stage', () => {
+  const { events } = decodeBatch(vectorFrame('ibeacon-uuid-table'));
+  const histograms = new LatencyHistograms('test');
+  for (const event of events) {
+    stamp(event, 'controller', event.trace.sent + 40);
+    stamp(event, 'published', event.trace.controller + 3);
+    stamp(event, 'delivered', event.trace.published + 12);
+    histograms.observeTrace(event);
+  }
+
+  const json = histograms.toJSON();
+  assert.strictEqual(json.traced, events.length);
+  assert.strictEqual(json.clockSkewed, 0);
+  assert.deepStrictEqual(
+    [...new Set(json.stages.map((entry) => entry.stage))],
+    ['received_to_enqueued', 'enqueued_to_sent', 'sent_to_controller', 'controller_to_published',
+      'published_to_delivered', 'end_to_end']);
+
+  // First event of the vector: received 9980, enqueued 10000, sent at 20000
+  const first = events[0];
+  assert.strictEqual(first.trace.enqueued - first.trace.received, 20);
+  assert.strictEqual(first.trace.sent - first.trace.enqueued, 10000);
+
+  const arrivals = events.filter((event) => event.eventType === 'arrival');
+  assert.strictEqual(stageOf(histograms, 'sent_to_controller').count, arrivals.length);
+  assert.strictEqual(stageOf(histograms, 'sent_to_controller').maxMs, 40);
+  assert.strictEqual(stageOf(histograms, 'published_to_delivered', 'departure').count, 1);
+  const endToEnd = stageOf(histograms, 'end_to_end');
+  const expected = Math.max(...arrivals.map((event) => event.trace.delivered - event.trace.received));
+  assert.strictEqual(endToEnd.maxMs, expected);
+});
+
+test('events without a trace are skipped', () => {
+  const { events } = decodeBatch(vectorFrame('arrival-before-sntp'));
+  const histograms = new LatencyHistograms('test');
+  histograms.observeTrace(events[0]);
+  assert.strictEqual(events[0].trace, undefined);
+  assert.strictEqual(histograms.toJSON().traced, 0);
+});
+
+test('negative latency is counted as clock skew and recorded as 0', () => {
+  const histograms = new LatencyHistograms('test');
+  histograms.observeTrace({ eventType: 'departure', trace: { sent: 1000, controller: 990 } });
+  assert.strictEqual(histograms.toJSON().clockSkewed, 1);
+  const stage = stageOf(histograms, 'sent_to_controller', 'departure');
+  assert.strictEqual(stage.maxMs, 0);
+  assert.strictEqual(stage.count, 1);
+});
+
+test('quantiles and Prometheus buckets', () => {
+  const histograms = new LatencyHistograms('test');
+  for (let ms = 1; ms <= 100; ms++) {
+    histograms.observe('sent_to_controller', { event: 'arrival' }, ms);
+  }
+  const stage = stageOf(histograms, 'sent_to_controller');
+  assert.strictEqual(stage.p50Ms, 50);
+  assert.strictEqual(stage.p95Ms, 100);
+  assert.strictEqual(stage.maxMs, 100);
+  assert.strictEqual(stage.meanMs, 50.5);
+
+  const text = histograms.toPrometheus();
+  const bucket = (le) => {
+    const line = new RegExp(`stage="sent_to_controller",event="arrival",le="${le}"} (\\d+)`);
+    return Number(text.match(line)[1]);
+  };
+  assert.strictEqual(bucket(0.01), 10);
+  assert.strictEqual(bucket(0.1), 100);
+  assert.strictEqual(bucket(BOUNDS_MS[BOUNDS_MS.length - 1] / 1000), 100);
+  assert.strictEqual(bucket('\\+Inf'), 100);
+  assert.match(text, /beacon_trace_latency_seconds_sum\{component="test",stage="sent_to_controller",event="arrival"\} 5\.05/);
+});
@@ -3,6 +3,7 @@ const express = require('express');
 const cors = require('cors');
 const path = require('path'); // 🆕 Chemins de fichiers sûrs
 const axios = require('axios');
+const { LatencyHistograms, stamp, mountLatency } = require('./latency');
 const app = express();
 
 // Middleware
@@ -43,6 +44,10 @@ const PORT = process.env.PORT || 3000;
 let beaconEvents = [];
 let connectedDevices = new Set();
 
+// Latences par étape des événements tracés, jusqu'à leur arrivée ici (voir latency.js)
+const latency = new LatencyHistograms('server');
+mountLatency(app, latency);
+
 // Fonction pour logger avec timestamp
 function logWithTimestamp(message) {
     const now = new Date();
@@ -65,6 +70,8 @@ app.post('/beacon/arrival', (req, res) => {
         // Ajouter des métadonnées
         eventData.receivedAt = new Date().toISOString();
         eventData.eventType = 'arrival';
+        stamp(eventData, 'delivered');
+        latency.observeTrace(eventData);
         
         // Stocker l'événement
         beaconEvents.push(eventData);
@@ -107,6 +114,8 @@ app.post('/beacon/departure', (req, res) => {
         // Ajouter des métadonnées
         eventData.receivedAt = new Date().toISOString();
         eventData.eventType = 'departure';
+        stamp(eventData, 'delivered');
+        latency.observeTrace(eventData);
         
         // Stocker l'événement
         beaconEvents.push(eventData);
@@ -268,6 +277,7 @@ app.use((req, res) => {
             'GET /stats',
             'GET /beacons/status',
             'GET /beacon/:beaconId/events',
+            'GET /latency',
             'DELETE /events/cleanup'
         ]
     });
@@ -292,6 +302,7 @@ app.listen(PORT, () => {
     logWithTimestamp(`   GET  http://localhost:${PORT}/events`);
     logWithTimestamp(`   GET  http://localhost:${PORT}/stats`);
     logWithTimestamp(`   GET  http://localhost:${PORT}/beacons/status`);
+    logWithTimestamp(`   GET  http://localhost:${PORT}/latency`);
     logWithTimestamp(`💡 Prêt à recevoir les événements des beacons!`);
 });
 
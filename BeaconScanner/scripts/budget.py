@@ -0,0 +1,55 @@
+# Budget mémoire de chaque environnement, après l'édition de liens :
+# flash, DRAM et IRAM statiques tirées des sections de firmware.elf,
+# enregistrées dans .pio/build/budget.json puis affichées côte à côte pour
+# tous les environnements déjà compilés, par exemple :
+#   pio run -e esp32dev -e esp32dev-nimble
+# La RAM prise à l'exécution par la pile Bluetooth n'y est pas : voir
+# "Tas libre après l'init BLE" dans la console, et beacon_heap_free_bytes.
+
+import json
+import os
+import subprocess
+
+Import("env")
+
+
+def section_sizes(elf):
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", "-d", elf], universal_newlines=True)
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def budget(sizes):
+    def total(*prefixes):
+        return sum(size for name, size in sizes.items() if name.startswith(prefixes))
+
+    return {
+        "flash": total(".flash.", ".iram0.", ".dram0.data"),
+        "dram": total(".dram0."),
+        "iram": total(".iram0."),
+    }
+
+
+def report(source, target, env):
+    path = os.path.join(env.subst("$BUILD_DIR"), "..", "budget.json")
+    try:
+        with open(path) as f:
+            budgets = json.load(f)
+    except (IOError, ValueError):
+        budgets = {}
+    budgets[env.subst("$PIOENV")] = budget(section_sizes(source[0].get_abspath()))
+    with open(path, "w") as f:
+        json.dump(budgets, f, indent=2, sort_keys=True)
+
+    names = sorted(budgets)
+    print("Budget mémoire (octets, statique)")
+    print("  %-8s" % "" + "".join("%18s" % name for name in names))
+    for key in ("flash", "dram", "iram"):
+        print("  %-8s" % key + "".join("%18d" % budgets[name][key] for name in names))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
@@ -0,0 +1,280 @@
+#include "AdvFilter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool testBit(const uint32_t mask[8], uint8_t value) {
+    return (mask[value >> 5] >> (value & 31)) & 1;
+}
+
+static uint32_t ouiOf(const uint8_t address[6]) {
+    return ((uint32_t)address[0] << 16) | ((uint32_t)address[1] << 8) | address[2];
+}
+
+// Octets hexadécimaux, séparateurs '-' et ':' ignorés ; exactement count
+static bool parseHexBytes(const char* text, uint8_t* out, size_t count) {
+    size_t n = 0;
+    int high = -1;
+    for (const char* p = text; *p; p++) {
+        if (*p == '-' || *p == ':') {
+            continue;
+        }
+        int digit;
+        if (*p >= '0' && *p <= '9') {
+            digit = *p - '0';
+        } else if (*p >= 'a' && *p <= 'f') {
+            digit = *p - 'a' + 10;
+        } else if (*p >= 'A' && *p <= 'F') {
+            digit = *p - 'A' + 10;
+        } else {
+            return false;
+        }
+        if (high < 0) {
+            high = digit;
+        } else {
+            if (n == count) {
+                return false;
+            }
+            out[n++] = (uint8_t)(high << 4 | digit);
+            high = -1;
+        }
+    }
+    return n == count && high < 0;
+}
+
+// "N" ou "N-M", dans [0, 65535]
+static bool parseRange(const char* text, uint16_t& low, uint16_t& high) {
+    char* end;
+    unsigned long first = strtoul(text, &end, 10);
+    unsigned long last = first;
+    if (*end == '-') {
+        last = strtoul(end + 1, &end, 10);
+    }
+    if (end == text || *end != '\0' || first > last || last > 0xFFFF) {
+        return false;
+    }
+    low = (uint16_t)first;
+    high = (uint16_t)last;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// RuleSet
+
+void AdvFilter::RuleSet::clear() {
+    ouiCount = 0;
+    uuidCount = 0;
+    memset(ouiFirstByte, 0, sizeof(ouiFirstByte));
+    memset(uuidFirstByte, 0, sizeof(uuidFirstByte));
+}
+
+// Tri par insertion (quelques règles) et masques du premier octet
+void AdvFilter::RuleSet::compile() {
+    for (size_t i = 1; i < ouiCount; i++) {
+        uint32_t value = ouis[i];
+        size_t j = i;
+        for (; j > 0 && ouis[j - 1] > value; j--) {
+            ouis[j] = ouis[j - 1];
+        }
+        ouis[j] = value;
+    }
+    for (size_t i = 1; i < uuidCount; i++) {
+        UuidRule rule = uuids[i];
+        size_t j = i;
+        for (; j > 0 && memcmp(uuids[j - 1].uuid, rule.uuid, 16) > 0; j--) {
+            uuids[j] = uuids[j - 1];
+        }
+        uuids[j] = rule;
+    }
+
+    memset(ouiFirstByte, 0, sizeof(ouiFirstByte));
+    memset(uuidFirstByte, 0, sizeof(uuidFirstByte));
+    for (size_t i = 0; i < ouiCount; i++) {
+        uint8_t first = ouis[i] >> 16;
+        ouiFirstByte[first >> 5] |= 1u << (first & 31);
+    }
+    for (size_t i = 0; i < uuidCount; i++) {
+        uint8_t first = uuids[i].uuid[0];
+        uuidFirstByte[first >> 5] |= 1u << (first & 31);
+    }
+}
+
+bool AdvFilter::RuleSet::matchOui(const uint8_t address[6]) const {
+    if (ouiCount == 0 || !testBit(ouiFirstByte, address[0])) {
+        return false;
+    }
+    uint32_t oui = ouiOf(address);
+    size_t low = 0, high = ouiCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (ouis[middle] < oui) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < ouiCount && ouis[low] == oui;
+}
+
+bool AdvFilter::RuleSet::matchUuid(const ParsedAdvertisement& adv) const {
+    if (uuidCount == 0 || (adv.frameType != FRAME_IBEACON && adv.frameType != FRAME_ALTBEACON &&
+                           adv.frameType != FRAME_EDDYSTONE_UID)) {
+        return false;
+    }
+    if (!testBit(uuidFirstByte, adv.beaconUUID[0])) {
+        return false;
+    }
+    // Première règle de cet UUID, puis ses plages une à une
+    size_t low = 0, high = uuidCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (memcmp(uuids[middle].uuid, adv.beaconUUID, 16) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    bool hasMajorMinor = adv.frameType != FRAME_EDDYSTONE_UID;
+    for (size_t i = low; i < uuidCount && memcmp(uuids[i].uuid, adv.beaconUUID, 16) == 0; i++) {
+        const UuidRule& rule = uuids[i];
+        if (hasMajorMinor) {
+            if (adv.major >= rule.majorMin && adv.major <= rule.majorMax && adv.minor >= rule.minorMin &&
+                adv.minor <= rule.minorMax) {
+                return true;
+            }
+        } else if (rule.majorMin == 0 && rule.majorMax == 0xFFFF && rule.minorMin == 0 && rule.minorMax == 0xFFFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// AdvFilter
+
+AdvFilter::AdvFilter() {
+    clear();
+}
+
+void AdvFilter::clear() {
+    allowRules.clear();
+    denyRules.clear();
+    rssiFloor = -128;
+    active = false;
+}
+
+bool AdvFilter::parse(const char* text, char* error, size_t errorSize) {
+    AdvFilter result;
+    int lineNumber = 0;
+
+    while (*text) {
+        const char* end = strchr(text, '\n');
+        size_t length = end ? (size_t)(end - text) : strlen(text);
+        char line[160];
+        lineNumber++;
+        if (length >= sizeof(line)) {
+            snprintf(error, errorSize, "ligne %d : trop longue", lineNumber);
+            return false;
+        }
+        memcpy(line, text, length);
+        line[length] = '\0';
+        text += length + (end ? 1 : 0);
+
+        char* comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        char* save = nullptr;
+        char* word = strtok_r(line, " \t\r", &save);
+        if (!word) {
+            continue;
+        }
+
+        if (strcmp(word, "rssi-floor") == 0) {
+            char* value = strtok_r(nullptr, " \t\r", &save);
+            char* last = nullptr;
+            long floor = value ? strtol(value, &last, 10) : 0;
+            if (!value || *last != '\0' || floor < -128 || floor > 0) {
+                snprintf(error, errorSize, "ligne %d : seuil de RSSI invalide", lineNumber);
+                return false;
+            }
+            result.rssiFloor = (int16_t)floor;
+            result.active = true;
+            continue;
+        }
+
+        bool allow = strcmp(word, "allow") == 0;
+        if (!allow && strcmp(word, "deny") != 0) {
+            snprintf(error, errorSize, "ligne %d : \"%s\" inconnu", lineNumber, word);
+            return false;
+        }
+        RuleSet& rules = allow ? result.allowRules : result.denyRules;
+        char* kind = strtok_r(nullptr, " \t\r", &save);
+        char* value = strtok_r(nullptr, " \t\r", &save);
+        if (!kind || !value) {
+            snprintf(error, errorSize, "ligne %d : règle incomplète", lineNumber);
+            return false;
+        }
+
+        if (strcmp(kind, "oui") == 0) {
+            uint8_t oui[3];
+            if (!parseHexBytes(value, oui, sizeof(oui))) {
+                snprintf(error, errorSize, "ligne %d : préfixe OUI invalide", lineNumber);
+                return false;
+            }
+            if (rules.ouiCount == ADV_FILTER_MAX_RULES) {
+                snprintf(error, errorSize, "ligne %d : plus de %d préfixes", lineNumber, ADV_FILTER_MAX_RULES);
+                return false;
+            }
+            rules.ouis[rules.ouiCount++] = ouiOf(oui);
+        } else if (strcmp(kind, "uuid") == 0) {
+            UuidRule rule = {{0}, 0, 0xFFFF, 0, 0xFFFF};
+            if (!parseHexBytes(value, rule.uuid, sizeof(rule.uuid))) {
+                snprintf(error, errorSize, "ligne %d : UUID invalide", lineNumber);
+                return false;
+            }
+            char* field;
+            while ((field = strtok_r(nullptr, " \t\r", &save)) != nullptr) {
+                char* range = strtok_r(nullptr, " \t\r", &save);
+                bool valid = range && (strcmp(field, "major") == 0 ? parseRange(range, rule.majorMin, rule.majorMax)
+                                       : strcmp(field, "minor") == 0 ? parseRange(range, rule.minorMin, rule.minorMax)
+                                       : false);
+                if (!valid) {
+                    snprintf(error, errorSize, "ligne %d : plage major/minor invalide", lineNumber);
+                    return false;
+                }
+            }
+            if (rules.uuidCount == ADV_FILTER_MAX_RULES) {
+                snprintf(error, errorSize, "ligne %d : plus de %d UUID", lineNumber, ADV_FILTER_MAX_RULES);
+                return false;
+            }
+            rules.uuids[rules.uuidCount++] = rule;
+        } else {
+            snprintf(error, errorSize, "ligne %d : \"%s\" inconnu (uuid ou oui)", lineNumber, kind);
+            return false;
+        }
+        result.active = true;
+    }
+
+    result.allowRules.compile();
+    result.denyRules.compile();
+    *this = result;
+    return true;
+}
+
+AdvFilterVerdict AdvFilter::checkAddress(const AdvRecord& record) const {
+    if (record.rssi < rssiFloor || denyRules.matchOui(record.address)) {
+        return FILTER_REJECT;
+    }
+    if (allowRules.ouiCount + allowRules.uuidCount == 0 || allowRules.matchOui(record.address)) {
+        return FILTER_ADDRESS_ALLOWED;
+    }
+    return allowRules.uuidCount > 0 ? FILTER_CHECK_FRAME : FILTER_REJECT;
+}
+
+bool AdvFilter::checkFrame(const ParsedAdvertisement& adv, AdvFilterVerdict verdict) const {
+    if (verdict == FILTER_REJECT || denyRules.matchUuid(adv)) {
+        return false;
+    }
+    return verdict == FILTER_ADDRESS_ALLOWED || allowRules.matchUuid(adv);
+}
@@ -0,0 +1,92 @@
+#ifndef ADV_FILTER_H
+#define ADV_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AdvParser.h"
+#include "AdvRecord.h"
+
+// Règles par liste (autorisées ou refusées, UUID ou préfixe OUI)
+#ifndef ADV_FILTER_MAX_RULES
+#define ADV_FILTER_MAX_RULES 16
+#endif
+
+// Taille maximale du texte de configuration (corps de POST /filter, NVS)
+#ifndef ADV_FILTER_TEXT_MAX
+#define ADV_FILTER_TEXT_MAX 1536
+#endif
+
+// Verdict de la première étape, avant décodage de l'annonce
+enum AdvFilterVerdict : uint8_t {
+    FILTER_REJECT,          // Sous le seuil de RSSI ou préfixe refusé
+    FILTER_ADDRESS_ALLOWED, // Préfixe autorisé : reste à vérifier les UUID refusés
+    FILTER_CHECK_FRAME      // Décider sur la trame décodée
+};
+
+// Filtre des annonces par liste d'autorisation et de refus, appliqué avant
+// toute création d'état pour l'appareil. Configuration texte, une règle par
+// ligne ('#' : commentaire) :
+//
+//   rssi-floor -90
+//   allow uuid E2E3E4E5-E6E7-E8E9-EAEB-ECEDEEEFF0F1 major 1-2 minor 0-99
+//   allow oui D0:5E:00
+//   deny uuid 8B8C8D8E8F9091929394000000000007
+//   deny oui 00:1A:7D
+//
+// Une règle uuid vise l'UUID iBeacon/AltBeacon ou l'identifiant
+// Eddystone-UID (namespace + instance) ; ses plages major/minor (défaut :
+// toutes) ne s'appliquent qu'aux deux premiers. Une annonce est refusée si
+// une règle deny la vise ; sinon, s'il y a des règles allow, elle doit en
+// vérifier une. Les trames sans UUID (Eddystone-URL/TLM, appareils
+// nommés) ne passent une liste allow que par leur préfixe OUI.
+//
+// Les règles sont compilées en tableaux triés (recherche dichotomique),
+// précédés d'un masque de 256 bits sur le premier octet : la plupart des
+// annonces étrangères sont écartées sur ce seul test.
+class AdvFilter {
+private:
+    struct UuidRule {
+        uint8_t uuid[16];
+        uint16_t majorMin, majorMax;
+        uint16_t minorMin, minorMax;
+    };
+
+    struct RuleSet {
+        uint32_t ouis[ADV_FILTER_MAX_RULES];     // Préfixes 0xAABBCC, triés
+        UuidRule uuids[ADV_FILTER_MAX_RULES];    // Triés par UUID
+        uint8_t ouiCount;
+        uint8_t uuidCount;
+        uint32_t ouiFirstByte[8];                // Masques sur le premier octet
+        uint32_t uuidFirstByte[8];
+
+        void clear();
+        bool matchOui(const uint8_t address[6]) const;
+        bool matchUuid(const ParsedAdvertisement& adv) const;
+        void compile();
+    };
+
+    RuleSet allowRules;
+    RuleSet denyRules;
+    int16_t rssiFloor;     // -128 : aucun seuil
+    bool active;
+
+public:
+    AdvFilter();
+
+    // Aucune règle : tout passe
+    void clear();
+
+    // Remplace les règles par celles du texte. En cas d'erreur, le filtre
+    // n'est pas modifié et error décrit la ligne fautive.
+    bool parse(const char* text, char* error, size_t errorSize);
+
+    bool isActive() const { return active; }
+
+    // Première étape, sur l'annonce brute : seuil de RSSI et préfixes OUI
+    AdvFilterVerdict checkAddress(const AdvRecord& record) const;
+
+    // Seconde étape, sur la trame décodée
+    bool checkFrame(const ParsedAdvertisement& adv, AdvFilterVerdict verdict) const;
+};
+
+#endif
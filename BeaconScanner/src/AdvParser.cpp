@@ -0,0 +1,201 @@
+#include "AdvParser.h"
+#include <string.h>
+
+// UUID de base Bluetooth : 00000000-0000-1000-8000-00805F9B34FB
+static const uint8_t BASE_UUID[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB
+};
+
+static const uint16_t EDDYSTONE_SERVICE = 0xFEAA;
+
+static inline uint16_t readBE16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t readBE32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Données fabricant : iBeacon (Apple) ou AltBeacon
+static void parseManufacturerData(const uint8_t* data, uint8_t length, ParsedAdvertisement& out) {
+    // iBeacon : 4C 00 | 02 15 | UUID (16) | major (2) | minor (2) | puissance (1)
+    if (length == 25 && data[0] == 0x4C && data[1] == 0x00 && data[2] == 0x02 && data[3] == 0x15) {
+        out.frameType = FRAME_IBEACON;
+        memcpy(out.beaconUUID, data + 4, 16);
+        out.major = readBE16(data + 20);
+        out.minor = readBE16(data + 22);
+        out.txPower = (int8_t)data[24];
+        return;
+    }
+
+    // AltBeacon : fabricant (2, LE) | BE AC | ID (20) | RSSI de référence (1) | réservé (1)
+    if (length == 26 && data[2] == 0xBE && data[3] == 0xAC) {
+        out.frameType = FRAME_ALTBEACON;
+        out.manufacturerId = (uint16_t)(data[0] | (data[1] << 8));
+        memcpy(out.beaconUUID, data + 4, 16);
+        out.major = readBE16(data + 20);
+        out.minor = readBE16(data + 22);
+        out.txPower = (int8_t)data[24];
+    }
+}
+
+// Données de service Eddystone (UUID 0xFEAA déjà retiré)
+static void parseEddystone(const uint8_t* data, uint8_t length, ParsedAdvertisement& out) {
+    if (length < 2) {
+        return;
+    }
+
+    switch (data[0]) {
+    case 0x00: // UID : puissance (1) | namespace (10) | instance (6) | réservé (2, optionnel)
+        if (length >= 18) {
+            out.frameType = FRAME_EDDYSTONE_UID;
+            out.txPower = (int8_t)data[1];
+            memcpy(out.beaconUUID, data + 2, 16);
+        }
+        break;
+
+    case 0x10: // URL : puissance (1) | schéma (1) | URL encodée (1 à 17)
+        if (length >= 4 && length <= 20) {
+            out.frameType = FRAME_EDDYSTONE_URL;
+            out.txPower = (int8_t)data[1];
+            out.urlScheme = data[2];
+            out.url = data + 3;
+            out.urlLength = length - 3;
+        }
+        break;
+
+    case 0x20: // TLM version 0 : batterie (2) | température (2) | compteur (4) | durée (4)
+        if (length >= 14 && data[1] == 0x00) {
+            out.frameType = FRAME_EDDYSTONE_TLM;
+            out.batteryMillivolts = readBE16(data + 2);
+            out.temperature = (int16_t)readBE16(data + 4);
+            out.advertisementCount = readBE32(data + 6);
+            out.uptimeTenths = readBE32(data + 10);
+        }
+        break;
+    }
+}
+
+// Premier UUID de service de la liste, étendu sur 128 bits en ordre réseau
+static void parseServiceUUID(uint8_t type, const uint8_t* data, uint8_t length, ParsedAdvertisement& out) {
+    if (out.hasServiceUUID) {
+        return;
+    }
+
+    switch (type) {
+    case AD_TYPE_UUID16_PARTIAL:
+    case AD_TYPE_UUID16_COMPLETE:
+        if (length < 2) return;
+        memcpy(out.serviceUUID, BASE_UUID, 16);
+        out.serviceUUID[2] = data[1];
+        out.serviceUUID[3] = data[0];
+        break;
+
+    case AD_TYPE_UUID32_PARTIAL:
+    case AD_TYPE_UUID32_COMPLETE:
+        if (length < 4) return;
+        memcpy(out.serviceUUID, BASE_UUID, 16);
+        for (int i = 0; i < 4; i++) {
+            out.serviceUUID[i] = data[3 - i];
+        }
+        break;
+
+    default: // 128 bits, transmis en little-endian
+        if (length < 16) return;
+        for (int i = 0; i < 16; i++) {
+            out.serviceUUID[i] = data[15 - i];
+        }
+        break;
+    }
+    out.hasServiceUUID = true;
+}
+
+bool parseAdvertisement(const uint8_t* payload, size_t length, ParsedAdvertisement& out) {
+    memset(&out, 0, sizeof(out));
+
+    size_t pos = 0;
+    while (pos < length) {
+        uint8_t fieldLength = payload[pos];
+        if (fieldLength == 0) {
+            // Remplissage en fin d'annonce
+            return true;
+        }
+        if (pos + 1 + fieldLength > length) {
+            return false;
+        }
+
+        uint8_t type = payload[pos + 1];
+        const uint8_t* data = payload + pos + 2;
+        uint8_t dataLength = fieldLength - 1;
+
+        switch (type) {
+        case AD_TYPE_NAME_COMPLETE:
+        case AD_TYPE_NAME_SHORT:
+            // Le nom complet a priorité sur le nom abrégé
+            if (out.name == nullptr || type == AD_TYPE_NAME_COMPLETE) {
+                out.name = data;
+                out.nameLength = dataLength;
+            }
+            break;
+
+        case AD_TYPE_UUID16_PARTIAL:
+        case AD_TYPE_UUID16_COMPLETE:
+        case AD_TYPE_UUID32_PARTIAL:
+        case AD_TYPE_UUID32_COMPLETE:
+        case AD_TYPE_UUID128_PARTIAL:
+        case AD_TYPE_UUID128_COMPLETE:
+            parseServiceUUID(type, data, dataLength, out);
+            break;
+
+        case AD_TYPE_SERVICE_DATA16:
+            if (dataLength >= 2 && (uint16_t)(data[0] | (data[1] << 8)) == EDDYSTONE_SERVICE) {
+                parseEddystone(data + 2, dataLength - 2, out);
+            }
+            break;
+
+        case AD_TYPE_MANUFACTURER:
+            parseManufacturerData(data, dataLength, out);
+            break;
+        }
+
+        pos += 1 + fieldLength;
+    }
+    return true;
+}
+
+size_t formatEddystoneUrl(const ParsedAdvertisement& adv, char* out, size_t outSize) {
+    static const char* const SCHEMES[] = { "http://www.", "https://www.", "http://", "https://" };
+    static const char* const EXPANSIONS[] = {
+        ".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+        ".com", ".org", ".edu", ".net", ".info", ".biz", ".gov"
+    };
+
+    if (outSize == 0) {
+        return 0;
+    }
+
+    size_t written = 0;
+    auto append = [&](const char* text, size_t count) {
+        for (size_t i = 0; i < count && written + 1 < outSize; i++) {
+            out[written++] = text[i];
+        }
+    };
+
+    if (adv.frameType == FRAME_EDDYSTONE_URL) {
+        if (adv.urlScheme < 4) {
+            append(SCHEMES[adv.urlScheme], strlen(SCHEMES[adv.urlScheme]));
+        }
+        for (uint8_t i = 0; i < adv.urlLength; i++) {
+            uint8_t c = adv.url[i];
+            if (c < 14) {
+                append(EXPANSIONS[c], strlen(EXPANSIONS[c]));
+            } else if (c > 0x20 && c < 0x7F) {
+                append((const char*)&adv.url[i], 1);
+            }
+        }
+    }
+
+    out[written] = '\0';
+    return written;
+}
@@ -0,0 +1,69 @@
+#ifndef ADV_PARSER_H
+#define ADV_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Types de champs AD utilisés par le scanner (Bluetooth Core Spec Supplement)
+#define AD_TYPE_UUID16_PARTIAL   0x02
+#define AD_TYPE_UUID16_COMPLETE  0x03
+#define AD_TYPE_UUID32_PARTIAL   0x04
+#define AD_TYPE_UUID32_COMPLETE  0x05
+#define AD_TYPE_UUID128_PARTIAL  0x06
+#define AD_TYPE_UUID128_COMPLETE 0x07
+#define AD_TYPE_NAME_SHORT       0x08
+#define AD_TYPE_NAME_COMPLETE    0x09
+#define AD_TYPE_SERVICE_DATA16   0x16
+#define AD_TYPE_MANUFACTURER     0xFF
+
+// Formats de trame beacon reconnus
+enum BeaconFrameType : uint8_t {
+    FRAME_NONE = 0,
+    FRAME_IBEACON,
+    FRAME_ALTBEACON,
+    FRAME_EDDYSTONE_UID,
+    FRAME_EDDYSTONE_URL,
+    FRAME_EDDYSTONE_TLM
+};
+
+// Résultat du décodage d'une annonce. Structure de taille fixe : le nom et
+// l'URL Eddystone pointent directement dans l'annonce brute (vue, pas de
+// copie), ils ne sont valides que tant que le tampon source existe.
+struct ParsedAdvertisement {
+    // Champs génériques
+    const uint8_t* name;          // Non terminé par '\0'
+    uint8_t nameLength;
+    uint8_t serviceUUID[16];      // Premier UUID de service, étendu sur 128 bits (ordre réseau)
+    bool hasServiceUUID;
+
+    // Trame beacon
+    BeaconFrameType frameType;
+    uint8_t beaconUUID[16];       // iBeacon/AltBeacon : UUID ; Eddystone-UID : namespace (10) + instance (6)
+    uint16_t major;
+    uint16_t minor;
+    int8_t txPower;               // Puissance mesurée à 1 m (0 m pour Eddystone)
+    uint16_t manufacturerId;      // AltBeacon uniquement
+
+    // Eddystone-URL (encodée : préfixe de schéma + octets compressés)
+    uint8_t urlScheme;
+    const uint8_t* url;
+    uint8_t urlLength;
+
+    // Eddystone-TLM (non chiffrée)
+    uint16_t batteryMillivolts;
+    int16_t temperature;          // Virgule fixe 8.8, en °C
+    uint32_t advertisementCount;
+    uint32_t uptimeTenths;        // Dixièmes de seconde depuis la mise sous tension
+};
+
+// Décode en une seule passe les champs AD d'une annonce brute, sans
+// allocation. Toutes les longueurs sont vérifiées ; retourne false si la
+// structure AD est tronquée ou incohérente (les champs déjà décodés
+// restent renseignés).
+bool parseAdvertisement(const uint8_t* payload, size_t length, ParsedAdvertisement& out);
+
+// Reconstruit l'URL Eddystone en texte. Retourne la longueur écrite (hors
+// '\0'), tronquée à outSize - 1.
+size_t formatEddystoneUrl(const ParsedAdvertisement& adv, char* out, size_t outSize);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ADV_RECORD_H
+#define ADV_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Taille maximale d'une annonce BLE legacy + réponse de scan (2 x 31 octets)
+#define ADV_MAX_PAYLOAD 62
+
+// Enregistrement compact de taille fixe copié par le callback BLE dans la
+// file circulaire. Aucune allocation : l'annonce brute est conservée telle
+// quelle et décodée plus tard par le consommateur.
+struct AdvRecord {
+    uint8_t address[6];               // Adresse MAC (ordre d'affichage)
+    int8_t rssi;
+    uint8_t payloadLength;
+    uint32_t timestamp;               // millis() à la réception
+    uint8_t payload[ADV_MAX_PAYLOAD]; // Champs AD bruts (longueur, type, données)
+};
+
+// Ordre des octets de l'adresse remise par la pile Bluetooth : Bluedroid
+// la donne dans l'ordre d'affichage, NimBLE octet de poids faible en tête
+enum AdvAddressOrder {
+    ADV_ADDRESS_DISPLAY_ORDER,
+    ADV_ADDRESS_LSB_FIRST
+};
+
+// Remplit record à partir de ce que remet la pile (callbacks onResult de
+// HalEsp32.cpp), en tronquant l'annonce à ADV_MAX_PAYLOAD
+inline void fillAdvRecord(AdvRecord& record, const uint8_t* address, AdvAddressOrder order, int rssi,
+                          const uint8_t* payload, size_t length, uint32_t timestamp) {
+    for (size_t i = 0; i < sizeof(record.address); i++) {
+        record.address[i] = order == ADV_ADDRESS_LSB_FIRST ? address[sizeof(record.address) - 1 - i] : address[i];
+    }
+    record.rssi = (int8_t)rssi;
+    record.timestamp = timestamp;
+    if (length > ADV_MAX_PAYLOAD) {
+        length = ADV_MAX_PAYLOAD;
+    }
+    record.payloadLength = (uint8_t)length;
+    memcpy(record.payload, payload, length);
+}
+
+#endif
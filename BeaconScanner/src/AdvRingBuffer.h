@@ -0,0 +1,81 @@
+#ifndef ADV_RING_BUFFER_H
+#define ADV_RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// File circulaire lock-free mono-producteur / mono-consommateur.
+// Le producteur (callback BLE) n'écrit que head, le consommateur (tâche de
+// suivi) n'écrit que tail : une case n'est jamais lue et écrite en même
+// temps. Quand la file est pleine, le nouvel enregistrement est refusé et
+// compté (dropped) ; écraser le plus ancien obligerait le producteur à
+// avancer tail, et le consommateur pourrait lire une case en cours
+// d'écriture.
+// Capacity doit être une puissance de deux.
+template <typename T, size_t Capacity>
+class AdvRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity doit être une puissance de deux");
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    T slots[Capacity];
+    std::atomic<size_t> head;     // Prochaine case à écrire (producteur)
+    std::atomic<size_t> tail;     // Prochaine case à lire (consommateur)
+    std::atomic<uint32_t> dropped; // Enregistrements refusés car file pleine
+    std::atomic<uint32_t> pushed;  // Enregistrements acceptés depuis le démarrage
+
+public:
+    AdvRingBuffer() : head(0), tail(0), dropped(0), pushed(0) {}
+
+    // Côté producteur : copie l'enregistrement, ou le refuse si la file est
+    // pleine (retourne alors false)
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & MASK] = item;
+        head.store(h + 1, std::memory_order_release);
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Côté consommateur : retire au plus maxCount enregistrements d'un coup
+    size_t popBatch(T* out, size_t maxCount) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - t;
+        size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = slots[(t + i) & MASK];
+        }
+        // Les cases lues ne sont rendues au producteur qu'après la copie
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    bool pop(T& out) {
+        return popBatch(&out, 1) == 1;
+    }
+
+    // Côté consommateur : abandonne tout ce qui est en file, sans copie
+    size_t discard() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        tail.store(h, std::memory_order_release);
+        return h - t;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+    uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint32_t pushedCount() const { return pushed.load(std::memory_order_relaxed); }
+};
+
+#endif
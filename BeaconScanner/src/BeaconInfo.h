@@ -0,0 +1,70 @@
+#ifndef BEACON_INFO_H
+#define BEACON_INFO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BEACON_NAME_MAX 20  // Caractères conservés du nom annoncé
+#define BEACON_UUID_TEXT 37 // "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" + '\0'
+#define BEACON_ID_TEXT 56   // Adresse MAC + '_' + UUID de proximité + '\0'
+
+// Informations d'un beacon : structure POD de taille fixe, sans String,
+// pour pouvoir être stockée dans une table préallouée.
+struct BeaconInfo {
+    uint8_t address[6];           // Adresse MAC brute
+    char name[BEACON_NAME_MAX + 1];
+    char uuid[BEACON_UUID_TEXT];  // UUID de service annoncé ou "N/A"
+    int8_t rssi;
+    uint32_t lastSeen;
+    bool isPresent;
+
+    // Informations de trame beacon (voir AdvParser.h)
+    uint8_t frameType;            // BeaconFrameType de la dernière trame d'identification
+    bool isIBeacon;               // L'UUID de proximité fait alors partie de la clé
+    uint8_t proximityUUID[16];    // Octets bruts, ordre réseau (iBeacon, AltBeacon, Eddystone-UID)
+    uint16_t major;
+    uint16_t minor;
+    int8_t txPower;
+
+    // Filtre de présence (voir Presence.h)
+    bool dwelling;                // Condition d'entrée ou de sortie en cours
+    uint32_t dwellSince;          // Début de cette condition
+    float rssiFiltered;           // Estimation lissée du RSSI (dBm)
+    float rssiVariance;           // Incertitude de l'estimation (dB²)
+    float flapPenalty;            // Arrivées et départs récents, amortis
+    uint32_t flapUpdated;         // Instant de la dernière mise à jour de flapPenalty
+
+    // Suivi des modifications pour GET /beacons?since= (voir BeaconTracker.h)
+    uint32_t changeSeq;           // Numéro de la dernière modification signalée
+    int8_t rssiReported;          // RSSI lissé à cette modification
+};
+
+// Formate 16 octets d'UUID (ordre réseau) en texte canonique
+inline void formatUUID(const uint8_t* uuid, char* out) {
+    snprintf(out, BEACON_UUID_TEXT,
+             "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+             uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+             uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+}
+
+// Construit l'identifiant texte d'un beacon : "aa:bb:cc:dd:ee:ff" suivi de
+// "_<uuid>" pour un iBeacon. N'est appelé que lors d'un événement.
+inline void formatBeaconId(const BeaconInfo& beacon, char* out) {
+    const uint8_t* a = beacon.address;
+    int length = snprintf(out, BEACON_ID_TEXT, "%02x:%02x:%02x:%02x:%02x:%02x",
+                          a[0], a[1], a[2], a[3], a[4], a[5]);
+    if (beacon.isIBeacon) {
+        out[length] = '_';
+        formatUUID(beacon.proximityUUID, out + length + 1);
+    }
+}
+
+// Même clé que la table des beacons : adresse, plus l'UUID pour un iBeacon
+inline bool sameBeacon(const BeaconInfo& a, const BeaconInfo& b) {
+    return memcmp(a.address, b.address, sizeof(a.address)) == 0 && a.isIBeacon == b.isIBeacon &&
+           (!a.isIBeacon || memcmp(a.proximityUUID, b.proximityUUID, sizeof(a.proximityUUID)) == 0);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "BeaconStream.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "AdvParser.h"
+#include "Hal.h"
+
+static const char* const frameNames[] = {
+    nullptr, "iBeacon", "AltBeacon", "Eddystone-UID", "Eddystone-URL", "Eddystone-TLM"
+};
+
+// Tampon de sortie : vidé vers write dès qu'une entrée n'y tient plus
+class StreamBuffer {
+private:
+    char text[BEACON_STREAM_BUFFER];
+    size_t length;
+    BeaconStreamWriter write;
+
+public:
+    explicit StreamBuffer(BeaconStreamWriter write) : length(0), write(write) {}
+
+    void flush() {
+        if (length > 0) {
+            write(text, length);
+            length = 0;
+        }
+    }
+
+    void append(const char* data, size_t size) {
+        if (length + size > sizeof(text)) {
+            flush();
+        }
+        memcpy(text + length, data, size);
+        length += size;
+    }
+
+    void format(const char* pattern, ...) {
+        char line[128];
+        va_list args;
+        va_start(args, pattern);
+        int size = vsnprintf(line, sizeof(line), pattern, args);
+        va_end(args);
+        append(line, size < (int)sizeof(line) ? (size_t)size : sizeof(line) - 1);
+    }
+};
+
+// Chaîne JSON : le nom annoncé peut contenir guillemets et octets de contrôle
+static void appendString(StreamBuffer& out, const char* value) {
+    char quoted[2 + 6 * BEACON_NAME_MAX + 16];
+    size_t length = 0;
+    quoted[length++] = '"';
+    for (const char* p = value; *p && length < sizeof(quoted) - 7; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            quoted[length++] = '\\';
+            quoted[length++] = (char)c;
+        } else if (c < 0x20) {
+            length += snprintf(quoted + length, 7, "\\u%04x", c);
+        } else {
+            quoted[length++] = (char)c;
+        }
+    }
+    quoted[length++] = '"';
+    out.append(quoted, length);
+}
+
+static void appendChange(StreamBuffer& out, const BeaconChange& change, uint32_t now) {
+    const BeaconInfo& beacon = change.info;
+    char beaconId[BEACON_ID_TEXT];
+    formatBeaconId(beacon, beaconId);
+    out.format("{\"beaconId\":\"%s\"", beaconId);
+
+    if (change.removed) {
+        out.format(",\"status\":\"removed\",\"seq\":%lu}", (unsigned long)beacon.changeSeq);
+        return;
+    }
+    out.append(",\"name\":", 8);
+    appendString(out, beacon.name);
+    out.format(",\"uuid\":\"%s\"", beacon.uuid);
+    if (beacon.frameType != FRAME_NONE && beacon.frameType < sizeof(frameNames) / sizeof(frameNames[0])) {
+        out.format(",\"frame\":\"%s\"", frameNames[beacon.frameType]);
+        if (beacon.frameType == FRAME_IBEACON || beacon.frameType == FRAME_ALTBEACON) {
+            out.format(",\"major\":%u,\"minor\":%u", beacon.major, beacon.minor);
+        }
+    }
+    out.format(",\"rssi\":%d,\"status\":\"%s\",\"age\":%lu,\"seq\":%lu}", (int)lroundf(beacon.rssiFiltered),
+               beacon.isPresent ? "present" : "absent", (unsigned long)(now - beacon.lastSeen),
+               (unsigned long)beacon.changeSeq);
+}
+
+int streamBeacons(BeaconTracker& tracker, uint32_t since, BeaconStreamWriter write) {
+    // Une seule requête à la fois (tâche du serveur web) : pas sur la pile
+    static BeaconChange changes[BEACON_STREAM_CHUNK];
+    BeaconChangeCursor cursor = {since, 0, 0, false};
+
+    int count = tracker.readChanges(cursor, changes, BEACON_STREAM_CHUNK);
+    if (count < 0) {
+        return -1;
+    }
+
+    StreamBuffer out(write);
+    out.format("{\"seq\":%lu,\"reset\":%s,\"beacons\":[", (unsigned long)cursor.seq, cursor.reset ? "true" : "false");
+    int total = 0;
+    bool complete = true;
+    for (;;) {
+        uint32_t now = halMillis();
+        for (int i = 0; i < count; i++) {
+            if (total++ > 0) {
+                out.append(",\n", 2);
+            } else {
+                out.append("\n", 1);
+            }
+            appendChange(out, changes[i], now);
+        }
+        if (count < BEACON_STREAM_CHUNK) {
+            break;
+        }
+        // Ce morceau part avant la lecture du suivant
+        out.flush();
+        count = tracker.readChanges(cursor, changes, BEACON_STREAM_CHUNK);
+        if (count < 0) {
+            complete = false;
+            break;
+        }
+    }
+    out.format("\n],\"complete\":%s}", complete ? "true" : "false");
+    out.flush();
+    return total;
+}
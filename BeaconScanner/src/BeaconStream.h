@@ -0,0 +1,39 @@
+#ifndef BEACON_STREAM_H
+#define BEACON_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BeaconTracker.h"
+
+// Entrées copiées par la tâche de suivi à chaque lecture
+#ifndef BEACON_STREAM_CHUNK
+#define BEACON_STREAM_CHUNK 32
+#endif
+
+// Texte accumulé avant chaque écriture (octets)
+#ifndef BEACON_STREAM_BUFFER
+#define BEACON_STREAM_BUFFER 1024
+#endif
+
+// Reçoit chaque morceau du corps de la réponse
+typedef void (*BeaconStreamWriter)(const char* data, size_t length);
+
+// Corps de GET /beacons?since=<seq> : la table de présence, ou seulement ce
+// qui a changé après le numéro since, écrit par morceaux d'au plus
+// BEACON_STREAM_BUFFER octets, sans String ni allocation :
+//
+//   {"seq":812,"reset":false,"beacons":[
+//   {"beaconId":"aa:bb:cc:dd:ee:ff","name":"Tag","uuid":"N/A","frame":"iBeacon",
+//    "major":1,"minor":2,"rssi":-67,"status":"present","age":420,"seq":809},
+//   {"beaconId":"11:22:33:44:55:66","status":"removed","seq":811}
+//   ],"complete":true}
+//
+// Le client repasse seq à la requête suivante. reset : instantané complet
+// (premier appel, redémarrage ou client trop en retard), l'état local est
+// à remplacer. complete vaut false si la tâche de suivi n'a plus répondu
+// en cours de route : la liste est partielle, seq reste valable.
+// Retourne le nombre d'entrées écrites, ou -1 (rien n'est écrit) si la
+// tâche de suivi n'a pas répondu à la première lecture.
+int streamBeacons(BeaconTracker& tracker, uint32_t since, BeaconStreamWriter write);
+
+#endif
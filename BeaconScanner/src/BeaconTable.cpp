@@ -0,0 +1,282 @@
+#include "BeaconTable.h"
+#include <string.h>
+
+BeaconTable::BeaconTable() {
+    clear();
+}
+
+void BeaconTable::clear() {
+    for (size_t i = 0; i < INDEX_SIZE; i++) {
+        index[i] = NONE;
+    }
+    // Chaîner toutes les entrées dans la liste libre
+    for (size_t i = 0; i < BEACON_TABLE_CAPACITY; i++) {
+        entries[i].used = false;
+        entries[i].scheduled = false;
+        entries[i].prev = NONE;
+        entries[i].next = (i + 1 < BEACON_TABLE_CAPACITY) ? (uint16_t)(i + 1) : NONE;
+    }
+    freeHead = 0;
+    lruHead = NONE;
+    lruTail = NONE;
+    count = 0;
+    evictions = 0;
+    for (size_t i = 0; i < 2 * TIMER_WHEEL_SLOTS; i++) {
+        wheel[i] = NONE;
+    }
+    wheelTick = 0;
+    wheelTime = 0;
+}
+
+uint32_t BeaconTable::hashKey(const uint8_t* address, const uint8_t* proximityUUID) {
+    // Adresse MAC sur 48 bits, mélangée par le finaliseur de MurmurHash3
+    uint64_t h = 0;
+    for (int i = 0; i < 6; i++) {
+        h = (h << 8) | address[i];
+    }
+    if (proximityUUID) {
+        for (int i = 0; i < 16; i += 8) {
+            uint64_t word;
+            memcpy(&word, proximityUUID + i, sizeof(word));
+            h ^= word + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        }
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+bool BeaconTable::keyEquals(const BeaconInfo& info, const uint8_t* address, const uint8_t* proximityUUID) {
+    if (memcmp(info.address, address, sizeof(info.address)) != 0) {
+        return false;
+    }
+    if (proximityUUID == nullptr) {
+        return !info.isIBeacon;
+    }
+    return info.isIBeacon && memcmp(info.proximityUUID, proximityUUID, sizeof(info.proximityUUID)) == 0;
+}
+
+// Retourne la case contenant la clé, ou la première case vide rencontrée
+size_t BeaconTable::findSlot(uint32_t hash, const uint8_t* address, const uint8_t* proximityUUID) const {
+    size_t slot = hash & (INDEX_SIZE - 1);
+    while (index[slot] != NONE) {
+        const Entry& entry = entries[index[slot]];
+        if (entry.hash == hash && keyEquals(entry.info, address, proximityUUID)) {
+            return slot;
+        }
+        slot = (slot + 1) & (INDEX_SIZE - 1);
+    }
+    return slot;
+}
+
+void BeaconTable::unlink(uint16_t id) {
+    Entry& entry = entries[id];
+    if (entry.prev != NONE) {
+        entries[entry.prev].next = entry.next;
+    } else {
+        lruHead = entry.next;
+    }
+    if (entry.next != NONE) {
+        entries[entry.next].prev = entry.prev;
+    } else {
+        lruTail = entry.prev;
+    }
+}
+
+void BeaconTable::pushFront(uint16_t id) {
+    Entry& entry = entries[id];
+    entry.prev = NONE;
+    entry.next = lruHead;
+    if (lruHead != NONE) {
+        entries[lruHead].prev = id;
+    }
+    lruHead = id;
+    if (lruTail == NONE) {
+        lruTail = id;
+    }
+}
+
+// Libère une case de l'index en recompactant la suite de sondage
+// (suppression par décalage arrière, sans pierre tombale)
+void BeaconTable::removeSlot(size_t slot) {
+    size_t hole = slot;
+    size_t next = slot;
+    for (;;) {
+        next = (next + 1) & (INDEX_SIZE - 1);
+        if (index[next] == NONE) {
+            break;
+        }
+        size_t home = entries[index[next]].hash & (INDEX_SIZE - 1);
+        // L'entrée peut combler le trou si sa case d'origine n'est pas
+        // comprise (circulairement) entre le trou exclu et sa position
+        bool between = (hole <= next) ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+        if (!between) {
+            index[hole] = index[next];
+            hole = next;
+        }
+    }
+    index[hole] = NONE;
+}
+
+// Le beacon absent le moins récemment vu parmi les BEACON_EVICT_SCAN plus
+// anciens, ou à défaut le moins récemment vu : un beacon présent n'est
+// recyclé que si la fin de la liste n'a que des présents
+uint16_t BeaconTable::victim() const {
+    uint16_t id = lruTail;
+    for (size_t i = 0; i < BEACON_EVICT_SCAN && id != NONE; i++) {
+        if (!entries[id].info.isPresent) {
+            return id;
+        }
+        id = entries[id].prev;
+    }
+    return lruTail;
+}
+
+BeaconInfo* BeaconTable::find(const uint8_t* address, const uint8_t* proximityUUID) {
+    size_t slot = findSlot(hashKey(address, proximityUUID), address, proximityUUID);
+    return index[slot] != NONE ? &entries[index[slot]].info : nullptr;
+}
+
+BeaconInfo* BeaconTable::findOrInsert(const uint8_t* address, const uint8_t* proximityUUID, bool& isNew,
+                                      BeaconInfo* evicted) {
+    uint32_t hash = hashKey(address, proximityUUID);
+    size_t slot = findSlot(hash, address, proximityUUID);
+
+    if (index[slot] != NONE) {
+        uint16_t id = index[slot];
+        if (id != lruHead) {
+            unlink(id);
+            pushFront(id);
+        }
+        isNew = false;
+        return &entries[id].info;
+    }
+
+    uint16_t id;
+    if (freeHead != NONE) {
+        id = freeHead;
+        freeHead = entries[id].next;
+        count++;
+    } else {
+        // Table pleine : recycler de préférence un beacon absent
+        id = victim();
+        Entry& victim = entries[id];
+        if (evicted) {
+            *evicted = victim.info;
+        }
+        removeSlot(findSlot(victim.hash, victim.info.address,
+                            victim.info.isIBeacon ? victim.info.proximityUUID : nullptr));
+        unlink(id);
+        unlinkTimer(id);
+        evictions++;
+        // Le décalage arrière a pu déplacer la case libre
+        slot = findSlot(hash, address, proximityUUID);
+    }
+
+    Entry& entry = entries[id];
+    memset(&entry.info, 0, sizeof(entry.info));
+    memcpy(entry.info.address, address, sizeof(entry.info.address));
+    if (proximityUUID) {
+        entry.info.isIBeacon = true;
+        memcpy(entry.info.proximityUUID, proximityUUID, sizeof(entry.info.proximityUUID));
+    }
+    entry.hash = hash;
+    entry.used = true;
+    entry.scheduled = false;
+    index[slot] = id;
+    pushFront(id);
+
+    isNew = true;
+    return &entry.info;
+}
+
+void BeaconTable::remove(BeaconInfo* beacon) {
+    Entry* entry = reinterpret_cast<Entry*>(beacon);
+    uint16_t id = (uint16_t)(entry - entries);
+
+    removeSlot(findSlot(entry->hash, beacon->address, beacon->isIBeacon ? beacon->proximityUUID : nullptr));
+    unlink(id);
+    unlinkTimer(id);
+    entry->used = false;
+    entry->next = freeHead;
+    freeHead = id;
+    count--;
+}
+
+// Les échéances déjà passées vont dans la prochaine case traitée, celles du
+// tour en cours au premier niveau, les suivantes dans la case de leur tour
+// au second (la dernière pour celles qui le dépassent : elles y remonteront)
+void BeaconTable::linkTimer(uint16_t id) {
+    Entry& entry = entries[id];
+    int32_t ahead = (int32_t)(entry.deadline - wheelTime);
+    uint32_t ticks = ahead > 0 ? (uint32_t)ahead / TIMER_WHEEL_TICK : 0;
+    uint32_t tick = wheelTick + ticks;
+    if (ticks < TIMER_WHEEL_SLOTS) {
+        entry.timerSlot = (uint16_t)(tick & (TIMER_WHEEL_SLOTS - 1));
+    } else {
+        uint32_t laps = tick / TIMER_WHEEL_SLOTS - wheelTick / TIMER_WHEEL_SLOTS;
+        if (laps >= TIMER_WHEEL_SLOTS) {
+            laps = TIMER_WHEEL_SLOTS - 1;
+        }
+        uint32_t lap = wheelTick / TIMER_WHEEL_SLOTS + laps;
+        entry.timerSlot = (uint16_t)(TIMER_WHEEL_SLOTS + (lap & (TIMER_WHEEL_SLOTS - 1)));
+    }
+    uint16_t& head = wheel[entry.timerSlot];
+    entry.timerPrev = NONE;
+    entry.timerNext = head;
+    if (head != NONE) {
+        entries[head].timerPrev = id;
+    }
+    head = id;
+    entry.scheduled = true;
+}
+
+void BeaconTable::unlinkTimer(uint16_t id) {
+    Entry& entry = entries[id];
+    if (!entry.scheduled) {
+        return;
+    }
+    if (entry.timerPrev != NONE) {
+        entries[entry.timerPrev].timerNext = entry.timerNext;
+    } else {
+        wheel[entry.timerSlot] = entry.timerNext;
+    }
+    if (entry.timerNext != NONE) {
+        entries[entry.timerNext].timerPrev = entry.timerPrev;
+    }
+    entry.scheduled = false;
+}
+
+// Redescend les échéances d'une case du second niveau
+void BeaconTable::cascade(size_t slot) {
+    uint16_t id = wheel[slot];
+    wheel[slot] = NONE;
+    while (id != NONE) {
+        uint16_t next = entries[id].timerNext;
+        linkTimer(id);
+        id = next;
+    }
+}
+
+// Saute des cases sans les traiter : le tour complet qui suit visite tout
+// le premier niveau, et le second redescend, rangé par rapport à la
+// nouvelle position de la roue
+void BeaconTable::skipTicks(uint32_t ticks) {
+    wheelTick += ticks;
+    wheelTime += ticks * TIMER_WHEEL_TICK;
+    for (size_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        cascade(TIMER_WHEEL_SLOTS + i);
+    }
+}
+
+void BeaconTable::schedule(BeaconInfo* beacon, uint32_t deadline) {
+    Entry* entry = reinterpret_cast<Entry*>(beacon);
+    uint16_t id = (uint16_t)(entry - entries);
+    unlinkTimer(id);
+    entry->deadline = deadline;
+    linkTimer(id);
+}
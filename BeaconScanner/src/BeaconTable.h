@@ -0,0 +1,179 @@
+#ifndef BEACON_TABLE_H
+#define BEACON_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "BeaconInfo.h"
+
+// Nombre maximal de beacons suivis simultanément
+#ifndef BEACON_TABLE_CAPACITY
+#define BEACON_TABLE_CAPACITY 384
+#endif
+
+// Entrées examinées depuis la moins récente pour trouver un beacon absent
+// à recycler quand la table est pleine
+#ifndef BEACON_EVICT_SCAN
+#define BEACON_EVICT_SCAN 32
+#endif
+
+// Échéancier des entrées : roue temporelle de TIMER_WHEEL_SLOTS cases de
+// TIMER_WHEEL_TICK ms (12,8 s par tour par défaut), et second niveau d'autant
+// de cases d'un tour chacune (27 min par défaut)
+#ifndef TIMER_WHEEL_TICK
+#define TIMER_WHEEL_TICK 100
+#endif
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS 128    // Puissance de deux
+#endif
+
+// Table de hachage à adressage ouvert (sondage linéaire) de capacité fixe.
+// La clé est l'adresse MAC brute, complétée par l'UUID de proximité pour
+// un iBeacon. Toute la mémoire est réservée à la construction : aucune
+// allocation ensuite. Quand la table est pleine, l'entrée recyclée est la
+// moins récemment vue (LRU) parmi les beacons absents, sinon parmi tous.
+// Les champs address, isIBeacon et proximityUUID forment la clé : ils ne
+// doivent pas être modifiés par l'appelant.
+// Chaque entrée peut porter une échéance, rangée dans une roue temporelle à
+// deux niveaux : une échéance au-delà du tour en cours attend dans la case
+// de son tour au second niveau, et ne redescend qu'au début de celui-ci.
+// expire() ne visite que les cases écoulées ; une entrée n'est déplacée
+// qu'une fois avant son échéance (de nouveau à chaque tour du second niveau
+// au-delà de celui-ci) : le coût suit le nombre d'échéances, pas la taille
+// de la table.
+class BeaconTable {
+private:
+    static constexpr uint16_t NONE = 0xFFFF;
+    static constexpr size_t INDEX_SIZE = BEACON_TABLE_CAPACITY <= 128 ? 256
+                                       : BEACON_TABLE_CAPACITY <= 256 ? 512
+                                       : BEACON_TABLE_CAPACITY <= 512 ? 1024
+                                       : BEACON_TABLE_CAPACITY <= 1024 ? 2048 : 4096;
+    static_assert(BEACON_TABLE_CAPACITY * 2 <= INDEX_SIZE && BEACON_TABLE_CAPACITY < NONE,
+                  "BEACON_TABLE_CAPACITY trop grand");
+    static_assert((TIMER_WHEEL_SLOTS & (TIMER_WHEEL_SLOTS - 1)) == 0,
+                  "TIMER_WHEEL_SLOTS doit être une puissance de deux");
+
+    struct Entry {
+        BeaconInfo info;
+        uint32_t hash;
+        uint16_t prev;  // Liste LRU (vers le plus récent)
+        uint16_t next;  // Liste LRU (vers le plus ancien) ou liste libre
+        uint16_t timerPrev;  // Liste de la case de la roue
+        uint16_t timerNext;
+        uint16_t timerSlot;  // Premier niveau, puis second à partir de TIMER_WHEEL_SLOTS
+        uint32_t deadline;
+        bool used;
+        bool scheduled;
+    };
+
+    Entry entries[BEACON_TABLE_CAPACITY];
+    uint16_t index[INDEX_SIZE];  // Cases de hachage -> numéro d'entrée
+    uint16_t lruHead;            // Entrée la plus récemment vue
+    uint16_t lruTail;            // Entrée la moins récemment vue
+    uint16_t freeHead;
+    size_t count;
+    uint32_t evictions;
+
+    uint16_t wheel[2 * TIMER_WHEEL_SLOTS];  // Têtes des listes d'échéances, deux niveaux
+    uint32_t wheelTick;                     // Prochaine case à traiter (en ticks)
+    uint32_t wheelTime;                     // Début de cette case (ms)
+
+    size_t findSlot(uint32_t hash, const uint8_t* address, const uint8_t* proximityUUID) const;
+    uint16_t victim() const;
+    void unlink(uint16_t id);
+    void pushFront(uint16_t id);
+    void removeSlot(size_t slot);
+    void linkTimer(uint16_t id);
+    void unlinkTimer(uint16_t id);
+    void cascade(size_t slot);
+    void skipTicks(uint32_t ticks);
+
+public:
+    BeaconTable();
+
+    // Hachage et comparaison de la clé, partagés avec la fusion
+    // multi-passerelles (src/fusion/)
+    static uint32_t hashKey(const uint8_t* address, const uint8_t* proximityUUID);
+    static bool keyEquals(const BeaconInfo& info, const uint8_t* address, const uint8_t* proximityUUID);
+
+    // Recherche un beacon ; proximityUUID vaut nullptr hors iBeacon
+    BeaconInfo* find(const uint8_t* address, const uint8_t* proximityUUID);
+
+    // Une seule recherche par annonce : retourne l'entrée existante (et la
+    // marque comme la plus récente) ou en crée une nouvelle, remise à zéro,
+    // avec la clé déjà renseignée. isNew indique une création. Si la table
+    // était pleine, l'entrée recyclée est copiée dans evicted (s'il est
+    // fourni) et evictionCount() augmente.
+    BeaconInfo* findOrInsert(const uint8_t* address, const uint8_t* proximityUUID, bool& isNew,
+                             BeaconInfo* evicted = nullptr);
+
+    // Entrée que findOrInsert() recyclerait pour une nouvelle clé, nullptr
+    // si la table n'est pas pleine
+    const BeaconInfo* evictionCandidate() const {
+        return freeHead == NONE ? &entries[victim()].info : nullptr;
+    }
+
+    // Supprime une entrée obtenue par find/findOrInsert
+    void remove(BeaconInfo* beacon);
+
+    void clear();
+    size_t size() const { return count; }
+    static constexpr size_t capacity() { return BEACON_TABLE_CAPACITY; }
+    uint32_t evictionCount() const { return evictions; }
+
+    // Arme (ou réarme) l'échéance d'une entrée, en O(1)
+    void schedule(BeaconInfo* beacon, uint32_t deadline);
+
+    // Appelle fn pour chaque entrée dont l'échéance est atteinte, au plus
+    // TIMER_WHEEL_TICK ms après celle-ci si expire() est appelé assez souvent.
+    // L'échéance est consommée : fn peut la réarmer ou supprimer l'entrée.
+    // now ne doit pas reculer d'un appel à l'autre. Le temps de la roue est
+    // compté en écarts à wheelTime : le passage de millis() par zéro n'y
+    // change rien.
+    template <typename Fn>
+    void expire(uint32_t now, Fn fn) {
+        // Après une longue pause, un tour complet visite toutes les entrées
+        uint32_t elapsed = now - wheelTime;
+        if (elapsed > TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK) {
+            skipTicks(elapsed / TIMER_WHEEL_TICK - TIMER_WHEEL_SLOTS);
+        }
+        // Une case n'est traitée qu'une fois son intervalle entièrement écoulé
+        while (now - wheelTime >= TIMER_WHEEL_TICK) {
+            // Début d'un tour : ses échéances quittent le second niveau
+            if ((wheelTick & (TIMER_WHEEL_SLOTS - 1)) == 0) {
+                cascade(TIMER_WHEEL_SLOTS + ((wheelTick / TIMER_WHEEL_SLOTS) & (TIMER_WHEEL_SLOTS - 1)));
+            }
+            uint16_t& head = wheel[wheelTick++ & (TIMER_WHEEL_SLOTS - 1)];
+            wheelTime += TIMER_WHEEL_TICK;
+            uint16_t id = head;
+            head = NONE;
+            while (id != NONE) {
+                Entry& entry = entries[id];
+                uint16_t next = entry.timerNext;
+                entry.scheduled = false;
+                if ((int32_t)(entry.deadline - now) <= 0) {
+                    fn(entry.info);
+                } else {
+                    linkTimer(id);  // Rangée avant une longue pause
+                }
+                id = next;
+            }
+        }
+    }
+
+    // Entrée à une position fixe du stockage (0 à capacity() - 1), ou
+    // nullptr si elle est libre : parcours reprenable d'un appel à l'autre
+    const BeaconInfo* at(size_t position) const {
+        return entries[position].used ? &entries[position].info : nullptr;
+    }
+
+    // Parcourt les entrées de la plus récente à la plus ancienne
+    // (fn ne doit ni insérer ni supprimer d'entrée)
+    template <typename Fn>
+    void forEach(Fn fn) {
+        for (uint16_t id = lruHead; id != NONE; id = entries[id].next) {
+            fn(entries[id].info);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,396 @@
+#include "BeaconTracker.h"
+#include "AdvParser.h"
+#include "Hal.h"
+#include "Log.h"
+#include "Presence.h"
+
+BeaconTracker::BeaconTracker(SendEvents& eventSender)
+    : filterPending(false), changeSeq(0), tombstoneCount(0), tombstoneFloor(0), changesState(CHANGES_IDLE),
+      changesCursor(nullptr), changesOut(nullptr), changesMax(0), changesCount(0), taskStarted(false),
+      eventSender(eventSender), lastScanDeviceCount(0), lastSummary(0), lastReceived(0), summaryInterval(5000),
+      arrivalCount(0), departureCount(0), reclaimCount(0), tableFullCount(0), parseFailureCount(0), filteredCount(0),
+      tableSize(0), tableEvictions(0) {
+  memset(tombstones, 0, sizeof(tombstones));
+}
+
+bool BeaconTracker::startTask(uint32_t summaryIntervalMs) {
+  summaryInterval = summaryIntervalMs;
+  taskStarted = xTaskCreatePinnedToCore(trackerTask, "tracker", TRACKER_TASK_STACK, this, TRACKER_TASK_PRIORITY,
+                                        NULL, RADIO_CORE) == pdPASS;
+  return taskStarted;
+}
+
+bool BeaconTracker::setRefreshInterval(const uint8_t address[6], uint32_t refreshMs) {
+  if (refreshMs > BEACON_TIMEOUT / 2 || refreshMs > 0xFFFF) {
+    return false;
+  }
+  return duplicateFilter.setRefreshInterval(address, (uint16_t)refreshMs);
+}
+
+bool BeaconTracker::setFilter(const char* text, char* error, size_t errorSize) {
+  if (filterPending.load(std::memory_order_acquire)) {
+    snprintf(error, errorSize, "mise à jour précédente en cours");
+    return false;
+  }
+  if (!pendingFilter.parse(text, error, errorSize)) {
+    return false;
+  }
+  filterPending.store(true, std::memory_order_release);
+  return true;
+}
+
+void BeaconTracker::trackerTask(void* parameter) {
+  static_cast<BeaconTracker*>(parameter)->runTracker();
+}
+
+// Boucle de la tâche de suivi : la file des annonces est vidée à chaque
+// réveil, la roue des départs avance d'au plus un pas
+void BeaconTracker::runTracker() {
+  for (;;) {
+    processAdvertisements();
+    checkForDepartedBeacons();
+    serviceChanges();
+    displayScanSummary(summaryInterval);
+    vTaskDelay(pdMS_TO_TICKS(TRACKER_TICK));
+  }
+}
+
+void BeaconTracker::publishTableStats() {
+  tableSize.store((uint32_t)knownBeacons.size(), std::memory_order_relaxed);
+  tableEvictions.store(knownBeacons.evictionCount(), std::memory_order_relaxed);
+}
+
+// Journal d'un événement (arrivée ou départ) : une ligne, plus le détail de
+// la trame au niveau DEBUG. Rien n'est construit sous LOG_LEVEL_INFO.
+void BeaconTracker::logBeaconEvent(const char* eventType, const BeaconInfo& beacon) {
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  // L'identifiant texte n'est construit que pour l'événement
+  char beaconId[BEACON_ID_TEXT];
+  formatBeaconId(beacon, beaconId);
+  LOG_INFO("%s %s \"%s\" RSSI %d (lissé %.1f)", eventType, beaconId, beacon.name, beacon.rssi,
+           beacon.rssiFiltered);
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  char uuid[BEACON_UUID_TEXT];
+  formatUUID(beacon.proximityUUID, uuid);
+  if (beacon.frameType == FRAME_IBEACON || beacon.frameType == FRAME_ALTBEACON) {
+    LOG_DEBUG("  %s %s major %u minor %u, %d dBm à 1 m, %.1f m",
+              beacon.frameType == FRAME_IBEACON ? "iBeacon" : "AltBeacon", uuid, beacon.major, beacon.minor,
+              beacon.txPower, estimateDistance(beacon));
+  } else if (beacon.frameType == FRAME_EDDYSTONE_UID) {
+    LOG_DEBUG("  Eddystone-UID %s, %d dBm à 0 m, %.1f m", uuid, beacon.txPower, estimateDistance(beacon));
+  } else if (beacon.frameType == FRAME_EDDYSTONE_URL) {
+    LOG_DEBUG("  Eddystone-URL, %d dBm à 0 m, %.1f m", beacon.txPower, estimateDistance(beacon));
+  } else {
+    LOG_DEBUG("  Service %s", beacon.uuid);
+  }
+#endif
+#else
+  (void)eventType;
+  (void)beacon;
+#endif
+}
+
+// Nouveau numéro de modification, lu par GET /beacons?since=
+void BeaconTracker::markChanged(BeaconInfo& beacon) {
+  beacon.changeSeq = ++changeSeq;
+  beacon.rssiReported = (int8_t)lroundf(beacon.rssiFiltered);
+}
+
+// Clé d'une entrée libérée ou recyclée, signalée comme supprimée
+void BeaconTracker::addTombstone(const BeaconInfo& beacon) {
+  Tombstone& tombstone = tombstones[tombstoneCount++ % BEACON_TOMBSTONES];
+  if (tombstoneCount > BEACON_TOMBSTONES) {
+    tombstoneFloor = tombstone.seq;
+  }
+  memcpy(tombstone.address, beacon.address, sizeof(tombstone.address));
+  tombstone.isIBeacon = beacon.isIBeacon;
+  memcpy(tombstone.proximityUUID, beacon.proximityUUID, sizeof(tombstone.proximityUUID));
+  tombstone.seq = ++changeSeq;
+}
+
+// Parcours par position : les suppressions retenues, puis la table. Une
+// suppression précède toujours l'entrée vivante de même clé, plus récente.
+// Les entrées modifiées entre deux morceaux peuvent apparaître deux fois
+// ou pas du tout ; elles portent alors un numéro postérieur à cursor.seq
+// et reviennent à la lecture suivante.
+size_t BeaconTracker::copyChanges(BeaconChangeCursor& cursor, BeaconChange* out, size_t max) {
+  if (cursor.position == 0) {
+    cursor.seq = changeSeq;
+    cursor.reset = cursor.since == 0 || cursor.since > changeSeq || cursor.since < tombstoneFloor;
+    if (cursor.reset) {
+      cursor.since = 0;
+      cursor.position = BEACON_TOMBSTONES;
+    }
+  }
+
+  size_t count = 0;
+  while (count < max && cursor.position < BEACON_TOMBSTONES) {
+    const Tombstone& tombstone = tombstones[cursor.position++];
+    if (tombstone.seq > cursor.since) {
+      BeaconInfo& info = out[count].info;
+      memset(&info, 0, sizeof(info));
+      memcpy(info.address, tombstone.address, sizeof(info.address));
+      info.isIBeacon = tombstone.isIBeacon;
+      memcpy(info.proximityUUID, tombstone.proximityUUID, sizeof(info.proximityUUID));
+      info.changeSeq = tombstone.seq;
+      out[count].removed = true;
+      count++;
+    }
+  }
+
+  while (count < max && cursor.position < BEACON_TOMBSTONES + knownBeacons.capacity()) {
+    const BeaconInfo* beacon = knownBeacons.at(cursor.position++ - BEACON_TOMBSTONES);
+    if (beacon && beacon->changeSeq > cursor.since) {
+      out[count].info = *beacon;
+      out[count].removed = false;
+      count++;
+    }
+  }
+  return count;
+}
+
+// Lecture demandée par readChanges(), dans la tâche de suivi
+void BeaconTracker::serviceChanges() {
+  uint8_t expected = CHANGES_REQUESTED;
+  if (changesState.load(std::memory_order_relaxed) != CHANGES_REQUESTED ||
+      !changesState.compare_exchange_strong(expected, CHANGES_SERVING, std::memory_order_acquire)) {
+    return;
+  }
+  changesCount = copyChanges(*changesCursor, changesOut, changesMax);
+  changesState.store(CHANGES_DONE, std::memory_order_release);
+}
+
+int BeaconTracker::readChanges(BeaconChangeCursor& cursor, BeaconChange* out, size_t max) {
+  // Simulation en un seul fil : la table n'est pas partagée
+  if (!taskStarted) {
+    return (int)copyChanges(cursor, out, max);
+  }
+
+  changesCursor = &cursor;
+  changesOut = out;
+  changesMax = max;
+  changesState.store(CHANGES_REQUESTED, std::memory_order_release);
+
+  uint32_t start = halMillis();
+  for (;;) {
+    if (changesState.load(std::memory_order_acquire) == CHANGES_DONE) {
+      changesState.store(CHANGES_IDLE, std::memory_order_relaxed);
+      return (int)changesCount;
+    }
+    // Abandon possible tant que la copie n'a pas commencé
+    uint8_t expected = CHANGES_REQUESTED;
+    if (halMillis() - start >= BEACON_CHANGES_TIMEOUT &&
+        changesState.compare_exchange_strong(expected, CHANGES_IDLE, std::memory_order_relaxed)) {
+      return -1;
+    }
+    halDelay(1);
+  }
+}
+
+// Fonction pour vérifier les beacons qui ont disparu. Chaque entrée porte
+// une seule échéance dans la roue de la table : BEACON_TIMEOUT après la
+// dernière annonce si le beacon est présent, BEACON_RECLAIM_GRACE sinon.
+// Les annonces ne la déplacent pas ; elle est recalculée quand elle tombe.
+void BeaconTracker::checkForDepartedBeacons() {
+  uint32_t currentTime = halMillis();
+
+  knownBeacons.expire(currentTime, [this, currentTime](BeaconInfo& beacon) {
+    uint32_t silence = currentTime - beacon.lastSeen;
+
+    if (beacon.isPresent) {
+      if (silence <= BEACON_TIMEOUT) {
+        knownBeacons.schedule(&beacon, beacon.lastSeen + BEACON_TIMEOUT + 1);
+        return;
+      }
+      // Plus aucune annonce reçue : départ sans attendre le filtre
+      beacon.dwelling = false;
+      reportDeparture(beacon);
+    }
+
+    if (silence <= BEACON_RECLAIM_GRACE) {
+      knownBeacons.schedule(&beacon, beacon.lastSeen + BEACON_RECLAIM_GRACE + 1);
+    } else {
+      addTombstone(beacon);
+      knownBeacons.remove(&beacon);
+      reclaimCount++;
+    }
+  });
+  publishTableStats();
+}
+
+void BeaconTracker::reportArrival(BeaconInfo& beacon) {
+  beacon.isPresent = true;
+  presenceFlap(beacon, beacon.lastSeen);
+  arrivalCount++;
+  markChanged(beacon);
+  knownBeacons.schedule(&beacon, beacon.lastSeen + BEACON_TIMEOUT + 1);
+  logBeaconEvent("Arrivée", beacon);
+
+  // Envoyer l'événement d'arrivée au backend
+  eventSender.sendBeaconArrival(beacon);
+}
+
+void BeaconTracker::reportDeparture(BeaconInfo& beacon) {
+  beacon.isPresent = false;
+  presenceFlap(beacon, beacon.lastSeen);
+  departureCount++;
+  markChanged(beacon);
+  logBeaconEvent("Départ", beacon);
+
+  // Envoyer l'événement de départ au backend
+  eventSender.sendBeaconDeparture(beacon);
+}
+
+// Traitement d'une annonce sortie de la file
+void BeaconTracker::handleAdvertisement(const AdvRecord& record) {
+  // Seuil de RSSI et préfixes OUI, avant même le décodage
+  AdvFilterVerdict verdict = FILTER_ADDRESS_ALLOWED;
+  if (filter.isActive()) {
+    verdict = filter.checkAddress(record);
+    if (verdict == FILTER_REJECT) {
+      filteredCount++;
+      return;
+    }
+  }
+
+  // Décodage unique de l'annonce brute, sans allocation
+  ParsedAdvertisement adv;
+  if (!parseAdvertisement(record.payload, record.payloadLength, adv)) {
+    parseFailureCount++;
+    return; // Annonce tronquée ou mal formée
+  }
+
+  // UUID et plages major/minor, avant toute création d'entrée
+  if (filter.isActive() && !filter.checkFrame(adv, verdict)) {
+    filteredCount++;
+    return;
+  }
+
+  // Si c'est un iBeacon, l'UUID de proximité fait partie de la clé
+  const uint8_t* proximityUUID = adv.frameType == FRAME_IBEACON ? adv.beaconUUID : nullptr;
+
+  // Table pleine et beacon inconnu : pas de recyclage d'une entrée encore
+  // active (voir BEACON_EVICT_AGE)
+  const BeaconInfo* candidate = knownBeacons.evictionCandidate();
+  if (candidate && record.timestamp - candidate->lastSeen < BEACON_EVICT_AGE &&
+      !knownBeacons.find(record.address, proximityUUID)) {
+    tableFullCount++;
+    return;
+  }
+
+  // Une seule recherche : créer ou récupérer les informations du beacon.
+  // Une entrée recyclée (table pleine) est signalée comme supprimée, après
+  // son départ si elle était présente.
+  bool isNewBeacon;
+  BeaconInfo evicted;
+  uint32_t evictions = knownBeacons.evictionCount();
+  BeaconInfo& beacon = *knownBeacons.findOrInsert(record.address, proximityUUID, isNewBeacon, &evicted);
+  if (knownBeacons.evictionCount() != evictions) {
+    if (evicted.isPresent) {
+      reportDeparture(evicted);
+    }
+    addTombstone(evicted);
+  }
+
+  // Filtre repris à zéro pour un nouveau beacon ou après une longue absence
+  uint32_t elapsed = record.timestamp - beacon.lastSeen;
+  if (isNewBeacon || (!beacon.isPresent && elapsed > BEACON_TIMEOUT)) {
+    presenceReset(beacon, record.rssi);
+    elapsed = 0;
+  }
+  if (isNewBeacon) {
+    knownBeacons.schedule(&beacon, record.timestamp + BEACON_RECLAIM_GRACE + 1);
+  }
+  PresenceTransition transition = presenceUpdate(beacon, record.rssi, elapsed, record.timestamp);
+
+  // Nom, UUID de service et trame : un changement est une modification
+  // pour GET /beacons
+  bool changed = isNewBeacon;
+  if (adv.name) {
+    uint8_t length = adv.nameLength > BEACON_NAME_MAX ? BEACON_NAME_MAX : adv.nameLength;
+    if (memcmp(beacon.name, adv.name, length) != 0 || beacon.name[length] != '\0') {
+      memcpy(beacon.name, adv.name, length);
+      beacon.name[length] = '\0';
+      changed = true;
+    }
+  } else if (strcmp(beacon.name, "Inconnu") != 0) {
+    strlcpy(beacon.name, "Inconnu", sizeof(beacon.name));
+    changed = true;
+  }
+  char uuid[BEACON_UUID_TEXT];
+  if (adv.hasServiceUUID) {
+    formatUUID(adv.serviceUUID, uuid);
+  } else {
+    strlcpy(uuid, "N/A", sizeof(uuid));
+  }
+  if (strcmp(beacon.uuid, uuid) != 0) {
+    memcpy(beacon.uuid, uuid, sizeof(beacon.uuid));
+    changed = true;
+  }
+  beacon.rssi = record.rssi;
+  beacon.lastSeen = record.timestamp;
+
+  // Les trames Eddystone-TLM alternent avec les trames d'identification :
+  // elles ne remplacent pas les informations de trame déjà connues
+  if (adv.frameType != FRAME_NONE && adv.frameType != FRAME_EDDYSTONE_TLM) {
+    changed |= beacon.frameType != adv.frameType;
+    beacon.frameType = adv.frameType;
+    beacon.txPower = adv.txPower;
+    if (adv.frameType != FRAME_EDDYSTONE_URL) {
+      changed |= memcmp(beacon.proximityUUID, adv.beaconUUID, sizeof(beacon.proximityUUID)) != 0 ||
+                 beacon.major != adv.major || beacon.minor != adv.minor;
+      memcpy(beacon.proximityUUID, adv.beaconUUID, sizeof(beacon.proximityUUID));
+      beacon.major = adv.major;
+      beacon.minor = adv.minor;
+    }
+  }
+
+  // Arrivée ou départ confirmé par l'hystérésis (voir Presence.h)
+  if (transition == PRESENCE_ARRIVAL) {
+    reportArrival(beacon);
+  } else if (transition == PRESENCE_DEPARTURE) {
+    reportDeparture(beacon);
+  } else if (changed || fabsf(beacon.rssiFiltered - beacon.rssiReported) >= BEACON_RSSI_CHANGE) {
+    markChanged(beacon);
+  }
+}
+
+void BeaconTracker::processAdvertisements() {
+  AdvRecord batch[ADV_BATCH_SIZE];
+  size_t count;
+  bool processed = false;
+
+  if (filterPending.load(std::memory_order_acquire)) {
+    filter = pendingFilter;
+    filterPending.store(false, std::memory_order_release);
+  }
+
+  while ((count = advRing.popBatch(batch, ADV_BATCH_SIZE)) > 0) {
+    for (size_t i = 0; i < count; i++) {
+      handleAdvertisement(batch[i]);
+    }
+    processed = true;
+  }
+  if (processed) {
+    publishTableStats();
+  }
+}
+
+// Display scan summary at the end of each scan cycle
+void BeaconTracker::displayScanSummary(uint32_t intervalMs) {
+  uint32_t currentTime = halMillis();
+
+  if (currentTime - lastSummary < intervalMs) {
+    return;
+  }
+  lastSummary = currentTime;
+
+  uint32_t received = advertisementsReceived();
+  LOG_INFO("Scan: %d appareils, %lu annonces (%lu perdues), %d beacons, WiFi %s, file %d", lastScanDeviceCount.load(),
+           (unsigned long)(received - lastReceived), (unsigned long)advRing.droppedCount(), (int)knownBeacons.size(),
+           eventSender.isConnected() ? "connecté" : "déconnecté", eventSender.getQueueSize());
+  LOG_DEBUG("Doublons écartés: %lu sur %lu annonces", (unsigned long)duplicateFilter.suppressedCount(),
+            (unsigned long)received);
+  lastReceived = received;
+}
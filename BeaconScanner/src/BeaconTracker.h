@@ -0,0 +1,236 @@
+#ifndef BEACON_TRACKER_H
+#define BEACON_TRACKER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "AdvFilter.h"
+#include "AdvRecord.h"
+#include "AdvRingBuffer.h"
+#include "BeaconTable.h"
+#include "DuplicateFilter.h"
+#include "SendEvents.h"
+
+// Timeout pour considérer qu'un beacon est parti (en millisecondes)
+#ifndef BEACON_TIMEOUT
+#define BEACON_TIMEOUT 10000
+#endif
+
+// Délai après la dernière annonce avant de libérer l'entrée d'un beacon
+// absent (en millisecondes)
+#ifndef BEACON_RECLAIM_GRACE
+#define BEACON_RECLAIM_GRACE 600000
+#endif
+
+// Table pleine : une entrée n'est recyclée pour un nouveau beacon que si
+// elle n'a rien reçu depuis BEACON_EVICT_AGE ms ; sinon l'annonce du
+// nouveau beacon est ignorée. Sans cela, au-delà de la capacité, chaque
+// nouveau beacon chasse un beacon encore en cours d'arrivée et plus aucun
+// n'arrive.
+#ifndef BEACON_EVICT_AGE
+#define BEACON_EVICT_AGE 3000
+#endif
+
+// Un beacon immobile n'est plus vu qu'une fois par ADV_DEDUP_REFRESH
+// (DuplicateFilter.h) : il ne doit pas passer pour parti
+static_assert(ADV_DEDUP_REFRESH <= BEACON_TIMEOUT / 2, "ADV_DEDUP_REFRESH doit rester sous BEACON_TIMEOUT / 2");
+
+// Configuration de la file des annonces
+// (puissance de deux). Une fois pleine, les nouvelles sont perdues :
+// elle doit couvrir les annonces reçues pendant TRACKER_TICK
+#ifndef ADV_RING_SIZE
+#define ADV_RING_SIZE 128        // Annonces en attente
+#endif
+#ifndef ADV_BATCH_SIZE
+#define ADV_BATCH_SIZE 16        // Annonces traitées par lot
+#endif
+
+// Tâche de suivi, sur le cœur radio (RADIO_CORE, voir Hal.h)
+#ifndef TRACKER_TASK_STACK
+#define TRACKER_TASK_STACK 4096
+#endif
+#ifndef TRACKER_TASK_PRIORITY
+#define TRACKER_TASK_PRIORITY 2  // Au-dessus de bleScan, pour vider la file
+#endif
+#ifndef TRACKER_TICK
+#define TRACKER_TICK 10          // Période de la tâche (ms), < TIMER_WHEEL_TICK
+#endif
+
+// Suivi des modifications (GET /beacons?since=, voir BeaconStream.h) : un
+// beacon change de numéro à sa création, à son arrivée ou son départ, quand
+// son nom ou sa trame changent, ou quand son RSSI lissé s'écarte de
+// BEACON_RSSI_CHANGE dB de la dernière valeur signalée
+#ifndef BEACON_RSSI_CHANGE
+#define BEACON_RSSI_CHANGE 4
+#endif
+
+// Entrées libérées dont la suppression reste signalée aux clients ; un
+// client plus en retard reçoit un instantané complet
+#ifndef BEACON_TOMBSTONES
+#define BEACON_TOMBSTONES 32
+#endif
+
+// Attente maximale d'une lecture de la table par la tâche de suivi (ms)
+#ifndef BEACON_CHANGES_TIMEOUT
+#define BEACON_CHANGES_TIMEOUT 200
+#endif
+
+// Une entrée de la table telle que lue par readChanges(), ou la clé d'une
+// entrée libérée (removed)
+struct BeaconChange {
+    BeaconInfo info;
+    bool removed;
+};
+
+// Position d'une lecture par morceaux de readChanges()
+struct BeaconChangeCursor {
+    uint32_t since;     // Modifications postérieures à ce numéro (0 : toutes)
+    uint32_t position;  // 0 au premier appel
+    uint32_t seq;       // Renseigné au premier appel : dernier numéro attribué
+    bool reset;         // Renseigné au premier appel : instantané complet
+};
+
+// Logique de présence, indépendante du matériel : reçoit les annonces
+// brutes de la radio, tient à jour la table des beacons et signale arrivées
+// et départs à SendEvents. Partagée par le firmware (main.cpp) et le
+// simulateur (sim/SimMain.cpp). La table n'est manipulée que par la tâche
+// de suivi ; les compteurs peuvent être lus depuis l'autre cœur (/metrics).
+class BeaconTracker {
+private:
+    // Table préallouée des beacons détectés
+    BeaconTable knownBeacons;
+
+    // Doublons écartés avant la file, dans la tâche radio
+    DuplicateFilter duplicateFilter;
+
+    // File entre le callback radio (producteur) et processAdvertisements()
+    AdvRingBuffer<AdvRecord, ADV_RING_SIZE> advRing;
+
+    // Listes d'autorisation et de refus (AdvFilter.h). setFilter() compile
+    // les règles dans pendingFilter ; la tâche de suivi les recopie dans
+    // filter au début de processAdvertisements()
+    AdvFilter filter;
+    AdvFilter pendingFilter;
+    std::atomic<bool> filterPending;
+
+    // Numérotation des modifications et clés des entrées libérées
+    struct Tombstone {
+        uint8_t address[6];
+        bool isIBeacon;
+        uint8_t proximityUUID[16];
+        uint32_t seq;
+    };
+    uint32_t changeSeq;
+    Tombstone tombstones[BEACON_TOMBSTONES];
+    uint32_t tombstoneCount;
+    uint32_t tombstoneFloor;  // Numéro de la dernière suppression oubliée
+
+    // Lecture demandée par readChanges() depuis une autre tâche, servie par
+    // la tâche de suivi entre deux lots (voir serviceChanges())
+    enum : uint8_t { CHANGES_IDLE, CHANGES_REQUESTED, CHANGES_SERVING, CHANGES_DONE };
+    std::atomic<uint8_t> changesState;
+    BeaconChangeCursor* changesCursor;
+    BeaconChange* changesOut;
+    size_t changesMax;
+    size_t changesCount;
+    bool taskStarted;
+
+    SendEvents& eventSender;
+
+    // Nombre d'appareils vus lors du dernier cycle de scan
+    std::atomic<int> lastScanDeviceCount;
+
+    uint32_t lastSummary;
+    uint32_t lastReceived;
+    uint32_t summaryInterval;
+    std::atomic<uint32_t> arrivalCount;
+    std::atomic<uint32_t> departureCount;
+    std::atomic<uint32_t> reclaimCount;
+    std::atomic<uint32_t> tableFullCount;
+    std::atomic<uint32_t> parseFailureCount;
+    std::atomic<uint32_t> filteredCount;
+
+    // Copie de l'occupation de la table, pour les lectures hors tâche
+    std::atomic<uint32_t> tableSize;
+    std::atomic<uint32_t> tableEvictions;
+
+    static void trackerTask(void* parameter);
+    void runTracker();
+    void publishTableStats();
+    void handleAdvertisement(const AdvRecord& record);
+    void reportArrival(BeaconInfo& beacon);
+    void reportDeparture(BeaconInfo& beacon);
+    void logBeaconEvent(const char* eventType, const BeaconInfo& beacon);
+    void markChanged(BeaconInfo& beacon);
+    void addTombstone(const BeaconInfo& beacon);
+    size_t copyChanges(BeaconChangeCursor& cursor, BeaconChange* out, size_t max);
+    void serviceChanges();
+
+public:
+    explicit BeaconTracker(SendEvents& eventSender);
+
+    // Appelé depuis la tâche radio : écarte les doublons et copie l'annonce
+    // dans la file, sans allocation ni autre traitement
+    void onAdvertisement(const AdvRecord& record) {
+        if (duplicateFilter.accept(record)) {
+            advRing.push(record);
+        }
+    }
+
+    // Intervalle de rafraîchissement propre à un beacon (voir
+    // DuplicateFilter.h), au plus BEACON_TIMEOUT / 2 ; avant
+    // halRadio().begin()
+    bool setRefreshInterval(const uint8_t address[6], uint32_t refreshMs);
+
+    // Remplace les règles de filtrage (texte décrit dans AdvFilter.h), depuis
+    // n'importe quelle tâche : elles s'appliquent au prochain lot
+    // d'annonces. Retourne false et décrit l'erreur si le texte est invalide
+    // ou si la mise à jour précédente n'a pas encore été prise en compte.
+    bool setFilter(const char* text, char* error, size_t errorSize);
+    void setScanDeviceCount(int count) { lastScanDeviceCount = count; }
+
+    // Lance la tâche de suivi sur RADIO_CORE : elle enchaîne
+    // processAdvertisements(), checkForDepartedBeacons() et
+    // displayScanSummary(summaryIntervalMs) toutes les TRACKER_TICK ms.
+    // Retourne false si la tâche n'a pas pu être créée (simulation en un
+    // seul fil : l'appelant appelle alors ces méthodes lui-même).
+    bool startTask(uint32_t summaryIntervalMs);
+
+    // Vide la file des annonces par lots
+    void processAdvertisements();
+
+    // Signale le départ des beacons non vus depuis BEACON_TIMEOUT et libère
+    // ceux absents depuis BEACON_RECLAIM_GRACE ; à appeler au moins toutes
+    // les TIMER_WHEEL_TICK ms
+    void checkForDepartedBeacons();
+
+    // Résumé périodique dans le journal (toutes les intervalMs)
+    void displayScanSummary(uint32_t intervalMs);
+
+    // Copie au plus max entrées modifiées après cursor.since, en reprenant
+    // à cursor.position ; moins de max : la lecture est terminée. Depuis
+    // une autre tâche (une à la fois), la copie est faite par la tâche de
+    // suivi entre deux lots : -1 si elle n'a pas répondu en
+    // BEACON_CHANGES_TIMEOUT ms. Un since inconnu (redémarrage) ou trop
+    // ancien pour les suppressions retenues donne un instantané complet.
+    int readChanges(BeaconChangeCursor& cursor, BeaconChange* out, size_t max);
+
+    size_t beaconCount() const { return tableSize; }
+    size_t beaconCapacity() const { return knownBeacons.capacity(); }
+    uint32_t beaconEvictions() const { return tableEvictions; }
+    uint32_t presentCount() const { return arrivalCount - departureCount; }
+    uint32_t arrivals() const { return arrivalCount; }
+    uint32_t departures() const { return departureCount; }
+    uint32_t reclaimed() const { return reclaimCount; }
+    uint32_t tableFullRejections() const { return tableFullCount; }
+    // Toutes les annonces remises par la radio : mises en file, écartées
+    // comme doublons ou perdues faute de place dans la file
+    uint32_t advertisementsReceived() const {
+        return advRing.pushedCount() + advRing.droppedCount() + duplicateFilter.suppressedCount();
+    }
+    uint32_t advertisementsSuppressed() const { return duplicateFilter.suppressedCount(); }
+    uint32_t advertisementsDropped() const { return advRing.droppedCount(); }
+    uint32_t parseFailures() const { return parseFailureCount; }
+    uint32_t advertisementsFiltered() const { return filteredCount; }
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "CoapTransport.h"
+#include "Hal.h"
+#include "Log.h"
+
+// Types de message et codes CoAP (RFC 7252, 3)
+#define COAP_TYPE_CON 0
+#define COAP_TYPE_NON 1
+#define COAP_TYPE_ACK 2
+#define COAP_TYPE_RST 3
+#define COAP_CODE_POST 0x02
+#define COAP_CODE_CONTINUE 0x5F      // 2.31
+#define COAP_CODE_TOO_LARGE 0x8D     // 4.13
+
+#define COAP_OPTION_URI_PATH 11
+#define COAP_OPTION_CONTENT_FORMAT 12
+#define COAP_OPTION_BLOCK1 27
+#define COAP_FORMAT_JSON 50
+
+#define COAP_TOKEN_LENGTH 4
+#define COAP_NO_BLOCK 0xFF
+
+// Champs utiles d'un message reçu
+struct CoapMessage {
+    uint8_t type;
+    uint8_t code;
+    uint16_t id;
+    uint8_t tokenLength;
+    const uint8_t* token;
+    uint8_t blockSzx;   // COAP_NO_BLOCK sans option Block1
+};
+
+// Valeur étendue d'un champ delta ou longueur d'option (13 ou 14)
+static bool readExtended(uint32_t& value, const uint8_t* data, size_t& offset, size_t length) {
+    if (value == 13) {
+        if (offset + 1 > length) {
+            return false;
+        }
+        value = 13 + data[offset++];
+    } else if (value == 14) {
+        if (offset + 2 > length) {
+            return false;
+        }
+        value = 269 + ((data[offset] << 8) | data[offset + 1]);
+        offset += 2;
+    } else if (value == 15) {
+        return false;
+    }
+    return true;
+}
+
+static bool parseMessage(const uint8_t* data, size_t length, CoapMessage& message) {
+    if (length < 4 || (data[0] >> 6) != 1) {
+        return false;
+    }
+    message.type = (data[0] >> 4) & 0x03;
+    message.tokenLength = data[0] & 0x0F;
+    message.code = data[1];
+    message.id = (data[2] << 8) | data[3];
+    message.token = data + 4;
+    message.blockSzx = COAP_NO_BLOCK;
+    size_t offset = 4 + message.tokenLength;
+    if (message.tokenLength > 8 || offset > length) {
+        return false;
+    }
+
+    uint32_t option = 0;
+    while (offset < length && data[offset] != 0xFF) {
+        uint32_t delta = data[offset] >> 4;
+        uint32_t optionLength = data[offset] & 0x0F;
+        offset++;
+        if (!readExtended(delta, data, offset, length) || !readExtended(optionLength, data, offset, length) ||
+            offset + optionLength > length) {
+            return false;
+        }
+        option += delta;
+        if (option == COAP_OPTION_BLOCK1 && optionLength >= 1 && optionLength <= 3) {
+            message.blockSzx = data[offset + optionLength - 1] & 0x07;
+        }
+        offset += optionLength;
+    }
+    return true;
+}
+
+// c.dd -> c * 100 + dd, comme un code HTTP
+static int codeToStatus(uint8_t code) {
+    return (code >> 5) * 100 + (code & 0x1F);
+}
+
+// Taille de bloc 2^(szx + 4)
+static uint8_t sizeExponent(size_t blockSize) {
+    uint8_t szx = 0;
+    while ((16u << szx) < blockSize) {
+        szx++;
+    }
+    return szx;
+}
+
+static size_t writeOption(uint8_t* out, size_t offset, uint32_t delta, const uint8_t* value, size_t length) {
+    uint8_t* header = out + offset++;
+    uint8_t deltaNibble = delta < 13 ? delta : 13;
+    uint8_t lengthNibble = length < 13 ? length : 13;
+    *header = (deltaNibble << 4) | lengthNibble;
+    if (delta >= 13) {
+        out[offset++] = delta - 13;
+    }
+    if (length >= 13) {
+        out[offset++] = length - 13;
+    }
+    memcpy(out + offset, value, length);
+    return offset + length;
+}
+
+CoapTransport::CoapTransport(const char* host, uint16_t port, bool confirmable)
+    : host(host), port(port), confirmable(confirmable) {
+}
+
+// Identifiants de message et jetons partent d'une valeur tirée de l'adresse
+// MAC et de l'horloge, pour ne pas être pris pour des doublons par le
+// serveur après un redémarrage
+void CoapTransport::begin(const uint8_t deviceMac[6], const char* deviceId) {
+    this->deviceId = deviceId;
+    randomState = halMillis() | 1;
+    for (int i = 0; i < 6; i++) {
+        randomState = randomState * 31 + deviceMac[i];
+    }
+    if (randomState == 0) {
+        randomState = 1;
+    }
+    messageId = (uint16_t)nextRandom();
+    tokenCounter = nextRandom();
+}
+
+// xorshift32 : tirage des délais de retransmission
+uint32_t CoapTransport::nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+// POST /beacon/events, avec l'option Block1 pour un lot en plusieurs blocs
+size_t CoapTransport::buildRequest(uint8_t type, const uint8_t token[4], const uint8_t* payload, size_t length,
+                                   size_t offset, size_t blockSize, bool more, bool blockwise) {
+    size_t n = 0;
+    packet[n++] = 0x40 | (type << 4) | COAP_TOKEN_LENGTH;
+    packet[n++] = COAP_CODE_POST;
+    messageId++;
+    packet[n++] = messageId >> 8;
+    packet[n++] = messageId & 0xFF;
+    memcpy(packet + n, token, COAP_TOKEN_LENGTH);
+    n += COAP_TOKEN_LENGTH;
+
+    uint32_t previous = 0;
+    const char* segment = COAP_RESOURCE;
+    while (*segment) {
+        const char* end = strchr(segment, '/');
+        size_t segmentLength = end ? (size_t)(end - segment) : strlen(segment);
+        n = writeOption(packet, n, COAP_OPTION_URI_PATH - previous, (const uint8_t*)segment, segmentLength);
+        previous = COAP_OPTION_URI_PATH;
+        segment += segmentLength + (end ? 1 : 0);
+    }
+
+    uint8_t format = COAP_FORMAT_JSON;
+    n = writeOption(packet, n, COAP_OPTION_CONTENT_FORMAT - previous, &format, 1);
+    previous = COAP_OPTION_CONTENT_FORMAT;
+
+    if (blockwise) {
+        uint32_t block = ((offset / blockSize) << 4) | (more ? 0x08 : 0) | sizeExponent(blockSize);
+        uint8_t value[3];
+        size_t valueLength = 0;
+        if (block > 0xFFFF) {
+            value[valueLength++] = block >> 16;
+        }
+        if (block > 0xFF) {
+            value[valueLength++] = block >> 8;
+        }
+        if (block > 0) {
+            value[valueLength++] = block;
+        }
+        n = writeOption(packet, n, COAP_OPTION_BLOCK1 - previous, value, valueLength);
+    }
+
+    packet[n++] = 0xFF;
+    memcpy(packet + n, payload + offset, length);
+    return n + length;
+}
+
+void CoapTransport::acknowledge(uint16_t id) {
+    uint8_t ack[4] = {(uint8_t)(0x40 | (COAP_TYPE_ACK << 4)), 0, (uint8_t)(id >> 8), (uint8_t)(id & 0xFF)};
+    halDatagram().sendTo(host, port, ack, sizeof(ack));
+}
+
+// Envoi CON de packet, retransmis jusqu'à l'ACK. Retourne le statut de la
+// réponse (portée par l'ACK ou séparée) et la taille de bloc du serveur
+int CoapTransport::exchange(size_t length, const uint8_t token[4], uint8_t* blockSzx) {
+    uint16_t id = messageId;
+    uint32_t timeout = COAP_ACK_TIMEOUT +
+                       nextRandom() % ((uint32_t)(COAP_ACK_TIMEOUT * (COAP_ACK_RANDOM_FACTOR - 1)) + 1);
+
+    for (int attempt = 0; attempt <= COAP_MAX_RETRANSMIT; attempt++) {
+        if (!halDatagram().sendTo(host, port, packet, length)) {
+            return COAP_ERROR_SOCKET;
+        }
+        if (attempt > 0) {
+            retransmissions++;
+            LOG_DEBUG("CoAP: retransmission %d du message %u", attempt, (unsigned)id);
+        }
+
+        uint32_t start = halMillis();
+        while (halMillis() - start < timeout) {
+            int received = halDatagram().receive(response, sizeof(response));
+            CoapMessage message;
+            if (received <= 0 || !parseMessage(response, received, message)) {
+                if (!halNetwork().connected()) {
+                    return COAP_ERROR_SOCKET;
+                }
+                halDelay(1);
+                continue;
+            }
+            bool ours = message.tokenLength == COAP_TOKEN_LENGTH && memcmp(message.token, token, COAP_TOKEN_LENGTH) == 0;
+
+            if (message.id == id && message.type == COAP_TYPE_RST) {
+                return COAP_ERROR_RESET;
+            }
+            if (message.id == id && message.type == COAP_TYPE_ACK) {
+                if (message.code == 0) {
+                    return awaitSeparate(token, blockSzx); // Réponse différée par le serveur
+                }
+                if (!ours) {
+                    return COAP_ERROR_PROTOCOL;
+                }
+                *blockSzx = message.blockSzx;
+                return codeToStatus(message.code);
+            }
+            // Réponse séparée arrivée avant l'ACK (ACK perdu)
+            if (ours && message.code >= 0x40 && message.type != COAP_TYPE_ACK) {
+                if (message.type == COAP_TYPE_CON) {
+                    acknowledge(message.id);
+                }
+                *blockSzx = message.blockSzx;
+                return codeToStatus(message.code);
+            }
+            // Sinon : doublon d'un échange précédent, ignoré
+        }
+        timeout *= 2;
+    }
+    return COAP_ERROR_TIMEOUT;
+}
+
+int CoapTransport::awaitSeparate(const uint8_t token[4], uint8_t* blockSzx) {
+    uint32_t start = halMillis();
+    while (halMillis() - start < COAP_RESPONSE_TIMEOUT) {
+        int received = halDatagram().receive(response, sizeof(response));
+        CoapMessage message;
+        if (received <= 0 || !parseMessage(response, received, message)) {
+            halDelay(1);
+            continue;
+        }
+        if (message.tokenLength == COAP_TOKEN_LENGTH && memcmp(message.token, token, COAP_TOKEN_LENGTH) == 0 &&
+            message.code >= 0x40) {
+            if (message.type == COAP_TYPE_CON) {
+                acknowledge(message.id);
+            }
+            *blockSzx = message.blockSzx;
+            return codeToStatus(message.code);
+        }
+    }
+    return COAP_ERROR_TIMEOUT;
+}
+
+// [{"deviceId": "...", "timestamp": ..., ...}, ...]. En mode CON, chaque
+// bloc attend son 2.31 Continue avant le suivant ; la taille de bloc est
+// réduite si le serveur le demande (2.31 ou 4.13 avec Block1). En mode NON,
+// les blocs partent à la suite et le lot est acquitté localement.
+int CoapTransport::send(const PendingEvent* events, size_t count) {
+    if (!halDatagram().begin()) {
+        return COAP_ERROR_SOCKET;
+    }
+    // Réponses tardives d'un échange précédent
+    while (halDatagram().receive(response, sizeof(response)) > 0) {
+    }
+
+    DynamicJsonDocument doc(256 + count * 512);
+    JsonArray array = doc.to<JsonArray>();
+    TraceClock clock = TraceClock::now();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject item = array.createNestedObject();
+        item["deviceId"] = deviceId;
+        eventToJson(events[i], item, clock);
+    }
+    String payload;
+    serializeJson(doc, payload);
+    const uint8_t* data = (const uint8_t*)payload.c_str();
+    size_t length = payload.length();
+
+    uint8_t token[COAP_TOKEN_LENGTH];
+    uint32_t tokenValue = ++tokenCounter;
+    memcpy(token, &tokenValue, sizeof(token));
+
+    size_t blockSize = COAP_BLOCK_SIZE;
+    bool blockwise = length > blockSize;
+    size_t offset = 0;
+    for (;;) {
+        size_t chunk = length - offset < blockSize ? length - offset : blockSize;
+        bool more = offset + chunk < length;
+        size_t packetLength = buildRequest(confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, token, data, chunk,
+                                           offset, blockSize, more, blockwise);
+
+        if (!confirmable) {
+            if (!halDatagram().sendTo(host, port, packet, packetLength)) {
+                return COAP_ERROR_SOCKET;
+            }
+            if (!more) {
+                LOG_DEBUG("Lot CoAP envoyé (NON): %d événements, %d octets", (int)count, (int)length);
+                return 200;
+            }
+            offset += chunk;
+            continue;
+        }
+
+        uint8_t blockSzx = COAP_NO_BLOCK;
+        int status = exchange(packetLength, token, &blockSzx);
+        bool smaller = blockSzx != COAP_NO_BLOCK && (16u << blockSzx) < blockSize;
+
+        if (status == codeToStatus(COAP_CODE_TOO_LARGE) && smaller) {
+            blockSize = 16u << blockSzx; // Même bloc, en plus petit
+            blockwise = true;
+            continue;
+        }
+        if (status == codeToStatus(COAP_CODE_CONTINUE) && more) {
+            offset += chunk;
+            if (smaller) {
+                blockSize = 16u << blockSzx;
+            }
+            continue;
+        }
+        if (status < 0 || status >= 300) {
+            return status;
+        }
+        if (more || status == codeToStatus(COAP_CODE_CONTINUE)) {
+            return COAP_ERROR_PROTOCOL; // Serveur qui ignore Block1
+        }
+        LOG_DEBUG("Lot CoAP acquitté: %d événements, %d octets", (int)count, (int)length);
+        return status;
+    }
+}
+
+const char* CoapTransport::errorToString(int code) {
+    switch (code) {
+    case COAP_ERROR_SOCKET:
+        return "socket UDP indisponible";
+    case COAP_ERROR_TIMEOUT:
+        return "acquittement CoAP non reçu";
+    case COAP_ERROR_RESET:
+        return "message rejeté par le serveur CoAP";
+    case COAP_ERROR_PROTOCOL:
+        return "réponse CoAP incohérente";
+    default:
+        return "erreur CoAP";
+    }
+}
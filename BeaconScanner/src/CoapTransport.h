@@ -0,0 +1,89 @@
+#ifndef COAP_TRANSPORT_H
+#define COAP_TRANSPORT_H
+
+#include "EventTransport.h"
+
+// Ressource de CoapServer.js
+#ifndef COAP_RESOURCE
+#define COAP_RESOURCE "beacon/events"
+#endif
+
+// 1 : messages confirmables (CON), retransmis jusqu'à l'acquittement du
+// serveur. 0 : non confirmables (NON), sans attente ni retransmission ; le
+// lot est considéré envoyé dès le dernier datagramme parti, et perdu si le
+// réseau le perd
+#ifndef COAP_CONFIRMABLE
+#define COAP_CONFIRMABLE 1
+#endif
+
+// Taille des blocs (option Block1, RFC 7959) : puissance de deux de 16 à
+// 1024. Un lot plus grand est envoyé en plusieurs blocs
+#ifndef COAP_BLOCK_SIZE
+#define COAP_BLOCK_SIZE 512
+#endif
+
+// Retransmissions en mode CON (RFC 7252, 4.8) : premier délai tiré entre
+// COAP_ACK_TIMEOUT et COAP_ACK_TIMEOUT * COAP_ACK_RANDOM_FACTOR, doublé à
+// chaque essai
+#ifndef COAP_ACK_TIMEOUT
+#define COAP_ACK_TIMEOUT 2000
+#endif
+#ifndef COAP_ACK_RANDOM_FACTOR
+#define COAP_ACK_RANDOM_FACTOR 1.5
+#endif
+#ifndef COAP_MAX_RETRANSMIT
+#define COAP_MAX_RETRANSMIT 4
+#endif
+
+// Attente d'une réponse séparée, après un ACK vide du serveur
+#ifndef COAP_RESPONSE_TIMEOUT
+#define COAP_RESPONSE_TIMEOUT 5000
+#endif
+
+static_assert(COAP_BLOCK_SIZE >= 16 && COAP_BLOCK_SIZE <= 1024 && (COAP_BLOCK_SIZE & (COAP_BLOCK_SIZE - 1)) == 0,
+              "COAP_BLOCK_SIZE doit être une puissance de deux entre 16 et 1024");
+
+// Codes d'erreur de send(), négatifs comme ceux de HTTPClient
+enum CoapError {
+    COAP_ERROR_SOCKET = -1,      // Socket UDP indisponible ou envoi refusé
+    COAP_ERROR_TIMEOUT = -2,     // Pas d'acquittement après les retransmissions
+    COAP_ERROR_RESET = -3,       // Message rejeté par le serveur (RST)
+    COAP_ERROR_PROTOCOL = -4     // Réponse incohérente
+};
+
+// POST direct sur la ressource de CoapServer.js, sans passer par le
+// contrôleur : un tableau JSON d'événements par lot, découpé en blocs
+// Block1 s'il dépasse COAP_BLOCK_SIZE. Le code de réponse CoAP c.dd est
+// rendu sous la forme c * 100 + dd (2.04 -> 204, 5.03 -> 503).
+class CoapTransport : public EventTransport {
+private:
+    const char* host;
+    uint16_t port;
+    bool confirmable;
+    String deviceId;
+    uint16_t messageId = 0;
+    uint32_t tokenCounter = 0;
+    uint32_t randomState = 1;
+    uint32_t retransmissions = 0;
+    uint8_t packet[COAP_BLOCK_SIZE + 16 + 2 * sizeof(COAP_RESOURCE)]; // En-tête, options, bloc
+    uint8_t response[128];
+
+    uint32_t nextRandom();
+    size_t buildRequest(uint8_t type, const uint8_t token[4], const uint8_t* payload, size_t length,
+                        size_t offset, size_t blockSize, bool more, bool blockwise);
+    int exchange(size_t length, const uint8_t token[4], uint8_t* blockSzx);
+    int awaitSeparate(const uint8_t token[4], uint8_t* blockSzx);
+    void acknowledge(uint16_t id);
+
+public:
+    CoapTransport(const char* host, uint16_t port, bool confirmable = COAP_CONFIRMABLE);
+
+    const char* name() const override { return confirmable ? "coap" : "coap-non"; }
+    void begin(const uint8_t deviceMac[6], const char* deviceId) override;
+    int send(const PendingEvent* events, size_t count) override;
+    const char* errorToString(int code) override;
+
+    uint32_t retransmissionCount() const { return retransmissions; }
+};
+
+#endif
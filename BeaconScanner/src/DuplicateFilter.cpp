@@ -0,0 +1,75 @@
+#include "DuplicateFilter.h"
+#include <string.h>
+
+// FNV-1a 32 bits
+static uint32_t hashBytes(const uint8_t* data, size_t length, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+DuplicateFilter::DuplicateFilter() : overrideCount(0), suppressed(0) {
+    memset(slots, 0, sizeof(slots));
+}
+
+uint16_t DuplicateFilter::refreshFor(const uint8_t address[6]) const {
+    for (size_t i = 0; i < overrideCount; i++) {
+        if (memcmp(overrides[i].address, address, sizeof(overrides[i].address)) == 0) {
+            return overrides[i].refreshMs;
+        }
+    }
+    return ADV_DEDUP_REFRESH;
+}
+
+bool DuplicateFilter::accept(const AdvRecord& record) {
+#if ADV_DEDUP
+    uint32_t addressHash = hashBytes(record.address, sizeof(record.address));
+    uint32_t payloadHash = hashBytes(record.payload, record.payloadLength, addressHash) | 1;
+    int8_t rssiBucket = (int8_t)((record.rssi + 128) / ADV_DEDUP_RSSI_STEP);
+    Slot& slot = slots[(payloadHash >> 1) & (ADV_DEDUP_SLOTS - 1)];
+
+    if (slot.payloadHash == payloadHash && slot.addressHash == addressHash) {
+        if (slot.rssiBucket == rssiBucket && record.timestamp - slot.forwardedAt < slot.refreshMs) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } else {
+        // Nouvelle trame, ou collision : l'intervalle du beacon n'est
+        // cherché qu'ici, pas à chaque annonce
+        slot.addressHash = addressHash;
+        slot.payloadHash = payloadHash;
+        slot.refreshMs = refreshFor(record.address);
+    }
+    slot.rssiBucket = rssiBucket;
+    slot.forwardedAt = record.timestamp;
+#else
+    (void)record;
+#endif
+    return true;
+}
+
+bool DuplicateFilter::setRefreshInterval(const uint8_t address[6], uint16_t refreshMs) {
+    size_t index = 0;
+    while (index < overrideCount && memcmp(overrides[index].address, address, 6) != 0) {
+        index++;
+    }
+    if (index == ADV_DEDUP_OVERRIDES) {
+        return false;
+    }
+    if (index == overrideCount) {
+        memcpy(overrides[index].address, address, 6);
+        overrideCount++;
+    }
+    overrides[index].refreshMs = refreshMs;
+
+    // Les entrées existantes de ce beacon reprennent le nouvel intervalle
+    uint32_t addressHash = hashBytes(address, 6);
+    for (size_t i = 0; i < ADV_DEDUP_SLOTS; i++) {
+        if (slots[i].addressHash == addressHash) {
+            slots[i].refreshMs = refreshMs;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef DUPLICATE_FILTER_H
+#define DUPLICATE_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "AdvRecord.h"
+
+// 0 : toutes les annonces vont dans la file de suivi
+#ifndef ADV_DEDUP
+#define ADV_DEDUP 1
+#endif
+
+// Entrées du cache (puissance de deux), 16 octets chacune
+#ifndef ADV_DEDUP_SLOTS
+#define ADV_DEDUP_SLOTS 256
+#endif
+
+// Une annonce inchangée est transmise au plus une fois par intervalle (ms)
+#ifndef ADV_DEDUP_REFRESH
+#define ADV_DEDUP_REFRESH 1000
+#endif
+
+// Largeur des tranches de RSSI (dB) : un changement de tranche compte
+// comme une annonce différente
+#ifndef ADV_DEDUP_RSSI_STEP
+#define ADV_DEDUP_RSSI_STEP 4
+#endif
+
+// Intervalles propres à certains beacons (setRefreshInterval)
+#ifndef ADV_DEDUP_OVERRIDES
+#define ADV_DEDUP_OVERRIDES 16
+#endif
+
+// Rejet précoce des annonces en double, dans la tâche radio, avant la file
+// de suivi. Le balayage actif remonte chaque annonce et chaque réponse de
+// scan plusieurs fois par seconde ; une annonce de même adresse, même
+// contenu et même tranche de RSSI que la dernière transmise, moins de
+// ADV_DEDUP_REFRESH ms plus tôt, est écartée sans autre traitement.
+//
+// Cache à correspondance directe indexé par l'empreinte (adresse, contenu) :
+// un beacon qui alterne plusieurs trames occupe une entrée par trame. Une
+// collision ne fait qu'écraser l'entrée, et l'annonce est transmise.
+class DuplicateFilter {
+    static_assert(ADV_DEDUP_SLOTS >= 2 && (ADV_DEDUP_SLOTS & (ADV_DEDUP_SLOTS - 1)) == 0,
+                  "ADV_DEDUP_SLOTS doit être une puissance de deux");
+
+private:
+    struct Slot {
+        uint32_t addressHash;
+        uint32_t payloadHash;   // 0 : entrée libre
+        uint32_t forwardedAt;   // Dernière annonce transmise
+        uint16_t refreshMs;
+        int8_t rssiBucket;
+    };
+
+    struct Override {
+        uint8_t address[6];
+        uint16_t refreshMs;
+    };
+
+    Slot slots[ADV_DEDUP_SLOTS];
+    Override overrides[ADV_DEDUP_OVERRIDES];
+    size_t overrideCount;
+    std::atomic<uint32_t> suppressed;
+
+    uint16_t refreshFor(const uint8_t address[6]) const;
+
+public:
+    DuplicateFilter();
+
+    // Appelé par la tâche radio pour chaque annonce : false si c'est un
+    // doublon à écarter. Sans allocation ni verrou.
+    bool accept(const AdvRecord& record);
+
+    // Intervalle propre à un beacon (0 : aucune annonce écartée), au plus
+    // 65535 ms. À appeler avant halRadio().begin() : le cache n'est pas
+    // protégé contre un appel concurrent. Retourne false si la table est
+    // pleine.
+    bool setRefreshInterval(const uint8_t address[6], uint16_t refreshMs);
+
+    uint32_t suppressedCount() const { return suppressed.load(std::memory_order_relaxed); }
+};
+
+#endif
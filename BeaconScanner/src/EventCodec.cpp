@@ -0,0 +1,125 @@
+#include "EventCodec.h"
+#include <string.h>
+
+static inline void writeLE16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static inline void writeLE32(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static inline void writeLE64(uint8_t* p, uint64_t value) {
+    writeLE32(p, (uint32_t)value);
+    writeLE32(p + 4, (uint32_t)(value >> 32));
+}
+
+// Heure réelle de l'instant millis() 0 pour cet événement (0 : inconnue).
+// Les événements de ce démarrage ont tous celle de clock.
+static uint64_t epochBase(const PendingEvent& event, const TraceClock& clock) {
+    uint64_t enqueued = clock.enqueuedAt(event);
+    return enqueued != 0 ? enqueued - event.timestamp : 0;
+}
+
+// Nombre d'événements qui tiennent dans une trame commençant à first, et
+// table des UUID correspondante
+static size_t planFrame(const PendingEvent* events, size_t count, size_t first, const TraceClock& clock,
+                        const uint8_t* uuids[EVENT_CODEC_MAX_UUIDS], uint8_t& uuidCount) {
+    uuidCount = 0;
+    size_t n = 0;
+    uint32_t previous = events[first].timestamp;
+    uint64_t base = epochBase(events[first], clock);
+
+    for (size_t i = first; i < count && n < 255; i++) {
+        const PendingEvent& event = events[i];
+        if (event.timestamp - previous > 0xFFFF || epochBase(event, clock) != base) {
+            break;
+        }
+        if (event.beacon.isIBeacon) {
+            uint8_t k = 0;
+            while (k < uuidCount && memcmp(uuids[k], event.beacon.proximityUUID, 16) != 0) {
+                k++;
+            }
+            if (k == uuidCount) {
+                if (uuidCount == EVENT_CODEC_MAX_UUIDS) {
+                    break;
+                }
+                uuids[uuidCount++] = event.beacon.proximityUUID;
+            }
+        }
+        previous = event.timestamp;
+        n++;
+    }
+    return n;
+}
+
+size_t encodeEvents(const uint8_t deviceId[6], const PendingEvent* events, size_t count, const TraceClock& clock,
+                    uint8_t* out, size_t outSize) {
+    size_t pos = 0;
+    size_t first = 0;
+
+    while (first < count) {
+        const uint8_t* uuids[EVENT_CODEC_MAX_UUIDS];
+        uint8_t uuidCount;
+        size_t n = planFrame(events, count, first, clock, uuids, uuidCount);
+
+        size_t frameSize = EVENT_CODEC_HEADER_SIZE + uuidCount * 16 + n * EVENT_CODEC_EVENT_SIZE;
+        if (pos + frameSize > outSize) {
+            return 0;
+        }
+
+        uint8_t* p = out + pos;
+        p[0] = 'B';
+        p[1] = 'S';
+        p[2] = EVENT_CODEC_VERSION;
+        p[3] = uuidCount;
+        memcpy(p + 4, deviceId, 6);
+        writeLE32(p + 10, events[first].timestamp);
+        p[14] = (uint8_t)n;
+        uint64_t base = epochBase(events[first], clock);
+        writeLE64(p + 15, base != 0 ? base + events[first].timestamp : 0);
+        writeLE64(p + 23, clock.epoch);
+        p += EVENT_CODEC_HEADER_SIZE;
+
+        for (uint8_t k = 0; k < uuidCount; k++) {
+            memcpy(p, uuids[k], 16);
+            p += 16;
+        }
+
+        uint32_t previous = events[first].timestamp;
+        for (size_t i = first; i < first + n; i++) {
+            const PendingEvent& event = events[i];
+            const BeaconInfo& beacon = event.beacon;
+
+            uint8_t uuidIndex = 0xFF;
+            if (beacon.isIBeacon) {
+                for (uint8_t k = 0; k < uuidCount; k++) {
+                    if (memcmp(uuids[k], beacon.proximityUUID, 16) == 0) {
+                        uuidIndex = k;
+                        break;
+                    }
+                }
+            }
+
+            p[0] = (uint8_t)((event.eventType & 0x01) | (beacon.frameType << 4));
+            p[1] = uuidIndex;
+            writeLE16(p + 2, (uint16_t)(event.timestamp - previous));
+            memcpy(p + 4, beacon.address, 6);
+            writeLE16(p + 10, beacon.major);
+            writeLE16(p + 12, beacon.minor);
+            p[14] = (uint8_t)beacon.rssi;
+            p[15] = (uint8_t)beacon.txPower;
+            writeLE32(p + 16, event.traceId);
+            writeLE32(p + 20, event.timestamp - event.receivedAt);
+            p += EVENT_CODEC_EVENT_SIZE;
+            previous = event.timestamp;
+        }
+
+        pos += frameSize;
+        first += n;
+    }
+    return pos;
+}
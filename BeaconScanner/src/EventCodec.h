@@ -0,0 +1,62 @@
+#ifndef EVENT_CODEC_H
+#define EVENT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "PendingEvent.h"
+#include "TraceClock.h"
+
+// Type MIME du format binaire, reconnu par controller.js (Backend/eventCodec.js)
+#define EVENT_CODEC_CONTENT_TYPE "application/x-beacon-events"
+
+#define EVENT_CODEC_VERSION 2
+#define EVENT_CODEC_MAX_UUIDS 8           // UUID de proximité distincts par trame
+#define EVENT_CODEC_HEADER_SIZE 31
+#define EVENT_CODEC_EVENT_SIZE 24
+
+// Format binaire compact (petit-boutiste), une ou plusieurs trames à la suite :
+//
+// Trame :
+//   0-1   'B' 'S'                  magic
+//   2     version (2)
+//   3     nombre d'UUID de la table (u)
+//   4-9   identifiant de l'ESP32 (adresse MAC WiFi)
+//   10-13 horodatage de base (ms, millis())
+//   14    nombre d'événements (n)
+//   15-22 heure réelle de l'horodatage de base (ms depuis 1970, 0 : inconnue)
+//   23-30 heure réelle de l'envoi (idem)
+//   31    u x 16 octets : table des UUID de proximité
+//   puis  n x 24 octets : événements
+//
+// Événement :
+//   0     bit 0 : type (0 arrivée, 1 départ) ; bits 4-7 : type de trame beacon
+//   1     index dans la table des UUID (0xFF : aucun)
+//   2-3   écart (ms) avec l'événement précédent (ou la base)
+//   4-9   adresse MAC du beacon
+//   10-11 major
+//   12-13 minor
+//   14    RSSI (signé)
+//   15    puissance TX (signée)
+//   16-19 identifiant de trace
+//   20-23 délai (ms) entre la réception de l'annonce et la mise en file
+//
+// L'heure réelle de mise en file d'un événement est celle de la base plus
+// la somme des écarts. Une nouvelle trame commence quand l'écart dépasse
+// 16 bits, que la table des UUID est pleine ou que l'événement n'a pas le
+// même décalage entre millis() et l'heure réelle (spool d'un démarrage
+// précédent). Le nom et l'UUID de service ne sont pas transmis. La
+// version 1 (sans heure réelle ni trace, événements de 16 octets) reste
+// acceptée par le décodeur.
+
+// Encode count événements ; clock est relevée au moment de l'envoi.
+// Retourne la taille écrite, ou 0 si out est trop petit (prévoir
+// encodedSizeBound(count) octets).
+size_t encodeEvents(const uint8_t deviceId[6], const PendingEvent* events, size_t count, const TraceClock& clock,
+                    uint8_t* out, size_t outSize);
+
+// Taille maximale produite pour count événements (une trame par événement)
+constexpr size_t encodedSizeBound(size_t count) {
+    return count * (EVENT_CODEC_HEADER_SIZE + 16 + EVENT_CODEC_EVENT_SIZE);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "EventPush.h"
+#include <string.h>
+#include "EventTransport.h"
+
+EventPush::EventPush() : subscriberCount(0), notified(false), notify(nullptr), messageCount(0), rejectedCount(0) {
+    deviceId[0] = '\0';
+}
+
+void EventPush::setDeviceId(const char* id) {
+    strlcpy(deviceId, id, sizeof(deviceId));
+}
+
+void EventPush::publish(const PendingEvent& event) {
+    if (subscriberCount.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    queue.push(event);
+    // Un seul réveil tant que le serveur web n'a pas vidé la file
+    if (!notified.exchange(true) && notify) {
+        notify();
+    }
+}
+
+bool EventPush::subscribe(int subscriber) {
+    uint32_t count = subscriberCount.load(std::memory_order_relaxed);
+    if (count >= EVENT_PUSH_SUBSCRIBERS) {
+        rejectedCount++;
+        return false;
+    }
+    if (count == 0) {
+        // Un publish() qui a vu le dernier abonné a pu remplir la file après
+        // son départ : le nouvel abonné ne reçoit que la suite
+        queue.discard();
+    }
+    subscribers[count] = subscriber;
+    subscriberCount.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+void EventPush::unsubscribe(int subscriber) {
+    uint32_t count = subscriberCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; i++) {
+        if (subscribers[i] == subscriber) {
+            subscribers[i] = subscribers[count - 1];
+            subscriberCount.store(count - 1, std::memory_order_release);
+            if (count == 1) {
+                queue.discard();  // Plus personne pour les recevoir
+            }
+            return;
+        }
+    }
+}
+
+// Même message que MqttTransport::formatEvent
+size_t EventPush::format(const PendingEvent& event, char* out, size_t size) {
+    StaticJsonDocument<EVENT_PUSH_MESSAGE_MAX> doc;
+    JsonObject item = doc.to<JsonObject>();
+    item["deviceId"] = (const char*)deviceId;
+    eventToJson(event, item, TraceClock::now());
+    return serializeJson(doc, out, size);
+}
+
+size_t EventPush::drain(EventPushSender send) {
+    notified.store(false);
+    size_t count = 0;
+    PendingEvent event;
+    // Le départ du dernier abonné vide la file : la boucle s'arrête avec lui
+    while (queue.pop(event)) {
+        char message[EVENT_PUSH_MESSAGE_MAX];
+        size_t length = format(event, message, sizeof(message));
+        bool delivered = false;
+        uint32_t i = 0;
+        while (i < subscriberCount.load(std::memory_order_relaxed)) {
+            if (send(subscribers[i], message, length)) {
+                delivered = true;
+                i++;
+            } else {
+                unsubscribe(subscribers[i]);  // Le dernier prend sa place
+            }
+        }
+        if (delivered) {
+            messageCount++;
+            count++;
+        }
+    }
+    return count;
+}
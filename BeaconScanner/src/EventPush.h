@@ -0,0 +1,86 @@
+#ifndef EVENT_PUSH_H
+#define EVENT_PUSH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "AdvRingBuffer.h"
+#include "PendingEvent.h"
+
+// Événements en attente de diffusion (puissance de deux). Déborde surtout
+// au démarrage, quand tous les beacons arrivent ensemble : 144 octets par
+// place
+#ifndef EVENT_PUSH_QUEUE
+#define EVENT_PUSH_QUEUE 32
+#endif
+
+// Abonnés simultanés de /ws
+#ifndef EVENT_PUSH_SUBSCRIBERS
+#define EVENT_PUSH_SUBSCRIBERS 4
+#endif
+
+// Taille maximale d'un message (octets)
+#ifndef EVENT_PUSH_MESSAGE_MAX
+#define EVENT_PUSH_MESSAGE_MAX 512
+#endif
+
+// Envoie un message à un abonné ; false si l'abonné n'est plus joignable
+typedef bool (*EventPushSender)(int subscriber, const char* data, size_t length);
+
+// Prévient le serveur web qu'il y a des événements à diffuser (depuis la
+// tâche de suivi : ne doit pas bloquer)
+typedef void (*EventPushNotify)();
+
+// Diffusion en direct des arrivées et départs aux abonnés du WebSocket /ws,
+// un message JSON par événement, comme les messages MQTT :
+//   {"deviceId":"ESP32_...","traceId":"5f3a09c2","timestamp":...,
+//    "beaconId":"...","rssi":-67,"eventType":"arrival","trace":{...}}
+// publish() est appelé par SendEvents à la mise en file (tâche de suivi) :
+// sans abonné, il ne coûte qu'une lecture atomique. L'événement est copié
+// dans une file circulaire (perdu si le serveur web prend trop de
+// retard) et notify() réveille le serveur web, qui appelle
+// drain() depuis sa tâche. Les abonnés ne sont modifiés que par cette
+// tâche. Indépendant de l'envoi : un abonné reçoit les événements même
+// quand le contrôleur est injoignable.
+class EventPush {
+private:
+    AdvRingBuffer<PendingEvent, EVENT_PUSH_QUEUE> queue;
+    int subscribers[EVENT_PUSH_SUBSCRIBERS];
+    std::atomic<uint32_t> subscriberCount;
+    std::atomic<bool> notified;
+    EventPushNotify notify;
+    char deviceId[24];
+
+    std::atomic<uint32_t> messageCount;
+    std::atomic<uint32_t> rejectedCount;    // Abonnés refusés (liste pleine)
+
+    size_t format(const PendingEvent& event, char* out, size_t size);
+
+public:
+    EventPush();
+
+    // Avant le premier abonné : réveil du serveur web (main.cpp) et
+    // identifiant de l'ESP32 (SendEvents::init())
+    void setNotify(EventPushNotify fn) { notify = fn; }
+    void setDeviceId(const char* id);
+
+    // Tâche de suivi
+    void publish(const PendingEvent& event);
+
+    // Tâche du serveur web. subscribe() retourne false si la liste est
+    // pleine. Sans abonné, la file est vidée : un nouvel abonné ne reçoit
+    // pas d'événements antérieurs à sa connexion.
+    bool subscribe(int subscriber);
+    void unsubscribe(int subscriber);
+
+    // Envoie les événements en attente à chaque abonné ; ceux dont l'envoi
+    // échoue sont retirés. Retourne le nombre d'événements diffusés.
+    size_t drain(EventPushSender send);
+
+    uint32_t subscriberTotal() const { return subscriberCount.load(std::memory_order_relaxed); }
+    uint32_t messages() const { return messageCount.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return queue.droppedCount(); }
+    uint32_t rejected() const { return rejectedCount.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,404 @@
+#include "EventSpool.h"
+#include "Hal.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+#else
+#include <stdio.h>
+#endif
+
+// Case de persistance de la queue, ajoutée à la suite dans le secteur de
+// métadonnées en cours
+struct SpoolMeta {
+    uint32_t tail;
+    uint32_t check;  // ~tail : détecte une écriture interrompue
+};
+
+static const uint32_t META_ENTRIES = SPOOL_SECTOR_SIZE / sizeof(SpoolMeta);
+
+static bool isBlank(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// PartitionSpoolStorage
+
+#ifdef ARDUINO
+
+PartitionSpoolStorage::PartitionSpoolStorage() : handle(nullptr) {}
+
+PartitionSpoolStorage::~PartitionSpoolStorage() {}
+
+bool PartitionSpoolStorage::open(const char* label) {
+    handle = const_cast<esp_partition_t*>(
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label));
+    return handle != nullptr;
+}
+
+size_t PartitionSpoolStorage::size() const {
+    return handle ? static_cast<const esp_partition_t*>(handle)->size : 0;
+}
+
+bool PartitionSpoolStorage::readAt(uint32_t offset, void* data, size_t length) {
+    return esp_partition_read(static_cast<const esp_partition_t*>(handle), offset, data, length) == ESP_OK;
+}
+
+bool PartitionSpoolStorage::writeAt(uint32_t offset, const void* data, size_t length) {
+    return esp_partition_write(static_cast<const esp_partition_t*>(handle), offset, data, length) == ESP_OK;
+}
+
+bool PartitionSpoolStorage::erase(uint32_t offset, size_t length) {
+    return esp_partition_erase_range(static_cast<const esp_partition_t*>(handle), offset, length) == ESP_OK;
+}
+
+#else
+
+PartitionSpoolStorage::PartitionSpoolStorage() : handle(nullptr) {}
+
+PartitionSpoolStorage::~PartitionSpoolStorage() {
+    if (handle) {
+        fclose(static_cast<FILE*>(handle));
+    }
+}
+
+// Fichier créé vierge (0xFF), comme une partition neuve
+bool PartitionSpoolStorage::open(const char* label) {
+    char path[128];
+    snprintf(path, sizeof(path), STORAGE_ROOT "/%s.bin", label);
+    FILE* file = fopen(path, "r+b");
+    if (!file) {
+        file = fopen(path, "w+b");
+        if (!file) {
+            return false;
+        }
+    }
+    fseek(file, 0, SEEK_END);
+    long existing = ftell(file);
+    if (existing >= 0 && (size_t)existing < SPOOL_HOST_PARTITION_SIZE) {
+        uint8_t blank[64];
+        memset(blank, 0xFF, sizeof(blank));
+        for (size_t written = existing; written < SPOOL_HOST_PARTITION_SIZE; written += sizeof(blank)) {
+            size_t length = SPOOL_HOST_PARTITION_SIZE - written;
+            fwrite(blank, 1, length < sizeof(blank) ? length : sizeof(blank), file);
+        }
+        fflush(file);
+    }
+    handle = file;
+    return true;
+}
+
+size_t PartitionSpoolStorage::size() const {
+    return handle ? SPOOL_HOST_PARTITION_SIZE : 0;
+}
+
+bool PartitionSpoolStorage::readAt(uint32_t offset, void* data, size_t length) {
+    FILE* file = static_cast<FILE*>(handle);
+    return offset + length <= SPOOL_HOST_PARTITION_SIZE && fseek(file, offset, SEEK_SET) == 0 &&
+           fread(data, 1, length, file) == length;
+}
+
+// Comme sur la flash, l'écriture ne peut que passer des bits à 0
+bool PartitionSpoolStorage::writeAt(uint32_t offset, const void* data, size_t length) {
+    FILE* file = static_cast<FILE*>(handle);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint8_t current[64];
+    for (size_t done = 0; done < length; done += sizeof(current)) {
+        size_t chunk = length - done < sizeof(current) ? length - done : sizeof(current);
+        if (!readAt(offset + done, current, chunk)) {
+            return false;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            current[i] &= bytes[done + i];
+        }
+        if (fseek(file, offset + done, SEEK_SET) != 0 || fwrite(current, 1, chunk, file) != chunk) {
+            return false;
+        }
+    }
+    return fflush(file) == 0;
+}
+
+bool PartitionSpoolStorage::erase(uint32_t offset, size_t length) {
+    FILE* file = static_cast<FILE*>(handle);
+    if (offset % SPOOL_SECTOR_SIZE != 0 || length % SPOOL_SECTOR_SIZE != 0 ||
+        offset + length > SPOOL_HOST_PARTITION_SIZE || fseek(file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    uint8_t blank[256];
+    memset(blank, 0xFF, sizeof(blank));
+    for (size_t done = 0; done < length; done += sizeof(blank)) {
+        if (fwrite(blank, 1, sizeof(blank), file) != sizeof(blank)) {
+            return false;
+        }
+    }
+    return fflush(file) == 0;
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// EventSpool
+
+EventSpool::EventSpool(SpoolStorage& storage)
+    : storage(storage), slots(0), head(1), flushedHead(1), tail(1), bootHead(1), peeked(1), metaSector(0), metaEntry(0),
+      overwrittenCount(0) {
+}
+
+uint16_t EventSpool::crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void EventSpool::toRecord(const PendingEvent& event, uint32_t sequence, SpoolRecord& record) {
+    const BeaconInfo& beacon = event.beacon;
+    memset(&record, 0, sizeof(record));
+    record.sequence = sequence;
+    record.timestamp = event.timestamp;
+    record.traceId = event.traceId;
+    uint64_t epoch = event.epoch == EVENT_EPOCH_UNKNOWN ? 0 : event.epoch;
+    record.epochLow = (uint32_t)epoch;
+    record.epochHigh = (uint16_t)(epoch >> 32);
+    uint32_t receivedAgo = event.timestamp - event.receivedAt;
+    record.receivedAgo = receivedAgo > 0xFFFF ? 0xFFFF : (uint16_t)receivedAgo;
+    memcpy(record.address, beacon.address, sizeof(record.address));
+    record.flags = (beacon.isIBeacon ? 1 : 0) | (event.eventType == EVENT_DEPARTURE ? 2 : 0);
+    record.frameType = beacon.frameType;
+    record.rssi = beacon.rssi;
+    record.txPower = beacon.txPower;
+    record.major = beacon.major;
+    record.minor = beacon.minor;
+    memcpy(record.proximityUUID, beacon.proximityUUID, sizeof(record.proximityUUID));
+    // Complété de zéros par le memset, non terminé si le nom remplit le champ
+    memcpy(record.name, beacon.name, strnlen(beacon.name, sizeof(record.name)));
+    record.crc = crc16(reinterpret_cast<const uint8_t*>(&record), offsetof(SpoolRecord, crc));
+}
+
+void EventSpool::fromRecord(const SpoolRecord& record, PendingEvent& event) const {
+    BeaconInfo& beacon = event.beacon;
+    memset(&event, 0, sizeof(event));
+    event.eventType = (record.flags & 2) ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+    event.timestamp = record.timestamp;
+    event.receivedAt = record.timestamp - record.receivedAgo;
+    event.traceId = record.traceId;
+    // Sans heure réelle, seul un enregistrement de ce démarrage peut encore
+    // être daté à partir de millis()
+    uint64_t epoch = (uint64_t)record.epochHigh << 32 | record.epochLow;
+    event.epoch = epoch != 0 || record.sequence >= bootHead ? epoch : EVENT_EPOCH_UNKNOWN;
+    memcpy(beacon.address, record.address, sizeof(beacon.address));
+    memcpy(beacon.name, record.name, sizeof(record.name));
+    beacon.name[sizeof(record.name)] = '\0';
+    memcpy(beacon.uuid, "N/A", sizeof("N/A"));
+    beacon.rssi = record.rssi;
+    beacon.lastSeen = event.receivedAt;
+    beacon.frameType = record.frameType;
+    beacon.isIBeacon = (record.flags & 1) != 0;
+    memcpy(beacon.proximityUUID, record.proximityUUID, sizeof(beacon.proximityUUID));
+    beacon.major = record.major;
+    beacon.minor = record.minor;
+    beacon.txPower = record.txPower;
+}
+
+uint32_t EventSpool::slotOffset(uint32_t slot) const {
+    return (META_SECTORS + slot / RECORDS_PER_SECTOR) * SPOOL_SECTOR_SIZE +
+           (slot % RECORDS_PER_SECTOR) * sizeof(SpoolRecord);
+}
+
+bool EventSpool::isValid(const SpoolRecord& record, uint32_t slot) const {
+    return record.sequence != 0 && record.sequence % slots == slot &&
+           record.crc == crc16(reinterpret_cast<const uint8_t*>(&record), offsetof(SpoolRecord, crc));
+}
+
+bool EventSpool::begin() {
+    size_t sectors = storage.size() / SPOOL_SECTOR_SIZE;
+    if (sectors < META_SECTORS + 2) {
+        return false;
+    }
+    slots = (sectors - META_SECTORS) * RECORDS_PER_SECTOR;
+
+    // La tête suit la plus grande séquence valide trouvée sur le support
+    uint32_t maxSequence = 0;
+    bool written = false;
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        SpoolRecord record;
+        if (!storage.readAt(slotOffset(slot), &record, sizeof(record))) {
+            return false;
+        }
+        if (isValid(record, slot)) {
+            maxSequence = record.sequence > maxSequence ? record.sequence : maxSequence;
+        } else if (!isBlank(&record, sizeof(record))) {
+            written = true;
+        }
+    }
+    if (maxSequence == 0 && written) {
+        // Aucun enregistrement valide sur une partition déjà écrite (autre
+        // usage, version précédente) : repartir d'une partition vierge
+        if (!storage.erase(0, sectors * SPOOL_SECTOR_SIZE)) {
+            return false;
+        }
+    }
+    head = maxSequence + 1;
+
+    // Une case entamée par une coupure ne peut être réécrite avant
+    // l'effacement de son secteur : la tête passe après
+    while (head % slots % RECORDS_PER_SECTOR != 0) {
+        SpoolRecord record;
+        if (!storage.readAt(slotOffset(head % slots), &record, sizeof(record))) {
+            return false;
+        }
+        if (isBlank(&record, sizeof(record))) {
+            break;
+        }
+        head++;
+    }
+    flushedHead = bootHead = head;
+
+    // La queue est la plus grande valeur valide des secteurs de métadonnées ;
+    // les suivantes s'ajoutent après la dernière case écrite de son secteur
+    uint32_t savedTail = 1;
+    uint32_t used[META_SECTORS];
+    metaSector = 0;
+    for (uint32_t sector = 0; sector < META_SECTORS; sector++) {
+        used[sector] = 0;
+        for (uint32_t i = 0; i < META_ENTRIES; i++) {
+            SpoolMeta entry;
+            if (!storage.readAt(sector * SPOOL_SECTOR_SIZE + i * sizeof(entry), &entry, sizeof(entry))) {
+                return false;
+            }
+            if (isBlank(&entry, sizeof(entry))) {
+                break;
+            }
+            used[sector] = i + 1;
+            if (entry.check == ~entry.tail && entry.tail >= savedTail) {
+                savedTail = entry.tail;
+                metaSector = sector;
+            }
+        }
+    }
+    metaEntry = used[metaSector];
+    // Le secteur de la tête a été effacé en y entrant, sauf si elle est à
+    // son début : le tour précédent n'y a plus rien
+    uint32_t sectorStart = head - head % slots % RECORDS_PER_SECTOR;
+    uint32_t firstKept = sectorStart == head ? head : sectorStart + RECORDS_PER_SECTOR;
+    uint32_t oldest = firstKept > slots ? firstKept - slots : 1;
+    tail = savedTail < oldest ? oldest : savedTail;
+    if (tail > head) {
+        tail = head;
+    }
+    return true;
+}
+
+bool EventSpool::append(const PendingEvent& event) {
+    if (head - flushedHead >= SPOOL_WRITE_BUFFER && !flush()) {
+        return false;
+    }
+
+    toRecord(event, head, writeBuffer[head % SPOOL_WRITE_BUFFER]);
+    head++;
+
+    if (head - flushedHead >= SPOOL_WRITE_BUFFER) {
+        flush();
+    }
+    return true;
+}
+
+bool EventSpool::flush() {
+    while (flushedHead != head) {
+        uint32_t slot = flushedHead % slots;
+        if (slot % RECORDS_PER_SECTOR == 0) {
+            // La tête entre dans un secteur : l'effacer, et avec lui les
+            // enregistrements les plus anciens
+            if (!storage.erase(slotOffset(slot), SPOOL_SECTOR_SIZE)) {
+                return false;
+            }
+            uint32_t kept = flushedHead + RECORDS_PER_SECTOR;
+            if (kept > slots && tail < kept - slots) {
+                overwrittenCount += kept - slots - tail;
+                tail = kept - slots;
+            }
+        }
+        if (!storage.writeAt(slotOffset(slot), &writeBuffer[flushedHead % SPOOL_WRITE_BUFFER],
+                             sizeof(SpoolRecord))) {
+            return false;
+        }
+        flushedHead++;
+    }
+    return true;
+}
+
+bool EventSpool::readSequence(uint32_t sequence, SpoolRecord& record) {
+    if (sequence >= flushedHead) {
+        record = writeBuffer[sequence % SPOOL_WRITE_BUFFER];
+        return true;
+    }
+    uint32_t slot = sequence % slots;
+    return storage.readAt(slotOffset(slot), &record, sizeof(record)) && isValid(record, slot) &&
+           record.sequence == sequence;
+}
+
+size_t EventSpool::peek(PendingEvent* out, size_t maxCount) {
+    size_t count = 0;
+    peeked = tail;
+    for (uint32_t sequence = tail; sequence < head && count < maxCount; sequence++) {
+        SpoolRecord record;
+        if (readSequence(sequence, record)) {
+            fromRecord(record, out[count]);
+            count++;
+        } else if (count == 0) {
+            // Enregistrement illisible (coupure pendant l'écriture) : l'ignorer
+            tail++;
+            peeked = tail;
+        } else {
+            break;
+        }
+    }
+    return count;
+}
+
+void EventSpool::consume(size_t count) {
+    uint32_t acked = (peeked + count > head) ? head : peeked + count;
+    if (acked > tail) {
+        tail = acked;
+    }
+    persistTail();
+}
+
+// Le tampon est d'abord écrit : après un redémarrage, la tête retrouvée
+// sur le support ne doit pas rester en deçà de la queue enregistrée
+void EventSpool::clear() {
+    flush();
+    tail = head;
+    persistTail();
+}
+
+// En cas d'échec, la queue précédente reste valide : après un redémarrage,
+// des événements déjà acquittés seraient renvoyés, aucun ne serait perdu
+void EventSpool::persistTail() {
+    if (metaEntry >= META_ENTRIES) {
+        // Secteur plein : l'autre est effacé et prend le relais, celui-ci
+        // garde la dernière valeur jusqu'à la première écriture suivante
+        uint32_t next = (metaSector + 1) % META_SECTORS;
+        if (!storage.erase(next * SPOOL_SECTOR_SIZE, SPOOL_SECTOR_SIZE)) {
+            return;
+        }
+        metaSector = next;
+        metaEntry = 0;
+    }
+    SpoolMeta entry;
+    entry.tail = tail;
+    entry.check = ~tail;
+    // Une case ratée n'est plus vierge : la suivante sert à la prochaine fois
+    storage.writeAt(metaSector * SPOOL_SECTOR_SIZE + metaEntry * sizeof(SpoolMeta), &entry, sizeof(entry));
+    metaEntry++;
+}
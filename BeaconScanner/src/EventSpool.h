@@ -0,0 +1,157 @@
+#ifndef EVENT_SPOOL_H
+#define EVENT_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "PendingEvent.h"
+
+// Partition brute du spool, sans système de fichiers (table de partitions
+// min_spiffs.csv : "spiffs", 128 Ko). Sur l'hôte, elle est simulée par le
+// fichier STORAGE_ROOT/<nom>.bin de SPOOL_HOST_PARTITION_SIZE octets.
+#ifndef SPOOL_PARTITION
+#define SPOOL_PARTITION "spiffs"
+#endif
+#ifndef SPOOL_HOST_PARTITION_SIZE
+#define SPOOL_HOST_PARTITION_SIZE (128 * 1024)
+#endif
+
+// Plus petite unité effaçable de la flash
+#define SPOOL_SECTOR_SIZE 4096
+
+// Enregistrements gardés en RAM avant écriture sur la flash
+#ifndef SPOOL_WRITE_BUFFER
+#define SPOOL_WRITE_BUFFER 8
+#endif
+
+// Enregistrement de taille fixe écrit dans une case de la partition. Plus compact
+// qu'un PendingEvent : l'UUID de service texte n'est pas conservé.
+// Les champs de suivi sont resserrés : heure réelle sur 48 bits (ms, jusqu'en
+// l'an 10000) et réception en écart à la mise en file.
+struct SpoolRecord {
+    uint32_t sequence;          // Numéro croissant, à partir de 1
+    uint32_t timestamp;
+    uint32_t traceId;
+    uint32_t epochLow;          // Heure réelle de la mise en file, 0 si inconnue
+    uint16_t epochHigh;
+    uint16_t receivedAgo;       // timestamp - receivedAt (ms), plafonné à 65535
+    uint8_t address[6];
+    uint8_t flags;              // Bit 0 : isIBeacon, bit 1 : départ
+    uint8_t frameType;
+    int8_t rssi;
+    int8_t txPower;
+    uint16_t major;
+    uint16_t minor;
+    uint8_t proximityUUID[16];
+    char name[BEACON_NAME_MAX]; // Non terminé par '\0' s'il est plein
+    uint16_t crc;               // CRC-16/CCITT des champs précédents
+};
+
+// 56 enregistrements par secteur de 4 Ko
+static_assert(sizeof(SpoolRecord) == 72, "SpoolRecord doit faire 72 octets");
+
+// Support de stockage au comportement de flash NOR : effacement par
+// secteurs entiers (octets à 0xFF), écriture qui ne fait que passer des
+// bits de 1 à 0. Une case écrite n'est donc réécrite qu'après effacement de
+// son secteur ; réécrire les mêmes octets est sans effet.
+class SpoolStorage {
+public:
+    virtual ~SpoolStorage() {}
+    virtual size_t size() const = 0;
+    virtual bool readAt(uint32_t offset, void* data, size_t length) = 0;
+    virtual bool writeAt(uint32_t offset, const void* data, size_t length) = 0;
+    virtual bool erase(uint32_t offset, size_t length) = 0;
+};
+
+// Partition de la flash (esp_partition_*) sur l'ESP32 ; ailleurs, fichier
+// ordinaire de SPOOL_HOST_PARTITION_SIZE octets qui reproduit l'effacement
+// et l'écriture de la flash
+class PartitionSpoolStorage : public SpoolStorage {
+private:
+    void* handle;
+
+public:
+    PartitionSpoolStorage();
+    ~PartitionSpoolStorage();
+    bool open(const char* label);
+    size_t size() const override;
+    bool readAt(uint32_t offset, void* data, size_t length) override;
+    bool writeAt(uint32_t offset, const void* data, size_t length) override;
+    bool erase(uint32_t offset, size_t length) override;
+};
+
+// Spool d'événements en journal circulaire sur la partition. Les deux
+// premiers secteurs portent la queue (événements acquittés), les suivants
+// les enregistrements. Chaque enregistrement est écrit une seule fois, à la
+// suite du précédent, et un secteur n'est effacé qu'au moment où la tête y
+// entre : les enregistrements qu'il contenait, les plus anciens, sont alors
+// perdus s'ils n'ont pas été envoyés. La capacité découle donc de la taille
+// de la partition. Chaque enregistrement porte un numéro de séquence et un
+// CRC : au démarrage, la tête est retrouvée en relisant les cases, et un
+// enregistrement interrompu par une coupure est ignoré. La queue est
+// ajoutée à la suite dans un secteur de métadonnées ; quand il est plein,
+// l'autre est effacé et prend le relais, si bien qu'une coupure laisse
+// toujours une valeur valide.
+class EventSpool {
+private:
+    static constexpr uint32_t META_SECTORS = 2;
+    static constexpr uint32_t RECORDS_PER_SECTOR = SPOOL_SECTOR_SIZE / sizeof(SpoolRecord);
+
+    SpoolStorage& storage;
+
+    uint32_t slots;          // Cases d'enregistrement de la partition
+    uint32_t head;           // Prochaine séquence à écrire
+    uint32_t flushedHead;    // Séquences < flushedHead sont sur le support
+    uint32_t tail;           // Plus ancienne séquence non acquittée
+    uint32_t bootHead;       // Séquences < bootHead : démarrages précédents
+    uint32_t peeked;         // Première séquence rendue par le dernier peek()
+    uint32_t metaSector;     // Secteur de métadonnées en cours
+    uint32_t metaEntry;      // Prochaine case vierge de ce secteur
+    uint32_t overwrittenCount;
+
+    // Enregistrements pas encore écrits, rangés par séquence modulo la taille
+    SpoolRecord writeBuffer[SPOOL_WRITE_BUFFER];
+
+    static uint16_t crc16(const uint8_t* data, size_t length);
+    static void toRecord(const PendingEvent& event, uint32_t sequence, SpoolRecord& record);
+    void fromRecord(const SpoolRecord& record, PendingEvent& event) const;
+    uint32_t slotOffset(uint32_t slot) const;
+    bool isValid(const SpoolRecord& record, uint32_t slot) const;
+    bool readSequence(uint32_t sequence, SpoolRecord& record);
+    void persistTail();
+
+public:
+    explicit EventSpool(SpoolStorage& storage);
+
+    // Relit le support et restaure tête et queue après un redémarrage
+    bool begin();
+
+    // Ajoute un événement au tampon RAM, écrit sur le support quand il est
+    // plein. Retourne false si le tampon est plein et que l'écriture échoue :
+    // l'événement n'est pas conservé.
+    bool append(const PendingEvent& event);
+
+    // Écrit le tampon RAM sur le support. En cas d'échec, les enregistrements
+    // non écrits restent en RAM jusqu'au prochain essai.
+    bool flush();
+
+    // Copie au plus maxCount événements parmi les plus anciens, sans les retirer
+    size_t peek(PendingEvent* out, size_t maxCount);
+
+    // Retire les count premiers événements rendus par le dernier peek()
+    // (après acquittement), même si la queue a avancé entre-temps
+    void consume(size_t count);
+
+    // Abandonne tous les événements en attente, tampon RAM compris
+    void clear();
+
+    size_t size() const { return head - tail; }
+    bool empty() const { return head == tail; }
+    size_t pendingWrites() const { return head - flushedHead; }
+
+    // Événements conservés à coup sûr : la partition moins le secteur
+    // effacé à l'entrée de la tête (après begin())
+    size_t capacity() const { return slots > RECORDS_PER_SECTOR ? slots - RECORDS_PER_SECTOR : 0; }
+    uint32_t overwritten() const { return overwrittenCount; }
+};
+
+#endif
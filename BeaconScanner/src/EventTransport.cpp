@@ -0,0 +1,35 @@
+#include "EventTransport.h"
+#include "Presence.h"
+
+void eventToJson(const PendingEvent& event, JsonObject item, const TraceClock& clock) {
+    char beaconId[BEACON_ID_TEXT];
+    formatBeaconId(event.beacon, beaconId);
+    char traceId[9];
+    snprintf(traceId, sizeof(traceId), "%08lx", (unsigned long)event.traceId);
+
+    item["traceId"] = (char*)traceId;
+    uint64_t received = clock.receivedAt(event);
+    if (received != 0) {
+        item["timestamp"] = received;
+    }
+    item["beaconId"] = (char*)beaconId; // Copié par ArduinoJson
+    item["name"] = event.beacon.name;
+    item["uuid"] = event.beacon.uuid;
+    item["rssi"] = event.beacon.rssi;
+    float distance = estimateDistance(event.beacon);
+    if (distance >= 0) {
+        item["distance"] = roundf(distance * 100) / 100;
+    }
+    item["eventType"] = event.eventType == EVENT_ARRIVAL ? "arrival" : "departure";
+
+    if (received != 0) {
+        JsonObject trace = item.createNestedObject("trace");
+        trace["received"] = received;
+        trace["enqueued"] = clock.enqueuedAt(event);
+        // Heure pas encore synchronisée depuis le démarrage : seuls les
+        // événements du spool déjà datés ont leurs étapes
+        if (clock.epoch != 0) {
+            trace["sent"] = clock.epoch;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef EVENT_TRANSPORT_H
+#define EVENT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "PendingEvent.h"
+#include "TraceClock.h"
+
+// Retour de service() et de EventTransport::poll() quand rien n'est en attente
+#define UPLINK_IDLE 0xFFFFFFFFUL
+
+// Destination des lots d'événements de SendEvents (HttpTransport,
+// MqttTransport). Seule la tâche réseau l'appelle, une fois le WiFi établi.
+class EventTransport {
+public:
+    virtual ~EventTransport() {}
+
+    virtual const char* name() const = 0;
+
+    // Appelé une fois par SendEvents::init(), avant tout envoi
+    virtual void begin(const uint8_t deviceMac[6], const char* deviceId) = 0;
+
+    // Envoie un lot et attend son acquittement. Retourne un code HTTP
+    // (2xx acquitté, 4xx ou 5xx refusé) ou un code négatif en cas d'erreur
+    // réseau (voir errorToString) ; les autres protocoles s'y ramènent
+    virtual int send(const PendingEvent* events, size_t count) = 0;
+
+    // Entretien de la connexion entre deux lots. Retourne le délai (ms)
+    // avant le prochain appel utile, ou UPLINK_IDLE
+    virtual uint32_t poll(uint32_t now) {
+        (void)now;
+        return UPLINK_IDLE;
+    }
+
+    virtual const char* errorToString(int code) = 0;
+};
+
+// Champs JSON d'un événement, communs au lot HTTP et aux messages MQTT :
+// traceId, timestamp, beaconId, name, uuid, rssi, distance, eventType et
+// trace. Les horodatages sont des entiers, en ms depuis 1970 (UTC), absents
+// tant que l'heure réelle n'est pas connue : timestamp est la réception de
+// l'annonce, trace ses étapes sur l'ESP32, que le backend complète
+// (Backend/latency.js) :
+//   "traceId": "5f3a09c2",
+//   "trace": {"received": ..., "enqueued": ..., "sent": ...}
+// clock : relevée au moment de l'envoi.
+void eventToJson(const PendingEvent& event, JsonObject item, const TraceClock& clock);
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "AdvRecord.h"
+
+// Couche d'abstraction matérielle : horloge, radio BLE, réseau et stockage.
+// La logique de scan, de présence et d'envoi ne passe que par ces fonctions,
+// ce qui permet de l'exécuter sur l'ESP32 (HalEsp32.cpp) comme sur l'hôte
+// (sim/HalSim.cpp, environnement PlatformIO "native").
+
+// Racine des fichiers persistants de l'hôte (réglages, partition simulée du
+// spool) ; sur l'ESP32, réglages en NVS et spool sur sa propre partition
+#ifndef STORAGE_ROOT
+#ifdef ARDUINO
+#define STORAGE_ROOT ""
+#else
+#define STORAGE_ROOT "."
+#endif
+#endif
+
+// Répartition des tâches entre les deux cœurs de l'ESP32 : la radio et le
+// suivi de présence d'un côté, le réseau, le serveur web et le
+// journal de l'autre. Sur l'hôte (--threads), chaque tâche est un thread.
+#ifndef RADIO_CORE
+#define RADIO_CORE 0             // Pile BLE, tâches bleScan et tracker
+#endif
+#ifndef NETWORK_CORE
+#define NETWORK_CORE 1           // Tâches uplink, log et serveur web (httpd)
+#endif
+
+// Horloge (ms depuis le démarrage)
+uint32_t halMillis();
+void halDelay(uint32_t ms);
+
+// Heure réelle (ms depuis le 1er janvier 1970, UTC), synchronisée par SNTP
+// auprès de server une fois le WiFi établi. halEpochMillis() retourne 0
+// tant que la première réponse n'est pas arrivée.
+void halClockBegin(const char* server);
+uint64_t halEpochMillis();
+
+// Nombre aléatoire (générateur matériel de l'ESP32)
+uint32_t halRandom();
+
+// Pile Bluetooth de la radio (HalEsp32.cpp), choisie par l'environnement
+// de platformio.ini : Bluedroid (bibliothèque ESP32 BLE Arduino, esp32dev)
+// ou NimBLE (NimBLE-Arduino, esp32dev-nimble), plus légère en RAM et en
+// flash
+#define BLE_BACKEND_BLUEDROID 0
+#define BLE_BACKEND_NIMBLE 1
+#ifndef BLE_BACKEND
+#define BLE_BACKEND BLE_BACKEND_BLUEDROID
+#endif
+
+// Filtre des doublons du contrôleur (NimBLE ; --hw-dedup dans la
+// simulation) : un appareil n'est remis qu'une fois par scan, le cache
+// étant vidé au début de chaque cycle. La tâche de suivi
+// ne voit plus alors qu'une annonce par beacon et par cycle (RSSI moins
+// lissé, trames alternées d'une même adresse perdues), mais la tâche
+// Bluetooth n'est plus réveillée pour chaque annonce.
+#ifndef BLE_DUPLICATE_FILTER
+#define BLE_DUPLICATE_FILTER 0
+#endif
+
+// Appelé pour chaque annonce reçue, depuis la tâche radio : ne doit ni
+// bloquer ni allouer
+typedef void (*HalAdvertisementCallback)(const AdvRecord& record);
+
+class HalRadio {
+public:
+    virtual ~HalRadio() {}
+
+    // Initialise le contrôleur BLE et enregistre le callback
+    virtual bool begin(HalAdvertisementCallback callback) = 0;
+
+    // Paramètres des scans suivants : écoute windowMs toutes les
+    // intervalMs, avec demandes de scan si active (voir ScanScheduler.h)
+    virtual void configure(uint16_t intervalMs, uint16_t windowMs, bool active) = 0;
+
+    // Scanne pendant durationMs (bloquant) ; retourne le nombre d'appareils vus
+    virtual int scan(uint32_t durationMs) = 0;
+};
+
+class HalNetwork {
+public:
+    virtual ~HalNetwork() {}
+
+    // Lance la connexion (non bloquant)
+    virtual void connect(const char* ssid, const char* password) = 0;
+    virtual bool connected() = 0;
+
+    virtual void macAddress(uint8_t mac[6]) = 0;
+
+    // Adresse IP locale en texte (out : au moins 16 octets)
+    virtual void localIP(char* out, size_t size) = 0;
+
+    // POST sur une connexion persistante. Retourne le code HTTP, ou un code
+    // négatif en cas d'erreur réseau (voir errorToString)
+    virtual int post(const char* url, const char* contentType, const uint8_t* body, size_t length) = 0;
+
+    // GET sans corps de réponse ; même convention de retour
+    virtual int get(const char* url, uint32_t timeoutMs) = 0;
+
+    virtual const char* errorToString(int code) = 0;
+};
+
+// Connexion TCP brute (client MQTT), ouverte une fois le WiFi établi
+class HalStream {
+public:
+    virtual ~HalStream() {}
+
+    virtual bool connect(const char* host, uint16_t port, uint32_t timeoutMs) = 0;
+    virtual bool connected() = 0;
+
+    // Retourne le nombre d'octets écrits, ou -1 si la connexion est perdue
+    virtual int write(const uint8_t* data, size_t length) = 0;
+
+    // Sans attente : nombre d'octets lus (0 si rien n'est arrivé), ou -1 si
+    // la connexion est fermée
+    virtual int read(uint8_t* data, size_t size) = 0;
+
+    virtual void stop() = 0;
+};
+
+// Socket UDP (client CoAP), ouvert une fois le WiFi établi
+class HalDatagram {
+public:
+    virtual ~HalDatagram() {}
+
+    // Ouvre le socket sur un port local libre
+    virtual bool begin() = 0;
+
+    virtual bool sendTo(const char* host, uint16_t port, const uint8_t* data, size_t length) = 0;
+
+    // Sans attente : taille du datagramme reçu, tronqué à size (0 si aucun)
+    virtual int receive(uint8_t* data, size_t size) = 0;
+};
+
+HalRadio& halRadio();
+HalNetwork& halNetwork();
+HalStream& halStream();
+HalDatagram& halDatagram();
+
+// Réglages persistants, par clé (15 caractères au plus) : NVS sur l'ESP32,
+// fichier STORAGE_ROOT/<clé>.cfg sur l'hôte. Load retourne false si la clé
+// n'existe pas ; la valeur est tronquée à size - 1.
+bool halSettingsLoad(const char* key, char* out, size_t size);
+bool halSettingsSave(const char* key, const char* value);
+
+#endif
@@ -0,0 +1,317 @@
+#ifdef ARDUINO
+
+#include "Hal.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+#if BLE_BACKEND == BLE_BACKEND_NIMBLE
+#include <NimBLEDevice.h>
+#else
+#include <BLEDevice.h>
+#include <BLEUtils.h>
+#include <BLEScan.h>
+#include <BLEAdvertisedDevice.h>
+#endif
+#include <esp_system.h>
+#include <sys/time.h>
+
+uint32_t halMillis() {
+    return millis();
+}
+
+void halDelay(uint32_t ms) {
+    delay(ms);
+}
+
+// Le client SNTP de lwIP tourne en tâche de fond et remet l'heure système
+// à jour périodiquement
+void halClockBegin(const char* server) {
+    configTime(0, 0, server);
+}
+
+uint64_t halEpochMillis() {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec < 1700000000) {
+        return 0; // Heure système pas encore réglée
+    }
+    return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+uint32_t halRandom() {
+    return esp_random();
+}
+
+#if BLE_BACKEND != BLE_BACKEND_NIMBLE
+// ---------------------------------------------------------------------------
+// Radio : pile Bluedroid (ESP32 BLE Arduino)
+
+// Le callback tourne dans la tâche Bluetooth : il se contente de copier
+// l'annonce brute, sans allocation ni traitement.
+class Esp32AdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
+private:
+    HalAdvertisementCallback callback;
+
+public:
+    explicit Esp32AdvertisedDeviceCallbacks(HalAdvertisementCallback callback) : callback(callback) {}
+
+    void onResult(BLEAdvertisedDevice advertisedDevice) {
+        AdvRecord record;
+        BLEAddress address = advertisedDevice.getAddress();
+        fillAdvRecord(record, *address.getNative(), ADV_ADDRESS_DISPLAY_ORDER, advertisedDevice.getRSSI(),
+                      advertisedDevice.getPayload(), advertisedDevice.getPayloadLength(), millis());
+        callback(record);
+    }
+};
+
+class Esp32Radio : public HalRadio {
+private:
+    BLEScan* scanner = nullptr;
+
+public:
+    bool begin(HalAdvertisementCallback callback) override {
+        BLEDevice::init("");
+        scanner = BLEDevice::getScan();
+        scanner->setAdvertisedDeviceCallbacks(new Esp32AdvertisedDeviceCallbacks(callback), true);
+        configure(100, 99, true);
+        return true;
+    }
+
+    // Pris en compte au prochain start()
+    void configure(uint16_t intervalMs, uint16_t windowMs, bool active) override {
+        scanner->setActiveScan(active);
+        scanner->setInterval(intervalMs);
+        scanner->setWindow(windowMs);
+    }
+
+    // start() ne compte qu'en secondes : le scan est lancé sans limite puis
+    // arrêté après durationMs, à la milliseconde près
+    int scan(uint32_t durationMs) override {
+        scanner->start(0, nullptr, false);
+        vTaskDelay(pdMS_TO_TICKS(durationMs));
+        scanner->stop();
+        int count = scanner->getResults().getCount();
+        scanner->clearResults(); // Libérer la mémoire des résultats
+        return count;
+    }
+};
+
+#else
+// ---------------------------------------------------------------------------
+// Radio : pile NimBLE (NimBLE-Arduino 1.4), observateur seul
+
+// L'annonce est reçue par pointeur, sans copie de l'appareil ni de ses
+// chaînes. NimBLE range l'adresse octet de poids faible en tête.
+class Esp32AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
+private:
+    HalAdvertisementCallback callback;
+
+public:
+    explicit Esp32AdvertisedDeviceCallbacks(HalAdvertisementCallback callback) : callback(callback) {}
+
+    void onResult(NimBLEAdvertisedDevice* advertisedDevice) override {
+        AdvRecord record;
+        fillAdvRecord(record, advertisedDevice->getAddress().getNative(), ADV_ADDRESS_LSB_FIRST,
+                      advertisedDevice->getRSSI(), advertisedDevice->getPayload(),
+                      advertisedDevice->getPayloadLength(), millis());
+        callback(record);
+    }
+};
+
+class Esp32Radio : public HalRadio {
+private:
+    NimBLEScan* scanner = nullptr;
+
+public:
+    bool begin(HalAdvertisementCallback callback) override {
+        NimBLEDevice::init("");
+        scanner = NimBLEDevice::getScan();
+        scanner->setAdvertisedDeviceCallbacks(new Esp32AdvertisedDeviceCallbacks(callback), true);
+        // Cache du contrôleur vidé à chaque start(), donc à chaque cycle
+        scanner->setDuplicateFilter(BLE_DUPLICATE_FILTER);
+        configure(100, 99, true);
+        return true;
+    }
+
+    // Pris en compte au prochain start()
+    void configure(uint16_t intervalMs, uint16_t windowMs, bool active) override {
+        scanner->setActiveScan(active);
+        scanner->setInterval(intervalMs);
+        scanner->setWindow(windowMs);
+    }
+
+    // Les appareils vus restent dans les résultats jusqu'à la fin du cycle :
+    // une annonce répétée met à jour l'entrée existante, sans allocation.
+    // start() compte en secondes dans NimBLE-Arduino 1.4 : même arrêt
+    // explicite après durationMs que pour Bluedroid.
+    int scan(uint32_t durationMs) override {
+        scanner->start(0, nullptr, false);
+        vTaskDelay(pdMS_TO_TICKS(durationMs));
+        scanner->stop();
+        int count = scanner->getResults().getCount();
+        scanner->clearResults();
+        return count;
+    }
+};
+#endif
+
+// ---------------------------------------------------------------------------
+// Réseau : WiFi station et client HTTP persistant (keep-alive)
+
+class Esp32Network : public HalNetwork {
+private:
+    WiFiClient client;
+    HTTPClient http;
+    String lastError;
+
+public:
+    Esp32Network() {
+        http.setReuse(true);
+    }
+
+    void connect(const char* ssid, const char* password) override {
+        WiFi.begin(ssid, password);
+    }
+
+    bool connected() override {
+        return WiFi.status() == WL_CONNECTED;
+    }
+
+    void macAddress(uint8_t mac[6]) override {
+        WiFi.macAddress(mac);
+    }
+
+    void localIP(char* out, size_t size) override {
+        strlcpy(out, WiFi.localIP().toString().c_str(), size);
+    }
+
+    // La réponse n'est pas lue, end() se contente de la vider
+    int post(const char* url, const char* contentType, const uint8_t* body, size_t length) override {
+        http.begin(client, url);
+        http.addHeader("Content-Type", contentType);
+        int code = http.POST(const_cast<uint8_t*>(body), length);
+        http.end();
+        return code;
+    }
+
+    int get(const char* url, uint32_t timeoutMs) override {
+        HTTPClient request;
+        request.begin(url);
+        request.setTimeout(timeoutMs);
+        int code = request.GET();
+        request.end();
+        return code;
+    }
+
+    const char* errorToString(int code) override {
+        lastError = HTTPClient::errorToString(code);
+        return lastError.c_str();
+    }
+};
+
+// Connexion TCP brute : un WiFiClient sans délai de Nagle
+class Esp32Stream : public HalStream {
+private:
+    WiFiClient client;
+
+public:
+    bool connect(const char* host, uint16_t port, uint32_t timeoutMs) override {
+        if (!client.connect(host, port, timeoutMs)) {
+            return false;
+        }
+        client.setNoDelay(true);
+        return true;
+    }
+
+    bool connected() override {
+        return client.connected();
+    }
+
+    int write(const uint8_t* data, size_t length) override {
+        size_t written = client.write(data, length);
+        return written == 0 && length > 0 ? -1 : (int)written;
+    }
+
+    int read(uint8_t* data, size_t size) override {
+        int available = client.available();
+        if (available <= 0) {
+            return client.connected() ? 0 : -1;
+        }
+        return client.read(data, (size_t)available < size ? available : size);
+    }
+
+    void stop() override {
+        client.stop();
+    }
+};
+
+// Socket UDP sur un port local attribué par lwIP
+class Esp32Datagram : public HalDatagram {
+private:
+    WiFiUDP udp;
+    bool started = false;
+
+public:
+    bool begin() override {
+        if (!started) {
+            started = udp.begin(0) == 1;
+        }
+        return started;
+    }
+
+    bool sendTo(const char* host, uint16_t port, const uint8_t* data, size_t length) override {
+        return udp.beginPacket(host, port) == 1 && udp.write(data, length) == length && udp.endPacket() == 1;
+    }
+
+    int receive(uint8_t* data, size_t size) override {
+        int length = udp.parsePacket();
+        if (length <= 0) {
+            return 0;
+        }
+        return udp.read(data, (size_t)length < size ? length : size);
+    }
+};
+
+static Esp32Radio radio;
+static Esp32Network network;
+static Esp32Stream stream;
+static Esp32Datagram datagram;
+
+HalRadio& halRadio() {
+    return radio;
+}
+
+HalNetwork& halNetwork() {
+    return network;
+}
+
+HalStream& halStream() {
+    return stream;
+}
+
+HalDatagram& halDatagram() {
+    return datagram;
+}
+
+// Espace de noms NVS "beacon", ouvert au premier accès
+static Preferences preferences;
+
+static bool settingsOpen() {
+    static bool open = preferences.begin("beacon", false);
+    return open;
+}
+
+bool halSettingsLoad(const char* key, char* out, size_t size) {
+    if (!settingsOpen() || !preferences.isKey(key)) {
+        return false;
+    }
+    return preferences.getString(key, out, size) > 0;
+}
+
+bool halSettingsSave(const char* key, const char* value) {
+    return settingsOpen() && preferences.putString(key, value) == strlen(value);
+}
+
+#endif
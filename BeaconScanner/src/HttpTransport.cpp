@@ -0,0 +1,72 @@
+#include "HttpTransport.h"
+#include "EventCodec.h"
+#include "Hal.h"
+#include "Log.h"
+#include "SendEvents.h"
+
+HttpTransport::HttpTransport(const char* serverURL, const char* endpoint)
+    : serverURL(serverURL), endpoint(endpoint), binaryWire(UPLINK_BINARY) {
+}
+
+void HttpTransport::begin(const uint8_t deviceMac[6], const char* deviceId) {
+    memcpy(this->deviceMac, deviceMac, sizeof(this->deviceMac));
+    this->deviceId = deviceId;
+    batchURL = String(serverURL) + endpoint;
+}
+
+// Format binaire compact ou JSON selon ce que le contrôleur accepte
+int HttpTransport::send(const PendingEvent* events, size_t count) {
+    int httpResponseCode;
+    if (binaryWire) {
+        httpResponseCode = postBinary(events, count);
+        if (httpResponseCode == 415) {
+            LOG_WARN("Format binaire refusé par le contrôleur, passage en JSON");
+            binaryWire = false;
+        }
+    }
+    if (!binaryWire) {
+        httpResponseCode = postJson(events, count);
+    }
+    return httpResponseCode;
+}
+
+// {"deviceId": "...", "events": [{...}, ...]}
+int HttpTransport::postJson(const PendingEvent* events, size_t count) {
+    DynamicJsonDocument doc(256 + count * 512);
+    doc["deviceId"] = deviceId;
+    JsonArray array = doc.createNestedArray("events");
+
+    TraceClock clock = TraceClock::now();
+    for (size_t i = 0; i < count; i++) {
+        eventToJson(events[i], array.createNestedObject(), clock);
+    }
+
+    String payload;
+    serializeJson(doc, payload);
+
+    // La connexion est conservée entre deux lots (keep-alive)
+    int httpResponseCode = halNetwork().post(batchURL.c_str(), "application/json",
+                                             (const uint8_t*)payload.c_str(), payload.length());
+
+    if (httpResponseCode >= 200 && httpResponseCode < 300) {
+        LOG_DEBUG("Lot envoyé: %d événements (%d octets JSON)", (int)count, (int)payload.length());
+    }
+    return httpResponseCode;
+}
+
+// Environ 24 octets par événement (voir EventCodec.h)
+int HttpTransport::postBinary(const PendingEvent* events, size_t count) {
+    static uint8_t payload[encodedSizeBound(EVENT_BATCH_SIZE)];
+    size_t length = encodeEvents(deviceMac, events, count, TraceClock::now(), payload, sizeof(payload));
+
+    int httpResponseCode = halNetwork().post(batchURL.c_str(), EVENT_CODEC_CONTENT_TYPE, payload, length);
+
+    if (httpResponseCode >= 200 && httpResponseCode < 300) {
+        LOG_DEBUG("Lot envoyé: %d événements (%d octets binaires)", (int)count, (int)length);
+    }
+    return httpResponseCode;
+}
+
+const char* HttpTransport::errorToString(int code) {
+    return halNetwork().errorToString(code);
+}
@@ -0,0 +1,35 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include "EventTransport.h"
+
+// Format binaire compact (EventCodec.h) au lieu du JSON ; repli automatique
+// sur le JSON si le contrôleur répond 415
+#ifndef UPLINK_BINARY
+#define UPLINK_BINARY 0
+#endif
+
+// Lots envoyés en un POST au contrôleur (controller.js, /beacon/batch), sur
+// une connexion persistante
+class HttpTransport : public EventTransport {
+private:
+    const char* serverURL;
+    const char* endpoint;
+    String batchURL;
+    String deviceId;
+    uint8_t deviceMac[6];
+    bool binaryWire;
+
+    int postJson(const PendingEvent* events, size_t count);
+    int postBinary(const PendingEvent* events, size_t count);
+
+public:
+    HttpTransport(const char* serverURL, const char* endpoint);
+
+    const char* name() const override { return "http"; }
+    void begin(const uint8_t deviceMac[6], const char* deviceId) override;
+    int send(const PendingEvent* events, size_t count) override;
+    const char* errorToString(int code) override;
+};
+
+#endif
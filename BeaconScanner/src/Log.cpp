@@ -0,0 +1,140 @@
+#include "Log.h"
+#include <atomic>
+#include "Hal.h"
+
+static QueueHandle_t logQueue = NULL;
+static std::atomic<uint32_t> droppedCount(0);
+
+static_assert(LOG_TEXT_SIZE <= 255, "LOG_TEXT_SIZE trop grand");
+
+// Copie tronquée si la place manque ; sans place, chaîne vide
+void logCapture(LogRecord& record, const char* value) {
+    size_t offset = record.textLength;
+    if (offset >= LOG_TEXT_SIZE) {
+        offset = LOG_TEXT_SIZE - 1;   // '\0' final de la dernière copie
+    } else {
+        size_t room = LOG_TEXT_SIZE - offset;
+        size_t length = strlcpy(record.text + offset, value ? value : "(null)", room);
+        record.textLength = (uint8_t)(offset + (length < room ? length : room - 1) + 1);
+    }
+    record.types[record.argCount] = LOG_ARG_TEXT;
+    record.values[record.argCount++].u = (uint32_t)offset;
+}
+
+// Formate une conversion avec la valeur convertie dans le type attendu
+static int formatArg(char* out, size_t size, const char* spec, char conversion, const LogRecord& record, size_t arg) {
+    uint8_t type = record.types[arg];
+    switch (conversion) {
+    case 'd': case 'i': case 'c':
+        return snprintf(out, size, spec, type == LOG_ARG_FLOAT ? (int)record.values[arg].f : record.values[arg].i);
+    case 'u': case 'x': case 'X': case 'o':
+        return snprintf(out, size, spec, type == LOG_ARG_FLOAT ? (unsigned)record.values[arg].f : record.values[arg].u);
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+        return snprintf(out, size, spec, type == LOG_ARG_FLOAT ? (double)record.values[arg].f
+                                         : type == LOG_ARG_INT ? (double)record.values[arg].i
+                                                               : (double)record.values[arg].u);
+    case 's':
+        return snprintf(out, size, spec, type == LOG_ARG_TEXT ? record.text + record.values[arg].u : "?");
+    default:
+        return snprintf(out, size, "%%%c", conversion);
+    }
+}
+
+// Rejoue le format avec les valeurs capturées
+static size_t formatRecord(const LogRecord& record, char* out, size_t size) {
+    size_t n = 0;
+    size_t arg = 0;
+    const char* p = record.format;
+
+    while (*p && n + 1 < size) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // %[drapeaux][largeur][.précision][longueur]conversion
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && s < sizeof(spec) - 3) {
+            spec[s++] = *p++;
+        }
+        while (*p == 'l' || *p == 'h' || *p == 'z') {
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion || arg >= record.argCount) {
+            break;
+        }
+        p++;
+        spec[s++] = conversion;
+        spec[s] = '\0';
+
+        int written = formatArg(out + n, size - n, spec, conversion, record, arg++);
+        if (written > 0) {
+            n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+static void logPrint(const LogRecord& record) {
+    static const char levels[] = "?EWID";
+    char line[192];
+    formatRecord(record, line, sizeof(line));
+
+    uint32_t time = record.timestamp;
+    Serial.printf("[%c %02lu:%02lu:%02lu.%03lu] %s\n", levels[record.level < 5 ? record.level : 0],
+                  (unsigned long)(time / 3600000 % 24), (unsigned long)(time / 60000 % 60),
+                  (unsigned long)(time / 1000 % 60), (unsigned long)(time % 1000), line);
+}
+
+void logSubmit(LogRecord& record) {
+    record.timestamp = halMillis();
+    if (!logQueue) {
+        logPrint(record);
+        return;
+    }
+    if (xQueueSend(logQueue, &record, 0) != pdTRUE) {
+        droppedCount++;
+    }
+}
+
+static void logTask(void*) {
+    LogRecord record;
+    for (;;) {
+        if (xQueueReceive(logQueue, &record, portMAX_DELAY) == pdTRUE) {
+            logPrint(record);
+        }
+    }
+}
+
+void logBegin() {
+    if (logQueue) {
+        return;
+    }
+    logQueue = xQueueCreate(LOG_QUEUE_LENGTH, sizeof(LogRecord));
+    if (logQueue) {
+        xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, NULL, NETWORK_CORE);
+    }
+}
+
+void logFlush() {
+    if (!logQueue) {
+        return;
+    }
+    LogRecord record;
+    while (xQueueReceive(logQueue, &record, 0) == pdTRUE) {
+        logPrint(record);
+    }
+}
+
+uint32_t logDropped() {
+    return droppedCount;
+}
@@ -0,0 +1,132 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Journalisation à niveaux fixés à la compilation. Sous le seuil LOG_LEVEL,
+// les appels disparaissent, évaluation des arguments comprise. Au-dessus,
+// l'appel ne formate rien : il copie le format (un littéral), les valeurs et
+// les chaînes dans un enregistrement de taille fixe, déposé sans attente
+// dans une file. Une tâche de basse priorité formate et écrit sur Serial ;
+// si la file est pleine, l'enregistrement est perdu et compté.
+//
+// Dans platformio.ini : build_flags = -D LOG_LEVEL=LOG_LEVEL_WARN
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_QUEUE_LENGTH
+#define LOG_QUEUE_LENGTH 32      // Enregistrements en attente d'écriture
+#endif
+#ifndef LOG_MAX_ARGS
+#define LOG_MAX_ARGS 6
+#endif
+#ifndef LOG_TEXT_SIZE
+#define LOG_TEXT_SIZE 96         // Chaînes copiées par enregistrement
+#endif
+#ifndef LOG_TASK_STACK
+#define LOG_TASK_STACK 3072
+#endif
+#ifndef LOG_TASK_PRIORITY
+#define LOG_TASK_PRIORITY 0      // Sous le serveur web et les tâches radio et réseau
+#endif
+
+enum LogArgType : uint8_t {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_FLOAT,
+    LOG_ARG_TEXT     // Valeur : position dans text
+};
+
+// Enregistrement copié tel quel dans la file. Les valeurs entières sont
+// conservées sur 32 bits : les modificateurs l, ll, h, z du format sont
+// ignorés au formatage.
+struct LogRecord {
+    const char* format;
+    uint32_t timestamp;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textLength;
+    uint8_t types[LOG_MAX_ARGS];
+    union {
+        int32_t i;
+        uint32_t u;
+        float f;
+    } values[LOG_MAX_ARGS];
+    char text[LOG_TEXT_SIZE];
+};
+
+inline void logCapture(LogRecord& record, long value) {
+    record.types[record.argCount] = LOG_ARG_INT;
+    record.values[record.argCount++].i = (int32_t)value;
+}
+inline void logCapture(LogRecord& record, int value) { logCapture(record, (long)value); }
+inline void logCapture(LogRecord& record, unsigned long value) {
+    record.types[record.argCount] = LOG_ARG_UINT;
+    record.values[record.argCount++].u = (uint32_t)value;
+}
+inline void logCapture(LogRecord& record, unsigned int value) { logCapture(record, (unsigned long)value); }
+inline void logCapture(LogRecord& record, double value) {
+    record.types[record.argCount] = LOG_ARG_FLOAT;
+    record.values[record.argCount++].f = (float)value;
+}
+void logCapture(LogRecord& record, const char* value);
+inline void logCapture(LogRecord& record, const String& value) { logCapture(record, value.c_str()); }
+
+// Dépose l'enregistrement dans la file, sans attendre
+void logSubmit(LogRecord& record);
+
+template <typename... Args>
+void logWrite(uint8_t level, const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Trop d'arguments pour LOG_*");
+    LogRecord record;
+    record.format = format;
+    record.level = level;
+    record.argCount = 0;
+    record.textLength = 0;
+    int expand[] = {0, (logCapture(record, args), 0)...};
+    (void)expand;
+    logSubmit(record);
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+// Crée la file et la tâche d'écriture. Avant l'appel, chaque enregistrement
+// est écrit à sa création ; sans tâche (simulation), l'appelant vide la
+// file avec logFlush().
+void logBegin();
+
+// Écrit les enregistrements en attente (tâche d'écriture, simulation)
+void logFlush();
+
+// Enregistrements perdus, file pleine
+uint32_t logDropped();
+
+#endif
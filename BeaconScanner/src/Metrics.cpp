@@ -0,0 +1,186 @@
+#include "Metrics.h"
+#include <stdarg.h>
+#include "BeaconTracker.h"
+#include "Hal.h"
+#include "Log.h"
+#include "ScanScheduler.h"
+#include "SendEvents.h"
+
+#ifndef METRICS_MAX_TASKS
+#define METRICS_MAX_TASKS 16     // Tâches FreeRTOS listées dans /metrics
+#endif
+
+const uint32_t MetricHistogram::bounds[MetricHistogram::BUCKETS] = {
+    5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000
+};
+
+MetricHistogram::MetricHistogram() : sum(0) {
+    for (size_t i = 0; i <= BUCKETS; i++) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(uint32_t value) {
+    size_t bucket = 0;
+    while (bucket < BUCKETS && value > bounds[bucket]) {
+        bucket++;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+// Ajoute une ligne formatée, sans allocation intermédiaire
+static void appendf(String& out, const char* format, ...) {
+    char line[192];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    out += line;
+}
+
+static void writeMetric(String& out, const char* name, const char* type, const char* help, unsigned long value) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    appendf(out, "%s %lu\n", name, value);
+}
+
+// Les compteurs sont convertis en secondes, unité de base de Prometheus
+static void writeHistogram(String& out, const char* name, const char* help, const MetricHistogram& histogram) {
+    appendf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i < MetricHistogram::BUCKETS; i++) {
+        cumulative += histogram.bucketCount(i);
+        appendf(out, "%s_bucket{le=\"%lu.%03lu\"} %lu\n", name, (unsigned long)(MetricHistogram::bounds[i] / 1000),
+                (unsigned long)(MetricHistogram::bounds[i] % 1000), cumulative);
+    }
+    cumulative += histogram.bucketCount(MetricHistogram::BUCKETS);
+    appendf(out, "%s_bucket{le=\"+Inf\"} %lu\n", name, cumulative);
+    appendf(out, "%s_sum %lu.%03lu\n%s_count %lu\n", name, (unsigned long)(histogram.total() / 1000),
+            (unsigned long)(histogram.total() % 1000), name, cumulative);
+}
+
+#ifdef ARDUINO
+static void writeSystemMetrics(String& out) {
+    writeMetric(out, "beacon_heap_free_bytes", "gauge", "Tas libre", ESP.getFreeHeap());
+    writeMetric(out, "beacon_heap_min_free_bytes", "gauge", "Plus bas niveau du tas libre depuis le démarrage",
+                ESP.getMinFreeHeap());
+    writeMetric(out, "beacon_heap_largest_block_bytes", "gauge", "Plus grand bloc allouable",
+                ESP.getMaxAllocHeap());
+
+#if configUSE_TRACE_FACILITY
+    static TaskStatus_t tasks[METRICS_MAX_TASKS];
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks, METRICS_MAX_TASKS, &totalRunTime);
+
+    out += "# HELP beacon_task_stack_free_bytes Pile jamais utilisée par la tâche\n"
+           "# TYPE beacon_task_stack_free_bytes gauge\n";
+    for (UBaseType_t i = 0; i < count; i++) {
+        appendf(out, "beacon_task_stack_free_bytes{task=\"%s\"} %lu\n", tasks[i].pcTaskName,
+                (unsigned long)tasks[i].usStackHighWaterMark);
+    }
+#if configGENERATE_RUN_TIME_STATS
+    // Part du CPU d'une tâche : rate(tâche) / rate(total)
+    out += "# HELP beacon_task_runtime_ticks_total Temps d'exécution cumulé de la tâche\n"
+           "# TYPE beacon_task_runtime_ticks_total counter\n";
+    for (UBaseType_t i = 0; i < count; i++) {
+        appendf(out, "beacon_task_runtime_ticks_total{task=\"%s\"} %lu\n", tasks[i].pcTaskName,
+                (unsigned long)tasks[i].ulRunTimeCounter);
+    }
+    writeMetric(out, "beacon_runtime_ticks_total", "counter", "Temps d'exécution cumulé de toutes les tâches",
+                totalRunTime);
+#endif
+#endif
+}
+#endif
+
+void writeMetrics(String& out, const BeaconTracker& tracker, SendEvents& sender, const ScanScheduler& scanner) {
+    out.reserve(4096);
+    UplinkStats uplink = sender.getStats();
+
+    writeMetric(out, "beacon_uptime_seconds", "gauge", "Temps depuis le démarrage", halMillis() / 1000);
+
+    // Réception
+    writeMetric(out, "beacon_advertisements_total", "counter", "Annonces reçues de la radio",
+                tracker.advertisementsReceived());
+    writeMetric(out, "beacon_advertisements_suppressed_total", "counter", "Annonces écartées comme doublons",
+                tracker.advertisementsSuppressed());
+    writeMetric(out, "beacon_advertisements_filtered_total", "counter", "Annonces refusées par le filtre",
+                tracker.advertisementsFiltered());
+    writeMetric(out, "beacon_advertisements_dropped_total", "counter", "Annonces perdues, file pleine",
+                tracker.advertisementsDropped());
+    writeMetric(out, "beacon_parse_failures_total", "counter", "Annonces tronquées ou mal formées",
+                tracker.parseFailures());
+
+    // Partage de la radio (ScanScheduler.h) : part d'écoute BLE =
+    // rate(listen) / rate(uptime)
+    out += "# HELP beacon_scan_cycles_total Cycles de scan, par mode\n"
+           "# TYPE beacon_scan_cycles_total counter\n";
+    for (size_t i = 0; i < SCAN_MODE_COUNT; i++) {
+        appendf(out, "beacon_scan_cycles_total{mode=\"%s\"} %lu\n", ScanScheduler::modeName((ScanMode)i),
+                (unsigned long)scanner.cycleCount((ScanMode)i));
+    }
+    appendf(out, "# HELP beacon_scan_duty_ratio Fenêtre / intervalle du cycle en cours\n"
+                 "# TYPE beacon_scan_duty_ratio gauge\nbeacon_scan_duty_ratio %lu.%03lu\n",
+            (unsigned long)(scanner.dutyPerMille() / 1000), (unsigned long)(scanner.dutyPerMille() % 1000));
+    writeMetric(out, "beacon_scan_active", "gauge", "Scan actif (1) ou passif (0)", scanner.activeScan());
+    appendf(out, "# HELP beacon_scan_listen_seconds_total Temps d'écoute BLE\n"
+                 "# TYPE beacon_scan_listen_seconds_total counter\nbeacon_scan_listen_seconds_total %lu.%03lu\n",
+            (unsigned long)(scanner.listenTimeMs() / 1000), (unsigned long)(scanner.listenTimeMs() % 1000));
+    appendf(out, "# HELP beacon_scan_wifi_window_seconds_total Scan suspendu pour l'envoi\n"
+                 "# TYPE beacon_scan_wifi_window_seconds_total counter\n"
+                 "beacon_scan_wifi_window_seconds_total %lu.%03lu\n",
+            (unsigned long)(scanner.wifiWindowTimeMs() / 1000), (unsigned long)(scanner.wifiWindowTimeMs() % 1000));
+    writeMetric(out, "beacon_scan_advertisement_rate", "gauge", "Annonces par seconde d'écoute, lissées",
+                scanner.advertisementRate());
+
+    // Table et présence
+    writeMetric(out, "beacon_table_entries", "gauge", "Beacons suivis", tracker.beaconCount());
+    writeMetric(out, "beacon_table_capacity", "gauge", "Capacité de la table", tracker.beaconCapacity());
+    writeMetric(out, "beacon_table_evictions_total", "counter", "Entrées recyclées, table pleine",
+                tracker.beaconEvictions());
+    writeMetric(out, "beacon_table_reclaimed_total", "counter", "Entrées libérées après une longue absence",
+                tracker.reclaimed());
+    writeMetric(out, "beacon_table_full_rejected_total", "counter",
+                "Annonces de nouveaux beacons ignorées, table pleine d'entrées actives",
+                tracker.tableFullRejections());
+    writeMetric(out, "beacon_present", "gauge", "Beacons présents", tracker.presentCount());
+    writeMetric(out, "beacon_arrivals_total", "counter", "Arrivées signalées", tracker.arrivals());
+    writeMetric(out, "beacon_departures_total", "counter", "Départs signalés", tracker.departures());
+
+    // Envoi
+    writeMetric(out, "beacon_events_enqueued_total", "counter", "Événements mis en file", uplink.enqueued);
+    writeMetric(out, "beacon_events_dropped_total", "counter", "Événements perdus, file pleine", uplink.dropped);
+    writeMetric(out, "beacon_events_spilled_total", "counter", "Événements versés dans le spool, file pleine",
+                uplink.spilled);
+    writeMetric(out, "beacon_events_coalesced_total", "counter", "Événements remplacés ou annulés dans le lot",
+                uplink.coalesced);
+    writeMetric(out, "beacon_events_sent_total", "counter", "Événements acquittés par le contrôleur", uplink.sent);
+    writeMetric(out, "beacon_event_queue_depth", "gauge", "Événements dans la file en RAM", uplink.queued);
+    writeMetric(out, "beacon_event_batch_depth", "gauge", "Événements du lot en cours", uplink.batched);
+    writeMetric(out, "beacon_event_spool_depth", "gauge", "Événements en attente sur la flash", uplink.spooled);
+    writeMetric(out, "beacon_event_spool_overwritten_total", "counter", "Événements écrasés, spool plein",
+                uplink.spoolOverwritten);
+    writeHistogram(out, "beacon_post_duration_seconds", "Durée des POST vers le contrôleur",
+                   sender.postLatencyHistogram());
+
+    out += "# HELP beacon_post_errors_total POST en échec, par cause\n"
+           "# TYPE beacon_post_errors_total counter\n";
+    appendf(out, "beacon_post_errors_total{cause=\"transport\"} %lu\n", (unsigned long)uplink.transportErrors);
+    appendf(out, "beacon_post_errors_total{cause=\"4xx\"} %lu\n", (unsigned long)uplink.clientErrors);
+    appendf(out, "beacon_post_errors_total{cause=\"5xx\"} %lu\n", (unsigned long)uplink.serverErrors);
+
+    // Diffusion /ws (EventPush.h)
+    if (const EventPush* push = sender.getPush()) {
+        writeMetric(out, "beacon_ws_subscribers", "gauge", "Abonnés connectés à /ws", push->subscriberTotal());
+        writeMetric(out, "beacon_ws_events_total", "counter", "Événements diffusés sur /ws", push->messages());
+        writeMetric(out, "beacon_ws_dropped_total", "counter", "Événements perdus avant diffusion, file pleine",
+                    push->dropped());
+        writeMetric(out, "beacon_ws_rejected_total", "counter", "Abonnés refusés, liste pleine", push->rejected());
+    }
+
+    writeMetric(out, "beacon_log_dropped_total", "counter", "Lignes de journal perdues, file pleine", logDropped());
+
+#ifdef ARDUINO
+    writeSystemMetrics(out);
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class BeaconTracker;
+class ScanScheduler;
+class SendEvents;
+
+// Histogramme à bornes fixes (ms), au format Prometheus. observe() ne prend
+// aucun verrou : un écrivain (la tâche réseau), des lecteurs quelconques.
+class MetricHistogram {
+public:
+    static const size_t BUCKETS = 11;
+    static const uint32_t bounds[BUCKETS];  // Bornes supérieures incluses
+
+private:
+    std::atomic<uint32_t> counts[BUCKETS + 1];  // Dernière case : +Inf
+    std::atomic<uint32_t> sum;
+
+public:
+    MetricHistogram();
+    void observe(uint32_t value);
+    uint32_t bucketCount(size_t bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+    uint32_t total() const { return sum.load(std::memory_order_relaxed); }
+};
+
+// Page /metrics au format texte Prometheus (version 0.0.4). Les compteurs
+// sont cumulés depuis le démarrage : les débits (annonces/s, ...) se
+// calculent côté serveur avec rate().
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+void writeMetrics(String& out, const BeaconTracker& tracker, SendEvents& sender, const ScanScheduler& scanner);
+
+#endif
@@ -0,0 +1,274 @@
+#include "MqttClient.h"
+#include <string.h>
+
+// Types de paquets (4 bits de poids fort de l'en-tête fixe)
+enum MqttPacketType : uint8_t {
+    MQTT_CONNECT = 0x10,
+    MQTT_CONNACK = 0x20,
+    MQTT_PUBLISH = 0x30,
+    MQTT_PUBACK = 0x40,
+    MQTT_PINGREQ = 0xC0,
+    MQTT_PINGRESP = 0xD0,
+    MQTT_DISCONNECT = 0xE0
+};
+
+#define MQTT_QOS1 0x02                   // Bits QoS de l'en-tête PUBLISH
+#define MQTT_CLEAN_SESSION_FLAG 0x02     // Drapeau du paquet CONNECT
+
+// Longueur restante (1 à 4 octets) ; retourne le nombre d'octets écrits
+static size_t encodeLength(uint8_t* out, uint32_t length) {
+    size_t size = 0;
+    do {
+        uint8_t digit = length & 0x7F;
+        length >>= 7;
+        out[size++] = length > 0 ? digit | 0x80 : digit;
+    } while (length > 0);
+    return size;
+}
+
+static size_t encodeString(uint8_t* out, const char* text, size_t length) {
+    out[0] = length >> 8;
+    out[1] = length & 0xFF;
+    memcpy(out + 2, text, length);
+    return 2 + length;
+}
+
+MqttClient::MqttClient(HalStream& stream)
+    : stream(stream), open(false), sessionPresent(false), keepAliveMs(0), lastSent(0), pingPending(false),
+      pingSent(0), nextPacketId(1), inFlightCount(0), rxState(0), rxHeader(0), rxRemaining(0), rxShift(0),
+      rxLength(0), connackCode(-1) {
+}
+
+int MqttClient::connect(const char* host, uint16_t port, const char* clientId, bool cleanSession,
+                        uint16_t keepAliveSeconds) {
+    drop();
+    if (!stream.connect(host, port, MQTT_ACK_TIMEOUT)) {
+        return MQTT_ERROR_CONNECT;
+    }
+
+    // En-tête variable : nom et niveau du protocole, drapeaux, keep-alive ;
+    // corps : identifiant du client
+    size_t idLength = strlen(clientId);
+    uint8_t variable[10] = {0, 4, 'M', 'Q', 'T', 'T', 4, (uint8_t)(cleanSession ? MQTT_CLEAN_SESSION_FLAG : 0),
+                            (uint8_t)(keepAliveSeconds >> 8), (uint8_t)(keepAliveSeconds & 0xFF)};
+    uint32_t remaining = sizeof(variable) + 2 + idLength;
+    if (1 + 4 + remaining > sizeof(packet)) {
+        stream.stop();
+        return MQTT_ERROR_PROTOCOL;
+    }
+    size_t length = 0;
+    packet[length++] = MQTT_CONNECT;
+    length += encodeLength(packet + length, remaining);
+    memcpy(packet + length, variable, sizeof(variable));
+    length += sizeof(variable);
+    length += encodeString(packet + length, clientId, idLength);
+
+    keepAliveMs = keepAliveSeconds * 1000UL;
+    rxState = 0;
+    connackCode = -1;
+    if (!writePacket(length)) {
+        stream.stop();
+        return MQTT_ERROR_CONNECTION_LOST;
+    }
+
+    uint32_t start = lastSent;
+    while (connackCode < 0) {
+        uint32_t now = halMillis();
+        if (!receive()) {
+            stream.stop();
+            return MQTT_ERROR_CONNECTION_LOST;
+        }
+        if (connackCode >= 0) {
+            break;
+        }
+        if (now - start >= MQTT_ACK_TIMEOUT) {
+            stream.stop();
+            return MQTT_ERROR_TIMEOUT;
+        }
+        halDelay(1);
+    }
+    if (connackCode != 0) {
+        stream.stop();
+        return MQTT_ERROR_REFUSED;
+    }
+
+    // Les PUBLISH non acquittés de la connexion précédente ne sont pas
+    // réémis : SendEvents renvoie le lot entier (au moins une fois)
+    open = true;
+    inFlightCount = 0;
+    pingPending = false;
+    return MQTT_OK;
+}
+
+void MqttClient::disconnect() {
+    if (open) {
+        packet[0] = MQTT_DISCONNECT;
+        packet[1] = 0;
+        writePacket(2);
+    }
+    drop();
+}
+
+void MqttClient::drop() {
+    if (open) {
+        stream.stop();
+    }
+    open = false;
+    inFlightCount = 0;
+    pingPending = false;
+}
+
+bool MqttClient::writePacket(size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        int result = stream.write(packet + written, length - written);
+        if (result <= 0) {
+            drop();
+            return false;
+        }
+        written += result;
+    }
+    lastSent = halMillis();
+    return true;
+}
+
+bool MqttClient::publish(const char* topic, const uint8_t* payload, size_t payloadLength) {
+    if (!open || windowFull()) {
+        return false;
+    }
+    size_t topicLength = strlen(topic);
+    uint32_t remaining = 2 + topicLength + 2 + payloadLength;
+    if (1 + 4 + remaining > sizeof(packet)) {
+        return false;
+    }
+
+    uint16_t packetId = nextPacketId;
+    nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1; // 0 est réservé
+
+    size_t length = 0;
+    packet[length++] = MQTT_PUBLISH | MQTT_QOS1;
+    length += encodeLength(packet + length, remaining);
+    length += encodeString(packet + length, topic, topicLength);
+    packet[length++] = packetId >> 8;
+    packet[length++] = packetId & 0xFF;
+    memcpy(packet + length, payload, payloadLength);
+    length += payloadLength;
+
+    if (!writePacket(length)) {
+        return false;
+    }
+    inFlightIds[inFlightCount++] = packetId;
+    return true;
+}
+
+bool MqttClient::poll(uint32_t now) {
+    if (!open) {
+        return false;
+    }
+    if (!receive()) {
+        drop();
+        return false;
+    }
+
+    // PINGRESP attendu : la connexion est considérée comme perdue
+    if (pingPending && now - pingSent >= MQTT_ACK_TIMEOUT) {
+        drop();
+        return false;
+    }
+    if (!pingPending && keepAliveMs > 0 && now - lastSent >= keepAliveMs / 2) {
+        packet[0] = MQTT_PINGREQ;
+        packet[1] = 0;
+        if (!writePacket(2)) {
+            return false;
+        }
+        pingPending = true;
+        pingSent = now;
+    }
+    return true;
+}
+
+uint32_t MqttClient::keepAliveDue(uint32_t now) const {
+    if (!open || keepAliveMs == 0) {
+        return 0xFFFFFFFFUL;
+    }
+    if (pingPending) {
+        uint32_t elapsed = now - pingSent;
+        return elapsed < MQTT_ACK_TIMEOUT ? MQTT_ACK_TIMEOUT - elapsed : 0;
+    }
+    uint32_t elapsed = now - lastSent;
+    return elapsed < keepAliveMs / 2 ? keepAliveMs / 2 - elapsed : 0;
+}
+
+// Lit tout ce qui est arrivé ; false si la connexion est fermée ou le flux
+// mal formé
+bool MqttClient::receive() {
+    uint8_t buffer[64];
+    int count;
+    while ((count = stream.read(buffer, sizeof(buffer))) > 0) {
+        for (int i = 0; i < count; i++) {
+            uint8_t byte = buffer[i];
+            switch (rxState) {
+            case 0: // En-tête fixe
+                rxHeader = byte;
+                rxRemaining = 0;
+                rxShift = 0;
+                rxState = 1;
+                break;
+            case 1: // Longueur restante
+                rxRemaining |= (uint32_t)(byte & 0x7F) << rxShift;
+                rxShift += 7;
+                if (byte & 0x80) {
+                    if (rxShift > 21) {
+                        return false;
+                    }
+                    break;
+                }
+                rxLength = 0;
+                if (rxRemaining == 0) {
+                    handlePacket();
+                    rxState = 0;
+                } else {
+                    rxState = 2;
+                }
+                break;
+            default: // Corps
+                if (rxLength < sizeof(rxBody)) {
+                    rxBody[rxLength] = byte;
+                }
+                if (++rxLength == rxRemaining) {
+                    handlePacket();
+                    rxState = 0;
+                }
+                break;
+            }
+        }
+    }
+    return count == 0;
+}
+
+void MqttClient::handlePacket() {
+    switch (rxHeader & 0xF0) {
+    case MQTT_CONNACK:
+        if (rxLength >= 2) {
+            sessionPresent = rxBody[0] & 0x01;
+            connackCode = rxBody[1];
+        }
+        break;
+    case MQTT_PUBACK:
+        if (rxLength >= 2) {
+            uint16_t packetId = (rxBody[0] << 8) | rxBody[1];
+            for (size_t i = 0; i < inFlightCount; i++) {
+                if (inFlightIds[i] == packetId) {
+                    inFlightIds[i] = inFlightIds[--inFlightCount];
+                    break;
+                }
+            }
+        }
+        break;
+    case MQTT_PINGRESP:
+        pingPending = false;
+        break;
+    default:
+        break; // Aucun abonnement : le reste est ignoré
+    }
+}
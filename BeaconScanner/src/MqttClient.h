@@ -0,0 +1,102 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Hal.h"
+
+// Intervalle de keep-alive annoncé au courtier (s)
+#ifndef MQTT_KEEP_ALIVE
+#define MQTT_KEEP_ALIVE 60
+#endif
+
+// PUBLISH QoS 1 envoyés sans attendre leur PUBACK
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW 8
+#endif
+
+// Attente maximale d'un CONNACK, d'un PUBACK ou d'un PINGRESP (ms)
+#ifndef MQTT_ACK_TIMEOUT
+#define MQTT_ACK_TIMEOUT 5000
+#endif
+
+// Taille maximale d'un paquet émis (en-tête, sujet et message)
+#ifndef MQTT_PACKET_MAX
+#define MQTT_PACKET_MAX 640
+#endif
+
+// Codes d'erreur (négatifs, comme les erreurs réseau de HalNetwork::post)
+enum MqttError {
+    MQTT_OK = 0,
+    MQTT_ERROR_CONNECT = -1,          // Connexion TCP impossible
+    MQTT_ERROR_REFUSED = -2,          // CONNACK avec un code de refus
+    MQTT_ERROR_TIMEOUT = -3,          // Acquittement non reçu à temps
+    MQTT_ERROR_CONNECTION_LOST = -4,
+    MQTT_ERROR_PROTOCOL = -5          // Paquet mal formé ou trop grand
+};
+
+// Client MQTT 3.1.1 minimal, en publication seulement : QoS 1 avec une
+// fenêtre de MQTT_INFLIGHT_WINDOW messages en vol, keep-alive, session
+// persistante au choix. Sans allocation ; la lecture ne bloque jamais,
+// seul connect() attend le CONNACK.
+class MqttClient {
+private:
+    HalStream& stream;
+    bool open;
+    bool sessionPresent;
+    uint32_t keepAliveMs;
+    uint32_t lastSent;
+    bool pingPending;
+    uint32_t pingSent;
+
+    // PUBLISH en attente de leur PUBACK
+    uint16_t nextPacketId;
+    uint16_t inFlightIds[MQTT_INFLIGHT_WINDOW];
+    size_t inFlightCount;
+
+    // Décodage incrémental des paquets reçus ; seuls les 4 premiers octets
+    // du corps sont conservés (CONNACK, PUBACK)
+    uint8_t rxState;
+    uint8_t rxHeader;
+    uint32_t rxRemaining;
+    uint8_t rxShift;
+    uint32_t rxLength;
+    uint8_t rxBody[4];
+    int connackCode;
+
+    uint8_t packet[MQTT_PACKET_MAX];
+
+    bool writePacket(size_t length);
+    bool receive();
+    void handlePacket();
+    void drop();
+
+public:
+    explicit MqttClient(HalStream& stream);
+
+    // Ouvre la connexion TCP et la session, et attend le CONNACK. Retourne
+    // MQTT_OK ou un MqttError
+    int connect(const char* host, uint16_t port, const char* clientId, bool cleanSession, uint16_t keepAliveSeconds);
+    void disconnect();
+
+    bool connected() const { return open; }
+
+    // Le courtier avait conservé la session (cleanSession = false)
+    bool sessionResumed() const { return sessionPresent; }
+
+    // Publie en QoS 1 ; false si la fenêtre est pleine, le paquet trop grand
+    // ou la connexion perdue
+    bool publish(const char* topic, const uint8_t* payload, size_t length);
+
+    size_t inFlight() const { return inFlightCount; }
+    bool windowFull() const { return inFlightCount >= MQTT_INFLIGHT_WINDOW; }
+
+    // Traite les paquets reçus et envoie un PINGREQ quand il le faut.
+    // Retourne false si la connexion est perdue
+    bool poll(uint32_t now);
+
+    // Délai (ms) avant le prochain poll() nécessaire au keep-alive
+    uint32_t keepAliveDue(uint32_t now) const;
+};
+
+#endif
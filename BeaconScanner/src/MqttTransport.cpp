@@ -0,0 +1,97 @@
+#include "MqttTransport.h"
+#include "Log.h"
+
+MqttTransport::MqttTransport(const char* host, uint16_t port, const char* topic)
+    : client(halStream()), host(host), port(port), topic(topic) {
+}
+
+void MqttTransport::begin(const uint8_t deviceMac[6], const char* deviceId) {
+    (void)deviceMac;
+    this->deviceId = deviceId; // Identifiant client : la session lui est liée
+}
+
+// {"deviceId": "...", "timestamp": ..., "beaconId": ..., "eventType": ...}
+size_t MqttTransport::formatEvent(const PendingEvent& event, char* out, size_t size) {
+    StaticJsonDocument<MQTT_PAYLOAD_MAX> doc;
+    JsonObject item = doc.to<JsonObject>();
+    item["deviceId"] = deviceId;
+    eventToJson(event, item, TraceClock::now());
+    return serializeJson(doc, out, size);
+}
+
+// Les PUBLISH partent sans attendre, dans la limite de la fenêtre ; le lot
+// est acquitté quand tous les PUBACK sont arrivés. Sans progression pendant
+// MQTT_ACK_TIMEOUT, la connexion est fermée et le lot sera renvoyé.
+int MqttTransport::send(const PendingEvent* events, size_t count) {
+    if (!client.connected()) {
+        int error = client.connect(host, port, deviceId.c_str(), MQTT_CLEAN_SESSION, MQTT_KEEP_ALIVE);
+        if (error != MQTT_OK) {
+            return error;
+        }
+        LOG_INFO("MQTT connecté à %s:%u, session %s", host, (unsigned)port,
+                 client.sessionResumed() ? "reprise" : "nouvelle");
+    }
+
+    size_t published = 0;
+    size_t acknowledged = 0;
+    uint32_t lastProgress = halMillis();
+
+    for (;;) {
+        while (published < count && !client.windowFull()) {
+            char payload[MQTT_PAYLOAD_MAX];
+            size_t length = formatEvent(events[published], payload, sizeof(payload));
+            if (!client.publish(topic, (const uint8_t*)payload, length)) {
+                return client.connected() ? MQTT_ERROR_PROTOCOL : MQTT_ERROR_CONNECTION_LOST;
+            }
+            published++;
+        }
+
+        uint32_t now = halMillis();
+        if (!client.poll(now)) {
+            return MQTT_ERROR_CONNECTION_LOST;
+        }
+        size_t acked = published - client.inFlight();
+        if (acked == count) {
+            LOG_DEBUG("Lot publié: %d événements sur %s", (int)count, topic);
+            return 200;
+        }
+        if (acked > acknowledged) {
+            acknowledged = acked;
+            lastProgress = now;
+        } else if (now - lastProgress >= MQTT_ACK_TIMEOUT) {
+            client.disconnect();
+            return MQTT_ERROR_TIMEOUT;
+        }
+        halDelay(1);
+    }
+}
+
+// Keep-alive de la connexion entre deux lots ; elle n'est rouverte qu'au
+// prochain envoi
+uint32_t MqttTransport::poll(uint32_t now) {
+    if (!client.connected()) {
+        return UPLINK_IDLE;
+    }
+    if (!client.poll(now)) {
+        LOG_WARN("Connexion MQTT perdue");
+        return UPLINK_IDLE;
+    }
+    return client.keepAliveDue(now);
+}
+
+const char* MqttTransport::errorToString(int code) {
+    switch (code) {
+    case MQTT_ERROR_CONNECT:
+        return "courtier MQTT injoignable";
+    case MQTT_ERROR_REFUSED:
+        return "connexion refusée par le courtier";
+    case MQTT_ERROR_TIMEOUT:
+        return "acquittement MQTT non reçu";
+    case MQTT_ERROR_CONNECTION_LOST:
+        return "connexion MQTT perdue";
+    case MQTT_ERROR_PROTOCOL:
+        return "message MQTT trop grand";
+    default:
+        return "erreur MQTT";
+    }
+}
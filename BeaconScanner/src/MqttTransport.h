@@ -0,0 +1,45 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include "EventTransport.h"
+#include "MqttClient.h"
+
+// Sujet consommé par MttqApp.js (et publié par controller.js en mode HTTP)
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "beacon/events"
+#endif
+
+// 0 : session persistante, conservée par le courtier entre deux connexions
+#ifndef MQTT_CLEAN_SESSION
+#define MQTT_CLEAN_SESSION 0
+#endif
+
+// Taille maximale du message JSON d'un événement
+#ifndef MQTT_PAYLOAD_MAX
+#define MQTT_PAYLOAD_MAX 512
+#endif
+
+// Publication directe au courtier MQTT, sans passer par le contrôleur : un
+// message JSON QoS 1 par événement, de même forme que ceux publiés par
+// controller.js. Le lot n'est acquitté qu'une fois tous ses PUBACK reçus.
+class MqttTransport : public EventTransport {
+private:
+    MqttClient client;
+    const char* host;
+    uint16_t port;
+    const char* topic;
+    String deviceId;
+
+    size_t formatEvent(const PendingEvent& event, char* out, size_t size);
+
+public:
+    MqttTransport(const char* host, uint16_t port, const char* topic = MQTT_TOPIC);
+
+    const char* name() const override { return "mqtt"; }
+    void begin(const uint8_t deviceMac[6], const char* deviceId) override;
+    int send(const PendingEvent* events, size_t count) override;
+    uint32_t poll(uint32_t now) override;
+    const char* errorToString(int code) override;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PENDING_EVENT_H
+#define PENDING_EVENT_H
+
+#include <stdint.h>
+#include "BeaconInfo.h"
+
+enum UplinkEventType : uint8_t {
+    EVENT_ARRIVAL = 0,
+    EVENT_DEPARTURE = 1
+};
+
+// PendingEvent::epoch d'un événement d'un démarrage précédent dont l'heure
+// réelle n'a jamais été connue
+#define EVENT_EPOCH_UNKNOWN UINT64_MAX
+
+// Événement en attente d'envoi : structure POD copiée telle quelle dans la
+// file, l'identifiant texte n'est construit qu'à la sérialisation.
+// Les horodatages restent en millis() jusqu'à l'envoi, où ils sont
+// convertis en heure réelle (voir TraceClock.h).
+struct PendingEvent {
+    uint8_t eventType;      // UplinkEventType
+    BeaconInfo beacon;
+    uint32_t timestamp;     // millis() à la mise en file
+    uint32_t receivedAt;    // millis() de l'annonce reçue (onResult)
+    uint32_t traceId;       // Suit l'événement jusqu'au tableau de bord
+    uint64_t epoch;         // Heure réelle de la mise en file (ms) si déjà
+                            // connue (spool), 0 sinon
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <math.h>
+#include <stdint.h>
+#include "BeaconInfo.h"
+#include "AdvParser.h"
+
+// Détection de présence avec hystérésis. Le RSSI de chaque beacon est lissé
+// par un filtre de Kalman scalaire ; un beacon n'arrive que si l'estimation
+// reste au-dessus de PRESENCE_ENTER_RSSI pendant PRESENCE_ENTER_DWELL, et ne
+// repart que si elle reste sous PRESENCE_EXIT_RSSI pendant
+// PRESENCE_EXIT_DWELL (ou s'il n'est plus vu pendant BEACON_TIMEOUT). Les
+// beacons en limite de portée ne font donc plus alterner arrivées et départs.
+//
+// Pour retrouver l'ancien comportement (une annonce suffit) :
+//   -D PRESENCE_ENTER_RSSI=-127 -D PRESENCE_EXIT_RSSI=-128 -D PRESENCE_ENTER_DWELL=0
+//   -D PRESENCE_FLAP_SUPPRESS=0
+
+#ifndef PRESENCE_ENTER_RSSI
+#define PRESENCE_ENTER_RSSI -88      // dBm
+#endif
+#ifndef PRESENCE_EXIT_RSSI
+#define PRESENCE_EXIT_RSSI -96       // dBm
+#endif
+#ifndef PRESENCE_ENTER_DWELL
+#define PRESENCE_ENTER_DWELL 2000    // ms
+#endif
+#ifndef PRESENCE_EXIT_DWELL
+#define PRESENCE_EXIT_DWELL 10000    // ms
+#endif
+
+// Bruit de mesure (dB², écart type 4 dB) et dérive du RSSI réel (dB² par s)
+#ifndef PRESENCE_MEASUREMENT_NOISE
+#define PRESENCE_MEASUREMENT_NOISE 16.0f
+#endif
+#ifndef PRESENCE_PROCESS_NOISE
+#define PRESENCE_PROCESS_NOISE 0.5f
+#endif
+
+// Amortissement des beacons qui oscillent, à la manière du « route flap
+// damping » (RFC 2439) : chaque arrivée ou départ signalé ajoute 1 à une
+// pénalité qui diminue de moitié toutes les PRESENCE_FLAP_HALF_LIFE. Tant
+// qu'elle atteint PRESENCE_FLAP_SUPPRESS, l'hystérésis ne change plus
+// l'état : un beacon présent ne repart que par le silence (BEACON_TIMEOUT),
+// un beacon absent n'arrive pas tant que son RSSI lissé reste à moins de
+// PRESENCE_FLAP_MARGIN dB du seuil d'entrée (un retour franc, en pleine
+// portée, est signalé tout de suite). La transition retenue est signalée dès
+// que la pénalité repasse sous le seuil, au plus une demi-vie plus tard avec
+// les valeurs par défaut. 0 : pas d'amortissement.
+#ifndef PRESENCE_FLAP_SUPPRESS
+#define PRESENCE_FLAP_SUPPRESS 2.0f
+#endif
+#ifndef PRESENCE_FLAP_MARGIN
+#define PRESENCE_FLAP_MARGIN 6       // dB
+#endif
+#ifndef PRESENCE_FLAP_HALF_LIFE
+#define PRESENCE_FLAP_HALF_LIFE 1800000 // ms
+#endif
+
+// Exposant d'affaiblissement pour l'estimation de distance (2 en champ libre)
+#ifndef PATH_LOSS_EXPONENT
+#define PATH_LOSS_EXPONENT 2.0f
+#endif
+
+enum PresenceTransition : uint8_t {
+    PRESENCE_NONE,
+    PRESENCE_ARRIVAL,
+    PRESENCE_DEPARTURE
+};
+
+// Pénalité d'oscillation ramenée à l'instant now
+inline float presenceFlapPenalty(const BeaconInfo& beacon, uint32_t now) {
+    return beacon.flapPenalty * exp2f(-(float)(now - beacon.flapUpdated) / PRESENCE_FLAP_HALF_LIFE);
+}
+
+// À chaque arrivée ou départ signalé
+inline void presenceFlap(BeaconInfo& beacon, uint32_t now) {
+    beacon.flapPenalty = presenceFlapPenalty(beacon, now) + 1.0f;
+    beacon.flapUpdated = now;
+}
+
+// Repart de la mesure courante (nouveau beacon ou retour après un départ)
+inline void presenceReset(BeaconInfo& beacon, int8_t rssi) {
+    beacon.rssiFiltered = rssi;
+    beacon.rssiVariance = PRESENCE_MEASUREMENT_NOISE;
+    beacon.dwelling = false;
+}
+
+// Intègre une mesure, en O(1). elapsedMs : temps depuis la mesure précédente.
+// Ne modifie pas isPresent : l'appelant le fait en émettant l'événement.
+inline PresenceTransition presenceUpdate(BeaconInfo& beacon, int8_t rssi, uint32_t elapsedMs, uint32_t now) {
+    beacon.rssiVariance += PRESENCE_PROCESS_NOISE * (elapsedMs / 1000.0f);
+    float gain = beacon.rssiVariance / (beacon.rssiVariance + PRESENCE_MEASUREMENT_NOISE);
+    beacon.rssiFiltered += gain * (rssi - beacon.rssiFiltered);
+    beacon.rssiVariance *= 1.0f - gain;
+
+    bool condition = beacon.isPresent ? beacon.rssiFiltered < PRESENCE_EXIT_RSSI
+                                      : beacon.rssiFiltered >= PRESENCE_ENTER_RSSI;
+    if (!condition) {
+        beacon.dwelling = false;
+        return PRESENCE_NONE;
+    }
+    if (!beacon.dwelling) {
+        beacon.dwelling = true;
+        beacon.dwellSince = now;
+    }
+    if (now - beacon.dwellSince < (uint32_t)(beacon.isPresent ? PRESENCE_EXIT_DWELL : PRESENCE_ENTER_DWELL)) {
+        return PRESENCE_NONE;
+    }
+    bool nearEdge = beacon.isPresent || beacon.rssiFiltered < PRESENCE_ENTER_RSSI + PRESENCE_FLAP_MARGIN;
+    if (PRESENCE_FLAP_SUPPRESS > 0 && nearEdge && presenceFlapPenalty(beacon, now) >= PRESENCE_FLAP_SUPPRESS) {
+        return PRESENCE_NONE; // Oscille : attend que la pénalité retombe
+    }
+    beacon.dwelling = false;
+    return beacon.isPresent ? PRESENCE_DEPARTURE : PRESENCE_ARRIVAL;
+}
+
+// Distance estimée (m) à partir du RSSI lissé et de la puissance annoncée,
+// ou -1 si la trame n'en donne pas. La puissance Eddystone est donnée à
+// 0 m : 41 dB de moins à 1 m.
+inline float estimateDistance(const BeaconInfo& beacon) {
+    int measuredPower;
+    switch (beacon.frameType) {
+    case FRAME_IBEACON:
+    case FRAME_ALTBEACON:
+        measuredPower = beacon.txPower;
+        break;
+    case FRAME_EDDYSTONE_UID:
+    case FRAME_EDDYSTONE_URL:
+        measuredPower = beacon.txPower - 41;
+        break;
+    default:
+        return -1.0f;
+    }
+    if (measuredPower == 0) {
+        return -1.0f;
+    }
+    return powf(10.0f, (measuredPower - beacon.rssiFiltered) / (10.0f * PATH_LOSS_EXPONENT));
+}
+
+#endif
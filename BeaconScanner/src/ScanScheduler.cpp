@@ -0,0 +1,72 @@
+#include "ScanScheduler.h"
+
+static_assert(SCAN_WINDOW <= SCAN_INTERVAL && SCAN_UPLINK_WINDOW <= SCAN_INTERVAL &&
+              SCAN_QUIET_WINDOW <= SCAN_QUIET_INTERVAL, "La fenêtre de scan dépasse l'intervalle");
+
+ScanScheduler::ScanScheduler(bool adaptive)
+    : adaptive(adaptive), started(false), lastAdvertisements(0), lastListenMs(0), rate(0),
+      quietSince(0), dense(false), listenMs(0), wifiWindowMs(0), currentDuty(0), currentActive(false),
+      currentMode(SCAN_MODE_FIXED), currentRate(0) {
+    for (size_t i = 0; i < SCAN_MODE_COUNT; i++) {
+        cycles[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* ScanScheduler::modeName(ScanMode mode) {
+    static const char* const names[SCAN_MODE_COUNT] = {"fixed", "quiet", "normal", "dense", "uplink"};
+    return mode < SCAN_MODE_COUNT ? names[mode] : "?";
+}
+
+ScanPlan ScanScheduler::choose(uint32_t now, uint32_t beacons, uint32_t pendingEvents) {
+    if (!adaptive) {
+        return {SCAN_MODE_FIXED, 100, 99, true, 5000, 0};
+    }
+
+    // Hystérésis : la zone reste dense jusqu'aux trois quarts des seuils
+    if (beacons >= SCAN_DENSE_BEACONS || rate >= SCAN_DENSE_RATE) {
+        dense = true;
+    } else if (beacons < SCAN_DENSE_BEACONS * 3 / 4 && rate < SCAN_DENSE_RATE * 3 / 4) {
+        dense = false;
+    }
+
+    if (beacons > 0 || rate >= SCAN_QUIET_RATE) {
+        quietSince = now;
+    }
+
+    if (pendingEvents > 0) {
+        return {SCAN_MODE_UPLINK, SCAN_INTERVAL, SCAN_UPLINK_WINDOW, !dense, SCAN_CYCLE, SCAN_TX_WINDOW};
+    }
+    if (dense) {
+        return {SCAN_MODE_DENSE, SCAN_INTERVAL, SCAN_WINDOW, false, SCAN_CYCLE, 0};
+    }
+    if (now - quietSince >= SCAN_QUIET_AFTER) {
+        return {SCAN_MODE_QUIET, SCAN_QUIET_INTERVAL, SCAN_QUIET_WINDOW, false, SCAN_QUIET_CYCLE, 0};
+    }
+    return {SCAN_MODE_NORMAL, SCAN_INTERVAL, SCAN_WINDOW, true, SCAN_CYCLE, 0};
+}
+
+ScanPlan ScanScheduler::plan(uint32_t now, uint32_t advertisements, uint32_t beacons, uint32_t pendingEvents) {
+    if (!started) {
+        started = true;
+        quietSince = now;
+    } else if (lastListenMs > 0) {
+        // Annonces reçues par seconde d'écoute, lissées sur quelques cycles
+        float observed = (advertisements - lastAdvertisements) * 1000.0f / lastListenMs;
+        rate += 0.5f * (observed - rate);
+    }
+    lastAdvertisements = advertisements;
+
+    ScanPlan next = choose(now, beacons, pendingEvents);
+
+    // Temps d'écoute effectif du cycle : fenêtre / intervalle de sa durée
+    lastListenMs = next.scanMs * next.windowMs / next.intervalMs;
+
+    cycles[next.mode].fetch_add(1, std::memory_order_relaxed);
+    listenMs.fetch_add(lastListenMs, std::memory_order_relaxed);
+    wifiWindowMs.fetch_add(next.pauseMs, std::memory_order_relaxed);
+    currentDuty.store(next.windowMs * 1000u / next.intervalMs, std::memory_order_relaxed);
+    currentActive.store(next.active, std::memory_order_relaxed);
+    currentMode.store(next.mode, std::memory_order_relaxed);
+    currentRate.store((uint32_t)(rate + 0.5f), std::memory_order_relaxed);
+    return next;
+}
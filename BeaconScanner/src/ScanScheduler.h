@@ -0,0 +1,138 @@
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// 0 : paramètres fixes d'origine (intervalle 100 ms, fenêtre 99 ms, scan
+// actif, cycles de 5 s)
+#ifndef SCAN_ADAPTIVE
+#define SCAN_ADAPTIVE 1
+#endif
+
+// Durée d'un cycle (ms) : les paramètres sont revus à chaque cycle.
+// halRadio().scan() arrête le scan après cette durée exacte
+#ifndef SCAN_CYCLE
+#define SCAN_CYCLE 1000
+#endif
+
+// Intervalle de scan et fenêtre d'écoute par intervalle (ms), selon le mode
+#ifndef SCAN_INTERVAL
+#define SCAN_INTERVAL 100
+#endif
+#ifndef SCAN_WINDOW
+#define SCAN_WINDOW 90           // Laisse 10 % du temps radio au WiFi
+#endif
+#ifndef SCAN_UPLINK_WINDOW
+#define SCAN_UPLINK_WINDOW 40    // Des événements attendent l'envoi
+#endif
+
+// Zone calme : veille à faible rapport cyclique
+#ifndef SCAN_QUIET_INTERVAL
+#define SCAN_QUIET_INTERVAL 1000
+#endif
+#ifndef SCAN_QUIET_WINDOW
+#define SCAN_QUIET_WINDOW 100
+#endif
+#ifndef SCAN_QUIET_CYCLE
+#define SCAN_QUIET_CYCLE 2000
+#endif
+#ifndef SCAN_QUIET_RATE
+#define SCAN_QUIET_RATE 20       // Annonces/s estimées (appareils lointains) tolérées
+#endif
+#ifndef SCAN_QUIET_AFTER
+#define SCAN_QUIET_AFTER 30000   // Durée de calme avant la veille (ms)
+#endif
+
+// Zone dense : scan passif, sans demande de scan à chaque annonce
+#ifndef SCAN_DENSE_BEACONS
+#define SCAN_DENSE_BEACONS 40    // Beacons présents
+#endif
+#ifndef SCAN_DENSE_RATE
+#define SCAN_DENSE_RATE 400      // Ou annonces/s estimées
+#endif
+
+// Radio laissée entièrement au WiFi après chaque cycle tant que des
+// événements attendent l'envoi (ms)
+#ifndef SCAN_TX_WINDOW
+#define SCAN_TX_WINDOW 200
+#endif
+
+enum ScanMode : uint8_t {
+    SCAN_MODE_FIXED,    // SCAN_ADAPTIVE=0
+    SCAN_MODE_QUIET,    // Veille
+    SCAN_MODE_NORMAL,   // Scan actif (réponses de scan : noms)
+    SCAN_MODE_DENSE,    // Scan passif
+    SCAN_MODE_UPLINK,   // Fenêtre réduite et fenêtre WiFi après le cycle
+    SCAN_MODE_COUNT
+};
+
+// Paramètres d'un cycle de scan
+struct ScanPlan {
+    ScanMode mode;
+    uint16_t intervalMs;
+    uint16_t windowMs;
+    bool active;
+    uint32_t scanMs;    // Durée du scan
+    uint32_t pauseMs;   // Puis radio laissée au WiFi
+};
+
+// Partage de la radio entre le scan BLE et le WiFi de l'envoi. L'ESP32 n'a
+// qu'une radio : pendant la fenêtre de scan, le WiFi attend, ce qui allonge
+// les POST, et les relances de l'envoi prennent à leur tour du temps au
+// scan. Avant chaque cycle, la tâche de scan demande un plan selon :
+//   - des événements en attente (WiFi connecté) : fenêtre réduite, puis
+//     SCAN_TX_WINDOW ms sans scan pour l'envoi ;
+//   - beaucoup de beacons présents ou d'annonces : scan passif ;
+//   - aucun beacon présent et peu d'annonces depuis SCAN_QUIET_AFTER :
+//     veille, quittée dès qu'un beacon arrive ou que les annonces
+//     dépassent SCAN_QUIET_RATE ;
+//   - sinon scan actif.
+// Le débit d'annonces est rapporté au temps d'écoute du cycle précédent :
+// c'est une estimation du débit dans l'air, indépendante du mode.
+// plan() est appelé par une seule tâche ; les compteurs peuvent être lus
+// depuis une autre (/metrics).
+class ScanScheduler {
+private:
+    bool adaptive;
+    bool started;
+    uint32_t lastAdvertisements;
+    uint32_t lastListenMs;       // Temps d'écoute du cycle précédent
+    float rate;                  // Annonces/s estimées, lissées
+    uint32_t quietSince;
+    bool dense;
+
+    std::atomic<uint32_t> cycles[SCAN_MODE_COUNT];
+    std::atomic<uint32_t> listenMs;
+    std::atomic<uint32_t> wifiWindowMs;
+    std::atomic<uint32_t> currentDuty;       // Fenêtre / intervalle, en millièmes
+    std::atomic<bool> currentActive;
+    std::atomic<uint8_t> currentMode;
+    std::atomic<uint32_t> currentRate;
+
+    ScanPlan choose(uint32_t now, uint32_t beacons, uint32_t pendingEvents);
+
+public:
+    explicit ScanScheduler(bool adaptive = SCAN_ADAPTIVE);
+
+    // Avant le premier plan (simulateur : comparaison des deux politiques)
+    void setAdaptive(bool enabled) { adaptive = enabled; }
+
+    // Plan du prochain cycle. advertisements : compteur cumulé des
+    // annonces reçues ; beacons : beacons présents ; pendingEvents :
+    // événements en attente, 0 si le WiFi est coupé.
+    ScanPlan plan(uint32_t now, uint32_t advertisements, uint32_t beacons, uint32_t pendingEvents);
+
+    uint32_t cycleCount(ScanMode mode) const { return cycles[mode].load(std::memory_order_relaxed); }
+    uint32_t listenTimeMs() const { return listenMs.load(std::memory_order_relaxed); }
+    uint32_t wifiWindowTimeMs() const { return wifiWindowMs.load(std::memory_order_relaxed); }
+    uint32_t dutyPerMille() const { return currentDuty.load(std::memory_order_relaxed); }
+    bool activeScan() const { return currentActive.load(std::memory_order_relaxed); }
+    ScanMode mode() const { return (ScanMode)currentMode.load(std::memory_order_relaxed); }
+    uint32_t advertisementRate() const { return currentRate.load(std::memory_order_relaxed); }
+
+    static const char* modeName(ScanMode mode);
+};
+
+#endif
@@ -1,7 +1,10 @@
 #include "SendEvents.h"
-#include <WiFi.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
+#include "Hal.h"
+#include "Log.h"
+#include "EventSpool.h"
+#include "CoapTransport.h"
+#include "HttpTransport.h"
+#include "MqttTransport.h"
 
 // Configuration WiFi - À modifier selon votre réseau
 const char* ssid = "newton";     // Vérifier que le nom est exact
@@ -9,19 +12,44 @@ const char* password = "wesh1234"; // Vérifier que le mot de passe est correct
 
 // Configuration du contrôleur intermédiaire - À modifier selon votre contrôleur
 const char* serverURL = "http://172.20.10.5:4000"; // Remplacez par l'IP de votre contrôleur
-const char* endpointArrival = "/beacon/arrival";
-const char* endpointDeparture = "/beacon/departure";
+const char* endpointBatch = "/beacon/batch";
 
-// Variables pour la gestion de la connexion
-bool wifiConnected = false;
-unsigned long lastWifiCheck = 0;
-const unsigned long WIFI_CHECK_INTERVAL = 30000; // Vérifier la connexion WiFi toutes les 30 secondes
+// Courtier MQTT (UPLINK_TRANSPORT_MQTT) - celui qu'écoute MttqApp.js
+const char* mqttBrokerHost = "172.20.10.5";
+const uint16_t mqttBrokerPort = 1883;
 
-// File d'attente pour les événements (en cas de perte de connexion)
-std::vector<PendingEvent> eventQueue;
-const int MAX_QUEUE_SIZE = 50;
+// Serveur CoAP (UPLINK_TRANSPORT_COAP) - CoapServer.js
+const char* coapServerHost = "172.20.10.5";
+const uint16_t coapServerPort = 5683;
 
-SendEvents::SendEvents() {
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+static MqttTransport defaultTransport(mqttBrokerHost, mqttBrokerPort);
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_COAP
+static CoapTransport defaultTransport(coapServerHost, coapServerPort);
+#else
+static HttpTransport defaultTransport(serverURL, endpointBatch);
+#endif
+
+// Spool sur la flash (partition SPOOL_PARTITION, sans système de fichiers) :
+// les événements non envoyés y survivent aux coupures réseau et aux
+// redémarrages
+PartitionSpoolStorage spoolStorage;
+EventSpool eventSpool(spoolStorage);
+bool spoolReady = false;
+
+// Durée maximale d'attente d'une connexion WiFi avant nouvel essai
+const unsigned long WIFI_CONNECT_TIMEOUT = 10000;
+
+// Intervalle de vérification de l'état de la connexion en cours
+const uint32_t WIFI_POLL_INTERVAL = 100;
+
+SendEvents::SendEvents()
+    : wifiConnected(false), connecting(false), connectStart(0), backingOff(false), backoffStart(0),
+      retryDelay(UPLINK_RETRY_MIN), clockStarted(false), eventQueue(NULL), uplinkTaskHandle(NULL), batchCount(0), batchStart(0),
+      spoolLock(NULL), spoolPending(0), spoolOverwritten(0), transport(&defaultTransport), push(nullptr), enqueuedCount(0), droppedCount(0), spilledCount(0),
+      coalescedCount(0), sentCount(0),
+      failedPostCount(0), latencyMax(0), latencyTotal(0), latencySamples(0), transportErrorCount(0), clientErrorCount(0),
+      serverErrorCount(0), nextTraceId(0) {
     // Constructeur
 }
 
@@ -29,180 +57,437 @@ void SendEvents::init() {
     Serial.println("╔══════════════════════════════════════════════════════╗");
     Serial.println("║              INITIALISATION WIFI                     ║");
     Serial.println("╚══════════════════════════════════════════════════════╝");
-    
-    connectToWiFi();
-}
-
-void SendEvents::connectToWiFi() {
-    WiFi.begin(ssid, password);
-    Serial.print("Connexion au WiFi");
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        wifiConnected = true;
-        Serial.println();
-        Serial.printf("WiFi connecté! IP: %s\n", WiFi.localIP().toString().c_str());
-        Serial.printf("Serveur backend: %s\n", serverURL);
-        Serial.println();
-        
-        // Traiter les événements en attente
-        processQueuedEvents();
+
+    halNetwork().macAddress(deviceMac);
+    deviceId = getDeviceId();
+    nextTraceId = halRandom();
+    transport->begin(deviceMac, deviceId.c_str());
+    if (push) {
+        push->setDeviceId(deviceId.c_str());
+    }
+    eventQueue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(PendingEvent));
+    spoolLock = xSemaphoreCreateMutex();
+
+    spoolReady = spoolStorage.open(SPOOL_PARTITION) && eventSpool.begin();
+    if (spoolReady) {
+        spoolPending = eventSpool.size();
+        Serial.printf("Spool d'événements: %d en attente (capacité %d)\n",
+                      (int)eventSpool.size(), (int)eventSpool.capacity());
     } else {
-        wifiConnected = false;
-        Serial.println();
-        Serial.println("Échec de la connexion WiFi!");
-        Serial.println();
-    }
-}
-
-void SendEvents::checkWiFiConnection() {
-    unsigned long currentTime = millis();
-    
-    if (currentTime - lastWifiCheck > WIFI_CHECK_INTERVAL) {
-        lastWifiCheck = currentTime;
-        
-        if (WiFi.status() != WL_CONNECTED) {
-            if (wifiConnected) {
-                Serial.println("Connexion WiFi perdue, tentative de reconnexion...");
-                wifiConnected = false;
-            }
-            connectToWiFi();
-        } else if (!wifiConnected) {
-            wifiConnected = true;
-            Serial.println("Connexion WiFi rétablie!");
-            processQueuedEvents();
+        Serial.println("Spool d'événements indisponible, file en RAM uniquement");
+    }
+    Serial.printf("Transport des événements: %s\n", transport->name());
+
+#if UPLINK_TASK
+    // La connexion, les reprises et l'envoi se font dans une tâche dédiée,
+    // sur le cœur réseau
+    xTaskCreatePinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, this, UPLINK_TASK_PRIORITY,
+                            &uplinkTaskHandle, NETWORK_CORE);
+#endif
+}
+
+void SendEvents::uplinkTask(void* parameter) {
+    static_cast<SendEvents*>(parameter)->runUplink();
+}
+
+// Boucle de la tâche réseau : enchaîne les étapes et dort entre deux, en se
+// réveillant dès qu'un événement arrive dans la file
+void SendEvents::runUplink() {
+    for (;;) {
+        uint32_t wait = service();
+        if (wait == 0) {
+            continue;
+        }
+
+        PendingEvent next;
+        if (uxQueueMessagesWaiting(eventQueue) == 0) {
+            xQueuePeek(eventQueue, &next, wait == UPLINK_IDLE ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+        } else if (wait != UPLINK_IDLE) {
+            vTaskDelay(pdMS_TO_TICKS(wait)); // File non consommée pendant l'attente
         }
     }
 }
 
-bool SendEvents::sendBeaconEvent(const String& eventType, const BeaconInfo& beacon, const String& beaconId) {
-    if (!wifiConnected) {
-        // Ajouter à la file d'attente si pas de connexion
-        queueEvent(eventType, beacon, beaconId);
-        return false;
+// Une étape, sans blocage autre que l'envoi HTTP : constitue les lots à
+// partir de la file et les envoie, en reprenant avec un délai exponentiel en
+// cas d'échec. Tant que le spool n'est pas vide, les nouveaux événements y
+// sont ajoutés et l'envoi se fait depuis le spool, pour conserver l'ordre.
+uint32_t SendEvents::service() {
+    uint32_t now = halMillis();
+
+    // Attente avant nouvel essai ; les événements reçus pendant ce temps
+    // passent directement dans le spool
+    if (backingOff) {
+        lockSpool();
+        spoolQueuedEvents();
+        uint32_t elapsed = now - backoffStart;
+        if (elapsed < retryDelay) {
+            unlockSpool();
+            return retryDelay - elapsed;
+        }
+        backingOff = false;
+        if (spoolReady) {
+            flushSpool();
+        }
+        unlockSpool();
+        retryDelay = retryDelay * 2 > UPLINK_RETRY_MAX ? UPLINK_RETRY_MAX : retryDelay * 2;
     }
-    
-    HTTPClient http;
-    http.begin(String(serverURL) + (eventType == "arrival" ? endpointArrival : endpointDeparture));
-    http.addHeader("Content-Type", "application/json");
-    
-    // Créer le payload JSON
-    StaticJsonDocument<512> doc;
-    doc["timestamp"] = getTimestamp();
-    doc["beaconId"] = beaconId;
-    doc["name"] = beacon.name;
-    doc["uuid"] = beacon.uuid;
-    doc["rssi"] = beacon.rssi;
-    doc["eventType"] = eventType;
-    doc["deviceId"] = getDeviceId();
-    
-    String payload;
-    serializeJson(doc, payload);
-    
-    int httpResponseCode = http.POST(payload);
-    
-    if (httpResponseCode > 0) {
-        String response = http.getString();
-        Serial.printf("Événement envoyé (%s): %d - %s\n", eventType.c_str(), httpResponseCode, response.c_str());
-        http.end();
+
+    if (!ensureWiFi(now)) {
+        lockSpool();
+        spoolQueuedEvents();
+        unlockSpool();
+        return backingOff ? retryDelay : WIFI_POLL_INTERVAL;
+    }
+    uint32_t transportWait = transport->poll(now);
+
+    // Rejeu du spool par lots après une coupure ou un redémarrage. Le verrou
+    // n'est pas gardé pendant l'envoi : la tâche de suivi peut déborder dans
+    // le spool entre-temps.
+    lockSpool();
+    if (spoolReady && batchCount == 0 && !eventSpool.empty()) {
+        spoolQueuedEvents();
+        size_t count = eventSpool.peek(outboundBatch, EVENT_BATCH_SIZE);
+        unlockSpool();
+        if (count == 0) {
+            return 0;
+        }
+        if (postBatch(outboundBatch, count)) {
+            lockSpool();
+            eventSpool.consume(count);
+            unlockSpool();
+            sentCount += count;
+            retryDelay = UPLINK_RETRY_MIN;
+            return 0;
+        }
+        failedPostCount++;
+        startBackoff(now);
+        return retryDelay;
+    }
+
+    // Compléter le lot jusqu'au seuil de taille ou de temps. Si la file a
+    // débordé dans le spool, le lot, plus ancien, part aussitôt tel quel et
+    // le spool ensuite.
+    PendingEvent event;
+    while (batchCount < EVENT_BATCH_SIZE && (!spoolReady || eventSpool.empty()) &&
+           xQueueReceive(eventQueue, &event, 0) == pdTRUE) {
+        if (coalesce(event)) {
+            continue;
+        }
+        if (batchCount == 0) {
+            batchStart = now;
+        }
+        outboundBatch[batchCount++] = event;
+    }
+    bool spilled = spoolReady && !eventSpool.empty();
+    size_t count = batchCount; // Lu sous le verrou : clearQueue() peut le vider ensuite
+    unlockSpool();
+    if (count == 0) {
+        return transportWait; // Rien à envoyer : attendre le premier événement
+    }
+    uint32_t elapsed = now - batchStart;
+    if (count < EVENT_BATCH_SIZE && elapsed < EVENT_FLUSH_INTERVAL && !spilled) {
+        return EVENT_FLUSH_INTERVAL - elapsed;
+    }
+
+    if (!halNetwork().connected()) {
+        lockSpool();
+        spoolBatch(); // Le lot est conservé jusqu'à la reconnexion
+        unlockSpool();
+        return 0;
+    }
+
+    if (postBatch(outboundBatch, count)) {
+        sentCount += batchCount; // 0 si clearQueue() est passé pendant l'envoi
+        batchCount = 0;
+        retryDelay = UPLINK_RETRY_MIN;
+        return 0;
+    }
+    failedPostCount++;
+    lockSpool();
+    spoolBatch(); // Le lot est conservé pour le prochain essai
+    unlockSpool();
+    startBackoff(now);
+    return retryDelay;
+}
+
+// Regroupement par beacon : seul le dernier état de chaque beacon compte
+// pour le backend. Un événement du même sens que celui en attente le
+// remplace ; de sens contraire (arrivée puis départ, ou l'inverse), il
+// l'annule et les deux sont retirés du lot. Retourne true si l'événement a
+// été absorbé.
+bool SendEvents::coalesce(const PendingEvent& event) {
+#if UPLINK_COALESCE
+    size_t count = batchCount;
+    for (size_t i = count; i-- > 0;) {
+        if (!sameBeacon(outboundBatch[i].beacon, event.beacon)) {
+            continue;
+        }
+        if (outboundBatch[i].eventType == event.eventType) {
+            outboundBatch[i] = event;
+            coalescedCount++;
+        } else {
+            memmove(&outboundBatch[i], &outboundBatch[i + 1], (count - i - 1) * sizeof(PendingEvent));
+            batchCount = count - 1;
+            coalescedCount += 2;
+        }
         return true;
-    } else {
-        Serial.printf("Erreur envoi événement: %s\n", http.errorToString(httpResponseCode).c_str());
-        http.end();
-        
-        // Ajouter à la file d'attente en cas d'erreur
-        queueEvent(eventType, beacon, beaconId);
+    }
+#else
+    (void)event;
+#endif
+    return false;
+}
+
+// L'heure réelle est figée à l'entrée dans le spool : après un
+// redémarrage, millis() ne permet plus de la retrouver. Retourne false si
+// le spool ne peut plus rien accepter (écriture sur la flash en échec).
+bool SendEvents::spoolEvent(PendingEvent& event, const TraceClock& clock) {
+    if (event.epoch == 0) {
+        event.epoch = clock.toEpoch(event.timestamp);
+    }
+    return eventSpool.append(event);
+}
+
+// Le spool appartient à la tâche réseau, sauf quand la file déborde : la
+// tâche de suivi y verse alors la file (voir spill()). Toute opération sur
+// le spool, et toute lecture de la file, se fait sous ce verrou.
+void SendEvents::lockSpool() {
+    xSemaphoreTake(spoolLock, portMAX_DELAY);
+}
+
+void SendEvents::unlockSpool() {
+    if (spoolReady) {
+        spoolPending = eventSpool.size();
+        spoolOverwritten = eventSpool.overwritten();
+    }
+    xSemaphoreGive(spoolLock);
+}
+
+// Écrit le tampon du spool ; en cas d'échec, il reste en RAM
+void SendEvents::flushSpool() {
+    if (!eventSpool.flush()) {
+        LOG_WARN("Écriture du spool en échec, %d événements gardés en RAM", (int)eventSpool.pendingWrites());
+    }
+}
+
+// Déplace le lot en cours dans le spool (sinon il reste en RAM). Les
+// événements refusés par le spool restent dans le lot. Si la file y a
+// débordé pendant l'envoi, le lot, plus ancien, ne peut pas passer devant :
+// il reste en RAM et repart avant le spool (voir service()).
+void SendEvents::spoolBatch() {
+    if (!spoolReady || !eventSpool.empty()) {
+        return;
+    }
+    TraceClock clock = TraceClock::now();
+    size_t spooled = 0;
+    while (spooled < batchCount && spoolEvent(outboundBatch[spooled], clock)) {
+        spooled++;
+    }
+    memmove(&outboundBatch[0], &outboundBatch[spooled], (batchCount - spooled) * sizeof(PendingEvent));
+    batchCount = batchCount - spooled;
+    flushSpool();
+}
+
+// Vide la file RAM dans le spool sans attendre (hors connexion) ; s'arrête
+// si le spool refuse, les événements restants attendent dans la file.
+// Retourne le nombre d'événements déplacés.
+size_t SendEvents::spoolQueuedEvents() {
+    if (!spoolReady) {
+        return 0;
+    }
+    TraceClock clock = TraceClock::now();
+    PendingEvent event;
+    size_t moved = 0;
+    while (xQueuePeek(eventQueue, &event, 0) == pdTRUE && spoolEvent(event, clock)) {
+        xQueueReceive(eventQueue, &event, 0);
+        moved++;
+    }
+    return moved;
+}
+
+// Retourne true si la connexion est établie ; sinon lance ou surveille la
+// tentative en cours, sans attendre
+bool SendEvents::ensureWiFi(uint32_t now) {
+    HalNetwork& network = halNetwork();
+
+    if (!network.connected()) {
+        if (wifiConnected) {
+            LOG_WARN("Connexion WiFi perdue, tentative de reconnexion...");
+            wifiConnected = false;
+        }
+
+        if (!connecting) {
+            network.connect(ssid, password);
+            connecting = true;
+            connectStart = now;
+        } else if (now - connectStart >= WIFI_CONNECT_TIMEOUT) {
+            LOG_WARN("Échec de la connexion WiFi!");
+            connecting = false;
+            startBackoff(now);
+        }
         return false;
     }
+
+    connecting = false;
+    if (!wifiConnected) {
+        wifiConnected = true;
+        retryDelay = UPLINK_RETRY_MIN;
+        char ip[16];
+        network.localIP(ip, sizeof(ip));
+        LOG_INFO("WiFi connecté! IP: %s, serveur backend: %s", ip, serverURL);
+        if (!clockStarted) {
+            halClockBegin(UPLINK_NTP_SERVER);
+            clockStarted = true;
+        }
+    }
+    return true;
 }
 
-void SendEvents::sendBeaconArrival(const BeaconInfo& beacon, const String& beaconId) {
-    sendBeaconEvent("arrival", beacon, beaconId);
+void SendEvents::startBackoff(uint32_t now) {
+    backingOff = true;
+    backoffStart = now;
 }
 
-void SendEvents::sendBeaconDeparture(const BeaconInfo& beacon, const String& beaconId) {
-    sendBeaconEvent("departure", beacon, beaconId);
+// Envoie un lot d'événements par le transport et classe la réponse
+bool SendEvents::postBatch(const PendingEvent* events, size_t count) {
+    uint32_t start = halMillis();
+    int httpResponseCode = transport->send(events, count);
+    postLatency.observe(halMillis() - start);
+
+    if (httpResponseCode >= 200 && httpResponseCode < 300) {
+        return true;
+    }
+
+    if (httpResponseCode <= 0) {
+        transportErrorCount++;
+    } else if (httpResponseCode >= 500) {
+        serverErrorCount++;
+    } else if (httpResponseCode >= 400) {
+        clientErrorCount++;
+    }
+
+    if (httpResponseCode > 0) {
+        LOG_WARN("Lot refusé par le serveur: %d", httpResponseCode);
+    } else {
+        LOG_WARN("Erreur envoi lot (%s): %s", transport->name(), transport->errorToString(httpResponseCode));
+    }
+    return false;
 }
 
-void SendEvents::queueEvent(const String& eventType, const BeaconInfo& beacon, const String& beaconId) {
-    // Éviter que la file d'attente devienne trop grande
-    if (eventQueue.size() >= MAX_QUEUE_SIZE) {
-        eventQueue.erase(eventQueue.begin()); // Supprimer l'événement le plus ancien
+// File pleine, la tâche réseau étant bloquée dans un envoi : la file puis
+// l'événement passent dans le spool, dans l'ordre, au lieu de perdre le
+// plus ancien. Appelée depuis la tâche de suivi ; attend au plus une
+// écriture sur la flash de la tâche réseau.
+bool SendEvents::spill(const PendingEvent& event) {
+    if (!spoolReady) {
+        return false;
     }
-    
+    PendingEvent copy = event;
+    lockSpool();
+    TraceClock clock = TraceClock::now();
+    size_t moved = spoolQueuedEvents();
+    bool spooled = spoolEvent(copy, clock);
+    unlockSpool();
+    spilledCount += moved + (spooled ? 1 : 0);
+    return spooled;
+}
+
+// Mise en file en O(1), sans attente : appelée depuis le chemin de scan
+void SendEvents::enqueue(uint8_t eventType, const BeaconInfo& beacon) {
     PendingEvent event;
     event.eventType = eventType;
-    event.beaconId = beaconId;
     event.beacon = beacon;
-    event.timestamp = millis();
-    
-    eventQueue.push_back(event);
-    
-    Serial.printf("Événement mis en file d'attente: %s (Total: %d)\n", eventType.c_str(), eventQueue.size());
-}
+    event.timestamp = halMillis();
+    event.receivedAt = beacon.lastSeen; // Dernière annonce, captée dans onResult
+    event.traceId = nextTraceId++;
+    event.epoch = 0;
 
-void SendEvents::processQueuedEvents() {
-    if (eventQueue.empty()) {
-        return;
+    if (xQueueSend(eventQueue, &event, 0) != pdTRUE && !spill(event)) {
+        // File pleine et spool indisponible : supprimer le plus ancien
+        while (xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+            PendingEvent oldest;
+            if (xQueueReceive(eventQueue, &oldest, 0) == pdTRUE) {
+                droppedCount++;
+            }
+        }
     }
-    
-    Serial.printf("Traitement de %d événements en attente...\n", eventQueue.size());
-    
-    auto it = eventQueue.begin();
-    while (it != eventQueue.end()) {
-        if (sendBeaconEvent(it->eventType, it->beacon, it->beaconId)) {
-            it = eventQueue.erase(it);
-        } else {
-            break; // Arrêter si l'envoi échoue
+    enqueuedCount++;
+    if (push) {
+        push->publish(event);
+    }
+
+    // Latence entre la réception de l'annonce et la mise en file
+    if (eventType == EVENT_ARRIVAL) {
+        uint32_t latency = event.timestamp - event.receivedAt;
+        uint32_t currentMax = latencyMax;
+        while (latency > currentMax && !latencyMax.compare_exchange_weak(currentMax, latency)) {
         }
+        latencyTotal += latency;
+        latencySamples++;
     }
-    
-    Serial.printf("Événements restants en file d'attente: %d\n", eventQueue.size());
 }
 
-void SendEvents::update() {
-    checkWiFiConnection();
+void SendEvents::sendBeaconArrival(const BeaconInfo& beacon) {
+    enqueue(EVENT_ARRIVAL, beacon);
 }
 
+void SendEvents::sendBeaconDeparture(const BeaconInfo& beacon) {
+    enqueue(EVENT_DEPARTURE, beacon);
+}
+
+// Identifiant unique basé sur l'adresse MAC WiFi
 String SendEvents::getDeviceId() {
-    // Générer un ID unique basé sur l'adresse MAC
-    String mac = WiFi.macAddress();
-    mac.replace(":", "");
-    return "ESP32_" + mac;
-}
-
-String SendEvents::getTimestamp() {
-    unsigned long currentTime = millis();
-    unsigned long seconds = currentTime / 1000;
-    unsigned long minutes = seconds / 60;
-    unsigned long hours = minutes / 60;
-    
-    seconds = seconds % 60;
-    minutes = minutes % 60;
-    hours = hours % 24;
-    
-    char timestamp[20];
-    sprintf(timestamp, "%02lu:%02lu:%02lu.%03lu", hours, minutes, seconds, currentTime % 1000);
-    return String(timestamp);
+    char id[20];
+    snprintf(id, sizeof(id), "ESP32_%02X%02X%02X%02X%02X%02X",
+             deviceMac[0], deviceMac[1], deviceMac[2], deviceMac[3], deviceMac[4], deviceMac[5]);
+    return String(id);
 }
 
 bool SendEvents::isConnected() {
     return wifiConnected;
 }
 
+// Appelée depuis d'autres tâches : le spool n'est lu qu'à travers le
+// compte publié par la tâche qui le modifie. Un événement en cours de
+// déplacement peut être compté deux fois, jamais oublié.
 int SendEvents::getQueueSize() {
-    return eventQueue.size();
+    return uxQueueMessagesWaiting(eventQueue) + batchCount + spoolPending;
 }
 
+// Depuis n'importe quelle tâche : la file, le lot en cours et le spool sont
+// vidés ensemble sous le verrou. Un lot déjà parti vers le serveur pendant
+// l'appel n'est pas rappelé, mais il n'est ni compté envoyé ni renvoyé.
 void SendEvents::clearQueue() {
-    eventQueue.clear();
-    Serial.println("File d'attente des événements vidée.");
+    lockSpool();
+    xQueueReset(eventQueue);
+    batchCount = 0;
+    if (spoolReady) {
+        eventSpool.clear();
+    }
+    unlockSpool();
+    LOG_INFO("File d'attente des événements vidée (file, lot en cours et spool).");
+}
+
+UplinkStats SendEvents::getStats() {
+    UplinkStats stats;
+    stats.enqueued = enqueuedCount;
+    stats.dropped = droppedCount;
+    stats.spilled = spilledCount;
+    stats.coalesced = coalescedCount;
+    stats.sent = sentCount;
+    stats.failedPosts = failedPostCount;
+    stats.transportErrors = transportErrorCount;
+    stats.clientErrors = clientErrorCount;
+    stats.serverErrors = serverErrorCount;
+    stats.queued = eventQueue ? uxQueueMessagesWaiting(eventQueue) : 0;
+    stats.batched = batchCount;
+    stats.latencyMaxMs = latencyMax;
+    stats.latencyTotalMs = latencyTotal;
+    stats.latencySamples = latencySamples;
+    stats.spooled = spoolPending;
+    stats.spoolOverwritten = spoolOverwritten;
+    return stats;
 }
 
 // Fonction pour envoyer un ping au serveur (optionnel)
@@ -210,13 +495,7 @@ bool SendEvents::pingServer() {
     if (!wifiConnected) {
         return false;
     }
-    
-    HTTPClient http;
-    http.begin(String(serverURL) + "/ping");
-    http.setTimeout(5000);
-    
-    int httpResponseCode = http.GET();
-    http.end();
-    
+
+    int httpResponseCode = halNetwork().get((String(serverURL) + "/ping").c_str(), 5000);
     return httpResponseCode == 200;
-}
\ No newline at end of file
+}
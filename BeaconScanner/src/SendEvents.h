@@ -3,66 +3,198 @@
 #define SEND_EVENTS_H
 
 #include <Arduino.h>
-#include <vector>
-
-// Structure étendue pour les informations d'un beacon
-struct BeaconInfo {
-    String name;
-    String uuid;
-    int rssi;
-    unsigned long lastSeen;
-    bool isPresent;
-    
-    // Nouvelles informations pour iBeacon
-    bool isIBeacon;
-    String proximityUUID;
-    uint16_t major;
-    uint16_t minor;
-    int8_t txPower;
-};
+#include <atomic>
+#include "PendingEvent.h"
+#include "EventTransport.h"
+#include "EventPush.h"
+#include "Metrics.h"
+#include "TraceClock.h"
+
+// Nombre d'événements déclenchant l'envoi immédiat du lot
+#ifndef EVENT_BATCH_SIZE
+#define EVENT_BATCH_SIZE 16
+#endif
+
+// Délai maximal (ms) avant l'envoi d'un lot incomplet
+#ifndef EVENT_FLUSH_INTERVAL
+#define EVENT_FLUSH_INTERVAL 500
+#endif
+
+// Capacité de la file entre les appelants et la tâche réseau ; une fois
+// pleine, elle déborde dans le spool (ou, sans spool, l'événement le plus
+// ancien est supprimé)
+#ifndef EVENT_QUEUE_LENGTH
+#define EVENT_QUEUE_LENGTH 64
+#endif
+
+// Attente entre deux tentatives (ms) : doublée à chaque échec, bornée
+#ifndef UPLINK_RETRY_MIN
+#define UPLINK_RETRY_MIN 500
+#endif
+#ifndef UPLINK_RETRY_MAX
+#define UPLINK_RETRY_MAX 30000
+#endif
+
+// Transport par défaut : lots HTTP vers le contrôleur (HttpTransport.h,
+// voir aussi UPLINK_BINARY), publication directe au courtier MQTT
+// (MqttTransport.h) ou POST CoAP au serveur CoAP (CoapTransport.h)
+#define UPLINK_TRANSPORT_HTTP 0
+#define UPLINK_TRANSPORT_MQTT 1
+#define UPLINK_TRANSPORT_COAP 2
+#ifndef UPLINK_TRANSPORT
+#define UPLINK_TRANSPORT UPLINK_TRANSPORT_HTTP
+#endif
+
+// Serveur SNTP : heure réelle des événements (voir TraceClock.h)
+#ifndef UPLINK_NTP_SERVER
+#define UPLINK_NTP_SERVER "pool.ntp.org"
+#endif
 
-// Structure pour les événements en attente
-struct PendingEvent {
-    String eventType;
-    String beaconId;
-    BeaconInfo beacon;
-    unsigned long timestamp;
+// Regroupement par beacon dans le lot en cours : un événement remplace celui
+// du même beacon encore en attente, ou l'annule s'il est de sens contraire
+#ifndef UPLINK_COALESCE
+#define UPLINK_COALESCE 1
+#endif
+
+// 0 : pas de tâche réseau, l'appelant exécute service() lui-même. Sur
+// l'hôte, la tâche n'est créée qu'avec --threads (voir sim/Arduino.h)
+#ifndef UPLINK_TASK
+#define UPLINK_TASK 1
+#endif
+
+#ifndef UPLINK_TASK_STACK
+#define UPLINK_TASK_STACK 8192
+#endif
+#ifndef UPLINK_TASK_PRIORITY
+#define UPLINK_TASK_PRIORITY 1
+#endif
+
+// Compteurs du pipeline d'envoi (lecture sans verrou)
+struct UplinkStats {
+    uint32_t enqueued;          // Événements acceptés
+    uint32_t dropped;           // Événements perdus (file pleine, sans spool)
+    uint32_t spilled;           // Événements versés dans le spool par la tâche de suivi, file pleine
+    uint32_t coalesced;         // Événements remplacés ou annulés dans le lot
+    uint32_t sent;              // Événements acquittés par le contrôleur
+    uint32_t failedPosts;       // POST en échec (réseau ou HTTP)
+    uint32_t transportErrors;   // POST sans réponse HTTP (connexion, délai)
+    uint32_t clientErrors;      // Réponses 4xx
+    uint32_t serverErrors;      // Réponses 5xx
+    uint32_t queued;            // Événements dans la file en RAM
+    uint32_t batched;           // Événements du lot en cours d'envoi
+    uint32_t latencyMaxMs;      // Latence max annonce -> mise en file (arrivées)
+    uint32_t latencyTotalMs;    // Somme des latences, pour la moyenne
+    uint32_t latencySamples;
+    uint32_t spooled;           // Événements en attente sur la flash
+    uint32_t spoolOverwritten;  // Événements écrasés (spool plein)
 };
 
 class SendEvents {
 private:
-    // Variables pour la gestion WiFi
-    bool wifiConnected;
-    unsigned long lastWifiCheck;
-    
-    // File d'attente pour les événements
-    std::vector<PendingEvent> eventQueue;
-    
-    // Méthodes privées
-    void connectToWiFi();
-    void checkWiFiConnection();
-    bool sendBeaconEvent(const String& eventType, const BeaconInfo& beacon, const String& beaconId);
-    void queueEvent(const String& eventType, const BeaconInfo& beacon, const String& beaconId);
-    void processQueuedEvents();
+    // Variables pour la gestion WiFi (écrites par la tâche réseau)
+    std::atomic<bool> wifiConnected;
+    bool connecting;
+    uint32_t connectStart;
+    bool backingOff;
+    uint32_t backoffStart;
+    uint32_t retryDelay;
+    bool clockStarted;
+
+    // File d'attente entre les appelants et la tâche réseau
+    QueueHandle_t eventQueue;
+    TaskHandle_t uplinkTaskHandle;
+
+    // Lot en cours d'envoi (propriété de la tâche réseau ; clearQueue() le
+    // vide sous le verrou du spool)
+    PendingEvent outboundBatch[EVENT_BATCH_SIZE];
+    std::atomic<size_t> batchCount;
+    uint32_t batchStart;
+
+    // Protège le spool et la lecture de la file (voir lockSpool())
+    SemaphoreHandle_t spoolLock;
+
+    // État du spool publié à chaque libération du verrou, lu sans verrou
+    // par les autres tâches (getQueueSize(), getStats())
+    std::atomic<uint32_t> spoolPending;
+    std::atomic<uint32_t> spoolOverwritten;
+
+    String deviceId;
+    uint8_t deviceMac[6];
+
+    // Destination des lots (propriété de la tâche réseau)
+    EventTransport* transport;
+
+    // Diffusion en direct aux abonnés de /ws, nullptr sans serveur web
+    EventPush* push;
+
+    // Compteurs
+    std::atomic<uint32_t> enqueuedCount;
+    std::atomic<uint32_t> droppedCount;
+    std::atomic<uint32_t> spilledCount;
+    std::atomic<uint32_t> coalescedCount;
+    std::atomic<uint32_t> sentCount;
+    std::atomic<uint32_t> failedPostCount;
+    std::atomic<uint32_t> latencyMax;
+    std::atomic<uint32_t> latencyTotal;
+    std::atomic<uint32_t> latencySamples;
+    std::atomic<uint32_t> transportErrorCount;
+    std::atomic<uint32_t> clientErrorCount;
+    std::atomic<uint32_t> serverErrorCount;
+
+    // Identifiant du prochain événement, tiré au hasard au démarrage
+    std::atomic<uint32_t> nextTraceId;
+
+    // Durée des POST (ms), succès ou échec
+    MetricHistogram postLatency;
+
+    // Méthodes privées (tâche réseau)
+    static void uplinkTask(void* parameter);
+    void runUplink();
+    bool ensureWiFi(uint32_t now);
+    void startBackoff(uint32_t now);
+    void spoolBatch();
+    size_t spoolQueuedEvents();
+    bool spoolEvent(PendingEvent& event, const TraceClock& clock);
+    void flushSpool();
+    void lockSpool();
+    void unlockSpool();
+    bool spill(const PendingEvent& event);
+    bool coalesce(const PendingEvent& event);
+    bool postBatch(const PendingEvent* events, size_t count);
+    void enqueue(uint8_t eventType, const BeaconInfo& beacon);
     String getDeviceId();
-    String getTimestamp();
-    
+
 public:
     // Constructeur
     SendEvents();
-    
+
+    // Remplace le transport par défaut (UPLINK_TRANSPORT) ; avant init()
+    void setTransport(EventTransport& transport) { this->transport = &transport; }
+
+    // Diffuse aussi chaque événement mis en file (voir EventPush.h) ; avant init()
+    void setPush(EventPush& push) { this->push = &push; }
+    const EventPush* getPush() const { return push; }
+
     // Méthodes publiques
     void init();
-    void update();
-    void sendBeaconArrival(const BeaconInfo& beacon, const String& beaconId);
-    void sendBeaconDeparture(const BeaconInfo& beacon, const String& beaconId);
+    void sendBeaconArrival(const BeaconInfo& beacon);
+    void sendBeaconDeparture(const BeaconInfo& beacon);
+
+    // Une étape de la tâche réseau. Retourne le délai (ms) avant la prochaine
+    // étape utile, ou UPLINK_IDLE si la file est vide
+    uint32_t service();
+
     bool isConnected();
     int getQueueSize();
+
+    // Abandonne les événements non envoyés : file, lot en cours et spool
     void clearQueue();
     bool pingServer();
+    UplinkStats getStats();
+    const MetricHistogram& postLatencyHistogram() const { return postLatency; }
 };
 
 // Instance globale (optionnel)
 extern SendEvents eventSender;
 
-#endif
\ No newline at end of file
+#endif
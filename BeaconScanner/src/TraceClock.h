@@ -0,0 +1,44 @@
+#ifndef TRACE_CLOCK_H
+#define TRACE_CLOCK_H
+
+#include <stdint.h>
+#include "Hal.h"
+#include "PendingEvent.h"
+
+// Correspondance entre millis() et l'heure réelle, relevée une fois par
+// envoi. Les horodatages d'un événement sont pris en millis() (callback
+// BLE, mise en file) et convertis ici : un événement reçu avant la
+// synchronisation SNTP obtient quand même son heure réelle, tant qu'il
+// est envoyé depuis le même démarrage.
+struct TraceClock {
+    uint32_t millis;
+    uint64_t epoch;     // 0 : heure réelle pas encore connue
+
+    static TraceClock now() {
+        TraceClock clock;
+        clock.millis = halMillis();
+        clock.epoch = halEpochMillis();
+        return clock;
+    }
+
+    // Heure réelle d'un instant passé (millis() du même démarrage)
+    uint64_t toEpoch(uint32_t stamp) const {
+        return epoch != 0 ? epoch - (uint32_t)(millis - stamp) : 0;
+    }
+
+    // Heure réelle de la mise en file de event, 0 si inconnue
+    uint64_t enqueuedAt(const PendingEvent& event) const {
+        if (event.epoch == EVENT_EPOCH_UNKNOWN) {
+            return 0;
+        }
+        return event.epoch != 0 ? event.epoch : toEpoch(event.timestamp);
+    }
+
+    // Heure réelle de réception de l'annonce, 0 si inconnue
+    uint64_t receivedAt(const PendingEvent& event) const {
+        uint64_t enqueued = enqueuedAt(event);
+        return enqueued != 0 ? enqueued - (uint32_t)(event.timestamp - event.receivedAt) : 0;
+    }
+};
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef ARDUINO
+
+// Service de fusion multi-passerelles (environnement "fusion") : lit les
+// observations de plusieurs scanners, enregistrées ou synthétiques, et écrit
+// une ligne JSON par événement dédupliqué (voir GatewayFusion.h) :
+//
+//   {"eventType":"nearest","beaconId":"d0:5e:01:00:00:2a","deviceId":"ESP32_24DCC3A10004",
+//    "previousDeviceId":"ESP32_24DCC3A10003","rssi":-62.4,"previousRssi":-70.1,"timestamp":81234}
+//   {"eventType":"lost","beaconId":"d0:5e:01:00:00:2a","previousDeviceId":"ESP32_24DCC3A10004",
+//    "timestamp":95000}
+//
+//   pio run -e fusion
+//   .pio/build/fusion/program --replay observations.txt
+//   .pio/build/fusion/program --bench --tags 50000 --gateways 64 --duration 300
+//
+// Sur une trace synthétique, la pièce de chaque tag est connue : le résumé
+// donne la part des tags localisés dans la bonne pièce et le délai entre un
+// changement de pièce et l'événement correspondant. En mode --bench, chaque
+// observation est chronométrée et les allocations sont comptées (Bench.h).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include "GatewayFusion.h"
+#include "GatewayTrace.h"
+#include "../sim/Bench.h"
+
+// Échantillonnage de la vérité terrain (ms de trace)
+#ifndef FUSION_SAMPLE_INTERVAL
+#define FUSION_SAMPLE_INTERVAL 10000
+#endif
+
+struct FusionOptions {
+    const char* replayPath = nullptr;
+    uint32_t tags = 1000;
+    uint32_t gateways = 9;
+    uint32_t durationMs = 600000;
+    uint32_t intervalMs = 1000;
+    uint32_t movesPerHour = 6;
+    uint32_t rssiJitter = 4;
+    uint32_t fadingDb = 4;
+    uint32_t lossPercent = 10;
+    uint32_t seed = 1;
+    FusionConfig fusion = GatewayFusion::defaultConfig();
+    bool quiet = false;
+    bool bench = false;
+    bool json = false;
+};
+
+// Mesures, et vérité terrain d'une trace synthétique
+struct FusionResults {
+    LatencyHistogram observation;   // GatewayFusion::observe (ns)
+    LatencyHistogram sweep;         // Recherche des tags perdus (ns)
+    LatencyHistogram switchDelay;   // Changement de pièce -> événement (ms)
+    uint64_t allocations = 0;
+    uint64_t events = 0;
+    uint64_t wrongSwitches = 0;     // Vers une autre pièce que celle du tag
+    uint64_t samples = 0;           // Tags x instants d'échantillonnage
+    uint64_t samplesLocated = 0;
+    uint64_t samplesCorrect = 0;
+    uint64_t settledLocated = 0;    // Hors période de transition
+    uint64_t settledCorrect = 0;
+    size_t peakTags = 0;
+    size_t peakBytes = 0;
+};
+
+static FusionOptions options;
+static FusionResults results;
+static GatewayRegistry gateways;
+static SyntheticGatewaySource* synthetic = nullptr;
+
+static void printEvent(const FusionEvent& event) {
+    char beaconId[BEACON_ID_TEXT];
+    formatBeaconId(*event.tag, beaconId);
+    printf("{\"eventType\":\"%s\",\"beaconId\":\"%s\"", event.type == FUSION_NEAREST ? "nearest" : "lost", beaconId);
+    if (event.gateway != FUSION_NO_GATEWAY) {
+        printf(",\"deviceId\":\"%s\"", gateways.name(event.gateway));
+    }
+    if (event.previous != FUSION_NO_GATEWAY) {
+        printf(",\"previousDeviceId\":\"%s\"", gateways.name(event.previous));
+    }
+    if (!isnan(event.rssi)) {
+        printf(",\"rssi\":%.1f", event.rssi);
+    }
+    if (!isnan(event.previousRssi)) {
+        printf(",\"previousRssi\":%.1f", event.previousRssi);
+    }
+    printf(",\"timestamp\":%lu}\n", (unsigned long)event.at);
+}
+
+static void onFusionEvent(const FusionEvent& event) {
+    results.events++;
+    if (!options.quiet) {
+        printEvent(event);
+    }
+    if (synthetic && event.type == FUSION_NEAREST && event.previous != FUSION_NO_GATEWAY) {
+        uint32_t tag = synthetic->tagOf(event.tag->address);
+        if (event.gateway != synthetic->roomOf(tag)) {
+            results.wrongSwitches++;
+        } else if (synthetic->movedAt(tag) != 0) {
+            // Hors correction d'une première localisation erronée
+            results.switchDelay.record(event.at - synthetic->movedAt(tag));
+        }
+    }
+}
+
+// Compare la passerelle de chaque tag à sa pièce. Juste après un changement
+// de pièce (fenêtre + maintien + une fenêtre de marge), l'ancienne passerelle
+// est attendue : ces instants ne comptent pas dans la précision établie.
+static void sampleTruth(const GatewayFusion& fusion, uint32_t now) {
+    uint32_t transition = 2 * options.fusion.windowMs + options.fusion.dwellMs;
+    for (uint32_t tag = 0; tag < synthetic->tagCount(); tag++) {
+        uint8_t address[6];
+        const uint8_t* proximityUUID;
+        synthetic->keyOf(tag, address, &proximityUUID);
+        uint16_t nearest = fusion.nearestGateway(address, proximityUUID);
+        bool correct = nearest == synthetic->roomOf(tag);
+        bool settled = now - synthetic->movedAt(tag) >= transition || synthetic->movedAt(tag) == 0;
+        results.samples++;
+        if (nearest == FUSION_NO_GATEWAY) {
+            continue;
+        }
+        results.samplesLocated++;
+        results.samplesCorrect += correct;
+        if (settled) {
+            results.settledLocated++;
+            results.settledCorrect += correct;
+        }
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --replay FICHIER      rejouer des observations (<ms> <deviceId> <adresse> <rssi> <hex>), - : stdin\n"
+            "  --tags N              tags synthétiques (défaut 1000)\n"
+            "  --gateways N          passerelles synthétiques, une par pièce (défaut 9)\n"
+            "  --duration S          durée de la trace synthétique en secondes (défaut 600)\n"
+            "  --interval MS         intervalle d'annonce synthétique (défaut 1000)\n"
+            "  --moves N             changements de pièce par tag et par heure (défaut 6)\n"
+            "  --rssi-jitter DB      bruit de chaque mesure (défaut 4)\n"
+            "  --fading DB           évanouissement lent de chaque liaison (défaut 4)\n"
+            "  --loss PCT            observations perdues (défaut 10)\n"
+            "  --seed N              graine du générateur (défaut 1)\n"
+            "  --window MS           fenêtre glissante par passerelle (défaut %d)\n"
+            "  --hysteresis DB       avance pour changer de passerelle (défaut %d)\n"
+            "  --dwell MS            durée de cette avance (défaut %d)\n"
+            "  --min-samples N       mesures dans la fenêtre pour être candidate (défaut %d)\n"
+            "  --timeout MS          tag perdu sans observation (défaut %d)\n"
+            "  --quiet               pas d'événements sur la sortie standard\n"
+            "  --bench               chronométrer chaque observation (implique --quiet)\n"
+            "  --json                résultats sur une ligne JSON\n",
+            program, FUSION_WINDOW, FUSION_HYSTERESIS, FUSION_SWITCH_DWELL, FUSION_MIN_SAMPLES, FUSION_TIMEOUT);
+}
+
+static bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = true;
+
+        if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--bench") == 0) {
+            options.bench = true;
+            options.quiet = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--json") == 0) {
+            options.json = true;
+            hasValue = false;
+        } else if (!value) {
+            return false;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replayPath = value;
+        } else if (strcmp(arg, "--tags") == 0) {
+            options.tags = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--gateways") == 0) {
+            options.gateways = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--duration") == 0) {
+            options.durationMs = strtoul(value, nullptr, 10) * 1000;
+        } else if (strcmp(arg, "--interval") == 0) {
+            options.intervalMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--moves") == 0) {
+            options.movesPerHour = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--rssi-jitter") == 0) {
+            options.rssiJitter = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--fading") == 0) {
+            options.fadingDb = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--loss") == 0) {
+            options.lossPercent = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--window") == 0) {
+            options.fusion.windowMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--hysteresis") == 0) {
+            options.fusion.hysteresisDb = strtof(value, nullptr);
+        } else if (strcmp(arg, "--dwell") == 0) {
+            options.fusion.dwellMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--min-samples") == 0) {
+            options.fusion.minSamples = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--timeout") == 0) {
+            options.fusion.timeoutMs = strtoul(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        if (hasValue) {
+            i++;
+        }
+    }
+    return options.intervalMs > 0 && options.lossPercent <= 100 && options.gateways > 0 &&
+           options.gateways < FUSION_NO_GATEWAY && options.tags <= 0xFFFFFF && options.fusion.windowMs > 0;
+}
+
+static void printSummary(const GatewayFusion& fusion, uint32_t traceMs, double wallSeconds, FILE* out) {
+    fprintf(out, "Trace      : %.1f s en %.3f s (x%.0f), %lu passerelles\n", traceMs / 1000.0, wallSeconds,
+            wallSeconds > 0 ? traceMs / 1000.0 / wallSeconds : 0.0, (unsigned long)gateways.size());
+    fprintf(out, "Fusion     : %lu observations, %lu illisibles, %lu ignorées (hors des %d passerelles les plus "
+            "fortes), %lu tags suivis (max %lu)\n",
+            (unsigned long)fusion.observationCount(), (unsigned long)fusion.parseFailureCount(),
+            (unsigned long)fusion.droppedCount(), FUSION_GATEWAYS_PER_TAG, (unsigned long)fusion.size(), (unsigned long)results.peakTags);
+    fprintf(out, "Événements : %lu (%lu localisations, %lu changements, %lu pertes), %.1f observations par événement\n",
+            (unsigned long)results.events, (unsigned long)fusion.locatedCount(), (unsigned long)fusion.switchCount(),
+            (unsigned long)fusion.lostCount(),
+            results.events ? (double)fusion.observationCount() / results.events : 0.0);
+    if (synthetic) {
+        fprintf(out, "Vérité     : %lu changements de pièce, %lu changements erronés, délai %.1f s en moyenne "
+                "(p95 %.1f s), tags localisés %.1f %%, bonne pièce %.2f %% (%.2f %% hors transition)\n",
+                (unsigned long)synthetic->moveCount(), (unsigned long)results.wrongSwitches,
+                results.switchDelay.mean() / 1000.0, results.switchDelay.percentile(0.95) / 1000.0,
+                results.samples ? 100.0 * results.samplesLocated / results.samples : 0.0,
+                results.samplesLocated ? 100.0 * results.samplesCorrect / results.samplesLocated : 0.0,
+                results.settledLocated ? 100.0 * results.settledCorrect / results.settledLocated : 0.0);
+    }
+    fprintf(out, "Mémoire    : %.1f Mo, %.0f octets par tag\n", results.peakBytes / 1e6,
+            results.peakTags ? (double)results.peakBytes / results.peakTags : 0.0);
+    if (options.bench) {
+        const LatencyHistogram& h = results.observation;
+        fprintf(out, "Observation: p50 %llu ns, p99 %llu ns, max %llu ns, %.2f M/s, %.3f allocations\n",
+                (unsigned long long)h.percentile(0.5), (unsigned long long)h.percentile(0.99),
+                (unsigned long long)h.max(), h.mean() > 0 ? 1e3 / h.mean() : 0.0,
+                h.count() ? (double)results.allocations / h.count() : 0.0);
+        fprintf(out, "Balayage   : %lu, p50 %.1f µs, max %.1f µs\n", (unsigned long)results.sweep.count(),
+                results.sweep.percentile(0.5) / 1e3, results.sweep.max() / 1e3);
+    }
+}
+
+static void printJson(const GatewayFusion& fusion, uint32_t traceMs, double wallSeconds) {
+    printf("{\"config\":{");
+    if (options.replayPath) {
+        printf("\"replay\":\"%s\",", options.replayPath);
+    } else {
+        printf("\"tags\":%lu,\"gateways\":%lu,\"duration_s\":%lu,\"interval_ms\":%lu,\"moves_per_hour\":%lu,"
+               "\"rssi_jitter_db\":%lu,\"fading_db\":%lu,\"loss_percent\":%lu,\"seed\":%lu,",
+               (unsigned long)options.tags, (unsigned long)options.gateways,
+               (unsigned long)(options.durationMs / 1000), (unsigned long)options.intervalMs,
+               (unsigned long)options.movesPerHour, (unsigned long)options.rssiJitter,
+               (unsigned long)options.fadingDb, (unsigned long)options.lossPercent, (unsigned long)options.seed);
+    }
+    printf("\"window_ms\":%lu,\"hysteresis_db\":%.1f,\"dwell_ms\":%lu,\"min_samples\":%lu,\"timeout_ms\":%lu},",
+           (unsigned long)options.fusion.windowMs, options.fusion.hysteresisDb, (unsigned long)options.fusion.dwellMs,
+           (unsigned long)options.fusion.minSamples, (unsigned long)options.fusion.timeoutMs);
+
+    printf("\"trace_seconds\":%.3f,\"wall_seconds\":%.3f,\"gateways_seen\":%lu,", traceMs / 1000.0, wallSeconds,
+           (unsigned long)gateways.size());
+    printf("\"observations\":%lu,\"parse_failures\":%lu,\"observations_dropped\":%lu,\"tags\":%lu,\"tags_peak\":%lu,",
+           (unsigned long)fusion.observationCount(), (unsigned long)fusion.parseFailureCount(),
+           (unsigned long)fusion.droppedCount(), (unsigned long)fusion.size(), (unsigned long)results.peakTags);
+    printf("\"events\":%llu,\"located\":%lu,\"switches\":%lu,\"lost\":%lu,",
+           (unsigned long long)results.events, (unsigned long)fusion.locatedCount(),
+           (unsigned long)fusion.switchCount(), (unsigned long)fusion.lostCount());
+    if (synthetic) {
+        printf("\"moves\":%lu,\"wrong_switches\":%llu,\"switch_delay_mean_ms\":%.0f,\"switch_delay_p95_ms\":%llu,"
+               "\"located_ratio\":%.4f,\"accuracy\":%.4f,\"settled_accuracy\":%.4f,",
+               (unsigned long)synthetic->moveCount(), (unsigned long long)results.wrongSwitches,
+               results.switchDelay.mean(), (unsigned long long)results.switchDelay.percentile(0.95),
+               results.samples ? (double)results.samplesLocated / results.samples : 0.0,
+               results.samplesLocated ? (double)results.samplesCorrect / results.samplesLocated : 0.0,
+               results.settledLocated ? (double)results.settledCorrect / results.settledLocated : 0.0);
+    }
+    printf("\"memory_bytes\":%lu,\"bytes_per_tag\":%.0f", (unsigned long)results.peakBytes,
+           results.peakTags ? (double)results.peakBytes / results.peakTags : 0.0);
+    if (options.bench) {
+        const LatencyHistogram& h = results.observation;
+        printf(",\"observe_p50_ns\":%llu,\"observe_p99_ns\":%llu,\"observe_max_ns\":%llu,\"observe_mean_ns\":%.1f,"
+               "\"allocations_per_observation\":%.4f,\"sweep_p50_us\":%.1f,\"sweep_max_us\":%.1f",
+               (unsigned long long)h.percentile(0.5), (unsigned long long)h.percentile(0.99),
+               (unsigned long long)h.max(), h.mean(), h.count() ? (double)results.allocations / h.count() : 0.0,
+               results.sweep.percentile(0.5) / 1e3, results.sweep.max() / 1e3);
+    }
+    printf("}\n");
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::unique_ptr<ObservationSource> source;
+    if (options.replayPath) {
+        ReplayObservationSource* replay = new ReplayObservationSource(gateways);
+        source.reset(replay);
+        if (!replay->open(options.replayPath)) {
+            fprintf(stderr, "Impossible d'ouvrir %s\n", options.replayPath);
+            return 1;
+        }
+    } else {
+        TraceConfig config = {options.tags, options.gateways, options.durationMs, options.intervalMs,
+                              options.movesPerHour, options.rssiJitter, options.fadingDb, options.lossPercent,
+                              options.seed};
+        synthetic = new SyntheticGatewaySource(config);
+        source.reset(synthetic);
+        // Numéros des passerelles synthétiques = numéros des pièces
+        for (uint32_t i = 0; i < options.gateways; i++) {
+            char name[24];
+            SyntheticGatewaySource::gatewayName(i, name, sizeof(name));
+            gateways.intern(name);
+        }
+    }
+
+    GatewayFusion fusion(options.fusion, synthetic ? options.tags : 1024);
+    fusion.setListener(onFusionEvent);
+
+    uint64_t wallStart = benchNanos();
+    uint32_t now = 0;
+    uint32_t nextSample = FUSION_SAMPLE_INTERVAL;
+    uint32_t nextSweep = 0;
+    GatewayObservation observation;
+    while (source->next(observation)) {
+        now = observation.record.timestamp;
+        while (synthetic && now >= nextSample) {
+            sampleTruth(fusion, nextSample);
+            nextSample += FUSION_SAMPLE_INTERVAL;
+        }
+
+        if (options.bench) {
+            // Balayage des tags perdus à son échéance, puis l'observation seule
+            if (now >= nextSweep) {
+                uint64_t start = benchNanos();
+                fusion.advance(now);
+                results.sweep.record(benchNanos() - start);
+                nextSweep = now + FUSION_SWEEP_INTERVAL;
+            }
+            uint64_t allocations = allocStats().allocations;
+            uint64_t start = benchNanos();
+            fusion.observe(observation.gateway, observation.record);
+            results.observation.record(benchNanos() - start);
+            results.allocations += allocStats().allocations - allocations;
+        } else {
+            fusion.observe(observation.gateway, observation.record);
+        }
+
+        if (fusion.size() > results.peakTags) {
+            results.peakTags = fusion.size();
+        }
+        if (fusion.memoryBytes() > results.peakBytes) {
+            results.peakBytes = fusion.memoryBytes();
+        }
+    }
+
+    // Fin du flux : les derniers tags sont perdus
+    uint32_t end = (synthetic && options.durationMs > now ? options.durationMs : now) + options.fusion.timeoutMs +
+                   FUSION_SWEEP_INTERVAL + 1;
+    fusion.advance(end);
+    fflush(stdout);
+
+    double wallSeconds = (benchNanos() - wallStart) / 1e9;
+    if (options.json) {
+        printJson(fusion, now, wallSeconds);
+    } else {
+        printSummary(fusion, now, wallSeconds, options.quiet ? stdout : stderr);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,381 @@
+#ifndef ARDUINO
+
+#include "GatewayFusion.h"
+#include <math.h>
+#include <string.h>
+#include "../AdvParser.h"
+#include "../BeaconTable.h"
+
+static_assert(FUSION_WINDOW_SLOTS > 0 && FUSION_WINDOW >= FUSION_WINDOW_SLOTS, "FUSION_WINDOW trop court");
+
+GatewayFusion::GatewayFusion(const FusionConfig& config, size_t expectedTags)
+    : config(config), count(0), nextSweep(0), listener(nullptr), observations(0), parseFailures(0), dropped(0),
+      located(0), switches(0), lost(0) {
+    slotMs = config.windowMs / FUSION_WINDOW_SLOTS;
+    if (slotMs == 0) {
+        slotMs = 1;
+    }
+    size_t size = 1024;
+    while (size < 2 * expectedTags) {
+        size *= 2;
+    }
+    index.assign(size, NONE);
+    tags.reserve(expectedTags);
+}
+
+FusionConfig GatewayFusion::defaultConfig() {
+    return {FUSION_WINDOW, FUSION_HYSTERESIS, FUSION_SWITCH_DWELL, FUSION_MIN_SAMPLES, FUSION_TIMEOUT};
+}
+
+size_t GatewayFusion::memoryBytes() const {
+    return tags.capacity() * sizeof(Tag) + index.capacity() * sizeof(uint32_t) +
+           freeTags.capacity() * sizeof(uint32_t);
+}
+
+// ---------------------------------------------------------------------------
+// Table des tags (sondage linéaire, comme BeaconTable)
+
+// Retourne la case contenant la clé, ou la première case vide rencontrée
+size_t GatewayFusion::findSlot(uint32_t hash, const uint8_t* address, const uint8_t* proximityUUID) const {
+    size_t mask = index.size() - 1;
+    size_t slot = hash & mask;
+    while (index[slot] != NONE) {
+        const Tag& tag = tags[index[slot]];
+        if (tag.hash == hash && BeaconTable::keyEquals(tag.info, address, proximityUUID)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Suppression par décalage arrière, sans pierre tombale
+void GatewayFusion::removeSlot(size_t slot) {
+    size_t mask = index.size() - 1;
+    size_t hole = slot;
+    size_t next = slot;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (index[next] == NONE) {
+            break;
+        }
+        size_t home = tags[index[next]].hash & mask;
+        bool between = (hole <= next) ? (hole < home && home <= next)
+                                      : (hole < home || home <= next);
+        if (!between) {
+            index[hole] = index[next];
+            hole = next;
+        }
+    }
+    index[hole] = NONE;
+}
+
+void GatewayFusion::grow() {
+    std::vector<uint32_t> larger(index.size() * 2, NONE);
+    size_t mask = larger.size() - 1;
+    for (uint32_t id : index) {
+        if (id == NONE) {
+            continue;
+        }
+        size_t slot = tags[id].hash & mask;
+        while (larger[slot] != NONE) {
+            slot = (slot + 1) & mask;
+        }
+        larger[slot] = id;
+    }
+    index.swap(larger);
+}
+
+GatewayFusion::Tag& GatewayFusion::findOrInsert(const uint8_t* address, const uint8_t* proximityUUID, uint32_t firstSeen,
+                                                bool& isNew) {
+    uint32_t hash = BeaconTable::hashKey(address, proximityUUID);
+    size_t slot = findSlot(hash, address, proximityUUID);
+    if (index[slot] != NONE) {
+        isNew = false;
+        return tags[index[slot]];
+    }
+
+    // Table à moitié pleine : doubler l'index avant d'insérer
+    if (2 * (count + 1) > index.size()) {
+        grow();
+        slot = findSlot(hash, address, proximityUUID);
+    }
+
+    uint32_t id;
+    if (!freeTags.empty()) {
+        id = freeTags.back();
+        freeTags.pop_back();
+    } else {
+        id = (uint32_t)tags.size();
+        tags.emplace_back();
+    }
+    index[slot] = id;
+    count++;
+
+    Tag& tag = tags[id];
+    memset(&tag.info, 0, sizeof(tag.info));
+    memcpy(tag.info.address, address, sizeof(tag.info.address));
+    tag.info.isIBeacon = proximityUUID != nullptr;
+    if (proximityUUID) {
+        memcpy(tag.info.proximityUUID, proximityUUID, sizeof(tag.info.proximityUUID));
+    }
+    memcpy(tag.info.name, "Inconnu", sizeof("Inconnu"));
+    memcpy(tag.info.uuid, "N/A", sizeof("N/A"));
+    tag.hash = hash;
+    tag.nearest = FUSION_NO_GATEWAY;
+    tag.challenger = FUSION_NO_GATEWAY;
+    tag.challengeSince = firstSeen;
+    tag.used = true;
+    for (size_t i = 0; i < FUSION_GATEWAYS_PER_TAG; i++) {
+        tag.windows[i].gateway = FUSION_NO_GATEWAY;
+    }
+    isNew = true;
+    return tag;
+}
+
+void GatewayFusion::remove(uint32_t id) {
+    Tag& tag = tags[id];
+    const uint8_t* proximityUUID = tag.info.isIBeacon ? tag.info.proximityUUID : nullptr;
+    removeSlot(findSlot(tag.hash, tag.info.address, proximityUUID));
+    tag.used = false;
+    freeTags.push_back(id);
+    count--;
+}
+
+// ---------------------------------------------------------------------------
+// Fenêtres glissantes
+
+// Intervalles [now - fenêtre, now] : les plus anciens sont ignorés, ceux
+// qui suivent newest sont vides
+GatewayFusion::WindowStats GatewayFusion::windowStats(const GatewayWindow& window, uint32_t now) const {
+    uint32_t current = now / slotMs;
+    uint32_t samples = 0;
+    int32_t sum = 0;
+    for (uint32_t k = 0; k < FUSION_WINDOW_SLOTS && k <= window.newest; k++) {
+        uint32_t slot = window.newest - k;
+        if (current - slot >= FUSION_WINDOW_SLOTS && current >= slot) {
+            break;
+        }
+        samples += window.count[slot % FUSION_WINDOW_SLOTS];
+        sum += window.sum[slot % FUSION_WINDOW_SLOTS];
+    }
+    return {samples, samples ? (float)sum / samples : NAN};
+}
+
+void GatewayFusion::addSample(GatewayWindow& window, int8_t rssi, uint32_t now) {
+    uint32_t slot = now / slotMs;
+    if (slot > window.newest) {
+        // Intervalles écoulés depuis la dernière mesure : remis à zéro
+        uint32_t elapsed = slot - window.newest;
+        for (uint32_t k = 1; k <= elapsed && k <= FUSION_WINDOW_SLOTS; k++) {
+            uint32_t position = (window.newest + k) % FUSION_WINDOW_SLOTS;
+            window.count[position] = 0;
+            window.sum[position] = 0;
+        }
+        window.newest = slot;
+    } else if (window.newest - slot >= FUSION_WINDOW_SLOTS) {
+        return;  // Plus ancienne que la fenêtre
+    }
+    uint32_t position = slot % FUSION_WINDOW_SLOTS;
+    if (window.count[position] == UINT8_MAX) {
+        return;  // La moyenne de l'intervalle est déjà bien établie
+    }
+    window.count[position]++;
+    window.sum[position] += rssi;
+    if ((int32_t)(now - window.lastSeen) > 0) {
+        window.lastSeen = now;
+    }
+}
+
+// Fenêtre de la passerelle pour ce tag. Toutes occupées : la plus ancienne
+// hors fenêtre, sinon la plus faible (jamais la passerelle courante), si la
+// mesure la dépasse ; nullptr sinon.
+GatewayFusion::GatewayWindow* GatewayFusion::windowFor(Tag& tag, uint16_t gateway, int8_t rssi, uint32_t now) {
+    GatewayWindow* free = nullptr;
+    GatewayWindow* stale = nullptr;
+    GatewayWindow* weakest = nullptr;
+    float weakestMean = 0;
+    for (size_t i = 0; i < FUSION_GATEWAYS_PER_TAG; i++) {
+        GatewayWindow& window = tag.windows[i];
+        if (window.gateway == gateway) {
+            return &window;
+        }
+        if (window.gateway == FUSION_NO_GATEWAY) {
+            if (!free) {
+                free = &window;
+            }
+            continue;
+        }
+        if (window.gateway == tag.nearest) {
+            continue;
+        }
+        WindowStats stats = windowStats(window, now);
+        if (stats.count == 0) {
+            if (!stale || (int32_t)(window.lastSeen - stale->lastSeen) < 0) {
+                stale = &window;
+            }
+        } else if (!weakest || stats.mean < weakestMean) {
+            weakest = &window;
+            weakestMean = stats.mean;
+        }
+    }
+
+    GatewayWindow* window = free ? free : stale ? stale : (weakest && rssi > weakestMean) ? weakest : nullptr;
+    if (window) {
+        if (window->gateway == tag.challenger) {
+            tag.challenger = FUSION_NO_GATEWAY;
+        }
+        window->gateway = gateway;
+        memset(window->count, 0, sizeof(window->count));
+        memset(window->sum, 0, sizeof(window->sum));
+        window->newest = now / slotMs;
+        window->lastSeen = now;
+    }
+    return window;
+}
+
+// ---------------------------------------------------------------------------
+// Décision
+
+void GatewayFusion::decide(Tag& tag, uint32_t now) {
+    const GatewayWindow* best = nullptr;
+    float bestMean = 0;
+    float currentMean = NAN;
+    for (size_t i = 0; i < FUSION_GATEWAYS_PER_TAG; i++) {
+        const GatewayWindow& window = tag.windows[i];
+        if (window.gateway == FUSION_NO_GATEWAY) {
+            continue;
+        }
+        WindowStats stats = windowStats(window, now);
+        if (window.gateway == tag.nearest) {
+            currentMean = stats.mean;
+        }
+        if (stats.count >= config.minSamples && (!best || stats.mean > bestMean)) {
+            best = &window;
+            bestMean = stats.mean;
+        }
+    }
+
+    if (!best) {
+        return;
+    }
+    if (tag.nearest == FUSION_NO_GATEWAY) {
+        // Première localisation après FUSION_SWITCH_DWELL ms d'écoute : la
+        // première passerelle à répondre n'est pas forcément la plus proche
+        if (now - tag.challengeSince < config.dwellMs) {
+            return;
+        }
+        tag.nearest = best->gateway;
+        tag.info.isPresent = true;
+        located++;
+        emit(FUSION_NEAREST, tag, best->gateway, FUSION_NO_GATEWAY, bestMean, NAN, now);
+        return;
+    }
+
+    // La passerelle courante, si elle n'entend plus le tag, est dépassée
+    bool ahead = best->gateway != tag.nearest &&
+                 (isnan(currentMean) || bestMean - currentMean >= config.hysteresisDb);
+    if (!ahead) {
+        tag.challenger = FUSION_NO_GATEWAY;
+        return;
+    }
+    if (tag.challenger != best->gateway) {
+        tag.challenger = best->gateway;
+        tag.challengeSince = now;
+    }
+    if (now - tag.challengeSince < config.dwellMs) {
+        return;
+    }
+    uint16_t previous = tag.nearest;
+    tag.nearest = best->gateway;
+    tag.challenger = FUSION_NO_GATEWAY;
+    switches++;
+    emit(FUSION_NEAREST, tag, best->gateway, previous, bestMean, currentMean, now);
+}
+
+void GatewayFusion::emit(FusionEventType type, const Tag& tag, uint16_t gateway, uint16_t previous, float rssi,
+                         float previousRssi, uint32_t now) {
+    if (listener) {
+        listener({type, &tag.info, gateway, previous, rssi, previousRssi, now});
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Observations
+
+void GatewayFusion::observe(uint16_t gateway, const AdvRecord& record) {
+    advance(record.timestamp);
+    observations++;
+
+    ParsedAdvertisement adv;
+    if (!parseAdvertisement(record.payload, record.payloadLength, adv)) {
+        parseFailures++;
+        return;
+    }
+
+    // Même clé que la table des beacons du firmware
+    const uint8_t* proximityUUID = adv.frameType == FRAME_IBEACON ? adv.beaconUUID : nullptr;
+    bool isNew;
+    Tag& tag = findOrInsert(record.address, proximityUUID, record.timestamp, isNew);
+    BeaconInfo& info = tag.info;
+
+    GatewayWindow* window = windowFor(tag, gateway, record.rssi, record.timestamp);
+    if (!window) {
+        dropped++;
+        return;
+    }
+    addSample(*window, record.rssi, record.timestamp);
+    if (isNew || (int32_t)(record.timestamp - info.lastSeen) > 0) {
+        info.lastSeen = record.timestamp;
+    }
+    info.rssi = record.rssi;
+
+    if (adv.name) {
+        uint8_t length = adv.nameLength > BEACON_NAME_MAX ? BEACON_NAME_MAX : adv.nameLength;
+        memcpy(info.name, adv.name, length);
+        info.name[length] = '\0';
+    }
+    if (adv.hasServiceUUID && isNew) {
+        formatUUID(adv.serviceUUID, info.uuid);
+    }
+    if (adv.frameType != FRAME_NONE && adv.frameType != FRAME_EDDYSTONE_TLM) {
+        info.frameType = adv.frameType;
+        info.txPower = adv.txPower;
+        if (adv.frameType != FRAME_EDDYSTONE_URL) {
+            memcpy(info.proximityUUID, adv.beaconUUID, sizeof(info.proximityUUID));
+            info.major = adv.major;
+            info.minor = adv.minor;
+        }
+    }
+
+    decide(tag, record.timestamp);
+}
+
+void GatewayFusion::advance(uint32_t now) {
+    if ((int32_t)(now - nextSweep) < 0) {
+        return;
+    }
+    nextSweep = now + FUSION_SWEEP_INTERVAL;
+
+    // Parcours complet, une fois par FUSION_SWEEP_INTERVAL : quelques
+    // microsecondes pour mille tags
+    for (uint32_t id = 0; id < tags.size(); id++) {
+        Tag& tag = tags[id];
+        if (!tag.used || now - tag.info.lastSeen <= config.timeoutMs) {
+            continue;
+        }
+        if (tag.nearest != FUSION_NO_GATEWAY) {
+            lost++;
+            tag.info.isPresent = false;
+            emit(FUSION_LOST, tag, FUSION_NO_GATEWAY, tag.nearest, NAN, NAN, now);
+        }
+        remove(id);
+    }
+}
+
+uint16_t GatewayFusion::nearestGateway(const uint8_t* address, const uint8_t* proximityUUID) const {
+    size_t slot = findSlot(BeaconTable::hashKey(address, proximityUUID), address, proximityUUID);
+    return index[slot] != NONE ? tags[index[slot]].nearest : FUSION_NO_GATEWAY;
+}
+
+#endif
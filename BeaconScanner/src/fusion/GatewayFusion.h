@@ -0,0 +1,184 @@
+#ifndef GATEWAY_FUSION_H
+#define GATEWAY_FUSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "../AdvRecord.h"
+#include "../BeaconInfo.h"
+
+// Fenêtre glissante du RSSI de chaque passerelle (ms), découpée en
+// FUSION_WINDOW_SLOTS intervalles
+#ifndef FUSION_WINDOW
+#define FUSION_WINDOW 4000
+#endif
+#ifndef FUSION_WINDOW_SLOTS
+#define FUSION_WINDOW_SLOTS 4
+#endif
+
+// Passerelles suivies en même temps pour un tag
+#ifndef FUSION_GATEWAYS_PER_TAG
+#define FUSION_GATEWAYS_PER_TAG 4
+#endif
+
+// Changement de passerelle : avance du RSSI moyen (dB), tenue pendant
+// FUSION_SWITCH_DWELL ms
+#ifndef FUSION_HYSTERESIS
+#define FUSION_HYSTERESIS 6
+#endif
+#ifndef FUSION_SWITCH_DWELL
+#define FUSION_SWITCH_DWELL 3000
+#endif
+
+// Mesures dans la fenêtre pour qu'une passerelle soit candidate
+#ifndef FUSION_MIN_SAMPLES
+#define FUSION_MIN_SAMPLES 2
+#endif
+
+// Tag perdu s'il n'est plus entendu par aucune passerelle (ms)
+#ifndef FUSION_TIMEOUT
+#define FUSION_TIMEOUT 15000
+#endif
+
+// Période de la recherche des tags perdus (ms)
+#ifndef FUSION_SWEEP_INTERVAL
+#define FUSION_SWEEP_INTERVAL 1000
+#endif
+
+#define FUSION_NO_GATEWAY 0xFFFF
+
+// Réglages d'une instance (valeurs par défaut : macros ci-dessus)
+struct FusionConfig {
+    uint32_t windowMs;
+    float hysteresisDb;
+    uint32_t dwellMs;
+    uint32_t minSamples;
+    uint32_t timeoutMs;
+};
+
+enum FusionEventType : uint8_t {
+    FUSION_NEAREST,     // Première localisation ou changement de passerelle
+    FUSION_LOST         // Plus entendu depuis FUSION_TIMEOUT
+};
+
+// Événement dédupliqué : un seul pour toutes les passerelles. tag n'est
+// valable que pendant l'appel de l'écouteur.
+struct FusionEvent {
+    FusionEventType type;
+    const BeaconInfo* tag;
+    uint16_t gateway;     // Passerelle la plus proche (FUSION_NO_GATEWAY si perdu)
+    uint16_t previous;    // Passerelle précédente, ou FUSION_NO_GATEWAY
+    float rssi;           // RSSI moyen de gateway sur la fenêtre
+    float previousRssi;   // RSSI moyen de previous, NAN s'il ne l'entend plus
+    uint32_t at;
+};
+
+typedef void (*FusionListener)(const FusionEvent& event);
+
+// Fusion des observations de plusieurs passerelles (un ESP32 par pièce) :
+// chacune rapporte le RSSI de chaque annonce reçue, avec son deviceId.
+// Pour chaque tag (même clé que BeaconTable : adresse, plus l'UUID de
+// proximité pour un iBeacon), la fusion tient une fenêtre glissante du RSSI
+// par passerelle et n'émet qu'un événement "le tag X est au plus près de la
+// passerelle Y" :
+//   - à la première localisation, FUSION_SWITCH_DWELL ms après la première
+//     observation, pour la passerelle la plus forte parmi celles qui ont
+//     FUSION_MIN_SAMPLES mesures dans la fenêtre ;
+//   - puis seulement quand une autre passerelle dépasse la passerelle
+//     courante d'au moins FUSION_HYSTERESIS dB, en moyenne sur la fenêtre,
+//     pendant FUSION_SWITCH_DWELL ms. Un tag à mi-chemin entre deux pièces
+//     ne fait donc pas alterner les événements ;
+//   - FUSION_LOST quand plus aucune passerelle ne l'entend.
+//
+// Chaque fenêtre est un anneau de FUSION_WINDOW_SLOTS sommes partielles :
+// une observation coûte O(FUSION_GATEWAYS_PER_TAG), sans allocation une
+// fois la table dimensionnée. Les tags sont rangés dans une table à
+// adressage ouvert qui double quand elle est à moitié pleine.
+// Les horodatages sont ceux de la fusion (ou de l'enregistrement), non
+// décroissants à la fenêtre près : les observations plus anciennes que la
+// fenêtre sont ignorées.
+class GatewayFusion {
+private:
+    static const uint32_t NONE = UINT32_MAX;
+
+    struct GatewayWindow {
+        uint16_t gateway;                   // FUSION_NO_GATEWAY : libre
+        uint8_t count[FUSION_WINDOW_SLOTS];
+        int16_t sum[FUSION_WINDOW_SLOTS];   // Sommes des RSSI (dBm)
+        uint32_t newest;                    // Numéro de l'intervalle le plus récent
+        uint32_t lastSeen;
+    };
+
+    struct Tag {
+        BeaconInfo info;        // Clé, trame, nom, lastSeen, isPresent (localisé)
+        uint32_t hash;
+        uint32_t challengeSince;  // Ou première observation, avant la localisation
+        uint16_t nearest;
+        uint16_t challenger;    // Passerelle en avance sur nearest
+        bool used;
+        GatewayWindow windows[FUSION_GATEWAYS_PER_TAG];
+    };
+
+    struct WindowStats {
+        uint32_t count;
+        float mean;
+    };
+
+    FusionConfig config;
+    uint32_t slotMs;
+    std::vector<Tag> tags;
+    std::vector<uint32_t> index;     // Cases de hachage -> numéro de tag
+    std::vector<uint32_t> freeTags;
+    size_t count;
+    uint32_t nextSweep;
+    FusionListener listener;
+
+    uint32_t observations;
+    uint32_t parseFailures;
+    uint32_t dropped;
+    uint32_t located;
+    uint32_t switches;
+    uint32_t lost;
+
+    size_t findSlot(uint32_t hash, const uint8_t* address, const uint8_t* proximityUUID) const;
+    void removeSlot(size_t slot);
+    void grow();
+    Tag& findOrInsert(const uint8_t* address, const uint8_t* proximityUUID, uint32_t firstSeen, bool& isNew);
+    void remove(uint32_t id);
+
+    WindowStats windowStats(const GatewayWindow& window, uint32_t now) const;
+    GatewayWindow* windowFor(Tag& tag, uint16_t gateway, int8_t rssi, uint32_t now);
+    void addSample(GatewayWindow& window, int8_t rssi, uint32_t now);
+    void decide(Tag& tag, uint32_t now);
+    void emit(FusionEventType type, const Tag& tag, uint16_t gateway, uint16_t previous, float rssi,
+              float previousRssi, uint32_t now);
+
+public:
+    explicit GatewayFusion(const FusionConfig& config, size_t expectedTags = 1024);
+
+    static FusionConfig defaultConfig();
+
+    void setListener(FusionListener fn) { listener = fn; }
+
+    // Intègre l'annonce reçue par une passerelle (record.timestamp : instant
+    // de l'observation). Les tags perdus sont signalés au passage.
+    void observe(uint16_t gateway, const AdvRecord& record);
+
+    // Fait avancer le temps sans observation (fin d'un flux, inactivité)
+    void advance(uint32_t now);
+
+    // Passerelle courante d'un tag, FUSION_NO_GATEWAY s'il n'est pas localisé
+    uint16_t nearestGateway(const uint8_t* address, const uint8_t* proximityUUID) const;
+
+    size_t size() const { return count; }
+    size_t memoryBytes() const;
+
+    uint32_t observationCount() const { return observations; }
+    uint32_t parseFailureCount() const { return parseFailures; }
+    uint32_t droppedCount() const { return dropped; }       // Plus faibles que les fenêtres du tag
+    uint32_t locatedCount() const { return located; }
+    uint32_t switchCount() const { return switches; }
+    uint32_t lostCount() const { return lost; }
+};
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef ARDUINO
+
+#include "GatewayTrace.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// GatewayRegistry
+
+uint16_t GatewayRegistry::intern(const char* deviceId) {
+    auto found = ids.find(deviceId);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    uint16_t gateway = (uint16_t)names.size();
+    names.emplace_back(deviceId);
+    ids.emplace(deviceId, gateway);
+    return gateway;
+}
+
+const char* GatewayRegistry::name(uint16_t gateway) const {
+    return gateway < names.size() ? names[gateway].c_str() : "?";
+}
+
+// ---------------------------------------------------------------------------
+// ReplayObservationSource
+
+ReplayObservationSource::ReplayObservationSource(GatewayRegistry& gateways)
+    : file(nullptr), lineNumber(0), gateways(gateways) {}
+
+ReplayObservationSource::~ReplayObservationSource() {
+    if (file && file != stdin) {
+        fclose(file);
+    }
+}
+
+bool ReplayObservationSource::open(const char* path) {
+    file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    return file != nullptr;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ReplayObservationSource::next(GatewayObservation& observation) {
+    char line[320];
+    AdvRecord& record = observation.record;
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        unsigned long timestamp;
+        char deviceId[64];
+        unsigned int address[6];
+        int rssi;
+        char payload[2 * ADV_MAX_PAYLOAD + 2];
+        if (sscanf(line, "%lu %63s %x:%x:%x:%x:%x:%x %d %126s", &timestamp, deviceId, &address[0], &address[1],
+                   &address[2], &address[3], &address[4], &address[5], &rssi, payload) != 10) {
+            fprintf(stderr, "Ligne %lu ignorée : format invalide\n", (unsigned long)lineNumber);
+            continue;
+        }
+
+        size_t length = strlen(payload) / 2;
+        bool valid = length <= ADV_MAX_PAYLOAD;
+        for (size_t i = 0; valid && i < length; i++) {
+            int high = hexValue(payload[2 * i]);
+            int low = hexValue(payload[2 * i + 1]);
+            valid = high >= 0 && low >= 0;
+            record.payload[i] = (uint8_t)((high << 4) | low);
+        }
+        if (!valid) {
+            fprintf(stderr, "Ligne %lu ignorée : charge utile invalide\n", (unsigned long)lineNumber);
+            continue;
+        }
+
+        observation.gateway = gateways.intern(deviceId);
+        for (int i = 0; i < 6; i++) {
+            record.address[i] = (uint8_t)address[i];
+        }
+        record.rssi = (int8_t)rssi;
+        record.timestamp = (uint32_t)timestamp;
+        record.payloadLength = (uint8_t)length;
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// SyntheticGatewaySource
+
+SyntheticGatewaySource::SyntheticGatewaySource(const TraceConfig& config)
+    : emitters(config.tags), pendingNext(0), config(config), randomState(config.seed ? config.seed : 1), moves(0) {
+    columns = 1;
+    while (columns * columns < config.gateways) {
+        columns++;
+    }
+    rows = (config.gateways + columns - 1) / columns;
+
+    for (uint32_t i = 0; i < config.tags; i++) {
+        Emitter& emitter = emitters[i];
+        buildPayload(emitter, i);
+        place(emitter, (uint16_t)randomRange(0, config.gateways));
+        for (int k = 0; k < NEIGHBOURS; k++) {
+            emitter.fading[k] = config.fadingDb * randomGaussian();
+        }
+        emitter.lastAt = 0;
+        emitter.nextAt = randomRange(0, config.intervalMs);
+        emitter.moveAt = stayDuration();
+        emitter.movedAt = 0;
+        heap.push_back(i);
+    }
+    for (size_t pos = heap.size() / 2; pos-- > 0;) {
+        siftDown(pos);
+    }
+    pending.reserve(NEIGHBOURS);
+}
+
+void SyntheticGatewaySource::gatewayName(uint32_t gateway, char* out, size_t size) {
+    snprintf(out, size, "ESP32_24DCC3A1%04X", (unsigned)gateway);
+}
+
+// xorshift32
+uint32_t SyntheticGatewaySource::random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+uint32_t SyntheticGatewaySource::randomRange(uint32_t low, uint32_t high) {
+    return high > low ? low + random() % (high - low) : low;
+}
+
+// Loi normale centrée réduite, approchée par une somme de quatre uniformes
+float SyntheticGatewaySource::randomGaussian() {
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        sum += random() / 4294967296.0f;
+    }
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+void SyntheticGatewaySource::buildPayload(Emitter& emitter, uint32_t index) {
+    uint8_t* p = emitter.payload;
+    size_t n = 0;
+
+    // Flags : LE General Discoverable, BR/EDR non supporté
+    p[n++] = 0x02; p[n++] = 0x01; p[n++] = 0x06;
+
+    if (index % 2 == 0) {
+        // iBeacon : trois UUID de proximité partagés, numéro en major/minor
+        static const uint8_t header[] = {0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15};
+        memcpy(p + n, header, sizeof(header));
+        n += sizeof(header);
+        for (int i = 0; i < 16; i++) {
+            p[n++] = (uint8_t)(0xE2 + 16 * (index % 3) + i);
+        }
+        p[n++] = (uint8_t)(index >> 24); p[n++] = (uint8_t)(index >> 16);   // major
+        p[n++] = (uint8_t)(index >> 8); p[n++] = (uint8_t)index;            // minor
+        p[n++] = (uint8_t)TRACE_TX_POWER;
+    } else {
+        // Eddystone-UID, numéro dans l'instance
+        static const uint8_t header[] = {0x03, 0x03, 0xAA, 0xFE, 0x17, 0x16, 0xAA, 0xFE, 0x00, 0xEE};
+        memcpy(p + n, header, sizeof(header));
+        n += sizeof(header);
+        for (int i = 0; i < 10; i++) {
+            p[n++] = (uint8_t)(0x8B + i);                          // namespace
+        }
+        for (int i = 0; i < 6; i++) {
+            p[n++] = (uint8_t)(i < 2 ? 0 : index >> (8 * (5 - i)));  // instance
+        }
+        p[n++] = 0x00; p[n++] = 0x00;
+    }
+    emitter.payloadLength = (uint8_t)n;
+}
+
+// Point au hasard dans la pièce, à 0,5 m des murs
+void SyntheticGatewaySource::place(Emitter& emitter, uint16_t room) {
+    emitter.room = room;
+    float span = TRACE_ROOM_SIZE - 1.0f;
+    emitter.x = (room % columns) * TRACE_ROOM_SIZE + 0.5f + span * (random() / 4294967296.0f);
+    emitter.y = (room / columns) * TRACE_ROOM_SIZE + 0.5f + span * (random() / 4294967296.0f);
+}
+
+// Séjour dans une pièce : moyenne 3600 / moves s, à ± 50 % ; sans
+// déplacement, les tags restent dans leur pièce
+uint32_t SyntheticGatewaySource::stayDuration() {
+    if (config.movesPerHour == 0 || config.gateways < 2) {
+        return UINT32_MAX;
+    }
+    uint32_t mean = 3600000 / config.movesPerHour;
+    return randomRange(mean / 2, mean + mean / 2 + 1);
+}
+
+// Observations d'une annonce par les passerelles de la pièce et des voisines
+void SyntheticGatewaySource::emit(uint32_t index) {
+    Emitter& emitter = emitters[index];
+    uint32_t now = emitter.nextAt;
+    float decay = config.fadingDb > 0 ? expf(-(float)(now - emitter.lastAt) / TRACE_FADING_TAU) : 0.0f;
+    float innovation = sqrtf(1.0f - decay * decay) * config.fadingDb;
+    emitter.lastAt = now;
+
+    pending.clear();
+    pendingNext = 0;
+    int column = emitter.room % columns;
+    int row = emitter.room / columns;
+    for (int k = 0; k < NEIGHBOURS; k++) {
+        int gatewayColumn = column + k % 3 - 1;
+        int gatewayRow = row + k / 3 - 1;
+        uint32_t gateway = gatewayRow * columns + gatewayColumn;
+        if (gatewayColumn < 0 || gatewayColumn >= (int)columns || gatewayRow < 0 || gatewayRow >= (int)rows ||
+            gateway >= config.gateways) {
+            continue;
+        }
+        if (config.fadingDb > 0) {
+            emitter.fading[k] = decay * emitter.fading[k] + innovation * randomGaussian();
+        }
+        if (randomRange(0, 100) < config.lossPercent) {
+            continue;
+        }
+
+        float dx = emitter.x - (gatewayColumn + 0.5f) * TRACE_ROOM_SIZE;
+        float dy = emitter.y - (gatewayRow + 0.5f) * TRACE_ROOM_SIZE;
+        float distance = sqrtf(dx * dx + dy * dy);
+        if (distance < 1.0f) {
+            distance = 1.0f;
+        }
+        int walls = abs(gatewayColumn - column) + abs(gatewayRow - row);
+        int spread = (int)config.rssiJitter;
+        int noise = (int)randomRange(0, spread + 1) - (int)randomRange(0, spread + 1);
+        int rssi = (int)lroundf(TRACE_TX_POWER - 10.0f * TRACE_PATH_LOSS * log10f(distance) -
+                                walls * TRACE_WALL_LOSS + emitter.fading[k]) + noise;
+        if (rssi < TRACE_SENSITIVITY) {
+            continue;
+        }
+
+        pending.emplace_back();
+        GatewayObservation& observation = pending.back();
+        observation.gateway = (uint16_t)gateway;
+        AdvRecord& record = observation.record;
+        keyOf(index, record.address, nullptr);
+        record.rssi = (int8_t)(rssi > -30 ? -30 : rssi);
+        record.timestamp = now;
+        record.payloadLength = emitter.payloadLength;
+        memcpy(record.payload, emitter.payload, emitter.payloadLength);
+    }
+}
+
+void SyntheticGatewaySource::siftDown(size_t pos) {
+    size_t size = heap.size();
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < size && emitters[heap[left]].nextAt < emitters[heap[smallest]].nextAt) smallest = left;
+        if (right < size && emitters[heap[right]].nextAt < emitters[heap[smallest]].nextAt) smallest = right;
+        if (smallest == pos) {
+            return;
+        }
+        uint32_t swap = heap[pos];
+        heap[pos] = heap[smallest];
+        heap[smallest] = swap;
+        pos = smallest;
+    }
+}
+
+bool SyntheticGatewaySource::next(GatewayObservation& observation) {
+    while (pendingNext >= pending.size()) {
+        if (heap.empty()) {
+            return false;
+        }
+        uint32_t index = heap[0];
+        Emitter& emitter = emitters[index];
+        if (emitter.nextAt >= config.durationMs) {
+            return false;
+        }
+
+        // Passage dans une pièce voisine (quatre directions)
+        if (emitter.nextAt >= emitter.moveAt) {
+            int column = emitter.room % columns;
+            int row = emitter.room / columns;
+            for (;;) {
+                uint32_t direction = randomRange(0, 4);
+                int toColumn = column + (direction == 0) - (direction == 1);
+                int toRow = row + (direction == 2) - (direction == 3);
+                uint32_t room = toRow * columns + toColumn;
+                if (toColumn >= 0 && toColumn < (int)columns && toRow >= 0 && room < config.gateways) {
+                    place(emitter, (uint16_t)room);
+                    break;
+                }
+            }
+            uint32_t stay = stayDuration();
+            emitter.moveAt = stay > UINT32_MAX - emitter.nextAt ? UINT32_MAX : emitter.nextAt + stay;
+            emitter.movedAt = emitter.nextAt;
+            moves++;
+        }
+
+        emit(index);
+        uint32_t jitter = config.intervalMs / 10;
+        emitter.nextAt += randomRange(config.intervalMs - jitter, config.intervalMs + jitter + 1);
+        siftDown(0);
+    }
+    observation = pending[pendingNext++];
+    return true;
+}
+
+void SyntheticGatewaySource::keyOf(uint32_t tag, uint8_t address[6], const uint8_t** proximityUUID) const {
+    address[0] = 0xD0;
+    address[1] = 0x5E;
+    address[2] = (uint8_t)config.seed;
+    address[3] = (uint8_t)(tag >> 16);
+    address[4] = (uint8_t)(tag >> 8);
+    address[5] = (uint8_t)tag;
+    if (proximityUUID) {
+        // iBeacon : l'UUID suit les drapeaux et l'en-tête Apple
+        *proximityUUID = tag % 2 == 0 ? emitters[tag].payload + 9 : nullptr;
+    }
+}
+
+uint32_t SyntheticGatewaySource::tagOf(const uint8_t address[6]) const {
+    return ((uint32_t)address[3] << 16) | ((uint32_t)address[4] << 8) | address[5];
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef GATEWAY_TRACE_H
+#define GATEWAY_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../AdvRecord.h"
+
+// Passerelles connues : deviceId (getDeviceId() de chaque ESP32) <-> numéro
+class GatewayRegistry {
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint16_t> ids;
+
+public:
+    // Numéro de la passerelle, attribué à la première rencontre
+    uint16_t intern(const char* deviceId);
+    const char* name(uint16_t gateway) const;
+    size_t size() const { return names.size(); }
+};
+
+// Annonce reçue par une passerelle
+struct GatewayObservation {
+    uint16_t gateway;
+    AdvRecord record;   // record.timestamp : instant de l'observation (ms)
+};
+
+// Flux d'observations de toutes les passerelles, dans l'ordre chronologique
+class ObservationSource {
+public:
+    virtual ~ObservationSource() {}
+    virtual bool next(GatewayObservation& observation) = 0;
+};
+
+// Enregistrement texte, une observation par ligne : le format de
+// l'enregistrement du simulateur précédé du deviceId de la passerelle
+//   <ms> <deviceId> <aa:bb:cc:dd:ee:ff> <rssi> <charge utile en hexadécimal>
+// Les lignes vides ou commençant par '#' sont ignorées. "-" lit l'entrée
+// standard.
+class ReplayObservationSource : public ObservationSource {
+private:
+    FILE* file;
+    uint32_t lineNumber;
+    GatewayRegistry& gateways;
+
+public:
+    explicit ReplayObservationSource(GatewayRegistry& gateways);
+    ~ReplayObservationSource();
+    bool open(const char* path);
+    bool next(GatewayObservation& observation) override;
+};
+
+// Géométrie et propagation de la trace synthétique
+#ifndef TRACE_ROOM_SIZE
+#define TRACE_ROOM_SIZE 6.0f      // Côté d'une pièce (m), passerelle au centre
+#endif
+#ifndef TRACE_TX_POWER
+#define TRACE_TX_POWER -59        // RSSI à 1 m (dBm)
+#endif
+#ifndef TRACE_PATH_LOSS
+#define TRACE_PATH_LOSS 2.2f      // Exposant d'affaiblissement en intérieur
+#endif
+#ifndef TRACE_WALL_LOSS
+#define TRACE_WALL_LOSS 6.0f      // Par mur traversé (dB)
+#endif
+#ifndef TRACE_SENSITIVITY
+#define TRACE_SENSITIVITY -97     // dBm
+#endif
+#ifndef TRACE_FADING_TAU
+#define TRACE_FADING_TAU 10000    // ms
+#endif
+
+// Paramètres d'une trace synthétique
+struct TraceConfig {
+    uint32_t tags;
+    uint32_t gateways;       // Une par pièce, sur une grille carrée
+    uint32_t durationMs;
+    uint32_t intervalMs;     // Intervalle d'annonce (± 10 %)
+    uint32_t movesPerHour;   // Changements de pièce par tag et par heure
+    uint32_t rssiJitter;     // Bruit (dB) de chaque mesure
+    uint32_t fadingDb;       // Évanouissement lent de chaque liaison (dB)
+    uint32_t lossPercent;    // Observations perdues (%)
+    uint32_t seed;
+};
+
+// Trace multi-passerelles synthétique : des pièces carrées sur une grille,
+// une passerelle au centre de chacune. Chaque tag se tient à un point de sa
+// pièce et passe de temps en temps dans une pièce voisine. Chaque annonce
+// est entendue par les passerelles de la pièce et des huit voisines, avec
+// un RSSI selon la distance, les murs traversés, un évanouissement lent par
+// liaison et du bruit ; sous TRACE_SENSITIVITY, elle est perdue. La pièce
+// du tag est la vérité terrain. Adresses : d0:5e:<graine>:<numéro sur 24
+// bits> ; iBeacon (tags pairs) et Eddystone-UID (impairs).
+// Déterministe pour une configuration donnée.
+class SyntheticGatewaySource : public ObservationSource {
+private:
+    static const int NEIGHBOURS = 9;
+
+    struct Emitter {
+        uint8_t payload[ADV_MAX_PAYLOAD];
+        uint8_t payloadLength;
+        uint16_t room;
+        float x, y;                  // Position dans la grille (m)
+        float fading[NEIGHBOURS];    // Par liaison, pièces voisines
+        uint32_t lastAt;
+        uint32_t nextAt;
+        uint32_t moveAt;
+        uint32_t movedAt;            // Dernier changement de pièce
+    };
+
+    std::vector<Emitter> emitters;
+    std::vector<uint32_t> heap;      // Indices, tas minimal sur nextAt
+    std::vector<GatewayObservation> pending;
+    size_t pendingNext;
+    TraceConfig config;
+    uint32_t columns;
+    uint32_t rows;
+    uint32_t randomState;
+    uint32_t moves;
+
+    uint32_t random();
+    uint32_t randomRange(uint32_t low, uint32_t high);
+    float randomGaussian();
+    void buildPayload(Emitter& emitter, uint32_t index);
+    void place(Emitter& emitter, uint16_t room);
+    uint32_t stayDuration();
+    void emit(uint32_t index);
+    void siftDown(size_t pos);
+
+public:
+    explicit SyntheticGatewaySource(const TraceConfig& config);
+    bool next(GatewayObservation& observation) override;
+
+    // Vérité terrain
+    uint32_t tagCount() const { return (uint32_t)emitters.size(); }
+    uint16_t roomOf(uint32_t tag) const { return emitters[tag].room; }
+    uint32_t movedAt(uint32_t tag) const { return emitters[tag].movedAt; }
+    uint32_t moveCount() const { return moves; }
+    // Clé du tag (adresse, UUID de proximité ou nullptr) comme la fusion
+    void keyOf(uint32_t tag, uint8_t address[6], const uint8_t** proximityUUID) const;
+    // Numéro du tag d'après son adresse
+    uint32_t tagOf(const uint8_t address[6]) const;
+
+    // Noms des passerelles, dans l'ordre des numéros
+    static void gatewayName(uint32_t gateway, char* out, size_t size);
+};
+
+#endif
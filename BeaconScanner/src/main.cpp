@@ -1,235 +1,349 @@
 #include <WiFi.h>
-#include <WebServer.h>
 #include <Arduino.h>
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEScan.h>
-#include <BLEAdvertisedDevice.h>
-#include <BLEBeacon.h>
-#include <map>
-#include <string>
+#include <esp_http_server.h>
+#include <unistd.h>
+#include "Hal.h"
 #include "SendEvents.h"
+#include "BeaconTracker.h"
+#include "BeaconStream.h"
+#include "EventPush.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "ScanScheduler.h"
 
 // LED Configuration
 #define LED_PIN 18
-WebServer webServer(80);
+
+// Serveur web ESP-IDF (esp_http_server) : une tâche à lui sur NETWORK_CORE,
+// réveillée par les sockets (select). Les connexions restent ouvertes
+// entre deux requêtes (keep-alive) ; quand elles sont toutes prises, la
+// moins récemment utilisée est recyclée
+#ifndef WEB_SERVER_STACK
+#define WEB_SERVER_STACK 6144
+#endif
+#ifndef WEB_SERVER_SOCKETS
+#define WEB_SERVER_SOCKETS 7     // Connexions simultanées, abonnés /ws compris
+#endif
+httpd_handle_t webServer = NULL;
+
+// Instance de la classe pour l'envoi d'événements
+SendEvents eventSender;
+
+// Suivi de présence des beacons (voir BeaconTracker.h)
+BeaconTracker tracker(eventSender);
+
+// Partage de la radio entre scan BLE et WiFi (voir ScanScheduler.h)
+ScanScheduler scanScheduler;
+
+// Arrivées et départs poussés aux abonnés de /ws (voir EventPush.h)
+EventPush eventPush;
+
+// Réponses fixes, en-têtes CORS compris, construites une fois dans setup()
+// et envoyées telles quelles
+struct StaticResponse {
+  char data[320];
+  size_t length;
+};
+
+static StaticResponse rootResponse;
+static StaticResponse ledOnResponse;
+static StaticResponse ledOffResponse;
+static StaticResponse optionsResponse;
+
+#define CORS_HEADERS                                     \
+  "Access-Control-Allow-Origin: *\r\n"                   \
+  "Access-Control-Allow-Methods: POST, GET, OPTIONS\r\n"  \
+  "Access-Control-Allow-Headers: Content-Type\r\n"
+
+static void buildResponse(StaticResponse& response, const char* status, const char* body) {
+  const char* type = body[0] != '\0' ? "Content-Type: application/json\r\n" : "";
+  response.length = snprintf(response.data, sizeof(response.data),
+                             "HTTP/1.1 %s\r\n" CORS_HEADERS "%sContent-Length: %u\r\n\r\n%s",
+                             status, type, (unsigned)strlen(body), body);
+}
+
+static esp_err_t sendStatic(httpd_req_t* req, const StaticResponse& response) {
+  int sent = httpd_send(req, response.data, response.length);
+  return sent == (int)response.length ? ESP_OK : ESP_FAIL;
+}
+
+// En-têtes CORS des réponses construites à la demande
+static void setCorsHeaders(httpd_req_t* req) {
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+}
+
+static esp_err_t sendText(httpd_req_t* req, const char* status, const char* type, const char* body) {
+  setCorsHeaders(req);
+  httpd_resp_set_status(req, status);
+  httpd_resp_set_type(req, type);
+  return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
 
 // LED Control Functions
-void handleLedOn() {
-  Serial.println("LED ON request received");
+esp_err_t handleLedOn(httpd_req_t* req) {
   digitalWrite(LED_PIN, HIGH);
-  
-  // Add CORS headers
-  webServer.sendHeader("Access-Control-Allow-Origin", "*");
-  webServer.sendHeader("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
-  webServer.sendHeader("Access-Control-Allow-Headers", "Content-Type");
-  
-  webServer.send(200, "application/json", "{\"success\":true,\"state\":\"on\",\"message\":\"LED turned on\"}");
-  Serial.println("LED turned ON - Response sent");
+  LOG_INFO("LED allumée");
+  return sendStatic(req, ledOnResponse);
 }
 
-void handleLedOff() {
-  Serial.println("LED OFF request received");
+esp_err_t handleLedOff(httpd_req_t* req) {
   digitalWrite(LED_PIN, LOW);
-  
-  // Add CORS headers
-  webServer.sendHeader("Access-Control-Allow-Origin", "*");
-  webServer.sendHeader("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
-  webServer.sendHeader("Access-Control-Allow-Headers", "Content-Type");
-  
-  webServer.send(200, "application/json", "{\"success\":true,\"state\":\"off\",\"message\":\"LED turned off\"}");
-  Serial.println("LED turned OFF - Response sent");
+  LOG_INFO("LED éteinte");
+  return sendStatic(req, ledOffResponse);
 }
 
-// Handle OPTIONS requests for CORS
-void handleOptions() {
-  webServer.sendHeader("Access-Control-Allow-Origin", "*");
-  webServer.sendHeader("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
-  webServer.sendHeader("Access-Control-Allow-Headers", "Content-Type");
-  webServer.send(200);
+// Handle OPTIONS requests for CORS (toutes les routes)
+esp_err_t handleOptions(httpd_req_t* req) {
+  return sendStatic(req, optionsResponse);
 }
 
 // Test endpoint to check if server is working
-void handleRoot() {
-  webServer.sendHeader("Access-Control-Allow-Origin", "*");
-  webServer.send(200, "application/json", "{\"status\":\"ESP32 server running\",\"led_pin\":" + String(LED_PIN) + "}");
+esp_err_t handleRoot(httpd_req_t* req) {
+  return sendStatic(req, rootResponse);
 }
 
-// Handle 404 errors
-void handleNotFound() {
-  String message = "File Not Found\n\n";
-  message += "URI: ";
-  message += webServer.uri();
-  message += "\nMethod: ";
-  message += (webServer.method() == HTTP_GET) ? "GET" : "POST";
-  message += "\nArguments: ";
-  message += webServer.args();
-  message += "\n";
-  for (uint8_t i = 0; i < webServer.args(); i++) {
-    message += " " + webServer.argName(i) + ": " + webServer.arg(i) + "\n";
+// Compteurs d'exécution pour Prometheus (voir Metrics.h)
+esp_err_t handleMetrics(httpd_req_t* req) {
+  String body;
+  writeMetrics(body, tracker, eventSender, scanScheduler);
+  httpd_resp_set_type(req, METRICS_CONTENT_TYPE);
+  return httpd_resp_send(req, body.c_str(), body.length());
+}
+
+// Règles de filtrage des annonces (voir AdvFilter.h), conservées en NVS.
+// Les gestionnaires s'exécutent tous dans la tâche du serveur web : un seul
+// tampon suffit.
+static char filterText[ADV_FILTER_TEXT_MAX];
+
+esp_err_t handleFilterGet(httpd_req_t* req) {
+  if (!halSettingsLoad("filter", filterText, sizeof(filterText))) {
+    filterText[0] = '\0';
   }
-  webServer.send(404, "text/plain", message);
+  return sendText(req, HTTPD_200, "text/plain", filterText);
 }
 
-// Macro pour conversion endian si pas définie
-#ifndef ENDIAN_CHANGE_U16
-#define ENDIAN_CHANGE_U16(x) ((((x)&0xFF00)>>8) + (((x)&0xFF)<<8))
-#endif
+esp_err_t handleFilterSet(httpd_req_t* req) {
+  if (req->content_len >= ADV_FILTER_TEXT_MAX) {
+    return sendText(req, "413 Payload Too Large", "text/plain", "Règles trop longues");
+  }
+  size_t length = 0;
+  while (length < req->content_len) {
+    int received = httpd_req_recv(req, filterText + length, req->content_len - length);
+    if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+      continue;
+    }
+    if (received <= 0) {
+      return ESP_FAIL;  // Connexion fermée par le serveur
+    }
+    length += received;
+  }
+  filterText[length] = '\0';
 
-// Map pour stocker les beacons détectés
-std::map<String, BeaconInfo> knownBeacons;
+  char error[96];
+  if (!tracker.setFilter(filterText, error, sizeof(error))) {
+    return sendText(req, HTTPD_400, "text/plain", error);
+  }
+  if (!halSettingsSave("filter", filterText)) {
+    return sendText(req, HTTPD_500, "text/plain", "Règles appliquées mais non enregistrées");
+  }
+  LOG_INFO("Filtre des annonces mis à jour (%d octets)", (int)length);
+  return sendText(req, HTTPD_200, "application/json", "{\"success\":true}");
+}
 
-// Timeout pour considérer qu'un beacon est parti (en millisecondes)
-const unsigned long BEACON_TIMEOUT = 10000; // 10 secondes
+// Table de présence, ou ses modifications depuis ?since=<seq> (voir
+// BeaconStream.h), en réponse chunked. L'en-tête part avec le premier
+// morceau : sans réponse de la tâche de suivi, 503.
+static httpd_req_t* beaconsRequest;
 
-// Instance de la classe pour l'envoi d'événements
-SendEvents eventSender;
+void sendBeaconsChunk(const char* data, size_t length) {
+  httpd_resp_send_chunk(beaconsRequest, data, length);
+}
 
-// Fonction pour obtenir l'horodatage formaté
-String getTimestamp() {
-  unsigned long currentTime = millis();
-  unsigned long seconds = currentTime / 1000;
-  unsigned long minutes = seconds / 60;
-  unsigned long hours = minutes / 60;
-  
-  seconds = seconds % 60;
-  minutes = minutes % 60;
-  hours = hours % 24;
-  
-  char timestamp[20];
-  sprintf(timestamp, "%02lu:%02lu:%02lu.%03lu", hours, minutes, seconds, currentTime % 1000);
-  return String(timestamp);
+esp_err_t handleBeacons(httpd_req_t* req) {
+  char query[48];
+  char value[16];
+  uint32_t since = 0;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+    since = strtoul(value, nullptr, 10);
+  }
+  setCorsHeaders(req);
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  httpd_resp_set_type(req, "application/json");
+  beaconsRequest = req;
+  if (streamBeacons(tracker, since, sendBeaconsChunk) < 0) {
+    return sendText(req, "503 Service Unavailable", "text/plain", "Suivi occupé, réessayer");
+  }
+  return httpd_resp_send_chunk(req, NULL, 0);  // Dernier morceau
 }
 
-// Fonction pour générer un ID unique pour chaque beacon
-String generateBeaconId(BLEAdvertisedDevice advertisedDevice) {
-  String id = advertisedDevice.getAddress().toString().c_str();
-  
-  // Si c'est un iBeacon, ajouter l'UUID pour plus de précision
-  if (advertisedDevice.haveManufacturerData()) {
-    std::string strManufacturerData = advertisedDevice.getManufacturerData();
-    uint8_t cManufacturerData[100];
-    memcpy(cManufacturerData, strManufacturerData.c_str(), strManufacturerData.length());
-    
-    if (strManufacturerData.length() == 25 && cManufacturerData[0] == 0x4C && cManufacturerData[1] == 0x00) {
-      BLEBeacon oBeacon = BLEBeacon();
-      oBeacon.setData(strManufacturerData);
-      id += "_" + String(oBeacon.getProximityUUID().toString().c_str());
+// Handle 404 errors
+esp_err_t handleNotFound(httpd_req_t* req, httpd_err_code_t) {
+  char message[160];
+  snprintf(message, sizeof(message), "File Not Found\n\nURI: %s\nMethod: %s\n", req->uri,
+           http_method_str((enum http_method)req->method));
+  return sendText(req, "404 Not Found", "text/plain", message);
+}
+
+// Routes enregistrées, pour l'en-tête Allow des réponses 405
+struct RouteEntry {
+  const char* uri;
+  httpd_method_t method;
+};
+static RouteEntry routes[12];
+static size_t routeCount = 0;
+
+// URI connue, méthode non prise en charge : 405 avec la liste des
+// méthodes acceptées. « /* » capte toutes les URI pour OPTIONS, donc le
+// serveur répond 405 aussi pour une URI inconnue : elle reçoit un 404.
+esp_err_t handleMethodNotAllowed(httpd_req_t* req, httpd_err_code_t error) {
+  size_t pathLength = strcspn(req->uri, "?");
+  char allow[64] = "";
+  for (size_t i = 0; i < routeCount; i++) {
+    if (strlen(routes[i].uri) == pathLength && strncmp(routes[i].uri, req->uri, pathLength) == 0) {
+      strlcat(allow, http_method_str((enum http_method)routes[i].method), sizeof(allow));
+      strlcat(allow, ", ", sizeof(allow));
     }
   }
-  
-  return id;
+  if (allow[0] == '\0') {
+    return handleNotFound(req, error);
+  }
+  strlcat(allow, "OPTIONS", sizeof(allow));
+  httpd_resp_set_hdr(req, "Allow", allow);
+
+  char message[160];
+  snprintf(message, sizeof(message), "Method Not Allowed\n\nURI: %s\nMethod: %s\nAllow: %s\n", req->uri,
+           http_method_str((enum http_method)req->method), allow);
+  return sendText(req, "405 Method Not Allowed", "text/plain", message);
 }
 
-// Fonction pour afficher les détails d'un beacon (utilisée pour arrivée ET départ)
-void displayBeaconDetails(const String& eventType, const BeaconInfo& beacon, const String& beaconId) {
-  Serial.println("╔══════════════════════════════════════════════════════╗");
-  if (eventType == "arrival") {
-    Serial.println("║                    BEACON ARRIVÉE                    ║");
-  } else {
-    Serial.println("║                    BEACON DÉPART                     ║");
+#if CONFIG_HTTPD_WS_SUPPORT
+// WebSocket /ws : chaque connexion reçoit les arrivées et départs au fil
+// de l'eau. Les messages des clients sont lus et ignorés ; ping, pong et
+// fermeture sont traités par le serveur.
+esp_err_t handleWebSocket(httpd_req_t* req) {
+  int socket = httpd_req_to_sockfd(req);
+  if (req->method == HTTP_GET) {
+    // Poignée de main terminée
+    if (!eventPush.subscribe(socket)) {
+      LOG_WARN("Abonné /ws refusé, %d déjà connectés", EVENT_PUSH_SUBSCRIBERS);
+      return ESP_FAIL;  // Ferme la connexion
+    }
+    LOG_INFO("Abonné /ws connecté (%lu)", (unsigned long)eventPush.subscriberTotal());
+    return ESP_OK;
   }
-  Serial.println("╠══════════════════════════════════════════════════════╣");
-  Serial.printf("║ Horodatage: %s                             ║\n", getTimestamp().c_str());
-  Serial.printf("║ Nom: %-43s     ║\n", beacon.name.c_str());
-  Serial.printf("║ UUID: %-42s    ║\n", beacon.uuid.c_str());
-  Serial.printf("║ RSSI: %-6d                                       ║\n", beacon.rssi);
-  Serial.printf("║ ID: %-44s  ║\n", beaconId.c_str());
-  
-  // Afficher les informations spécifiques pour iBeacon
-  if (beacon.isIBeacon) {
-    Serial.println("║ Type: iBeacon                                        ║");
-    Serial.printf("║ Major: %-5d | Minor: %-5d                    ║\n", beacon.major, beacon.minor);
-    Serial.printf("║ Proximity UUID: %-32s ║\n", beacon.proximityUUID.c_str());
-    Serial.printf("║ TX Power: %-6d                            ║\n", beacon.txPower);
+
+  httpd_ws_frame_t frame = {};
+  uint8_t payload[64];
+  if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK || frame.len > sizeof(payload)) {
+    return ESP_FAIL;
   }
-  
-  Serial.println("╚══════════════════════════════════════════════════════╝");
-  Serial.println();
+  frame.payload = payload;
+  return httpd_ws_recv_frame(req, &frame, frame.len);
 }
 
-// Fonction pour vérifier les beacons qui ont disparu
-void checkForDepartedBeacons() {
-  unsigned long currentTime = millis();
-  
-  for (auto& pair : knownBeacons) {
-    String beaconId = pair.first.c_str();
-    BeaconInfo& beacon = pair.second;
-    
-    if (beacon.isPresent && (currentTime - beacon.lastSeen) > BEACON_TIMEOUT) {
-      beacon.isPresent = false;
-      
-      // Affichage console avec toutes les informations
-      displayBeaconDetails("departure", beacon, beaconId);
-      
-      // Envoyer l'événement de départ au backend
-      eventSender.sendBeaconDeparture(beacon, beaconId);
-    }
+static bool sendWebSocket(int socket, const char* data, size_t length) {
+  httpd_ws_frame_t frame = {};
+  frame.type = HTTPD_WS_TYPE_TEXT;
+  frame.final = true;
+  frame.payload = (uint8_t*)data;
+  frame.len = length;
+  return httpd_ws_send_frame_async(webServer, socket, &frame) == ESP_OK;
+}
+
+// Dans la tâche du serveur web, à la demande de la tâche de suivi
+static void pushWork(void*) {
+  eventPush.drain(sendWebSocket);
+}
+
+static void notifyWebServer() {
+  httpd_queue_work(webServer, pushWork, NULL);
+}
+#endif
+
+// Connexion fermée (client, erreur ou recyclage) : plus d'envoi vers elle
+static void onSocketClose(httpd_handle_t, int socket) {
+  eventPush.unsubscribe(socket);
+  close(socket);
+}
+
+static void registerRoute(const char* uri, httpd_method_t method, esp_err_t (*handler)(httpd_req_t*),
+                          bool webSocket = false) {
+  httpd_uri_t route = {};
+  route.uri = uri;
+  route.method = method;
+  route.handler = handler;
+#if CONFIG_HTTPD_WS_SUPPORT
+  route.is_websocket = webSocket;
+#else
+  (void)webSocket;
+#endif
+  if (httpd_register_uri_handler(webServer, &route) == ESP_OK && routeCount < sizeof(routes) / sizeof(routes[0])) {
+    routes[routeCount++] = {uri, method};
   }
 }
 
-int scanTime = 5;  //In seconds
-BLEScan *pBLEScan;
-
-class MyAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
-  void onResult(BLEAdvertisedDevice advertisedDevice) {
-    String beaconId = generateBeaconId(advertisedDevice);
-    String deviceName = advertisedDevice.haveName() ? advertisedDevice.getName().c_str() : "Inconnu";
-    String deviceUUID = advertisedDevice.haveServiceUUID() ? advertisedDevice.getServiceUUID().toString().c_str() : "N/A";
-    int rssi = advertisedDevice.getRSSI();
-    unsigned long currentTime = millis();
-    
-    // Vérifier si c'est un nouveau beacon ou un beacon connu
-    bool isNewBeacon = knownBeacons.find(beaconId.c_str()) == knownBeacons.end();
-    bool wasAbsent = false;
-    
-    if (!isNewBeacon) {
-      wasAbsent = !knownBeacons[beaconId.c_str()].isPresent;
-    }
-    
-    // Créer ou récupérer les informations du beacon
-    BeaconInfo& beacon = knownBeacons[beaconId.c_str()];
-    beacon.name = deviceName;
-    beacon.uuid = deviceUUID;
-    beacon.rssi = rssi;
-    beacon.lastSeen = currentTime;
-    beacon.isPresent = true;
-    
-    // Initialiser les informations iBeacon
-    beacon.isIBeacon = false;
-    beacon.major = 0;
-    beacon.minor = 0;
-    beacon.txPower = 0;
-    beacon.proximityUUID = "";
-    
-    // Traitement des données iBeacon si disponibles
-    if (advertisedDevice.haveManufacturerData()) {
-      std::string strManufacturerData = advertisedDevice.getManufacturerData();
-      uint8_t cManufacturerData[100];
-      memcpy(cManufacturerData, strManufacturerData.c_str(), strManufacturerData.length());
-
-      if (strManufacturerData.length() == 25 && cManufacturerData[0] == 0x4C && cManufacturerData[1] == 0x00) {
-        BLEBeacon oBeacon = BLEBeacon();
-        oBeacon.setData(strManufacturerData);
-        
-        // Stocker les informations iBeacon
-        beacon.isIBeacon = true;
-        beacon.major = ENDIAN_CHANGE_U16(oBeacon.getMajor());
-        beacon.minor = ENDIAN_CHANGE_U16(oBeacon.getMinor());
-        beacon.proximityUUID = String(oBeacon.getProximityUUID().toString().c_str());
-        beacon.txPower = oBeacon.getSignalPower();
-      }
-    }
-    
-    // Afficher événement d'arrivée pour nouveau beacon ou beacon qui revient
-    if (isNewBeacon || wasAbsent) {
-      displayBeaconDetails("arrival", beacon, beaconId);
-      
-      // Envoyer l'événement d'arrivée au backend
-      eventSender.sendBeaconArrival(beacon, beaconId);
+bool startWebServer() {
+  char body[96];
+  snprintf(body, sizeof(body), "{\"status\":\"ESP32 server running\",\"led_pin\":%d}", LED_PIN);
+  buildResponse(rootResponse, "200 OK", body);
+  buildResponse(ledOnResponse, "200 OK", "{\"success\":true,\"state\":\"on\",\"message\":\"LED turned on\"}");
+  buildResponse(ledOffResponse, "200 OK", "{\"success\":true,\"state\":\"off\",\"message\":\"LED turned off\"}");
+  buildResponse(optionsResponse, "204 No Content", "");
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.core_id = NETWORK_CORE;
+  config.stack_size = WEB_SERVER_STACK;
+  config.max_open_sockets = WEB_SERVER_SOCKETS;
+  config.max_uri_handlers = 12;
+  config.lru_purge_enable = true;
+  config.uri_match_fn = httpd_uri_match_wildcard;
+  config.close_fn = onSocketClose;
+  if (httpd_start(&webServer, &config) != ESP_OK) {
+    return false;
+  }
+
+  registerRoute("/", HTTP_GET, handleRoot);
+  registerRoute("/led/on", HTTP_POST, handleLedOn);
+  registerRoute("/led/off", HTTP_POST, handleLedOff);
+  registerRoute("/metrics", HTTP_GET, handleMetrics);
+  registerRoute("/beacons", HTTP_GET, handleBeacons);
+  registerRoute("/filter", HTTP_GET, handleFilterGet);
+  registerRoute("/filter", HTTP_POST, handleFilterSet);
+#if CONFIG_HTTPD_WS_SUPPORT
+  eventPush.setNotify(notifyWebServer);
+  registerRoute("/ws", HTTP_GET, handleWebSocket, true);
+#endif
+  registerRoute("/*", HTTP_OPTIONS, handleOptions);
+  httpd_register_err_handler(webServer, HTTPD_404_NOT_FOUND, handleNotFound);
+  httpd_register_err_handler(webServer, HTTPD_405_METHOD_NOT_ALLOWED, handleMethodNotAllowed);
+  return true;
+}
+
+int scanTime = 5;  // Période du résumé dans le journal (s)
+
+// Configuration du scan continu en tâche de fond, sur le cœur radio
+#ifndef SCAN_TASK_STACK
+#define SCAN_TASK_STACK 4096
+#endif
+#ifndef SCAN_TASK_PRIORITY
+#define SCAN_TASK_PRIORITY 1
+#endif
+
+// Tâche de scan continu : enchaîne les cycles sans bloquer loop(). Avant
+// chaque cycle, l'ordonnanceur choisit intervalle, fenêtre et mode selon
+// les annonces, les beacons présents et les événements en attente
+void scanTask(void*) {
+  for (;;) {
+    uint32_t pending = eventSender.isConnected() ? eventSender.getQueueSize() : 0;
+    ScanPlan plan = scanScheduler.plan(halMillis(), tracker.advertisementsReceived(), tracker.presentCount(), pending);
+    halRadio().configure(plan.intervalMs, plan.windowMs, plan.active);
+    tracker.setScanDeviceCount(halRadio().scan(plan.scanMs));
+    if (plan.pauseMs > 0) {
+      halDelay(plan.pauseMs);  // Radio laissée au WiFi pour l'envoi
     }
   }
-};
+}
 
 void setup() {
   // Initialize LED pin first
@@ -237,13 +351,17 @@ void setup() {
   digitalWrite(LED_PIN, LOW);
   Serial.begin(115200);
   delay(1000); // Give serial time to initialize
+
+  // Journal différé : écrit par une tâche de basse priorité (voir Log.h)
+  logBegin();
   
   Serial.println("╔══════════════════════════════════════════════════════╗");
   Serial.println("║              BEACON SCANNER DÉMARRÉ                  ║");
   Serial.println("╠══════════════════════════════════════════════════════╣");
-  Serial.printf("║ Horodatage: %s                           ║\n", getTimestamp().c_str());
+  Serial.printf("║ Horloge: SNTP %-39s║\n", UPLINK_NTP_SERVER);
   Serial.println("║ Timeout de départ: 10 secondes                      ║");
-  Serial.println("║ Intervalle de scan: 5 secondes                      ║");
+  Serial.println(SCAN_ADAPTIVE ? "║ Scan adaptatif: cycles de 1 à 2 secondes            ║"
+                                : "║ Scan continu: cycles de 5 secondes                  ║");
   Serial.printf("║ LED Pin: %d                                           ║\n", LED_PIN);
   Serial.println("╚══════════════════════════════════════════════════════╝");
   Serial.println();
@@ -257,6 +375,7 @@ void setup() {
   Serial.println("LED test completed");
 
   // Initialize WiFi and events
+  eventSender.setPush(eventPush);
   eventSender.init();
   
   // Wait for WiFi connection before starting web server
@@ -267,16 +386,10 @@ void setup() {
   }
   Serial.println("\nWiFi connected!");
 
-  // Setup web server routes
-  webServer.on("/", HTTP_GET, handleRoot);
-  webServer.on("/led/on", HTTP_POST, handleLedOn);
-  webServer.on("/led/off", HTTP_POST, handleLedOff);
-  webServer.on("/led/on", HTTP_OPTIONS, handleOptions);
-  webServer.on("/led/off", HTTP_OPTIONS, handleOptions);
-  webServer.onNotFound(handleNotFound);
-  
   // Start web server
-  webServer.begin();
+  if (!startWebServer()) {
+    Serial.println("Échec du démarrage du serveur HTTP");
+  }
   Serial.println("Serveur HTTP pour LED démarré sur le port 80");
   Serial.print("ESP32 IP Address: ");
   Serial.println(WiFi.localIP());
@@ -284,43 +397,37 @@ void setup() {
   Serial.println("  POST /led/on");
   Serial.println("  POST /led/off");
   Serial.println("  GET / (status)");
+  Serial.println("  GET /metrics (Prometheus)");
+  Serial.println("  GET /beacons[?since=seq] (table de présence)");
+  Serial.println("  GET|POST /filter (règles de filtrage)");
+#if CONFIG_HTTPD_WS_SUPPORT
+  Serial.println("  WS /ws (arrivées et départs en direct)");
+#endif
+
+  // Règles de filtrage enregistrées, avant la première annonce
+  if (halSettingsLoad("filter", filterText, sizeof(filterText))) {
+    char error[96];
+    if (!tracker.setFilter(filterText, error, sizeof(error))) {
+      Serial.printf("Filtre enregistré ignoré: %s\n", error);
+    }
+  }
 
   // Initialize BLE
   Serial.println("Initializing BLE...");
-  BLEDevice::init("");
-  pBLEScan = BLEDevice::getScan();
-  pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
-  pBLEScan->setActiveScan(true);
-  pBLEScan->setInterval(100);
-  pBLEScan->setWindow(99);
+  halRadio().begin([](const AdvRecord& record) { tracker.onAdvertisement(record); });
+  Serial.printf("Pile BLE: %s, tas libre après l'init BLE: %lu octets\n",
+                BLE_BACKEND == BLE_BACKEND_NIMBLE ? "NimBLE" : "Bluedroid", (unsigned long)ESP.getFreeHeap());
+
+  // Start continuous scan in its own task. Ingest runs on RADIO_CORE, next
+  // to the Bluetooth stack; web server, uplink and log run on NETWORK_CORE
+  xTaskCreatePinnedToCore(scanTask, "bleScan", SCAN_TASK_STACK, NULL, SCAN_TASK_PRIORITY, NULL, RADIO_CORE);
+  tracker.startTask(scanTime * 1000);
   
   Serial.println("Setup completed successfully!");
 }
 
 void loop() {
-  // Handle web server requests (this is critical!)
-  webServer.handleClient();
-  
-  // Update WiFi and event sender
-  eventSender.update();
-  
-  // Check for departed beacons
-  checkForDepartedBeacons();
-  
-  // BLE scan
-  BLEScanResults foundDevices = pBLEScan->start(scanTime, false);
-  
-  // Display scan summary
-  Serial.println("┌──────────────────────────────────────────────────────┐");
-  Serial.printf("│ Scan terminé - %s                     │\n", getTimestamp().c_str());
-  Serial.printf("│ Appareils trouvés: %-2d                              │\n", foundDevices.getCount());
-  Serial.printf("│ Beacons connus: %-2d                                 │\n", knownBeacons.size());
-  Serial.printf("│ WiFi: %-9s | File d'attente: %-2d              │\n", 
-                eventSender.isConnected() ? "Connecté" : "Déconnecté", 
-                eventSender.getQueueSize());
-  Serial.println("└──────────────────────────────────────────────────────┘");
-  Serial.println();
-  
-  pBLEScan->clearResults();
-  delay(1000); // Reduced delay to handle web requests more frequently
-}
\ No newline at end of file
+  // Plus rien à faire ici : serveur web, suivi, scan, envoi et journal ont
+  // chacun leur tâche. La pile de loop() est rendue au tas.
+  vTaskDelete(NULL);
+}
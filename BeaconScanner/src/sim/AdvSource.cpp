@@ -0,0 +1,278 @@
+#ifndef ARDUINO
+
+#include "AdvSource.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// ReplayAdvSource
+
+ReplayAdvSource::ReplayAdvSource() : file(nullptr), lineNumber(0) {}
+
+ReplayAdvSource::~ReplayAdvSource() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool ReplayAdvSource::open(const char* path) {
+    file = fopen(path, "r");
+    return file != nullptr;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ReplayAdvSource::next(AdvRecord& record) {
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        unsigned long timestamp;
+        unsigned int address[6];
+        int rssi;
+        char payload[2 * ADV_MAX_PAYLOAD + 2];
+        if (sscanf(line, "%lu %x:%x:%x:%x:%x:%x %d %126s", &timestamp, &address[0], &address[1],
+                   &address[2], &address[3], &address[4], &address[5], &rssi, payload) != 9) {
+            fprintf(stderr, "Ligne %lu ignorée : format invalide\n", (unsigned long)lineNumber);
+            continue;
+        }
+
+        size_t length = strlen(payload) / 2;
+        bool valid = length <= ADV_MAX_PAYLOAD;
+        for (size_t i = 0; valid && i < length; i++) {
+            int high = hexValue(payload[2 * i]);
+            int low = hexValue(payload[2 * i + 1]);
+            valid = high >= 0 && low >= 0;
+            record.payload[i] = (uint8_t)((high << 4) | low);
+        }
+        if (!valid) {
+            fprintf(stderr, "Ligne %lu ignorée : charge utile invalide\n", (unsigned long)lineNumber);
+            continue;
+        }
+
+        for (int i = 0; i < 6; i++) {
+            record.address[i] = (uint8_t)address[i];
+        }
+        record.rssi = (int8_t)rssi;
+        record.timestamp = (uint32_t)timestamp;
+        record.payloadLength = (uint8_t)length;
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// SyntheticAdvSource
+
+SyntheticAdvSource::SyntheticAdvSource(const SyntheticConfig& config)
+    : emitters(config.beacons), config(config), randomState(config.seed ? config.seed : 1) {
+    for (uint32_t i = 0; i < config.beacons; i++) {
+        Emitter& emitter = emitters[i];
+        emitter.address[0] = 0xD0;
+        emitter.address[1] = 0x5E;
+        emitter.address[2] = (uint8_t)(config.seed >> 8);
+        emitter.address[3] = (uint8_t)(i >> 16);
+        emitter.address[4] = (uint8_t)(i >> 8);
+        emitter.address[5] = (uint8_t)i;
+        buildPayload(emitter, i);
+
+        emitter.meanRssi = (int8_t)-randomRange(50, 100);
+        emitter.fading = config.fadingDb * randomGaussian();
+        emitter.present = config.churnPerHour == 0 || randomRange(0, 100) < 50;
+        emitter.toggleAt = presenceDuration();
+        emitter.nextAt = emitter.present ? randomRange(0, config.intervalMs) : emitter.toggleAt;
+        emitter.lastAt = 0;
+        heap.push_back(i);
+    }
+    for (size_t pos = heap.size() / 2; pos-- > 0;) {
+        siftDown(pos);
+    }
+}
+
+// xorshift32
+uint32_t SyntheticAdvSource::random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+uint32_t SyntheticAdvSource::randomRange(uint32_t low, uint32_t high) {
+    return high > low ? low + random() % (high - low) : low;
+}
+
+// Loi normale centrée réduite, approchée par une somme de quatre uniformes
+float SyntheticAdvSource::randomGaussian() {
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        sum += random() / 4294967296.0f;
+    }
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+// Processus de Gauss-Markov : corrélé sur SIM_FADING_TAU, écart type fadingDb
+void SyntheticAdvSource::updateFading(Emitter& emitter) {
+    if (config.fadingDb == 0) {
+        return;
+    }
+    float decay = expf(-(float)(emitter.nextAt - emitter.lastAt) / SIM_FADING_TAU);
+    emitter.fading = decay * emitter.fading +
+                     sqrtf(1.0f - decay * decay) * config.fadingDb * randomGaussian();
+    emitter.lastAt = emitter.nextAt;
+}
+
+void SyntheticAdvSource::buildPayload(Emitter& emitter, uint32_t index) {
+    uint8_t* p = emitter.payload;
+    size_t n = 0;
+
+    // Flags : LE General Discoverable, BR/EDR non supporté
+    p[n++] = 0x02; p[n++] = 0x01; p[n++] = 0x06;
+
+    uint32_t kind = index % 10;
+    if (kind < 5) {
+        // iBeacon : trois UUID de proximité partagés
+        static const uint8_t header[] = {0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15};
+        memcpy(p + n, header, sizeof(header));
+        n += sizeof(header);
+        for (int i = 0; i < 16; i++) {
+            p[n++] = (uint8_t)(0xE2 + 16 * (index % 3) + i);
+        }
+        p[n++] = 0x00; p[n++] = (uint8_t)(1 + index % 4);          // major
+        p[n++] = (uint8_t)(index >> 8); p[n++] = (uint8_t)index;   // minor
+        p[n++] = 0xC5;                                             // -59 dBm à 1 m
+    } else if (kind == 5) {
+        // AltBeacon
+        static const uint8_t header[] = {0x1B, 0xFF, 0x18, 0x01, 0xBE, 0xAC};
+        memcpy(p + n, header, sizeof(header));
+        n += sizeof(header);
+        for (int i = 0; i < 16; i++) {
+            p[n++] = (uint8_t)(0x40 + i);
+        }
+        p[n++] = 0x00; p[n++] = 0x07;
+        p[n++] = (uint8_t)(index >> 8); p[n++] = (uint8_t)index;
+        p[n++] = 0xC3;
+        p[n++] = 0x00;
+    } else if (kind < 8) {
+        // Eddystone-UID
+        static const uint8_t header[] = {0x03, 0x03, 0xAA, 0xFE, 0x17, 0x16, 0xAA, 0xFE, 0x00, 0xEE};
+        memcpy(p + n, header, sizeof(header));
+        n += sizeof(header);
+        for (int i = 0; i < 10; i++) {
+            p[n++] = (uint8_t)(0x8B + i);                          // namespace
+        }
+        for (int i = 0; i < 6; i++) {
+            p[n++] = (uint8_t)(i < 2 ? 0 : index >> (8 * (5 - i)));  // instance
+        }
+        p[n++] = 0x00; p[n++] = 0x00;
+    } else if (kind == 8) {
+        // Eddystone-URL : https://example.com
+        static const uint8_t frame[] = {0x03, 0x03, 0xAA, 0xFE, 0x0E, 0x16, 0xAA, 0xFE, 0x10, 0xEE,
+                                        0x03, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x07};
+        memcpy(p + n, frame, sizeof(frame));
+        n += sizeof(frame);
+    } else {
+        // Appareil nommé avec un service (batterie, 0x180F)
+        p[n++] = 0x03; p[n++] = 0x03; p[n++] = 0x0F; p[n++] = 0x18;
+        char name[16];
+        int length = snprintf(name, sizeof(name), "Sim-%u", (unsigned)index);
+        p[n++] = (uint8_t)(length + 1);
+        p[n++] = 0x09;
+        memcpy(p + n, name, length);
+        n += length;
+    }
+    emitter.payloadLength = (uint8_t)n;
+}
+
+// Durée d'une période de présence ou d'absence : moyenne 3600 / churn s,
+// à ± 50 % ; sans churn, les beacons restent présents
+uint32_t SyntheticAdvSource::presenceDuration() {
+    if (config.churnPerHour == 0) {
+        return UINT32_MAX;
+    }
+    uint32_t mean = 3600000 / config.churnPerHour;
+    return randomRange(mean / 2, mean + mean / 2 + 1);
+}
+
+// Prochaine annonce à intervalMs ± 10 %, ou au retour du beacon
+void SyntheticAdvSource::schedule(Emitter& emitter) {
+    uint32_t now = emitter.nextAt;
+    if (now >= emitter.toggleAt) {
+        emitter.present = !emitter.present;
+        uint32_t duration = presenceDuration();
+        emitter.toggleAt = duration > UINT32_MAX - now ? UINT32_MAX : now + duration;
+    }
+    if (emitter.present) {
+        uint32_t jitter = config.intervalMs / 10;
+        emitter.nextAt = now + randomRange(config.intervalMs - jitter, config.intervalMs + jitter + 1);
+    } else {
+        emitter.nextAt = emitter.toggleAt;
+    }
+}
+
+bool SyntheticAdvSource::earlier(uint32_t a, uint32_t b) const {
+    return emitters[a].nextAt < emitters[b].nextAt;
+}
+
+void SyntheticAdvSource::siftDown(size_t pos) {
+    size_t size = heap.size();
+    for (;;) {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        if (left < size && earlier(heap[left], heap[smallest])) smallest = left;
+        if (right < size && earlier(heap[right], heap[smallest])) smallest = right;
+        if (smallest == pos) {
+            return;
+        }
+        uint32_t swap = heap[pos];
+        heap[pos] = heap[smallest];
+        heap[smallest] = swap;
+        pos = smallest;
+    }
+}
+
+bool SyntheticAdvSource::next(AdvRecord& record) {
+    while (!heap.empty()) {
+        Emitter& emitter = emitters[heap[0]];
+        if (emitter.nextAt >= config.durationMs) {
+            return false;
+        }
+
+        bool emitted = emitter.present && randomRange(0, 100) >= config.lossPercent;
+        int rssi = 0;
+        if (emitted) {
+            // Évanouissement lent et bruit triangulaire dans [-jitter, +jitter]
+            updateFading(emitter);
+            int spread = (int)config.rssiJitter;
+            int noise = (int)randomRange(0, spread + 1) - (int)randomRange(0, spread + 1);
+            rssi = emitter.meanRssi + (int)lroundf(emitter.fading) + noise;
+            emitted = rssi >= SIM_RX_SENSITIVITY;
+        }
+        if (emitted) {
+
+            memcpy(record.address, emitter.address, sizeof(record.address));
+            record.rssi = (int8_t)(rssi < -100 ? -100 : rssi > -30 ? -30 : rssi);
+            record.timestamp = emitter.nextAt;
+            record.payloadLength = emitter.payloadLength;
+            memcpy(record.payload, emitter.payload, emitter.payloadLength);
+        }
+
+        schedule(emitter);
+        siftDown(0);
+        if (emitted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
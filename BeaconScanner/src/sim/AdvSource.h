@@ -0,0 +1,91 @@
+#ifndef ADV_SOURCE_H
+#define ADV_SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "../AdvRecord.h"
+
+// Flux d'annonces rejoué par le simulateur, dans l'ordre chronologique.
+// record.timestamp contient l'instant d'émission (ms depuis le début du flux).
+class AdvSource {
+public:
+    virtual ~AdvSource() {}
+    virtual bool next(AdvRecord& record) = 0;
+};
+
+// Enregistrement texte, une annonce par ligne :
+//   <ms> <aa:bb:cc:dd:ee:ff> <rssi> <charge utile en hexadécimal>
+// Les lignes vides ou commençant par '#' sont ignorées.
+class ReplayAdvSource : public AdvSource {
+private:
+    FILE* file;
+    uint32_t lineNumber;
+
+public:
+    ReplayAdvSource();
+    ~ReplayAdvSource();
+    bool open(const char* path);
+    bool next(AdvRecord& record) override;
+};
+
+#ifndef SIM_FADING_TAU
+#define SIM_FADING_TAU 20000     // ms
+#endif
+#ifndef SIM_RX_SENSITIVITY
+#define SIM_RX_SENSITIVITY -97   // dBm
+#endif
+
+// Paramètres d'une population synthétique
+struct SyntheticConfig {
+    uint32_t beacons;
+    uint32_t durationMs;
+    uint32_t intervalMs;     // Intervalle d'annonce (± 10 %)
+    uint32_t rssiJitter;     // Bruit (dB) autour du RSSI moyen de chaque beacon
+    uint32_t churnPerHour;   // Changements de présence par beacon et par heure
+    uint32_t lossPercent;    // Annonces perdues (%)
+    uint32_t fadingDb;       // Écart type de l'évanouissement lent (dB)
+    uint32_t seed;
+};
+
+// Population synthétique : un mélange d'iBeacon, AltBeacon, Eddystone et
+// d'appareils nommés, qui apparaissent et disparaissent au hasard. Le RSSI
+// suit un évanouissement lent (Gauss-Markov, constante de temps
+// SIM_FADING_TAU) et les annonces sous SIM_RX_SENSITIVITY sont perdues, ce
+// qui fait clignoter les beacons en limite de portée.
+// Déterministe pour une configuration donnée.
+class SyntheticAdvSource : public AdvSource {
+private:
+    struct Emitter {
+        uint8_t address[6];
+        uint8_t payload[ADV_MAX_PAYLOAD];
+        uint8_t payloadLength;
+        int8_t meanRssi;
+        bool present;
+        float fading;        // Évanouissement lent courant (dB)
+        uint32_t lastAt;     // Annonce précédente
+        uint32_t nextAt;     // Prochaine annonce
+        uint32_t toggleAt;   // Prochain changement de présence
+    };
+
+    std::vector<Emitter> emitters;
+    std::vector<uint32_t> heap;  // Indices, tas minimal sur nextAt
+    SyntheticConfig config;
+    uint32_t randomState;
+
+    uint32_t random();
+    uint32_t randomRange(uint32_t low, uint32_t high);
+    float randomGaussian();
+    void updateFading(Emitter& emitter);
+    void buildPayload(Emitter& emitter, uint32_t index);
+    uint32_t presenceDuration();
+    void schedule(Emitter& emitter);
+    bool earlier(uint32_t a, uint32_t b) const;
+    void siftDown(size_t pos);
+
+public:
+    explicit SyntheticAdvSource(const SyntheticConfig& config);
+    bool next(AdvRecord& record) override;
+};
+
+#endif
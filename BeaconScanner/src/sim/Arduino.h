@@ -0,0 +1,191 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Sous-ensemble de l'API Arduino et FreeRTOS utilisé par la logique
+// portable (SendEvents, BeaconTracker), pour la compilation sur l'hôte.
+// Seul l'environnement "native" place ce répertoire dans le chemin
+// d'inclusion ; l'horloge est celle de la simulation (HalSim.cpp).
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// glibc ne fournit strlcpy qu'à partir de la version 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copied);
+        dst[copied] = '\0';
+    }
+    return length;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// String : ce qu'utilisent le firmware et ArduinoJson
+// (ARDUINOJSON_ENABLE_ARDUINO_STRING=1)
+
+class String {
+private:
+    std::string value;
+
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    explicit String(int number) : value(std::to_string(number)) {}
+
+    String& operator=(const char* text) {
+        value = text ? text : "";
+        return *this;
+    }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.size(); }
+    bool reserve(unsigned int size) {
+        value.reserve(size);
+        return true;
+    }
+
+    bool concat(const char* text) {
+        value += text;
+        return true;
+    }
+    bool concat(const char* text, unsigned int length) {
+        value.append(text, length);
+        return true;
+    }
+
+    String& operator+=(const char* text) {
+        value += text;
+        return *this;
+    }
+    String& operator+=(const String& other) {
+        value += other.value;
+        return *this;
+    }
+
+    bool operator==(const char* text) const { return value == text; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const char* text) const { return value != text; }
+
+    void replace(const char* find, const char* replacement) {
+        size_t findLength = strlen(find);
+        size_t replacementLength = strlen(replacement);
+        for (size_t pos = 0; findLength > 0 && (pos = value.find(find, pos)) != std::string::npos;
+             pos += replacementLength) {
+            value.replace(pos, findLength, replacement);
+        }
+    }
+};
+
+// Type intermédiaire des concaténations Arduino, attendu par ArduinoJson
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const char* text) : String(text) {}
+};
+
+inline String operator+(const String& left, const String& right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+inline String operator+(const String& left, const char* right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+inline String operator+(const char* left, const String& right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Console : sortie standard, coupée pendant les mesures (--quiet)
+
+class HardwareSerial {
+public:
+    bool enabled = true;
+
+    void begin(unsigned long) {}
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (!enabled) {
+            return 0;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vprintf(format, args);
+        va_end(args);
+        return written;
+    }
+
+    void print(const char* text) { printf("%s", text); }
+    void print(const String& text) { printf("%s", text.c_str()); }
+    void println() { printf("\n"); }
+    void println(const char* text) { printf("%s\n", text); }
+    void println(const String& text) { printf("%s\n", text.c_str()); }
+};
+
+extern HardwareSerial Serial;
+
+// ---------------------------------------------------------------------------
+// Horloge de la simulation (voir Hal.h)
+
+uint32_t halMillis();
+void halDelay(uint32_t ms);
+
+inline unsigned long millis() { return halMillis(); }
+inline void delay(unsigned long ms) { halDelay(ms); }
+
+// ---------------------------------------------------------------------------
+// FreeRTOS : files et tâches. Par défaut la simulation n'a qu'un fil
+// d'exécution : les délais d'attente sont ignorés et aucune tâche n'est
+// créée (l'appelant fait le travail lui-même). Après simStartThreads()
+// (option --threads), chaque tâche est un thread attaché au cœur demandé,
+// et les files attendent réellement.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct SimQueue* QueueHandle_t;
+typedef struct SimMutex* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+
+inline BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(task, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+inline void vTaskDelay(TickType_t ticks) { halDelay(ticks); }
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef ARDUINO
+
+#include "Bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+// ---------------------------------------------------------------------------
+// LatencyHistogram
+
+LatencyHistogram::LatencyHistogram() : total(0), sum(0), maximum(0) {
+    memset(counts, 0, sizeof(counts));
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < (1u << SUB_BITS)) {
+        return (size_t)value;
+    }
+    int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+    return ((size_t)(shift + 1) << SUB_BITS) + ((value >> shift) & ((1u << SUB_BITS) - 1));
+}
+
+uint64_t LatencyHistogram::lowerBound(size_t bucket) {
+    size_t group = bucket >> SUB_BITS;
+    uint64_t sub = bucket & ((1u << SUB_BITS) - 1);
+    if (group == 0) {
+        return sub;
+    }
+    return (sub | (1u << SUB_BITS)) << (group - 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    counts[bucketOf(value)]++;
+    total++;
+    sum += value;
+    if (value > maximum) {
+        maximum = value;
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += counts[bucket];
+        if (seen > rank) {
+            uint64_t upper = bucket + 1 < BUCKETS ? lowerBound(bucket + 1) - 1 : maximum;
+            return upper < maximum ? upper : maximum;
+        }
+    }
+    return maximum;
+}
+
+uint64_t benchNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Comptage des allocations : remplacement des operator new/delete globaux
+
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> liveBytes(0);
+static std::atomic<uint64_t> peakBytes(0);
+
+static void* countedAlloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    size_t usable = malloc_usable_size(p);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    uint64_t live = liveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+    uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return p;
+}
+
+static void countedFree(void* p) {
+    if (p) {
+        liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+
+AllocStats allocStats() {
+    AllocStats stats;
+    stats.allocations = allocationCount.load(std::memory_order_relaxed);
+    stats.liveBytes = liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void resetPeakBytes() {
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+#endif
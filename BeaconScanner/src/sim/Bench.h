@@ -0,0 +1,52 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Mesures du simulateur en mode --bench
+
+// Histogramme de durées (ns) à échelle logarithmique : 32 intervalles par
+// octave, soit une précision d'environ 3 %. Taille fixe, enregistrement en
+// O(1) sans allocation.
+class LatencyHistogram {
+private:
+    static const int SUB_BITS = 5;
+    static const size_t BUCKETS = 64 << SUB_BITS;
+
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t maximum;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t lowerBound(size_t bucket);
+
+public:
+    LatencyHistogram();
+    void record(uint64_t value);
+
+    // Borne supérieure de l'intervalle contenant le quantile p (0 à 1)
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return total ? (double)sum / total : 0.0; }
+};
+
+// Horloge murale monotone (ns)
+uint64_t benchNanos();
+
+// Allocations C++ (operator new) depuis le démarrage du programme
+struct AllocStats {
+    uint64_t allocations;
+    uint64_t liveBytes;
+    uint64_t peakBytes;   // Maximum atteint par liveBytes
+};
+
+AllocStats allocStats();
+
+// Remet le maximum au niveau courant (début de la mesure)
+void resetPeakBytes();
+
+#endif
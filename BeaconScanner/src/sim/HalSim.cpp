@@ -0,0 +1,983 @@
+#ifndef ARDUINO
+
+#include "SimHal.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+HardwareSerial Serial;
+
+static std::atomic<uint32_t> simNow(0);
+
+// Mode multi-thread : temps simulé = temps réel depuis simStartThreads(),
+// multiplié par threadSpeed
+static std::atomic<bool> threaded(false);
+static double threadSpeed = 1;
+static uint32_t threadBase = 0;
+static std::chrono::steady_clock::time_point threadStart;
+
+// Durée réelle correspondant à ms de temps simulé
+static std::chrono::microseconds wallDuration(uint32_t ms) {
+    return std::chrono::microseconds((int64_t)(ms * 1000.0 / threadSpeed));
+}
+
+uint32_t halMillis() {
+    if (threaded.load(std::memory_order_relaxed)) {
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - threadStart).count();
+        return threadBase + (uint32_t)(elapsed * threadSpeed);
+    }
+    return simNow.load(std::memory_order_relaxed);
+}
+
+// Le temps simulé avance sans attendre, sauf en mode multi-thread
+void halDelay(uint32_t ms) {
+    if (threaded.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(wallDuration(ms));
+    } else {
+        simNow.fetch_add(ms, std::memory_order_relaxed);
+    }
+}
+
+void simAdvanceTo(uint32_t now) {
+    if (threaded.load(std::memory_order_relaxed)) {
+        int32_t remaining = (int32_t)(now - halMillis());
+        if (remaining > 0) {
+            std::this_thread::sleep_for(wallDuration((uint32_t)remaining));
+        }
+    } else if ((int32_t)(now - simNow.load(std::memory_order_relaxed)) > 0) {
+        simNow.store(now, std::memory_order_relaxed);
+    }
+}
+
+void simStartThreads(double speed) {
+    threadSpeed = speed > 0 ? speed : 1;
+    threadBase = simNow.load(std::memory_order_relaxed);
+    threadStart = std::chrono::steady_clock::now();
+    threaded = true;
+}
+
+bool simThreaded() {
+    return threaded;
+}
+
+// Heure réelle : SIM_EPOCH_START au démarrage, connue SIM_SNTP_DELAY ms
+// après halClockBegin() (première réponse SNTP)
+static const uint64_t SIM_EPOCH_START = 1767225600000ULL; // 2026-01-01T00:00:00Z
+static const uint32_t SIM_SNTP_DELAY = 200;
+static std::atomic<bool> clockRequested(false);
+static std::atomic<uint32_t> clockRequestedAt(0);
+
+void halClockBegin(const char*) {
+    clockRequestedAt = halMillis();
+    clockRequested = true;
+}
+
+uint64_t halEpochMillis() {
+    uint32_t now = halMillis();
+    if (!clockRequested || now - clockRequestedAt < SIM_SNTP_DELAY) {
+        return 0;
+    }
+    return SIM_EPOCH_START + now;
+}
+
+// Suite reproductible d'une exécution à l'autre
+uint32_t halRandom() {
+    static std::atomic<uint32_t> state(0x9E3779B9u);
+    uint32_t x = state.load(std::memory_order_relaxed);
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state.store(x, std::memory_order_relaxed);
+    return x;
+}
+
+// ---------------------------------------------------------------------------
+// Tâches FreeRTOS : des threads en mode multi-thread, sinon aucune (pdFAIL)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t, void* parameter,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t core) {
+    if (!threaded) {
+        return pdFAIL;
+    }
+    // Jamais rejoint : les tâches ne se terminent pas, le processus sort
+    // sans attendre (voir SimMain.cpp)
+    std::thread* thread = new std::thread(task, parameter);
+#ifdef __linux__
+    char shortName[16];
+    strlcpy(shortName, name, sizeof(shortName));
+    pthread_setname_np(thread->native_handle(), shortName);
+
+    // Même répartition que sur l'ESP32 quand l'hôte a deux cœurs ou plus ;
+    // la priorité reste celle de l'ordonnanceur de l'hôte
+    unsigned cores = std::thread::hardware_concurrency();
+    if (core != tskNO_AFFINITY && cores >= 2) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % cores, &set);
+        pthread_setaffinity_np(thread->native_handle(), sizeof(set), &set);
+    }
+#else
+    (void)name;
+    (void)core;
+#endif
+    if (handle) {
+        *handle = thread;
+    }
+    return pdPASS;
+}
+
+// ---------------------------------------------------------------------------
+// Files FreeRTOS, protégées par un verrou ; les délais d'attente ne
+// s'appliquent qu'en mode multi-thread
+
+struct SimQueue {
+    size_t length;
+    size_t itemSize;
+    size_t head;
+    size_t count;
+    std::vector<uint8_t> storage;
+    std::mutex lock;
+    std::condition_variable changed;
+
+    SimQueue(size_t length, size_t itemSize)
+        : length(length), itemSize(itemSize), head(0), count(0), storage(length * itemSize) {}
+
+    uint8_t* slot(size_t index) { return &storage[((head + index) % length) * itemSize]; }
+
+    // Attend que ready() soit vrai, au plus wait ms simulées
+    template <typename Ready>
+    bool waitUntil(std::unique_lock<std::mutex>& guard, TickType_t wait, Ready ready) {
+        if (ready()) {
+            return true;
+        }
+        if (wait == 0 || !threaded) {
+            return false;
+        }
+        if (wait == portMAX_DELAY) {
+            changed.wait(guard, ready);
+            return true;
+        }
+        return changed.wait_for(guard, wallDuration(wait), ready);
+    }
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new SimQueue(length, itemSize);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue->waitUntil(guard, wait, [queue] { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+    memcpy(queue->slot(queue->count), item, queue->itemSize);
+    queue->count++;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue->waitUntil(guard, wait, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->slot(0), queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!queue->waitUntil(guard, wait, [queue] { return queue->count > 0; })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->slot(0), queue->itemSize);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t)queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+// Verrou FreeRTOS ; les délais d'attente ne s'appliquent qu'en mode
+// multi-thread
+struct SimMutex {
+    std::timed_mutex lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new SimMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t wait) {
+    if (wait == portMAX_DELAY) {
+        mutex->lock.lock();
+        return pdTRUE;
+    }
+    if (!threaded || wait == 0) {
+        return mutex->lock.try_lock() ? pdTRUE : pdFALSE;
+    }
+    return mutex->lock.try_lock_for(wallDuration(wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    mutex->lock.unlock();
+    return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Radio : les annonces sont fournies par le simulateur. Une fois
+// configurée, elle n'entend que celles émises pendant un scan, dans la
+// fenêtre de chaque intervalle.
+
+class SimRadio : public HalRadio {
+public:
+    HalAdvertisementCallback callback = nullptr;
+    std::atomic<uint32_t> intervalMs{0};    // 0 : écoute permanente
+    std::atomic<uint32_t> windowMs{0};
+    std::atomic<uint32_t> scanStart{0};
+    std::atomic<uint32_t> scanEnd{0};
+    std::atomic<uint32_t> missed{0};
+    std::atomic<uint32_t> duplicates{0};
+    bool duplicateFilter = BLE_DUPLICATE_FILTER;
+    std::mutex seenMutex;
+    std::unordered_set<uint64_t> seen;  // Adresses remises pendant ce scan
+
+    bool begin(HalAdvertisementCallback callback) override {
+        this->callback = callback;
+        return true;
+    }
+
+    // Le mode actif n'est pas modélisé : les annonces simulées portent déjà
+    // le nom
+    void configure(uint16_t interval, uint16_t window, bool) override {
+        intervalMs = interval;
+        windowMs = window;
+    }
+
+    void start(uint32_t now, uint32_t durationMs) {
+        if (duplicateFilter) {
+            std::lock_guard<std::mutex> lock(seenMutex);
+            seen.clear();
+        }
+        scanStart = now;
+        scanEnd = now + durationMs;
+    }
+
+    // Première annonce de cette adresse depuis le début du scan
+    bool firstInScan(const AdvRecord& record) {
+        uint64_t key = 0;
+        memcpy(&key, record.address, sizeof(record.address));
+        std::lock_guard<std::mutex> lock(seenMutex);
+        return seen.insert(key).second;
+    }
+
+    int scan(uint32_t durationMs) override {
+        start(halMillis(), durationMs);
+        halDelay(durationMs);
+        return 0;
+    }
+
+    bool listening(uint32_t at) const {
+        uint32_t interval = intervalMs;
+        if (interval == 0) {
+            return true;
+        }
+        uint32_t start = scanStart;
+        if ((int32_t)(at - start) < 0 || (int32_t)(at - scanEnd.load()) >= 0) {
+            return false;
+        }
+        return (at - start) % interval < windowMs;
+    }
+
+    // Part du temps radio prise par le scan
+    float duty(uint32_t at) const {
+        uint32_t interval = intervalMs;
+        if (interval == 0) {
+            return 0;
+        }
+        if ((int32_t)(at - scanStart.load()) < 0 || (int32_t)(at - scanEnd.load()) >= 0) {
+            return 0;
+        }
+        return (float)windowMs / interval;
+    }
+};
+
+static SimRadio radio;
+
+// Durée d'un échange WiFi : la radio est partagée, le WiFi n'a que le
+// temps laissé hors des fenêtres de scan (au moins 10 %)
+static uint32_t sharedAirtime(uint32_t latencyMs) {
+    return (uint32_t)(latencyMs / (1.0f - 0.9f * radio.duty(halMillis())) + 0.5f);
+}
+
+// ---------------------------------------------------------------------------
+// Réseau : contrôleur qui acquitte tout, avec coupure programmable
+
+class SimNetwork : public HalNetwork {
+private:
+    bool linkUp = false;
+    bool connectPending = false;
+    uint32_t connectRequestedAt = 0;
+
+    bool inOutage(uint32_t now) const {
+        return config.outageEndMs != 0 && now >= config.outageStartMs && now < config.outageEndMs;
+    }
+
+public:
+    SimNetworkConfig config = {50, 5, 0, 0, 200, 0};
+    SimNetworkStats stats = {0, 0, 0, 0, 0, 0, 0};
+
+    void connect(const char*, const char*) override {
+        connectPending = true;
+        connectRequestedAt = halMillis();
+    }
+
+    // Une coupure fait tomber la liaison : il faut un nouveau connect()
+    bool connected() override {
+        uint32_t now = halMillis();
+        if (linkUp && inOutage(now)) {
+            linkUp = false;
+        }
+        if (!linkUp && connectPending && now - connectRequestedAt >= config.connectDelayMs && !inOutage(now)) {
+            linkUp = true;
+            connectPending = false;
+            stats.connects++;
+        }
+        return linkUp;
+    }
+
+    void macAddress(uint8_t mac[6]) override {
+        static const uint8_t simMac[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+        memcpy(mac, simMac, 6);
+    }
+
+    void localIP(char* out, size_t size) override {
+        strlcpy(out, "127.0.0.1", size);
+    }
+
+    int post(const char*, const char*, const uint8_t*, size_t length) override {
+        if (!connected()) {
+            stats.failedPosts++;
+            return -1;
+        }
+        halDelay(sharedAirtime(config.postLatencyMs));
+        stats.posts++;
+        stats.bytes += length;
+        return config.statusCode;
+    }
+
+    int get(const char*, uint32_t) override {
+        return connected() ? 200 : -1;
+    }
+
+    const char* errorToString(int) override {
+        return "connection refused";
+    }
+};
+
+static SimNetwork network;
+
+// ---------------------------------------------------------------------------
+// Courtier MQTT intégré : accepte les connexions, garde les sessions
+// persistantes et acquitte chaque PUBLISH QoS 1 après postLatencyMs. Tampons
+// fixes, pour ne pas fausser le comptage des allocations de --bench.
+
+class SimBroker {
+private:
+    struct Response {
+        uint32_t due;
+        uint8_t length;
+        uint8_t bytes[4];
+    };
+
+    static const size_t RESPONSES = 64;
+
+    uint8_t input[1024];
+    size_t inputLength = 0;
+    Response responses[RESPONSES];
+    size_t responseHead = 0;
+    size_t responseCount = 0;
+    std::set<std::string> sessions;
+
+    void respond(const uint8_t* bytes, uint8_t length) {
+        if (responseCount == RESPONSES) {
+            open = false; // Client qui ne lit plus ses acquittements
+            return;
+        }
+        Response& response = responses[(responseHead + responseCount++) % RESPONSES];
+        response.due = halMillis() + sharedAirtime(network.config.postLatencyMs);
+        response.length = length;
+        memcpy(response.bytes, bytes, length);
+    }
+
+    // Paquet complet : en-tête, corps de bodyLength octets
+    void handle(uint8_t header, const uint8_t* body, size_t bodyLength, size_t packetLength) {
+        switch (header & 0xF0) {
+        case 0x10: { // CONNECT
+            if (bodyLength < 12) {
+                open = false;
+                return;
+            }
+            size_t nameLength = (body[0] << 8) | body[1];
+            size_t offset = 2 + nameLength + 1; // Nom du protocole, niveau
+            uint8_t flags = body[offset];
+            offset += 3; // Drapeaux, keep-alive
+            size_t idLength = (body[offset] << 8) | body[offset + 1];
+            std::string clientId((const char*)body + offset + 2, idLength);
+
+            uint8_t code = network.config.statusCode >= 500 ? 3 : network.config.statusCode >= 400 ? 5 : 0;
+            bool present = false;
+            if (code == 0) {
+                if (flags & 0x02) {
+                    sessions.erase(clientId);
+                } else {
+                    present = !sessions.insert(clientId).second;
+                }
+                network.stats.brokerConnects++;
+            }
+            uint8_t connack[4] = {0x20, 2, present, code};
+            respond(connack, sizeof(connack));
+            break;
+        }
+        case 0x30: { // PUBLISH
+            uint8_t qos = (header >> 1) & 0x03;
+            size_t topicLength = (body[0] << 8) | body[1];
+            network.stats.publishes++;
+            network.stats.bytes += packetLength;
+            if (qos == 1 && bodyLength >= topicLength + 4) {
+                uint8_t puback[4] = {0x40, 2, body[2 + topicLength], body[3 + topicLength]};
+                respond(puback, sizeof(puback));
+            }
+            break;
+        }
+        case 0xC0: { // PINGREQ
+            uint8_t pingresp[2] = {0xD0, 0};
+            respond(pingresp, sizeof(pingresp));
+            break;
+        }
+        case 0xE0: // DISCONNECT
+            open = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+public:
+    bool open = false;
+
+    void connect() {
+        open = true;
+        inputLength = 0;
+        responseHead = 0;
+        responseCount = 0;
+    }
+
+    void receive(const uint8_t* data, size_t length) {
+        if (inputLength + length > sizeof(input)) {
+            open = false;
+            return;
+        }
+        memcpy(input + inputLength, data, length);
+        inputLength += length;
+
+        // Paquets complets en tête du tampon
+        for (;;) {
+            size_t offset = 1;
+            uint32_t remaining = 0;
+            uint8_t shift = 0;
+            uint8_t byte;
+            do {
+                if (offset >= inputLength) {
+                    return;
+                }
+                byte = input[offset++];
+                remaining |= (uint32_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while ((byte & 0x80) && shift <= 21);
+            if (offset + remaining > inputLength) {
+                return;
+            }
+            handle(input[0], input + offset, remaining, offset + remaining);
+            inputLength -= offset + remaining;
+            memmove(input, input + offset + remaining, inputLength);
+        }
+    }
+
+    // Réponses arrivées à l'instant présent
+    size_t read(uint8_t* out, size_t size) {
+        size_t count = 0;
+        uint32_t now = halMillis();
+        while (responseCount > 0) {
+            Response& response = responses[responseHead];
+            if ((int32_t)(now - response.due) < 0 || count + response.length > size) {
+                break;
+            }
+            memcpy(out + count, response.bytes, response.length);
+            count += response.length;
+            responseHead = (responseHead + 1) % RESPONSES;
+            responseCount--;
+        }
+        return count;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Connexion TCP : vers le courtier intégré, ou vers un vrai courtier
+// (simUseRealBroker, par exemple mosquitto en local)
+
+class SimStream : public HalStream {
+private:
+    SimBroker broker;
+    int socketFd = -1;
+    uint32_t linkGeneration = 0;
+
+    // Une coupure WiFi, même brève, ferme la connexion
+    bool linkDown() {
+        return !network.connected() || network.stats.connects != linkGeneration;
+    }
+
+public:
+    bool realBroker = false;
+
+    bool connect(const char* host, uint16_t port, uint32_t) override {
+        stop();
+        linkGeneration = network.stats.connects;
+        if (linkDown()) {
+            return false;
+        }
+        if (!realBroker) {
+            broker.connect();
+            return true;
+        }
+
+        char service[8];
+        snprintf(service, sizeof(service), "%u", (unsigned)port);
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* addresses = nullptr;
+        if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+            return false;
+        }
+        for (struct addrinfo* a = addresses; a && socketFd < 0; a = a->ai_next) {
+            socketFd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (socketFd >= 0 && ::connect(socketFd, a->ai_addr, a->ai_addrlen) != 0) {
+                close(socketFd);
+                socketFd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (socketFd < 0) {
+            return false;
+        }
+        int noDelay = 1;
+        setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        return true;
+    }
+
+    bool connected() override {
+        if (linkDown()) {
+            stop();
+        }
+        return realBroker ? socketFd >= 0 : broker.open;
+    }
+
+    int write(const uint8_t* data, size_t length) override {
+        if (!connected()) {
+            return -1;
+        }
+        if (!realBroker) {
+            broker.receive(data, length);
+            return broker.open ? (int)length : -1;
+        }
+        ssize_t written = send(socketFd, data, length, MSG_NOSIGNAL);
+        return written < 0 ? -1 : (int)written;
+    }
+
+    // Vrai courtier : attend au plus 1 ms réelle, pour que les boucles
+    // d'attente du client durent à peu près le temps annoncé même quand
+    // l'horloge simulée avance sans attendre
+    int read(uint8_t* data, size_t size) override {
+        if (!connected()) {
+            return -1;
+        }
+        if (!realBroker) {
+            return (int)broker.read(data, size);
+        }
+        struct pollfd descriptor = {socketFd, POLLIN, 0};
+        if (poll(&descriptor, 1, 1) <= 0) {
+            return 0;
+        }
+        ssize_t count = recv(socketFd, data, size, 0);
+        if (count <= 0) {
+            stop();
+            return -1;
+        }
+        return (int)count;
+    }
+
+    void stop() override {
+        broker.open = false;
+        if (socketFd >= 0) {
+            close(socketFd);
+            socketFd = -1;
+        }
+    }
+};
+
+static SimStream stream;
+
+// ---------------------------------------------------------------------------
+// Serveur CoAP intégré : acquitte chaque requête (ACK portant la réponse en
+// mode CON, réponse NON sinon), reconstitue les transferts Block1 et renvoie
+// la même réponse à une requête retransmise. Tampons fixes, comme le
+// courtier intégré.
+
+class SimCoapServer {
+private:
+    struct Response {
+        uint32_t due;
+        uint8_t length;
+        uint8_t bytes[24];
+    };
+
+    static const size_t RESPONSES = 16;
+
+    Response responses[RESPONSES];
+    size_t responseHead = 0;
+    size_t responseCount = 0;
+    Response lastResponse;
+    uint16_t lastId = 0;
+    bool haveLast = false;
+    uint32_t nextBlock = 0;
+    uint32_t lossState = 0x9E3779B9;
+
+    void queue(const Response& response) {
+        if (responseCount < RESPONSES) {
+            responses[(responseHead + responseCount++) % RESPONSES] = response;
+        }
+    }
+
+    // Code CoAP équivalent à statusCode (503 -> 5.03)
+    static uint8_t statusToCode(int status) {
+        return (uint8_t)(((status / 100) << 5) | (status % 100));
+    }
+
+public:
+    bool lost() {
+        lossState ^= lossState << 13;
+        lossState ^= lossState >> 17;
+        lossState ^= lossState << 5;
+        return lossState % 100 < network.config.datagramLossPercent;
+    }
+
+    void receive(const uint8_t* data, size_t length) {
+        if (length < 4 || (data[0] >> 6) != 1 || lost()) {
+            return;
+        }
+        network.stats.datagrams++;
+        network.stats.bytes += length;
+        uint8_t type = (data[0] >> 4) & 0x03;
+        uint8_t tokenLength = data[0] & 0x0F;
+        uint16_t id = (data[2] << 8) | data[3];
+        if (type > 1 || data[1] == 0 || tokenLength > 8) {
+            return; // ACK/RST du client, ou message vide
+        }
+        if (type == 0 && haveLast && id == lastId) {
+            lastResponse.due = halMillis() + sharedAirtime(network.config.postLatencyMs);
+            queue(lastResponse); // Retransmission : même réponse
+            return;
+        }
+
+        // Option Block1 (27), s'il y en a une
+        size_t offset = 4 + tokenLength;
+        uint32_t option = 0;
+        bool blockwise = false;
+        uint32_t block = 0;
+        while (offset < length && data[offset] != 0xFF) {
+            uint32_t delta = data[offset] >> 4;
+            uint32_t optionLength = data[offset] & 0x0F;
+            offset++;
+            if (delta == 13) {
+                delta = 13 + data[offset++];
+            }
+            if (optionLength == 13) {
+                optionLength = 13 + data[offset++];
+            }
+            option += delta;
+            if (option == 27) {
+                blockwise = true;
+                for (uint32_t i = 0; i < optionLength; i++) {
+                    block = (block << 8) | data[offset + i];
+                }
+            }
+            offset += optionLength;
+        }
+        bool more = blockwise && (block & 0x08);
+        uint32_t number = block >> 4;
+
+        Response response;
+        response.due = halMillis() + sharedAirtime(network.config.postLatencyMs);
+        size_t n = 0;
+        response.bytes[n++] = 0x40 | ((type == 0 ? 2 : 1) << 4) | tokenLength;
+        if (blockwise && number != nextBlock && number != 0) {
+            response.bytes[n++] = statusToCode(408); // Bloc manquant
+        } else if (more) {
+            response.bytes[n++] = 0x5F; // 2.31 Continue
+        } else {
+            response.bytes[n++] = statusToCode(network.config.statusCode == 200 ? 204 : network.config.statusCode);
+        }
+        nextBlock = more ? number + 1 : 0;
+        if (response.bytes[1] < 0x80 && !more) {
+            network.stats.posts++;
+        }
+        // ACK : même identifiant ; réponse NON : le sien
+        uint16_t responseId = type == 0 ? id : (uint16_t)(id + 0x8000);
+        response.bytes[n++] = responseId >> 8;
+        response.bytes[n++] = responseId & 0xFF;
+        memcpy(response.bytes + n, data + 4, tokenLength);
+        n += tokenLength;
+        if (blockwise) {
+            response.bytes[n++] = 0xD3; // Block1, delta 27 = 13 + 14, 3 octets
+            response.bytes[n++] = 14;
+            response.bytes[n++] = block >> 16;
+            response.bytes[n++] = block >> 8;
+            response.bytes[n++] = block;
+        }
+        response.length = n;
+        if (type == 0) {
+            lastResponse = response;
+            lastId = id;
+            haveLast = true;
+        }
+        queue(response);
+    }
+
+    // Prochaine réponse arrivée, 0 sinon ; la perte s'applique aussi ici
+    size_t read(uint8_t* out, size_t size) {
+        uint32_t now = halMillis();
+        while (responseCount > 0 && (int32_t)(now - responses[responseHead].due) >= 0) {
+            Response& response = responses[responseHead];
+            responseHead = (responseHead + 1) % RESPONSES;
+            responseCount--;
+            if (lost()) {
+                continue;
+            }
+            size_t length = response.length < size ? response.length : size;
+            memcpy(out, response.bytes, length);
+            return length;
+        }
+        return 0;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Socket UDP : vers le serveur CoAP intégré, ou vers un vrai serveur
+// (simUseRealCoapServer, par exemple CoapServer.js en local)
+
+class SimDatagram : public HalDatagram {
+private:
+    SimCoapServer server;
+    int socketFd = -1;
+    int socketFamily = AF_INET6;
+
+public:
+    bool realServer = false;
+
+    bool begin() override {
+        if (!realServer || socketFd >= 0) {
+            return true;
+        }
+        socketFd = socket(AF_INET6, SOCK_DGRAM, 0);
+        if (socketFd >= 0) {
+            int v6only = 0; // Adresses IPv4 acceptées aussi
+            setsockopt(socketFd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+        } else {
+            socketFamily = AF_INET;
+            socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+        return socketFd >= 0;
+    }
+
+    bool sendTo(const char* host, uint16_t port, const uint8_t* data, size_t length) override {
+        if (!network.connected()) {
+            return false;
+        }
+        if (!realServer) {
+            server.receive(data, length);
+            return true;
+        }
+
+        char service[8];
+        snprintf(service, sizeof(service), "%u", (unsigned)port);
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* addresses = nullptr;
+        if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+            return false;
+        }
+        bool sent = false;
+        for (struct addrinfo* a = addresses; a && !sent; a = a->ai_next) {
+            struct sockaddr_in6 mapped = {};
+            const struct sockaddr* address = a->ai_addr;
+            socklen_t addressLength = a->ai_addrlen;
+            if (a->ai_family != socketFamily && socketFamily == AF_INET) {
+                continue;
+            }
+            if (a->ai_family == AF_INET && socketFamily == AF_INET6) {
+                // Socket IPv6 : adresse IPv4 sous la forme ::ffff:a.b.c.d
+                const struct sockaddr_in* v4 = (const struct sockaddr_in*)a->ai_addr;
+                mapped.sin6_family = AF_INET6;
+                mapped.sin6_port = v4->sin_port;
+                mapped.sin6_addr.s6_addr[10] = 0xFF;
+                mapped.sin6_addr.s6_addr[11] = 0xFF;
+                memcpy(&mapped.sin6_addr.s6_addr[12], &v4->sin_addr, 4);
+                address = (const struct sockaddr*)&mapped;
+                addressLength = sizeof(mapped);
+            }
+            sent = sendto(socketFd, data, length, 0, address, addressLength) == (ssize_t)length;
+        }
+        freeaddrinfo(addresses);
+        if (sent) {
+            network.stats.datagrams++;
+            network.stats.bytes += length;
+        }
+        return sent;
+    }
+
+    // Vrai serveur : attend au plus 1 ms réelle, comme SimStream::read()
+    int receive(uint8_t* data, size_t size) override {
+        if (!network.connected()) {
+            return 0;
+        }
+        if (!realServer) {
+            return (int)server.read(data, size);
+        }
+        struct pollfd descriptor = {socketFd, POLLIN, 0};
+        if (socketFd < 0 || poll(&descriptor, 1, 1) <= 0) {
+            return 0;
+        }
+        ssize_t count = recv(socketFd, data, size, 0);
+        return count < 0 ? 0 : (int)count;
+    }
+};
+
+static SimDatagram datagram;
+
+HalRadio& halRadio() {
+    return radio;
+}
+
+HalNetwork& halNetwork() {
+    return network;
+}
+
+HalStream& halStream() {
+    return stream;
+}
+
+HalDatagram& halDatagram() {
+    return datagram;
+}
+
+void simUseRealBroker(bool real) {
+    stream.realBroker = real;
+}
+
+void simUseRealCoapServer(bool real) {
+    datagram.realServer = real;
+}
+
+static std::string settingsPath(const char* key) {
+    return std::string(STORAGE_ROOT "/") + key + ".cfg";
+}
+
+bool halSettingsLoad(const char* key, char* out, size_t size) {
+    FILE* file = fopen(settingsPath(key).c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    size_t length = fread(out, 1, size - 1, file);
+    out[length] = '\0';
+    fclose(file);
+    return true;
+}
+
+bool halSettingsSave(const char* key, const char* value) {
+    FILE* file = fopen(settingsPath(key).c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(value, 1, strlen(value), file) == strlen(value);
+    return fclose(file) == 0 && written;
+}
+
+void simDeliverAdvertisement(const AdvRecord& record) {
+    if (!radio.listening(record.timestamp)) {
+        radio.missed++;
+        return;
+    }
+    if (radio.duplicateFilter && !radio.firstInScan(record)) {
+        radio.duplicates++;
+        return;
+    }
+    if (radio.callback) {
+        radio.callback(record);
+    }
+}
+
+void simStartScan(uint32_t durationMs) {
+    radio.start(halMillis(), durationMs);
+}
+
+uint32_t simMissedAdvertisements() {
+    return radio.missed;
+}
+
+void simSetDuplicateFilter(bool enabled) {
+    radio.duplicateFilter = enabled;
+}
+
+uint32_t simDuplicateAdvertisements() {
+    return radio.duplicates;
+}
+
+SimNetworkConfig& simNetworkConfig() {
+    return network.config;
+}
+
+const SimNetworkStats& simNetworkStats() {
+    return network.stats;
+}
+
+#endif
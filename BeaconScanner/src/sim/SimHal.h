@@ -0,0 +1,79 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include "../Hal.h"
+
+// Contrôle de la couche matérielle simulée (environnement "native")
+
+// Horloge virtuelle : n'avance que par simAdvanceTo/halDelay. En mode
+// multi-thread, elle suit l'horloge réelle accélérée et simAdvanceTo attend.
+void simAdvanceTo(uint32_t now);
+
+// Passe en mode multi-thread, à appeler avant de créer les tâches : elles
+// deviennent des threads, attachés au cœur RADIO_CORE ou NETWORK_CORE de
+// l'hôte s'il en a au moins deux. speed : millisecondes simulées par
+// milliseconde réelle.
+void simStartThreads(double speed);
+bool simThreaded();
+
+// halEpochMillis() : le 1er janvier 2026 à 00:00 UTC au démarrage,
+// disponible 200 ms après halClockBegin(). halRandom() donne la même suite
+// à chaque exécution.
+
+// Remet l'annonce au callback enregistré par halRadio().begin(), comme le
+// ferait la pile Bluetooth. record.timestamp est l'instant de réception :
+// la radio tourne en parallèle de l'envoi, qui peut avoir avancé l'horloge.
+void simDeliverAdvertisement(const AdvRecord& record);
+
+// Radio partagée : une fois halRadio().configure() appelé, seules les
+// annonces émises pendant un scan et dans la fenêtre de chaque intervalle
+// sont remises, les autres sont comptées comme manquées. Pendant un scan,
+// les échanges réseau (POST, PUBLISH, CoAP) durent postLatencyMs divisé par
+// la part du temps laissée au WiFi (au moins 10 %).
+// simStartScan() lance un scan sans attendre (boucle à un seul fil) ;
+// halRadio().scan() bloque pendant sa durée (--threads).
+void simStartScan(uint32_t durationMs);
+uint32_t simMissedAdvertisements();
+
+// Filtre des doublons du contrôleur (BLE_DUPLICATE_FILTER) : pendant un
+// scan, seule la première annonce de chaque adresse est remise
+void simSetDuplicateFilter(bool enabled);
+uint32_t simDuplicateAdvertisements();
+
+// Comportement du réseau simulé
+struct SimNetworkConfig {
+    uint32_t connectDelayMs;   // Délai d'association WiFi
+    uint32_t postLatencyMs;    // Durée d'un POST (temps simulé)
+    uint32_t outageStartMs;    // Coupure [début, fin[ ; fin = 0 : aucune
+    uint32_t outageEndMs;
+    int statusCode;            // Réponse du contrôleur
+    uint32_t datagramLossPercent; // Datagrammes UDP perdus, dans chaque sens
+};
+
+struct SimNetworkStats {
+    uint32_t connects;
+    uint32_t posts;
+    uint32_t failedPosts;      // Refusés faute de connexion
+    uint64_t bytes;
+    uint32_t brokerConnects;   // Sessions MQTT ouvertes (courtier intégré)
+    uint32_t publishes;        // PUBLISH reçus par le courtier intégré
+    uint32_t datagrams;        // Datagrammes reçus par le serveur CoAP intégré
+};
+
+// halStream() vise le courtier MQTT intégré (défaut) ou, si real, l'hôte et
+// le port demandés (mosquitto en local par exemple). Le courtier intégré
+// suit postLatencyMs, les coupures, et refuse la connexion si statusCode
+// est une erreur HTTP.
+void simUseRealBroker(bool real);
+
+// halDatagram() vise le serveur CoAP intégré (défaut) ou, si real, un vrai
+// serveur (CoapServer.js). Le serveur intégré répond après postLatencyMs,
+// 2.31 Continue pour chaque bloc Block1 sauf le dernier, puis 2.04 ou
+// l'équivalent CoAP de statusCode ; il perd datagramLossPercent % des
+// datagrammes dans chaque sens.
+void simUseRealCoapServer(bool real);
+
+SimNetworkConfig& simNetworkConfig();
+const SimNetworkStats& simNetworkStats();
+
+#endif
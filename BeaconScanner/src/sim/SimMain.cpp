@@ -0,0 +1,914 @@
+// Absent des tests (pio test -e native), qui ont leur propre main()
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+// Simulateur hôte (environnement "native") : rejoue un flux d'annonces,
+// enregistré ou synthétique, dans BeaconTracker et SendEvents, avec la
+// radio, le réseau et l'horloge simulés (SimHal.h). Le temps simulé saute
+// d'une échéance à la suivante, bien plus vite que le temps réel.
+//
+//   pio run -e native
+//   .pio/build/native/program --beacons 200 --duration 3600 --quiet
+//   .pio/build/native/program --replay capture.txt
+//   .pio/build/native/program --bench --json --beacons 500 --interval 50
+//
+// En mode --bench, chaque annonce est traitée dès sa réception et chronométrée
+// (callback radio -> présence -> mise en file), ainsi que la détection des
+// départs et les étapes d'envoi ; les allocations sont comptées (Bench.h).
+//
+// En mode --threads, la topologie est celle du firmware : radio et suivi
+// sur RADIO_CORE, envoi et journal sur NETWORK_CORE, chacun dans son thread,
+// avec une horloge réelle accélérée (--speed). Les files débordent alors
+// comme sur la carte quand un côté prend du retard.
+
+#include <Arduino.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include "SimHal.h"
+#include "AdvSource.h"
+#include "Bench.h"
+#include "../BeaconStream.h"
+#include "../BeaconTracker.h"
+#include "../Log.h"
+#include "../CoapTransport.h"
+#include "../EventPush.h"
+#include "../EventSpool.h"
+#include "../Metrics.h"
+#include "../MqttTransport.h"
+#include "../ScanScheduler.h"
+#include "../SendEvents.h"
+
+SendEvents eventSender;
+BeaconTracker tracker(eventSender);
+ScanScheduler scanScheduler;
+
+struct SimOptions {
+    const char* replayPath = nullptr;
+    const char* dataDir = nullptr;
+    uint32_t beacons = 50;
+    uint32_t durationMs = 0;     // 0 : 600 s, ou fin de l'enregistrement
+    uint32_t intervalMs = 100;
+    uint32_t seed = 1;
+    uint32_t rssiJitter = 4;
+    uint32_t churnPerHour = 30;
+    uint32_t lossPercent = 10;
+    uint32_t fadingDb = 0;
+    uint32_t tickMs = 10;
+    uint32_t pollMs = 0;         // 0 : pas de client GET /beacons
+    uint32_t wsSubscribers = 0;  // Abonnés de /ws
+    bool keepSpool = false;
+    bool quiet = false;
+    bool bench = false;
+    bool json = false;
+    bool metrics = false;
+    bool threads = false;
+    bool duplicateFilter = BLE_DUPLICATE_FILTER;
+    double speed = 50;
+    const char* transport = "http";     // http, mqtt, coap ou coap-non
+    const char* scan = "adaptive";      // adaptive, fixed ou off (radio toujours à l'écoute)
+    const char* brokerHost = nullptr;   // nullptr : courtier intégré
+    uint16_t brokerPort = 1883;
+    const char* coapHost = nullptr;     // nullptr : serveur CoAP intégré
+    uint16_t coapPort = 5683;
+};
+
+static bool usesTransport(const SimOptions& options, const char* name) {
+    return strncmp(options.transport, name, strlen(name)) == 0;
+}
+
+// Transport CoAP de la simulation, pour ses retransmissions
+static CoapTransport* coapTransport = nullptr;
+
+// Mesures du mode --bench
+struct BenchResults {
+    LatencyHistogram advertisement;     // Par annonce, jusqu'à la mise en file
+    LatencyHistogram rejected;          // Annonces refusées par le filtre
+    LatencyHistogram departureCheck;    // checkForDepartedBeacons()
+    LatencyHistogram uplink;            // SendEvents::service()
+    LatencyHistogram poll;              // GET /beacons?since= (--poll)
+    uint64_t advertisementAllocations = 0;
+    uint64_t uplinkAllocations = 0;
+};
+
+static BenchResults bench;
+static uint64_t heapBaseline = 0;
+
+// Abonnés de /ws (--ws) : EventPush leur diffuse chaque événement mis en
+// file, comme à un tableau de bord connecté à l'ESP32. La tâche du serveur
+// web est jouée par la boucle principale, qui vide la file quand EventPush
+// la réveille.
+struct WsClients {
+    uint32_t messages[EVENT_PUSH_SUBSCRIBERS] = {};
+    uint64_t bytes = 0;
+    uint32_t wakeups = 0;
+    bool notified = false;
+};
+
+static EventPush eventPush;
+static WsClients wsClients;
+
+static void notifyWs() {
+    wsClients.notified = true;
+}
+
+static bool receiveWs(int subscriber, const char*, size_t length) {
+    wsClients.messages[subscriber]++;
+    wsClients.bytes += length;
+    return true;
+}
+
+static void serveWs() {
+    if (wsClients.notified) {
+        wsClients.notified = false;
+        wsClients.wakeups++;
+        eventPush.drain(receiveWs);
+    }
+}
+
+// Messages reçus par chaque abonné, ou UINT32_MAX s'ils diffèrent
+static uint32_t wsMessagesPerSubscriber(const SimOptions& options) {
+    for (uint32_t i = 1; i < options.wsSubscribers; i++) {
+        if (wsClients.messages[i] != wsClients.messages[0]) {
+            return UINT32_MAX;
+        }
+    }
+    return wsClients.messages[0];
+}
+
+// Client de GET /beacons?since= (--poll) : il tient sa copie de la table à
+// partir des seules modifications, comparée en fin de simulation à un
+// instantané complet
+struct PollClient {
+    std::string body;
+    std::map<std::string, std::string> beacons;  // beaconId -> status
+    uint32_t seq = 0;
+    uint32_t requests = 0;
+    uint32_t resets = 0;
+    uint32_t timeouts = 0;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    size_t snapshotBytes = 0;
+    size_t snapshotRecords = 0;
+    size_t mismatches = 0;
+};
+
+static PollClient pollClient;
+
+static void pollWrite(const char* data, size_t length) {
+    pollClient.body.append(data, length);
+}
+
+// Applique un corps de réponse de GET /beacons ; retourne reset
+static bool applyBeacons(const std::string& body, std::map<std::string, std::string>& beacons, uint32_t& seq) {
+    unsigned long value = 0;
+    sscanf(body.c_str(), "{\"seq\":%lu", &value);
+    seq = (uint32_t)value;
+    bool reset = body.find("\"reset\":true") < body.find('[');
+    if (reset) {
+        beacons.clear();
+    }
+    static const std::string idKey = "{\"beaconId\":\"";
+    static const std::string statusKey = "\"status\":\"";
+    for (size_t at = body.find(idKey); at != std::string::npos; at = body.find(idKey, at + 1)) {
+        size_t idStart = at + idKey.size();
+        std::string id = body.substr(idStart, body.find('"', idStart) - idStart);
+        size_t statusStart = body.find(statusKey, idStart) + statusKey.size();
+        std::string status = body.substr(statusStart, body.find('"', statusStart) - statusStart);
+        if (status == "removed") {
+            beacons.erase(id);
+        } else {
+            beacons[id] = status;
+        }
+    }
+    return reset;
+}
+
+static void pollBeacons(const SimOptions& options) {
+    pollClient.body.clear();
+    uint64_t start = benchNanos();
+    int count = streamBeacons(tracker, pollClient.seq, pollWrite);
+    if (options.bench) {
+        bench.poll.record(benchNanos() - start);
+    }
+    if (count < 0) {
+        pollClient.timeouts++;
+        return;
+    }
+    pollClient.requests++;
+    pollClient.bytes += pollClient.body.size();
+    pollClient.records += count;
+    if (applyBeacons(pollClient.body, pollClient.beacons, pollClient.seq)) {
+        pollClient.resets++;
+    }
+}
+
+// Dernière lecture des modifications, puis comparaison avec la table entière
+static void checkPollClient(const SimOptions& options) {
+    pollBeacons(options);
+    pollClient.body.clear();
+    int count = streamBeacons(tracker, 0, pollWrite);
+    std::map<std::string, std::string> snapshot;
+    uint32_t seq;
+    applyBeacons(pollClient.body, snapshot, seq);
+    pollClient.snapshotBytes = pollClient.body.size();
+    pollClient.snapshotRecords = count > 0 ? count : 0;
+    for (const auto& entry : snapshot) {
+        auto copy = pollClient.beacons.find(entry.first);
+        if (copy == pollClient.beacons.end() || copy->second != entry.second) {
+            pollClient.mismatches++;
+        }
+    }
+    for (const auto& entry : pollClient.beacons) {
+        if (snapshot.find(entry.first) == snapshot.end()) {
+            pollClient.mismatches++;
+        }
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --replay FICHIER      rejouer un enregistrement (<ms> <adresse> <rssi> <hex>)\n"
+            "  --beacons N           beacons synthétiques (défaut 50)\n"
+            "  --duration S          durée simulée en secondes (défaut 600, ou fin de l'enregistrement)\n"
+            "  --interval MS         intervalle d'annonce synthétique (défaut 100)\n"
+            "  --seed N              graine du générateur (défaut 1)\n"
+            "  --rssi-jitter DB      bruit du RSSI synthétique (défaut 4)\n"
+            "  --churn N             changements de présence par beacon et par heure (défaut 30)\n"
+            "  --loss PCT            annonces synthétiques perdues (défaut 10)\n"
+            "  --fading DB           évanouissement lent du RSSI synthétique (défaut 0)\n"
+            "  --tick MS             période de la détection des départs (défaut 10)\n"
+            "  --poll MS             client de GET /beacons?since= toutes les MS ms (défaut : aucun)\n"
+            "  --ws N                N abonnés au WebSocket /ws, 1 à %d (défaut : aucun ; sans --threads)\n"
+            "  --scan MODE           adaptive (défaut, ScanScheduler), fixed (100/99 ms, cycles de 5 s) ou\n"
+            "                        off (radio toujours à l'écoute, sans partage avec le WiFi)\n"
+            "  --outage DEBUT:FIN    coupure réseau, en secondes\n"
+            "  --post-latency MS     durée simulée d'un POST (défaut 5)\n"
+            "  --status CODE         réponse HTTP du contrôleur (défaut 200), refus MQTT si >= 400\n"
+            "  --transport NOM       http (défaut), mqtt (publication directe au courtier), coap ou\n"
+            "                        coap-non (POST au serveur CoAP, confirmable ou non)\n"
+            "  --broker HOTE:PORT    vrai courtier MQTT (mosquitto...) au lieu du courtier intégré\n"
+            "  --coap HOTE:PORT      vrai serveur CoAP (CoapServer.js) au lieu du serveur intégré\n"
+            "  --filter FICHIER      règles de filtrage (voir AdvFilter.h), comme POST /filter\n"
+            "  --refresh ADRESSE=MS  intervalle de rafraîchissement d'un beacon (filtre des doublons)\n"
+            "  --hw-dedup            filtre des doublons du contrôleur BLE (BLE_DUPLICATE_FILTER) : une\n"
+            "                        annonce par adresse et par cycle de scan (incompatible avec --scan off)\n"
+            "  --udp-loss PCT        datagrammes perdus dans chaque sens, serveur CoAP intégré (défaut 0)\n"
+            "  --data REPERTOIRE     répertoire du spool (défaut : courant)\n"
+            "  --keep-spool          reprendre le spool existant (redémarrage)\n"
+            "  --quiet               pas de sortie console du firmware\n"
+            "  --bench               chronométrer le chemin annonce -> événement (implique --quiet)\n"
+            "  --json                résultats sur une ligne JSON\n"
+            "  --metrics             page /metrics en fin de simulation\n"
+            "  --threads             un thread par tâche, comme sur l'ESP32 (incompatible avec --bench)\n"
+            "  --speed X             accélération du temps avec --threads (défaut 50)\n",
+            program, EVENT_PUSH_SUBSCRIBERS);
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+    SimNetworkConfig& network = simNetworkConfig();
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = true;
+
+        if (strcmp(arg, "--keep-spool") == 0) {
+            options.keepSpool = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--bench") == 0) {
+            options.bench = true;
+            options.quiet = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--json") == 0) {
+            options.json = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--metrics") == 0) {
+            options.metrics = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--hw-dedup") == 0) {
+            options.duplicateFilter = true;
+            hasValue = false;
+        } else if (strcmp(arg, "--threads") == 0) {
+            options.threads = true;
+            hasValue = false;
+        } else if (!value) {
+            return false;
+        } else if (strcmp(arg, "--replay") == 0) {
+            options.replayPath = value;
+        } else if (strcmp(arg, "--beacons") == 0) {
+            options.beacons = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--duration") == 0) {
+            options.durationMs = strtoul(value, nullptr, 10) * 1000;
+        } else if (strcmp(arg, "--interval") == 0) {
+            options.intervalMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--rssi-jitter") == 0) {
+            options.rssiJitter = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--churn") == 0) {
+            options.churnPerHour = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--loss") == 0) {
+            options.lossPercent = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--fading") == 0) {
+            options.fadingDb = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--speed") == 0) {
+            options.speed = atof(value);
+        } else if (strcmp(arg, "--tick") == 0) {
+            options.tickMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--scan") == 0) {
+            if (strcmp(value, "adaptive") != 0 && strcmp(value, "fixed") != 0 && strcmp(value, "off") != 0) {
+                return false;
+            }
+            options.scan = value;
+            scanScheduler.setAdaptive(strcmp(value, "adaptive") == 0);
+        } else if (strcmp(arg, "--poll") == 0) {
+            options.pollMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--ws") == 0) {
+            options.wsSubscribers = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--outage") == 0) {
+            unsigned long start, end;
+            if (sscanf(value, "%lu:%lu", &start, &end) != 2 || end <= start) {
+                return false;
+            }
+            network.outageStartMs = start * 1000;
+            network.outageEndMs = end * 1000;
+        } else if (strcmp(arg, "--post-latency") == 0) {
+            network.postLatencyMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--status") == 0) {
+            network.statusCode = atoi(value);
+        } else if (strcmp(arg, "--transport") == 0) {
+            if (strcmp(value, "http") != 0 && strcmp(value, "mqtt") != 0 && strcmp(value, "coap") != 0 &&
+                strcmp(value, "coap-non") != 0) {
+                return false;
+            }
+            options.transport = value;
+        } else if (strcmp(arg, "--broker") == 0) {
+            static char host[64];
+            unsigned port;
+            if (sscanf(value, "%63[^:]:%u", host, &port) != 2 || port == 0 || port > 65535) {
+                return false;
+            }
+            options.brokerHost = host;
+            options.brokerPort = port;
+            options.transport = "mqtt";
+        } else if (strcmp(arg, "--coap") == 0) {
+            static char host[64];
+            unsigned port;
+            if (sscanf(value, "%63[^:]:%u", host, &port) != 2 || port == 0 || port > 65535) {
+                return false;
+            }
+            options.coapHost = host;
+            options.coapPort = port;
+            if (!usesTransport(options, "coap")) {
+                options.transport = "coap";
+            }
+        } else if (strcmp(arg, "--filter") == 0) {
+            static char text[ADV_FILTER_TEXT_MAX];
+            FILE* file = fopen(value, "r");
+            if (!file) {
+                fprintf(stderr, "Impossible d'ouvrir %s\n", value);
+                return false;
+            }
+            size_t length = fread(text, 1, sizeof(text) - 1, file);
+            fclose(file);
+            text[length] = '\0';
+            char error[96];
+            if (!tracker.setFilter(text, error, sizeof(error))) {
+                fprintf(stderr, "%s : %s\n", value, error);
+                return false;
+            }
+        } else if (strcmp(arg, "--refresh") == 0) {
+            unsigned int address[6];
+            unsigned long refresh;
+            if (sscanf(value, "%x:%x:%x:%x:%x:%x=%lu", &address[0], &address[1], &address[2], &address[3],
+                       &address[4], &address[5], &refresh) != 7) {
+                return false;
+            }
+            uint8_t mac[6];
+            for (int k = 0; k < 6; k++) {
+                mac[k] = (uint8_t)address[k];
+            }
+            if (!tracker.setRefreshInterval(mac, refresh)) {
+                return false;
+            }
+        } else if (strcmp(arg, "--udp-loss") == 0) {
+            network.datagramLossPercent = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--data") == 0) {
+            options.dataDir = value;
+        } else {
+            return false;
+        }
+
+        if (hasValue) {
+            i++;
+        }
+    }
+    return options.tickMs > 0 && options.intervalMs > 0 && options.lossPercent <= 100 && options.speed > 0 &&
+           network.datagramLossPercent <= 100 && !(options.threads && options.bench) &&
+           options.wsSubscribers <= EVENT_PUSH_SUBSCRIBERS && !(options.threads && options.wsSubscribers > 0) &&
+           !(options.duplicateFilter && strcmp(options.scan, "off") == 0);
+}
+
+static void printSummary(const SimOptions& options, double wallSeconds) {
+    double simSeconds = halMillis() / 1000.0;
+    UplinkStats uplink = eventSender.getStats();
+    const SimNetworkStats& network = simNetworkStats();
+
+    printf("Simulation : %.1f s simulées en %.3f s (x%.0f)\n", simSeconds, wallSeconds,
+           wallSeconds > 0 ? simSeconds / wallSeconds : 0.0);
+    uint32_t received = tracker.advertisementsReceived();
+    printf("Annonces   : %lu reçues, %lu doublons écartés (%.1f %%), %lu filtrées, %lu perdues (file pleine)\n",
+           (unsigned long)received, (unsigned long)tracker.advertisementsSuppressed(),
+           received ? 100.0 * tracker.advertisementsSuppressed() / received : 0.0,
+           (unsigned long)tracker.advertisementsFiltered(), (unsigned long)tracker.advertisementsDropped());
+    printf("Beacons    : %lu connus, %lu arrivées, %lu départs, %lu libérés", (unsigned long)tracker.beaconCount(),
+           (unsigned long)tracker.arrivals(), (unsigned long)tracker.departures(), (unsigned long)tracker.reclaimed());
+    if (tracker.beaconEvictions() > 0 || tracker.tableFullRejections() > 0) {
+        printf(", %lu recyclés, %lu annonces ignorées (table pleine)", (unsigned long)tracker.beaconEvictions(),
+               (unsigned long)tracker.tableFullRejections());
+    }
+    printf("\n");
+    printf("Envoi      : %lu en file, %lu envoyés, %lu perdus, %lu regroupés, %lu en spool (%lu écrasés)\n",
+           (unsigned long)uplink.enqueued, (unsigned long)uplink.sent, (unsigned long)uplink.dropped,
+           (unsigned long)uplink.coalesced, (unsigned long)uplink.spooled, (unsigned long)uplink.spoolOverwritten);
+    if (uplink.spilled > 0) {
+        printf("Débordement: %lu événements versés dans le spool, file pleine\n", (unsigned long)uplink.spilled);
+    }
+    printf("Latence    : %.1f ms en moyenne, %lu ms max (annonce -> mise en file)\n",
+           uplink.latencySamples ? (double)uplink.latencyTotalMs / uplink.latencySamples : 0.0,
+           (unsigned long)uplink.latencyMaxMs);
+    if (usesTransport(options, "mqtt")) {
+        printf("Réseau     : %lu connexions, %lu sessions MQTT, %lu PUBLISH, %lu échecs, %llu octets\n",
+               (unsigned long)network.connects, (unsigned long)network.brokerConnects,
+               (unsigned long)network.publishes, (unsigned long)uplink.failedPosts,
+               (unsigned long long)network.bytes);
+    } else if (usesTransport(options, "coap")) {
+        printf("Réseau     : %lu connexions, %lu datagrammes, %lu lots acquittés par le serveur, "
+               "%lu retransmissions, %lu échecs, %llu octets\n",
+               (unsigned long)network.connects, (unsigned long)network.datagrams, (unsigned long)network.posts,
+               (unsigned long)coapTransport->retransmissionCount(), (unsigned long)uplink.failedPosts,
+               (unsigned long long)network.bytes);
+    } else {
+        printf("Réseau     : %lu connexions, %lu POST, %lu échecs, %llu octets\n", (unsigned long)network.connects,
+               (unsigned long)network.posts, (unsigned long)(uplink.failedPosts),
+               (unsigned long long)network.bytes);
+    }
+    const MetricHistogram& posts = eventSender.postLatencyHistogram();
+    uint32_t postCount = 0;
+    for (size_t i = 0; i <= MetricHistogram::BUCKETS; i++) {
+        postCount += posts.bucketCount(i);
+    }
+    uint32_t scanCycles = 0;
+    for (size_t i = 0; i < SCAN_MODE_COUNT; i++) {
+        scanCycles += scanScheduler.cycleCount((ScanMode)i);
+    }
+    printf("Radio      : %lu cycles (veille %lu, normal %lu, dense %lu, envoi %lu, fixe %lu), écoute %.1f %%, "
+           "fenêtres WiFi %.1f s, %lu annonces manquées, envoi %.1f ms en moyenne\n",
+           (unsigned long)scanCycles, (unsigned long)scanScheduler.cycleCount(SCAN_MODE_QUIET),
+           (unsigned long)scanScheduler.cycleCount(SCAN_MODE_NORMAL),
+           (unsigned long)scanScheduler.cycleCount(SCAN_MODE_DENSE),
+           (unsigned long)scanScheduler.cycleCount(SCAN_MODE_UPLINK),
+           (unsigned long)scanScheduler.cycleCount(SCAN_MODE_FIXED),
+           simSeconds > 0 ? scanScheduler.listenTimeMs() / (10.0 * simSeconds) : 0.0,
+           scanScheduler.wifiWindowTimeMs() / 1000.0, (unsigned long)simMissedAdvertisements(),
+           postCount ? (double)posts.total() / postCount : 0.0);
+    if (options.duplicateFilter) {
+        printf("Contrôleur : %lu annonces filtrées comme doublons (une par adresse et par cycle de scan)\n",
+               (unsigned long)simDuplicateAdvertisements());
+    }
+    if (options.pollMs > 0) {
+        printf("Flux       : %lu requêtes /beacons, %.0f octets et %.1f entrées par requête (table entière : %lu "
+               "octets, %lu entrées), %lu instantanés complets, %lu sans réponse, %lu écarts\n",
+               (unsigned long)pollClient.requests,
+               pollClient.requests ? (double)pollClient.bytes / pollClient.requests : 0.0,
+               pollClient.requests ? (double)pollClient.records / pollClient.requests : 0.0,
+               (unsigned long)pollClient.snapshotBytes, (unsigned long)pollClient.snapshotRecords,
+               (unsigned long)pollClient.resets, (unsigned long)pollClient.timeouts,
+               (unsigned long)pollClient.mismatches);
+    }
+    if (options.wsSubscribers > 0) {
+        uint32_t perSubscriber = wsMessagesPerSubscriber(options);
+        printf("WebSocket  : %lu abonnés, %lu événements diffusés (%lu perdus avant diffusion), %s par abonné, "
+               "%.0f octets par message, %lu réveils du serveur web\n",
+               (unsigned long)options.wsSubscribers, (unsigned long)eventPush.messages(),
+               (unsigned long)eventPush.dropped(),
+               perSubscriber == eventPush.messages() ? "tous reçus" : "ÉCART",
+               eventPush.messages() ? (double)wsClients.bytes / options.wsSubscribers / eventPush.messages() : 0.0,
+               (unsigned long)wsClients.wakeups);
+    }
+
+    if (!options.bench) {
+        return;
+    }
+    const LatencyHistogram& adv = bench.advertisement;
+    printf("Annonce    : p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns (%.0f annonces/s)\n",
+           (unsigned long long)adv.percentile(0.50), (unsigned long long)adv.percentile(0.99),
+           (unsigned long long)adv.percentile(0.999), (unsigned long long)adv.max(),
+           adv.mean() > 0 ? 1e9 / adv.mean() : 0.0);
+    if (bench.rejected.count() > 0) {
+        printf("Refus      : p50 %llu ns, p99 %llu ns par annonce refusée par le filtre\n",
+               (unsigned long long)bench.rejected.percentile(0.50),
+               (unsigned long long)bench.rejected.percentile(0.99));
+    }
+    printf("Départs    : p50 %llu ns, p99 %llu ns par vérification\n",
+           (unsigned long long)bench.departureCheck.percentile(0.50),
+           (unsigned long long)bench.departureCheck.percentile(0.99));
+    printf("Envoi      : p50 %llu ns, p99 %llu ns par étape\n", (unsigned long long)bench.uplink.percentile(0.50),
+           (unsigned long long)bench.uplink.percentile(0.99));
+    if (bench.poll.count() > 0) {
+        printf("Flux       : p50 %llu ns, p99 %llu ns par requête /beacons\n",
+               (unsigned long long)bench.poll.percentile(0.50), (unsigned long long)bench.poll.percentile(0.99));
+    }
+    printf("Mémoire    : %.3f allocations/annonce, %.2f allocations/événement, pic du tas %llu octets, "
+           "statique %lu octets\n",
+           adv.count() ? (double)bench.advertisementAllocations / adv.count() : 0.0,
+           uplink.enqueued ? (double)bench.uplinkAllocations / uplink.enqueued : 0.0,
+           (unsigned long long)(allocStats().peakBytes - heapBaseline), (unsigned long)(sizeof(tracker) + sizeof(eventSender)));
+}
+
+static void printLatency(const char* name, const LatencyHistogram& histogram) {
+    printf("\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},",
+           name, (unsigned long long)histogram.count(), histogram.mean(),
+           (unsigned long long)histogram.percentile(0.50), (unsigned long long)histogram.percentile(0.90),
+           (unsigned long long)histogram.percentile(0.99), (unsigned long long)histogram.percentile(0.999),
+           (unsigned long long)histogram.max());
+}
+
+// Une ligne JSON, pour comparer les résultats entre deux commits
+static void printJson(const SimOptions& options, double wallSeconds) {
+    double simSeconds = halMillis() / 1000.0;
+    UplinkStats uplink = eventSender.getStats();
+    const SimNetworkStats& network = simNetworkStats();
+
+    printf("{\"config\":{");
+    if (options.replayPath) {
+        printf("\"replay\":\"%s\",", options.replayPath);
+    } else {
+        printf("\"beacons\":%lu,\"interval_ms\":%lu,\"rssi_jitter_db\":%lu,\"churn_per_hour\":%lu,"
+               "\"loss_percent\":%lu,\"fading_db\":%lu,\"seed\":%lu,",
+               (unsigned long)options.beacons, (unsigned long)options.intervalMs, (unsigned long)options.rssiJitter,
+               (unsigned long)options.churnPerHour, (unsigned long)options.lossPercent,
+               (unsigned long)options.fadingDb, (unsigned long)options.seed);
+    }
+    printf("\"duration_s\":%lu,\"tick_ms\":%lu,\"batch_size\":%d,\"flush_interval_ms\":%d,\"threads\":%s,"
+           "\"speed\":%.0f,\"transport\":\"%s\"},",
+           (unsigned long)(options.durationMs / 1000), (unsigned long)(options.threads ? TRACKER_TICK : options.tickMs),
+           EVENT_BATCH_SIZE, EVENT_FLUSH_INTERVAL, options.threads ? "true" : "false", options.threads ? options.speed : 0,
+           options.transport);
+
+    printf("\"sim_seconds\":%.3f,\"wall_seconds\":%.3f,", simSeconds, wallSeconds);
+    printf("\"advertisements\":%lu,\"advertisements_suppressed\":%lu,\"advertisements_filtered\":%lu,"
+           "\"advertisements_dropped\":%lu,\"beacons\":%lu,\"arrivals\":%lu,\"departures\":%lu,\"reclaimed\":%lu,"
+           "\"evictions\":%lu,\"table_full_rejected\":%lu,",
+           (unsigned long)tracker.advertisementsReceived(), (unsigned long)tracker.advertisementsSuppressed(),
+           (unsigned long)tracker.advertisementsFiltered(), (unsigned long)tracker.advertisementsDropped(),
+           (unsigned long)tracker.beaconCount(), (unsigned long)tracker.arrivals(),
+           (unsigned long)tracker.departures(), (unsigned long)tracker.reclaimed(),
+           (unsigned long)tracker.beaconEvictions(), (unsigned long)tracker.tableFullRejections());
+    printf("\"events\":%lu,\"events_sent\":%lu,\"events_dropped\":%lu,\"events_spilled\":%lu,\"events_coalesced\":%lu,"
+           "\"events_per_sim_second\":%.3f,\"event_latency_mean_ms\":%.1f,\"event_latency_max_ms\":%lu,"
+           "\"posts\":%lu,\"publishes\":%lu,\"datagrams\":%lu,\"retransmissions\":%lu,\"failed_posts\":%lu,"
+           "\"uplink_bytes\":%llu,",
+           (unsigned long)uplink.enqueued, (unsigned long)uplink.sent, (unsigned long)uplink.dropped,
+           (unsigned long)uplink.spilled, (unsigned long)uplink.coalesced, simSeconds > 0 ? uplink.enqueued / simSeconds : 0.0,
+           uplink.latencySamples ? (double)uplink.latencyTotalMs / uplink.latencySamples : 0.0,
+           (unsigned long)uplink.latencyMaxMs, (unsigned long)network.posts, (unsigned long)network.publishes,
+           (unsigned long)network.datagrams,
+           (unsigned long)(coapTransport ? coapTransport->retransmissionCount() : 0), (unsigned long)uplink.failedPosts,
+           (unsigned long long)network.bytes);
+    const MetricHistogram& posts = eventSender.postLatencyHistogram();
+    uint32_t postCount = 0;
+    for (size_t i = 0; i <= MetricHistogram::BUCKETS; i++) {
+        postCount += posts.bucketCount(i);
+    }
+    printf("\"scan\":\"%s\",\"scan_cycles\":{", options.scan);
+    for (size_t i = 0; i < SCAN_MODE_COUNT; i++) {
+        printf("%s\"%s\":%lu", i > 0 ? "," : "", ScanScheduler::modeName((ScanMode)i),
+               (unsigned long)scanScheduler.cycleCount((ScanMode)i));
+    }
+    printf("},\"scan_listen_ratio\":%.4f,\"wifi_window_s\":%.1f,\"advertisements_missed\":%lu,"
+           "\"hw_dedup\":%s,\"advertisements_duplicate\":%lu,\"post_duration_mean_ms\":%.2f,",
+           simSeconds > 0 ? scanScheduler.listenTimeMs() / (1000.0 * simSeconds) : 0.0,
+           scanScheduler.wifiWindowTimeMs() / 1000.0, (unsigned long)simMissedAdvertisements(),
+           options.duplicateFilter ? "true" : "false", (unsigned long)simDuplicateAdvertisements(),
+           postCount ? (double)posts.total() / postCount : 0.0);
+    printf("\"poll_requests\":%lu,\"poll_bytes_mean\":%.1f,\"poll_records_mean\":%.2f,\"poll_snapshot_bytes\":%lu,"
+           "\"poll_snapshot_records\":%lu,\"poll_resets\":%lu,\"poll_timeouts\":%lu,\"poll_mismatches\":%lu,",
+           (unsigned long)pollClient.requests, pollClient.requests ? (double)pollClient.bytes / pollClient.requests : 0.0,
+           pollClient.requests ? (double)pollClient.records / pollClient.requests : 0.0,
+           (unsigned long)pollClient.snapshotBytes, (unsigned long)pollClient.snapshotRecords,
+           (unsigned long)pollClient.resets, (unsigned long)pollClient.timeouts, (unsigned long)pollClient.mismatches);
+    printf("\"ws_subscribers\":%lu,\"ws_events\":%lu,\"ws_dropped\":%lu,\"ws_events_per_subscriber\":%ld,"
+           "\"ws_bytes\":%llu,\"ws_wakeups\":%lu,",
+           (unsigned long)options.wsSubscribers, (unsigned long)eventPush.messages(), (unsigned long)eventPush.dropped(),
+           wsMessagesPerSubscriber(options) == UINT32_MAX ? -1L : (long)wsMessagesPerSubscriber(options),
+           (unsigned long long)wsClients.bytes, (unsigned long)wsClients.wakeups);
+
+    if (options.bench) {
+        printLatency("advertisement_ns", bench.advertisement);
+        printLatency("rejected_ns", bench.rejected);
+        printLatency("departure_check_ns", bench.departureCheck);
+        printLatency("uplink_step_ns", bench.uplink);
+        printLatency("poll_ns", bench.poll);
+        uint64_t advertisements = bench.advertisement.count();
+        printf("\"advertisements_per_wall_second\":%.0f,\"events_per_wall_second\":%.0f,"
+               "\"allocations_per_advertisement\":%.4f,\"allocations_per_event\":%.3f,",
+               wallSeconds > 0 ? advertisements / wallSeconds : 0.0,
+               wallSeconds > 0 ? uplink.enqueued / wallSeconds : 0.0,
+               advertisements ? (double)bench.advertisementAllocations / advertisements : 0.0,
+               uplink.enqueued ? (double)bench.uplinkAllocations / uplink.enqueued : 0.0);
+        printf("\"heap_peak_bytes\":%llu,\"static_bytes\":%lu,",
+               (unsigned long long)(allocStats().peakBytes - heapBaseline),
+               (unsigned long)(sizeof(tracker) + sizeof(eventSender)));
+    }
+    printf("\"bench\":%s}\n", options.bench ? "true" : "false");
+}
+
+// Plan du prochain cycle de scan, comme la tâche bleScan du firmware
+static ScanPlan planScan() {
+    uint32_t pending = eventSender.isConnected() ? eventSender.getQueueSize() : 0;
+    ScanPlan plan = scanScheduler.plan(halMillis(), tracker.advertisementsReceived(), tracker.presentCount(), pending);
+    halRadio().configure(plan.intervalMs, plan.windowMs, plan.active);
+    return plan;
+}
+
+// Tâche de scan du mode --threads
+static void scanTask(void*) {
+    for (;;) {
+        ScanPlan plan = planScan();
+        halRadio().scan(plan.scanMs);
+        if (plan.pauseMs > 0) {
+            halDelay(plan.pauseMs);
+        }
+    }
+}
+
+// Tâche radio du mode --threads : remet chaque annonce à son heure, comme
+// la pile Bluetooth
+struct RadioTaskState {
+    AdvSource* source;
+    std::atomic<uint32_t> lastAdvertisement;
+    std::atomic<bool> done;
+
+    explicit RadioTaskState(AdvSource* source) : source(source), lastAdvertisement(0), done(false) {}
+};
+
+static void radioTask(void* parameter) {
+    RadioTaskState& state = *static_cast<RadioTaskState*>(parameter);
+    AdvRecord record;
+    while (state.source->next(record)) {
+        simAdvanceTo(record.timestamp);
+        simDeliverAdvertisement(record);
+        state.lastAdvertisement = record.timestamp;
+    }
+    state.done = true;
+}
+
+// Mode --threads : les tâches tournent seules, ce fil attend la fin du flux
+// puis le départ des derniers beacons et la vidange de la file d'envoi
+static void runThreaded(const SimOptions& options, AdvSource& source) {
+    RadioTaskState radio(&source);
+    tracker.startTask(5000);
+    if (strcmp(options.scan, "off") != 0) {
+        xTaskCreatePinnedToCore(scanTask, "scan", 4096, NULL, 1, NULL, RADIO_CORE);
+    }
+    xTaskCreatePinnedToCore(radioTask, "bleScan", 4096, &radio, 1, NULL, RADIO_CORE);
+
+    while (!radio.done) {
+        halDelay(options.pollMs > 0 ? options.pollMs : 100);
+        if (options.pollMs > 0) {
+            pollBeacons(options);
+        }
+    }
+    uint32_t last = radio.lastAdvertisement > options.durationMs ? radio.lastAdvertisement.load() : options.durationMs;
+    simAdvanceTo(last + BEACON_TIMEOUT + TIMER_WHEEL_TICK + EVENT_FLUSH_INTERVAL + TRACKER_TICK);
+
+    uint32_t deadline = halMillis() + UPLINK_RETRY_MAX;
+    while (eventSender.getQueueSize() > 0 && (int32_t)(halMillis() - deadline) < 0) {
+        halDelay(TRACKER_TICK);
+    }
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!options.replayPath && options.durationMs == 0) {
+        options.durationMs = 600000;
+    }
+
+    if (options.dataDir) {
+        if ((mkdir(options.dataDir, 0755) != 0 && errno != EEXIST) || chdir(options.dataDir) != 0) {
+            fprintf(stderr, "Répertoire de données inaccessible : %s\n", options.dataDir);
+            return 1;
+        }
+    }
+    if (!options.keepSpool) {
+        remove(STORAGE_ROOT "/" SPOOL_PARTITION ".bin");
+    }
+
+    std::unique_ptr<AdvSource> source;
+    if (options.replayPath) {
+        ReplayAdvSource* replay = new ReplayAdvSource();
+        source.reset(replay);
+        if (!replay->open(options.replayPath)) {
+            fprintf(stderr, "Impossible d'ouvrir %s\n", options.replayPath);
+            return 1;
+        }
+    } else {
+        SyntheticConfig config = {options.beacons, options.durationMs, options.intervalMs, options.rssiJitter,
+                                  options.churnPerHour, options.lossPercent, options.fadingDb, options.seed};
+        source.reset(new SyntheticAdvSource(config));
+    }
+
+    // Publication directe au courtier, intégré ou réel
+    std::unique_ptr<MqttTransport> mqtt;
+    if (usesTransport(options, "mqtt")) {
+        mqtt.reset(new MqttTransport(options.brokerHost ? options.brokerHost : "127.0.0.1", options.brokerPort));
+        eventSender.setTransport(*mqtt);
+        simUseRealBroker(options.brokerHost != nullptr);
+    }
+
+    // POST au serveur CoAP, intégré ou réel
+    std::unique_ptr<CoapTransport> coap;
+    if (usesTransport(options, "coap")) {
+        coap.reset(new CoapTransport(options.coapHost ? options.coapHost : "127.0.0.1", options.coapPort,
+                                     strcmp(options.transport, "coap") == 0));
+        coapTransport = coap.get();
+        eventSender.setTransport(*coap);
+        simUseRealCoapServer(options.coapHost != nullptr);
+    }
+
+    // Tas du pipeline seul : le générateur d'annonces est exclu
+    resetPeakBytes();
+    heapBaseline = allocStats().liveBytes;
+
+    Serial.enabled = !options.quiet;
+    simSetDuplicateFilter(options.duplicateFilter);
+    if (options.threads) {
+        simStartThreads(options.speed); // Avant la création des tâches
+    }
+    logBegin();
+    if (options.wsSubscribers > 0) {
+        eventPush.setNotify(notifyWs);
+        eventSender.setPush(eventPush);
+        for (uint32_t i = 0; i < options.wsSubscribers; i++) {
+            eventPush.subscribe(i);
+        }
+    }
+    eventSender.init();
+    halRadio().begin([](const AdvRecord& record) { tracker.onAdvertisement(record); });
+
+    uint64_t wallStart = benchNanos();
+    if (options.threads) {
+        runThreaded(options, *source);
+    }
+
+    // Boucle à échéances : prochaine annonce, prochaine vérification des
+    // départs ou prochaine étape de la tâche réseau
+    AdvRecord pending;
+    bool hasPending = source->next(pending);
+    uint32_t lastAdvertisement = 0;
+    uint32_t nextTick = 0;
+    uint32_t nextUplink = 0;
+    uint32_t nextPoll = options.pollMs > 0 ? options.pollMs : UINT32_MAX;
+    uint32_t nextScan = strcmp(options.scan, "off") != 0 ? 0 : UINT32_MAX;
+    uint32_t end = UINT32_MAX;
+    uint32_t drainLimit = UINT32_MAX;
+
+    while (!options.threads) {
+        uint32_t now = halMillis();
+        if (!hasPending && end == UINT32_MAX) {
+            // Laisser partir les derniers beacons et se vider la file d'envoi
+            uint32_t last = lastAdvertisement > options.durationMs ? lastAdvertisement : options.durationMs;
+            end = last + BEACON_TIMEOUT + TIMER_WHEEL_TICK + EVENT_FLUSH_INTERVAL + options.tickMs;
+            drainLimit = end + UPLINK_RETRY_MAX;
+        }
+        if (now >= end) {
+            // Dernier lot retardé par un envoi lent (blocs CoAP...) : un
+            // délai de regroupement de plus, dans la limite de drainLimit
+            if (eventSender.getQueueSize() == 0 || now >= drainLimit) {
+                break;
+            }
+            end = now + EVENT_FLUSH_INTERVAL < drainLimit ? now + EVENT_FLUSH_INTERVAL : drainLimit;
+        }
+
+        uint32_t target = nextTick < nextUplink ? nextTick : nextUplink;
+        if (nextPoll < target) {
+            target = nextPoll;
+        }
+        if (nextScan < target) {
+            target = nextScan;
+        }
+        if (hasPending && pending.timestamp < target) {
+            target = pending.timestamp;
+        }
+        if (target > end) {
+            target = end;
+        }
+        simAdvanceTo(target);
+        now = halMillis();
+
+        // Annonces reçues jusqu'ici, remises comme par la pile Bluetooth
+        while (hasPending && pending.timestamp <= now) {
+            lastAdvertisement = pending.timestamp;
+            if (options.bench) {
+                uint64_t allocations = allocStats().allocations;
+                uint32_t filtered = tracker.advertisementsFiltered();
+                uint64_t start = benchNanos();
+                simDeliverAdvertisement(pending);
+                tracker.processAdvertisements();
+                uint64_t elapsed = benchNanos() - start;
+                bench.advertisement.record(elapsed);
+                if (tracker.advertisementsFiltered() != filtered) {
+                    bench.rejected.record(elapsed);
+                }
+                bench.advertisementAllocations += allocStats().allocations - allocations;
+            } else {
+                simDeliverAdvertisement(pending);
+            }
+            hasPending = source->next(pending);
+        }
+
+        // Équivalent de la tâche bleScan : un cycle de scan, puis la radio
+        // laissée au WiFi pendant pauseMs
+        if (now >= nextScan) {
+            ScanPlan plan = planScan();
+            simStartScan(plan.scanMs);
+            nextScan = now + plan.scanMs + plan.pauseMs;
+        }
+
+        // Équivalent de loop() sur l'ESP32
+        tracker.processAdvertisements();
+        if (now >= nextTick) {
+            uint64_t start = benchNanos();
+            tracker.checkForDepartedBeacons();
+            if (options.bench) {
+                bench.departureCheck.record(benchNanos() - start);
+            }
+            tracker.displayScanSummary(5000);
+            nextTick = now + options.tickMs;
+        }
+
+        // La tâche réseau se réveille à son échéance ou quand un événement
+        // arrive dans la file
+        if (now >= nextUplink || eventSender.getQueueSize() > 0) {
+            uint64_t allocations = allocStats().allocations;
+            uint64_t start = benchNanos();
+            uint32_t wait = eventSender.service();
+            if (options.bench) {
+                bench.uplink.record(benchNanos() - start);
+                bench.uplinkAllocations += allocStats().allocations - allocations;
+            }
+            nextUplink = wait == UPLINK_IDLE ? UINT32_MAX : halMillis() + wait;
+        }
+
+        // Client du tableau de bord, sur la tâche du serveur web
+        if (now >= nextPoll) {
+            pollBeacons(options);
+            nextPoll = now + options.pollMs;
+        }
+
+        // Abonnés de /ws, sur la tâche du serveur web
+        serveWs();
+
+        // Équivalent de la tâche d'écriture du journal
+        logFlush();
+    }
+
+    if (options.pollMs > 0) {
+        checkPollClient(options);
+    }
+
+    double wallSeconds = (benchNanos() - wallStart) / 1e9;
+    if (options.json) {
+        printJson(options, wallSeconds);
+    } else {
+        printSummary(options, wallSeconds);
+    }
+    if (options.metrics) {
+        String page;
+        writeMetrics(page, tracker, eventSender, scanScheduler);
+        fputs(page.c_str(), stdout);
+    }
+    if (options.threads) {
+        // Les tâches ne se terminent pas : sortie sans destructeurs globaux
+        fflush(stdout);
+        _exit(0);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TRANSPORT_FIXTURE_H
+#define TRANSPORT_FIXTURE_H
+
+// Montage commun aux tests des transports (test_mqtt_transport,
+// test_coap_block1) : réseau simulé sans coupure ni perte, et un lot
+// d'événements qui alterne arrivées et départs
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "Hal.h"
+#include "PendingEvent.h"
+#include "sim/SimHal.h"
+
+// Réponses du serveur après postLatencyMs, WiFi connecté
+inline void setUpNetwork(uint32_t postLatencyMs) {
+    SimNetworkConfig& config = simNetworkConfig();
+    config.connectDelayMs = 0;
+    config.postLatencyMs = postLatencyMs;
+    config.outageStartMs = 0;
+    config.outageEndMs = 0;
+    config.statusCode = 200;
+    config.datagramLossPercent = 0;
+    halNetwork().connect("ssid", "password");
+    halDelay(1);
+    TEST_ASSERT_TRUE(halNetwork().connected());
+}
+
+// Beacon c0:00:00:00:00:<i>, nommé Tag-<i>, horodaté maintenant
+inline void fillEvents(PendingEvent* events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        PendingEvent& event = events[i];
+        memset(&event, 0, sizeof(event));
+        event.eventType = i % 2 ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+        event.beacon.address[0] = 0xC0;
+        event.beacon.address[5] = (uint8_t)i;
+        snprintf(event.beacon.name, sizeof(event.beacon.name), "Tag-%02u", (unsigned)i);
+        strcpy(event.beacon.uuid, "N/A");
+        event.beacon.rssi = -70;
+        event.timestamp = halMillis();
+        event.receivedAt = event.timestamp;
+        event.traceId = (uint32_t)i;
+    }
+}
+
+#endif
@@ -0,0 +1,377 @@
+// Filtre des annonces (AdvFilter) : texte de configuration refusé (mot
+// inconnu, UUID ou préfixe mal formé, ligne trop longue, trop de règles),
+// verdicts sur l'UUID, les plages major/minor, le préfixe OUI et le seuil
+// de RSSI, puis règles et annonces aléatoires comparées à une recherche
+// linéaire sans masque du premier octet ni tableaux triés.
+// pio test -e native -f test_adv_filter
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "AdvFilter.h"
+
+static AdvFilter filter;
+static char error[96];
+
+void setUp() {
+    filter.clear();
+    error[0] = '\0';
+}
+
+void tearDown() {}
+
+static bool parse(const std::string& text) {
+    return filter.parse(text.c_str(), error, sizeof(error));
+}
+
+static AdvRecord record(const uint8_t address[6], int8_t rssi) {
+    AdvRecord result;
+    memset(&result, 0, sizeof(result));
+    memcpy(result.address, address, 6);
+    result.rssi = rssi;
+    return result;
+}
+
+static ParsedAdvertisement frame(BeaconFrameType type, const uint8_t uuid[16], uint16_t major, uint16_t minor) {
+    ParsedAdvertisement adv;
+    memset(&adv, 0, sizeof(adv));
+    adv.frameType = type;
+    if (uuid) {
+        memcpy(adv.beaconUUID, uuid, 16);
+    }
+    adv.major = major;
+    adv.minor = minor;
+    return adv;
+}
+
+// Les deux étapes, comme BeaconTracker::handleAdvertisement
+static bool accept(const AdvRecord& rec, const ParsedAdvertisement& adv) {
+    AdvFilterVerdict verdict = filter.checkAddress(rec);
+    return verdict != FILTER_REJECT && filter.checkFrame(adv, verdict);
+}
+
+static const uint8_t UUID_A[16] = {0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9,
+                                   0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1};
+static const uint8_t UUID_B[16] = {0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91, 0x92,
+                                   0x93, 0x94, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07};
+static const uint8_t ADDRESS_ALLOWED[6] = {0xD0, 0x5E, 0x00, 0x11, 0x22, 0x33};
+static const uint8_t ADDRESS_DENIED[6] = {0x00, 0x1A, 0x7D, 0x11, 0x22, 0x33};
+static const uint8_t ADDRESS_OTHER[6] = {0xD0, 0x5F, 0x00, 0x11, 0x22, 0x33};
+
+static void assertRejected(const std::string& text, const char* expected) {
+    TEST_ASSERT_FALSE_MESSAGE(parse(text), text.c_str());
+    TEST_ASSERT_NOT_NULL_MESSAGE(strstr(error, expected), error);
+}
+
+static void test_malformed_rules_are_rejected() {
+    assertRejected("allow uuid E2E3", "ligne 1 : UUID invalide");
+    assertRejected("# commentaire\n\nallow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2", "ligne 3 : UUID invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0FZ", "UUID invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F", "UUID invalide");
+    assertRejected("allow oui D0:5E", "préfixe OUI invalide");
+    assertRejected("allow oui D0:5E:00:01", "préfixe OUI invalide");
+    assertRejected("allow", "règle incomplète");
+    assertRejected("deny oui", "règle incomplète");
+    assertRejected("permit oui D0:5E:00", "\"permit\" inconnu");
+    assertRejected("allow mac D0:5E:00", "\"mac\" inconnu (uuid ou oui)");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1 major", "plage major/minor invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1 major 5-2", "plage major/minor invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1 minor 0-65536", "plage major/minor invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1 minor 1x", "plage major/minor invalide");
+    assertRejected("allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1 power 1", "plage major/minor invalide");
+    assertRejected("rssi-floor", "seuil de RSSI invalide");
+    assertRejected("rssi-floor -90dB", "seuil de RSSI invalide");
+    assertRejected("rssi-floor 1", "seuil de RSSI invalide");
+    assertRejected("rssi-floor -129", "seuil de RSSI invalide");
+}
+
+// Une ligne de 160 caractères ou plus est refusée, commentaire compris
+static void test_too_long_line_is_rejected() {
+    std::string line = "allow oui D0:5E:00 #";
+    TEST_ASSERT_TRUE(parse(line + std::string(159 - line.size(), 'x')));
+    assertRejected("rssi-floor -90\n" + line + std::string(160 - line.size(), 'x'), "ligne 2 : trop longue");
+}
+
+static void test_too_many_rules_are_rejected() {
+    std::string ouis, uuids;
+    for (int i = 0; i <= ADV_FILTER_MAX_RULES; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "deny oui 00:1A:%02X\n", i);
+        ouis += line;
+        snprintf(line, sizeof(line), "allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEF00%02X\n", i);
+        uuids += line;
+    }
+    size_t lastLine = ouis.rfind("deny");
+    TEST_ASSERT_TRUE(parse(ouis.substr(0, lastLine)));
+    assertRejected(ouis, "plus de 16 préfixes");
+    TEST_ASSERT_TRUE(parse(uuids.substr(0, uuids.rfind("allow"))));
+    assertRejected(uuids, "plus de 16 UUID");
+
+    // Les listes allow et deny ont chacune leur capacité
+    std::string both = ouis.substr(0, lastLine);
+    for (int i = 0; i < ADV_FILTER_MAX_RULES; i++) {
+        char line[32];
+        snprintf(line, sizeof(line), "allow oui D0:5E:%02X\n", i);
+        both += line;
+    }
+    TEST_ASSERT_TRUE(parse(both));
+}
+
+// Un texte refusé laisse les règles précédentes en place
+static void test_failed_parse_keeps_previous_rules() {
+    uint8_t address[6];
+    memcpy(address, ADDRESS_DENIED, 6);
+    ParsedAdvertisement adv = frame(FRAME_NONE, nullptr, 0, 0);
+    TEST_ASSERT_TRUE(parse("deny oui 00:1A:7D"));
+    TEST_ASSERT_FALSE(accept(record(address, -60), adv));
+
+    TEST_ASSERT_FALSE(parse("allow oui D0:5E:00\nallow uuid 12"));
+    TEST_ASSERT_TRUE(filter.isActive());
+    TEST_ASSERT_FALSE(accept(record(address, -60), adv));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, -60), adv));
+
+    TEST_ASSERT_TRUE(parse("# rien\n\n"));
+    TEST_ASSERT_FALSE(filter.isActive());
+}
+
+static void test_uuid_and_major_minor() {
+    TEST_ASSERT_TRUE(parse("allow uuid E2E3E4E5-E6E7-E8E9-EAEB-ECEDEEEFF0F1 major 1-2 minor 10\n"
+                           "allow uuid e2e3e4e5e6e7e8e9eaebecedeeeff0f1 major 7\n"
+                           "allow uuid 8B8C8D8E8F9091929394000000000007"));
+    TEST_ASSERT_TRUE(filter.isActive());
+
+    // Première étape : rien ne permet de décider sans la trame
+    TEST_ASSERT_EQUAL_INT(FILTER_CHECK_FRAME, filter.checkAddress(record(ADDRESS_OTHER, -60)));
+
+    AdvRecord rec = record(ADDRESS_OTHER, -60);
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_IBEACON, UUID_A, 1, 10)));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_ALTBEACON, UUID_A, 2, 10)));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_IBEACON, UUID_A, 7, 65535)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, UUID_A, 0, 10)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, UUID_A, 3, 10)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, UUID_A, 1, 11)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, UUID_A, 8, 10)));
+
+    // Eddystone-UID : seules les règles sans plage s'appliquent
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_EDDYSTONE_UID, UUID_A, 1, 10)));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_EDDYSTONE_UID, UUID_B, 0, 0)));
+
+    // Trames sans UUID, ou UUID d'un autre beacon
+    uint8_t other[16];
+    memcpy(other, UUID_A, 16);
+    other[15] ^= 1;
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, other, 1, 10)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_EDDYSTONE_URL, UUID_A, 1, 10)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_NONE, nullptr, 0, 0)));
+}
+
+static void test_deny_uuid_wins_over_allow_oui() {
+    TEST_ASSERT_TRUE(parse("allow oui D0:5E:00\n"
+                           "deny uuid 8B8C8D8E8F9091929394000000000007 minor 5-6"));
+    AdvRecord rec = record(ADDRESS_ALLOWED, -60);
+    TEST_ASSERT_EQUAL_INT(FILTER_ADDRESS_ALLOWED, filter.checkAddress(rec));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_IBEACON, UUID_B, 0, 4)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_IBEACON, UUID_B, 0, 5)));
+    TEST_ASSERT_FALSE(accept(rec, frame(FRAME_ALTBEACON, UUID_B, 9, 6)));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_EDDYSTONE_UID, UUID_B, 0, 5)));
+    TEST_ASSERT_TRUE(accept(rec, frame(FRAME_EDDYSTONE_TLM, nullptr, 0, 0)));
+
+    // Hors de la liste allow (préfixe seul, sans règle uuid) : refusé d'emblée
+    TEST_ASSERT_EQUAL_INT(FILTER_REJECT, filter.checkAddress(record(ADDRESS_OTHER, -60)));
+}
+
+static void test_oui_prefixes() {
+    TEST_ASSERT_TRUE(parse("allow oui D0-5E-00\n"
+                           "allow uuid E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1\n"
+                           "deny oui 00:1a:7d"));
+    ParsedAdvertisement named = frame(FRAME_NONE, nullptr, 0, 0);
+    ParsedAdvertisement tagged = frame(FRAME_IBEACON, UUID_A, 3, 4);
+    TEST_ASSERT_EQUAL_INT(FILTER_ADDRESS_ALLOWED, filter.checkAddress(record(ADDRESS_ALLOWED, -60)));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_ALLOWED, -60), named));
+    TEST_ASSERT_EQUAL_INT(FILTER_REJECT, filter.checkAddress(record(ADDRESS_DENIED, -60)));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_DENIED, -60), tagged));
+
+    // Même premier octet qu'un préfixe autorisé : le masque laisse passer,
+    // la recherche dichotomique tranche
+    TEST_ASSERT_EQUAL_INT(FILTER_CHECK_FRAME, filter.checkAddress(record(ADDRESS_OTHER, -60)));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_OTHER, -60), named));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, -60), tagged));
+}
+
+static void test_rssi_floor_boundaries() {
+    ParsedAdvertisement adv = frame(FRAME_NONE, nullptr, 0, 0);
+    TEST_ASSERT_TRUE(parse("rssi-floor -90"));
+    TEST_ASSERT_TRUE(filter.isActive());
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, -90), adv));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, -20), adv));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_OTHER, -91), adv));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_OTHER, -128), adv));
+
+    TEST_ASSERT_TRUE(parse("rssi-floor 0"));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, 0), adv));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_OTHER, -1), adv));
+
+    TEST_ASSERT_TRUE(parse("rssi-floor -128"));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_OTHER, -128), adv));
+
+    // Le seuil s'applique aussi aux préfixes autorisés
+    TEST_ASSERT_TRUE(parse("rssi-floor -70\nallow oui D0:5E:00"));
+    TEST_ASSERT_TRUE(accept(record(ADDRESS_ALLOWED, -70), adv));
+    TEST_ASSERT_FALSE(accept(record(ADDRESS_ALLOWED, -71), adv));
+}
+
+// Référence : les règles dans l'ordre du texte, parcourues une à une
+struct ReferenceRule {
+    bool allow;
+    bool isUuid;
+    uint8_t bytes[16];
+    uint16_t majorMin, majorMax, minorMin, minorMax;
+};
+
+struct ReferenceFilter {
+    std::vector<ReferenceRule> rules;
+    int rssiFloor = -128;
+
+    bool matches(const ReferenceRule& rule, const AdvRecord& rec, const ParsedAdvertisement& adv) const {
+        if (!rule.isUuid) {
+            return memcmp(rule.bytes, rec.address, 3) == 0;
+        }
+        if (adv.frameType == FRAME_EDDYSTONE_UID) {
+            return memcmp(rule.bytes, adv.beaconUUID, 16) == 0 && rule.majorMin == 0 && rule.majorMax == 0xFFFF &&
+                   rule.minorMin == 0 && rule.minorMax == 0xFFFF;
+        }
+        return (adv.frameType == FRAME_IBEACON || adv.frameType == FRAME_ALTBEACON) &&
+               memcmp(rule.bytes, adv.beaconUUID, 16) == 0 && adv.major >= rule.majorMin &&
+               adv.major <= rule.majorMax && adv.minor >= rule.minorMin && adv.minor <= rule.minorMax;
+    }
+
+    bool accept(const AdvRecord& rec, const ParsedAdvertisement& adv) const {
+        if (rec.rssi < rssiFloor) {
+            return false;
+        }
+        bool hasAllow = false, allowed = false;
+        for (const ReferenceRule& rule : rules) {
+            bool match = matches(rule, rec, adv);
+            if (!rule.allow && match) {
+                return false;
+            }
+            hasAllow |= rule.allow;
+            allowed |= rule.allow && match;
+        }
+        return !hasAllow || allowed;
+    }
+};
+
+static uint32_t randomState = 1;
+
+// xorshift32
+static uint32_t nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+// Premiers octets tirés parmi quatre : le masque laisse passer beaucoup
+// d'annonces qui ne vérifient pourtant aucune règle
+static uint8_t randomByte(bool clustered) {
+    static const uint8_t FIRST[] = {0x00, 0x5E, 0xD0, 0xFF};
+    return clustered ? FIRST[nextRandom() % 4] : (uint8_t)(nextRandom() % 3);
+}
+
+static uint16_t randomShort() {
+    return (uint16_t)(nextRandom() % 8);
+}
+
+static void test_random_rules_match_reference() {
+    const uint32_t configurations = 2000;
+    const uint32_t advertisements = 500;
+    uint32_t accepted = 0, total = 0;
+
+    for (uint32_t c = 0; c < configurations; c++) {
+        ReferenceFilter reference;
+        std::string text;
+        char line[128];
+        if (nextRandom() % 4 == 0) {
+            reference.rssiFloor = -(int)(nextRandom() % 100);
+            snprintf(line, sizeof(line), "rssi-floor %d\n", reference.rssiFloor);
+            text += line;
+        }
+        uint32_t ruleCount = nextRandom() % 12;
+        for (uint32_t r = 0; r < ruleCount; r++) {
+            ReferenceRule rule;
+            rule.allow = nextRandom() % 3 != 0;
+            rule.isUuid = nextRandom() % 2 == 0;
+            rule.majorMin = 0;
+            rule.majorMax = 0xFFFF;
+            rule.minorMin = 0;
+            rule.minorMax = 0xFFFF;
+            for (size_t i = 0; i < 16; i++) {
+                rule.bytes[i] = randomByte(i == 0);
+            }
+            int n = snprintf(line, sizeof(line), "%s %s ", rule.allow ? "allow" : "deny", rule.isUuid ? "uuid" : "oui");
+            for (size_t i = 0; i < (rule.isUuid ? 16u : 3u); i++) {
+                n += snprintf(line + n, sizeof(line) - n, i ? ":%02X" : "%02X", rule.bytes[i]);
+            }
+            if (rule.isUuid && nextRandom() % 2) {
+                rule.majorMin = randomShort();
+                rule.majorMax = rule.majorMin + randomShort();
+                n += snprintf(line + n, sizeof(line) - n, " major %u-%u", rule.majorMin, rule.majorMax);
+            }
+            if (rule.isUuid && nextRandom() % 2) {
+                rule.minorMin = rule.minorMax = randomShort();
+                n += snprintf(line + n, sizeof(line) - n, " minor %u", rule.minorMin);
+            }
+            snprintf(line + n, sizeof(line) - n, "\n");
+            text += line;
+            reference.rules.push_back(rule);
+        }
+        TEST_ASSERT_TRUE_MESSAGE(parse(text), error);
+
+        for (uint32_t a = 0; a < advertisements; a++) {
+            uint8_t address[6];
+            uint8_t uuid[16];
+            for (size_t i = 0; i < 6; i++) {
+                address[i] = randomByte(i == 0);
+            }
+            for (size_t i = 0; i < 16; i++) {
+                uuid[i] = randomByte(i == 0);
+            }
+            static const BeaconFrameType TYPES[] = {FRAME_IBEACON, FRAME_ALTBEACON, FRAME_EDDYSTONE_UID,
+                                                    FRAME_EDDYSTONE_URL, FRAME_NONE};
+            AdvRecord rec = record(address, (int8_t)-(int)(nextRandom() % 100));
+            ParsedAdvertisement adv = frame(TYPES[nextRandom() % 5], uuid, randomShort(), randomShort());
+
+            bool expected = reference.accept(rec, adv);
+            if (expected != accept(rec, adv)) {
+                char message[160];
+                snprintf(message, sizeof(message), "configuration %lu, annonce %lu, attendu %d",
+                         (unsigned long)c, (unsigned long)a, expected);
+                TEST_FAIL_MESSAGE(message);
+            }
+            accepted += expected ? 1 : 0;
+            total++;
+        }
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu annonces, %lu acceptées", (unsigned long)total, (unsigned long)accepted);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(accepted > total / 20 && accepted < total - total / 20);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_malformed_rules_are_rejected);
+    RUN_TEST(test_too_long_line_is_rejected);
+    RUN_TEST(test_too_many_rules_are_rejected);
+    RUN_TEST(test_failed_parse_keeps_previous_rules);
+    RUN_TEST(test_uuid_and_major_minor);
+    RUN_TEST(test_deny_uuid_wins_over_allow_oui);
+    RUN_TEST(test_oui_prefixes);
+    RUN_TEST(test_rssi_floor_boundaries);
+    RUN_TEST(test_random_rules_match_reference);
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+// Décodeur des annonces (AdvParser) : trames iBeacon, AltBeacon et
+// Eddystone (UID, URL, TLM), nom et UUID de service, structure AD tronquée,
+// puis annonces aléatoires ou dérivées de trames valides. Chaque annonce
+// est copiée dans un tampon de sa taille exacte : compilé avec
+//   build_flags = -fsanitize=address,undefined
+// une lecture hors de l'annonce est signalée. Sans eux, le test vérifie que
+// le nom et l'URL rendus restent dans l'annonce. Enfin, coût du décodage
+// d'une trame iBeacon.
+// pio test -e native -f test_adv_parser
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "AdvParser.h"
+#include "sim/Bench.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint8_t IBEACON[] = {
+    0x02, 0x01, 0x06,
+    0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15,
+    0xE2, 0xC5, 0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2, 0xB0, 0x60, 0xD0, 0xF5, 0xA7, 0x10, 0x96, 0xE0,
+    0x00, 0x01, 0x00, 0x02, 0xC5
+};
+
+static const uint8_t ALTBEACON[] = {
+    0x1B, 0xFF, 0x18, 0x01, 0xBE, 0xAC,
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+    0x00, 0x07, 0x00, 0x08, 0xBC, 0x00
+};
+
+static const uint8_t EDDYSTONE_UID[] = {
+    0x03, 0x03, 0xAA, 0xFE,
+    0x17, 0x16, 0xAA, 0xFE, 0x00, 0xEC,
+    0x8B, 0x0C, 0xA7, 0x50, 0xE9, 0x03, 0x05, 0x69, 0x31, 0x6F,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x2A, 0x00, 0x00
+};
+
+// https://example.com/
+static const uint8_t EDDYSTONE_URL[] = {
+    0x03, 0x03, 0xAA, 0xFE,
+    0x0E, 0x16, 0xAA, 0xFE, 0x10, 0xEB, 0x03, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x00
+};
+
+static const uint8_t EDDYSTONE_TLM[] = {
+    0x11, 0x16, 0xAA, 0xFE, 0x20, 0x00,
+    0x0B, 0xB8, 0x16, 0x80, 0x00, 0x00, 0x30, 0x39, 0x00, 0x01, 0x86, 0xA0
+};
+
+// Nom abrégé puis complet, UUID de service 16 bits, remplissage final
+static const uint8_t NAMED[] = {
+    0x04, 0x08, 'T', 'a', 'g',
+    0x03, 0x03, 0x0F, 0x18,
+    0x06, 0x09, 'T', 'a', 'g', '-', '1',
+    0x00, 0x00, 0x00
+};
+
+// Copie dans un tampon de la taille exacte de l'annonce
+static bool parse(const uint8_t* payload, size_t length, ParsedAdvertisement& adv) {
+    std::vector<uint8_t> exact(payload, payload + length);
+    bool ok = parseAdvertisement(exact.data(), exact.size(), adv);
+    adv.name = adv.name ? payload + (adv.name - exact.data()) : nullptr;
+    adv.url = adv.url ? payload + (adv.url - exact.data()) : nullptr;
+    return ok;
+}
+
+static void test_ibeacon() {
+    ParsedAdvertisement adv;
+    TEST_ASSERT_TRUE(parse(IBEACON, sizeof(IBEACON), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_IBEACON, adv.frameType);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(IBEACON + 9, adv.beaconUUID, 16);
+    TEST_ASSERT_EQUAL_UINT16(1, adv.major);
+    TEST_ASSERT_EQUAL_UINT16(2, adv.minor);
+    TEST_ASSERT_EQUAL_INT8(-59, adv.txPower);
+    TEST_ASSERT_FALSE(adv.hasServiceUUID);
+    TEST_ASSERT_NULL(adv.name);
+}
+
+static void test_altbeacon() {
+    ParsedAdvertisement adv;
+    TEST_ASSERT_TRUE(parse(ALTBEACON, sizeof(ALTBEACON), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_ALTBEACON, adv.frameType);
+    TEST_ASSERT_EQUAL_HEX16(0x0118, adv.manufacturerId);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ALTBEACON + 6, adv.beaconUUID, 16);
+    TEST_ASSERT_EQUAL_UINT16(7, adv.major);
+    TEST_ASSERT_EQUAL_UINT16(8, adv.minor);
+    TEST_ASSERT_EQUAL_INT8(-68, adv.txPower);
+}
+
+static void test_eddystone_frames() {
+    ParsedAdvertisement adv;
+    TEST_ASSERT_TRUE(parse(EDDYSTONE_UID, sizeof(EDDYSTONE_UID), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_EDDYSTONE_UID, adv.frameType);
+    TEST_ASSERT_EQUAL_INT8(-20, adv.txPower);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(EDDYSTONE_UID + 10, adv.beaconUUID, 16);
+    TEST_ASSERT_TRUE(adv.hasServiceUUID);
+    TEST_ASSERT_EQUAL_HEX8(0xFE, adv.serviceUUID[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, adv.serviceUUID[3]);
+
+    char url[64];
+    TEST_ASSERT_TRUE(parse(EDDYSTONE_URL, sizeof(EDDYSTONE_URL), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_EDDYSTONE_URL, adv.frameType);
+    TEST_ASSERT_EQUAL_size_t(20, formatEddystoneUrl(adv, url, sizeof(url)));
+    TEST_ASSERT_EQUAL_STRING("https://example.com/", url);
+    TEST_ASSERT_EQUAL_size_t(7, formatEddystoneUrl(adv, url, 8));
+    TEST_ASSERT_EQUAL_STRING("https:/", url);
+
+    TEST_ASSERT_TRUE(parse(EDDYSTONE_TLM, sizeof(EDDYSTONE_TLM), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_EDDYSTONE_TLM, adv.frameType);
+    TEST_ASSERT_EQUAL_UINT16(3000, adv.batteryMillivolts);
+    TEST_ASSERT_EQUAL_INT16(0x1680, adv.temperature);
+    TEST_ASSERT_EQUAL_UINT32(12345, adv.advertisementCount);
+    TEST_ASSERT_EQUAL_UINT32(100000, adv.uptimeTenths);
+}
+
+static void test_name_and_service_uuid() {
+    ParsedAdvertisement adv;
+    TEST_ASSERT_TRUE(parse(NAMED, sizeof(NAMED), adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_NONE, adv.frameType);
+    TEST_ASSERT_EQUAL_UINT8(5, adv.nameLength);
+    TEST_ASSERT_EQUAL_MEMORY("Tag-1", adv.name, 5);
+    TEST_ASSERT_TRUE(adv.hasServiceUUID);
+    TEST_ASSERT_EQUAL_HEX8(0x18, adv.serviceUUID[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x0F, adv.serviceUUID[3]);
+}
+
+// Champ AD plus long que l'annonce : refusé, les champs précédents restent
+static void test_truncated_structure() {
+    ParsedAdvertisement adv;
+    TEST_ASSERT_FALSE(parse(IBEACON, sizeof(IBEACON) - 1, adv));
+    TEST_ASSERT_EQUAL_UINT8(FRAME_NONE, adv.frameType);
+    TEST_ASSERT_FALSE(parse(NAMED, 10, adv));
+    TEST_ASSERT_TRUE(adv.hasServiceUUID);
+    TEST_ASSERT_EQUAL_UINT8(3, adv.nameLength);
+}
+
+static uint32_t randomState = 1;
+
+// xorshift32
+static uint32_t nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static void checkBounds(const uint8_t* payload, size_t length, const ParsedAdvertisement& adv) {
+    if (adv.name) {
+        TEST_ASSERT_TRUE(adv.name >= payload && adv.name + adv.nameLength <= payload + length);
+    }
+    if (adv.url) {
+        TEST_ASSERT_TRUE(adv.url >= payload && adv.url + adv.urlLength <= payload + length);
+    }
+    char url[64];
+    TEST_ASSERT_TRUE(formatEddystoneUrl(adv, url, sizeof(url)) < sizeof(url));
+}
+
+// 1M annonces aléatoires, 1M trames valides altérées (octets changés,
+// longueur coupée)
+static void test_random_and_mutated_payloads() {
+    static const struct {
+        const uint8_t* data;
+        size_t length;
+    } seeds[] = {
+        {IBEACON, sizeof(IBEACON)},
+        {ALTBEACON, sizeof(ALTBEACON)},
+        {EDDYSTONE_UID, sizeof(EDDYSTONE_UID)},
+        {EDDYSTONE_URL, sizeof(EDDYSTONE_URL)},
+        {EDDYSTONE_TLM, sizeof(EDDYSTONE_TLM)},
+        {NAMED, sizeof(NAMED)},
+    };
+    const uint32_t rounds = 1000000;
+    uint8_t payload[62];
+    uint32_t accepted = 0;
+    ParsedAdvertisement adv;
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        size_t length = nextRandom() % (sizeof(payload) + 1);
+        for (size_t j = 0; j < length; j++) {
+            payload[j] = (uint8_t)nextRandom();
+        }
+        accepted += parse(payload, length, adv) ? 1 : 0;
+        checkBounds(payload, length, adv);
+    }
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        const auto& seed = seeds[i % (sizeof(seeds) / sizeof(seeds[0]))];
+        memcpy(payload, seed.data, seed.length);
+        for (uint32_t flips = nextRandom() % 4; flips > 0; flips--) {
+            payload[nextRandom() % seed.length] = (uint8_t)nextRandom();
+        }
+        size_t length = nextRandom() % 4 == 0 ? nextRandom() % (seed.length + 1) : seed.length;
+        accepted += parse(payload, length, adv) ? 1 : 0;
+        checkBounds(payload, length, adv);
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu annonces, %lu à la structure AD valide", (unsigned long)(2 * rounds),
+             (unsigned long)accepted);
+    TEST_MESSAGE(line);
+}
+
+// Coût du décodage d'une trame iBeacon, sans copie
+static void test_parse_benchmark() {
+    const uint32_t rounds = 1000000;
+    ParsedAdvertisement adv;
+    uint32_t sink = 0;
+    uint64_t start = benchNanos();
+    for (uint32_t i = 0; i < rounds; i++) {
+        parseAdvertisement(IBEACON, sizeof(IBEACON), adv);
+        sink += adv.minor;
+    }
+    double ns = (double)(benchNanos() - start) / rounds;
+
+    char line[96];
+    snprintf(line, sizeof(line), "Trame iBeacon : %.1f ns par décodage (%lu)", ns, (unsigned long)(sink & 1));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(2 * rounds, sink);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ibeacon);
+    RUN_TEST(test_altbeacon);
+    RUN_TEST(test_eddystone_frames);
+    RUN_TEST(test_name_and_service_uuid);
+    RUN_TEST(test_truncated_structure);
+    RUN_TEST(test_random_and_mutated_payloads);
+    RUN_TEST(test_parse_benchmark);
+    return UNITY_END();
+}
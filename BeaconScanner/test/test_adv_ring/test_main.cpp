@@ -0,0 +1,193 @@
+// File des annonces (AdvRingBuffer) entre le callback BLE et la tâche de
+// suivi : un thread producteur et un thread consommateur réels sur l'hôte.
+// pio test -e native -f test_adv_ring
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AdvRingBuffer.h"
+#include "BeaconTracker.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Le numéro de séquence est répété dans tout l'enregistrement : une case lue
+// pendant son écriture donnerait un enregistrement incohérent
+static void fillRecord(AdvRecord& record, uint32_t seq) {
+    memset(&record, 0, sizeof(record));
+    record.timestamp = seq;
+    record.rssi = (int8_t)-(int)(seq % 100);
+    record.payloadLength = ADV_MAX_PAYLOAD;
+    for (size_t i = 0; i < sizeof(record.address); i++) {
+        record.address[i] = (uint8_t)(seq >> (8 * (i % 4)));
+    }
+    for (size_t i = 0; i < ADV_MAX_PAYLOAD; i++) {
+        record.payload[i] = (uint8_t)(seq + i);
+    }
+}
+
+static bool recordMatches(const AdvRecord& record, uint32_t seq) {
+    AdvRecord expected;
+    fillRecord(expected, seq);
+    return memcmp(&record, &expected, sizeof(record)) == 0;
+}
+
+// Consommateur : vide la file comme processAdvertisements(), par lots de
+// ADV_BATCH_SIZE toutes les periodMs ms (0 : en continu), jusqu'à l'arrêt
+// du producteur
+template <size_t N>
+struct Consumer {
+    AdvRingBuffer<AdvRecord, N>& ring;
+    uint32_t periodMs;
+    std::atomic<bool>& producerDone;
+    uint32_t received = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t corrupted = 0;
+    size_t maxDepth = 0;
+
+    void run() {
+        AdvRecord batch[ADV_BATCH_SIZE];
+        for (;;) {
+            bool done = producerDone.load();
+            size_t depth = ring.size();
+            if (depth > maxDepth) {
+                maxDepth = depth;
+            }
+            size_t count;
+            while ((count = ring.popBatch(batch, ADV_BATCH_SIZE)) > 0) {
+                for (size_t i = 0; i < count; i++) {
+                    if (batch[i].timestamp != received) {
+                        outOfOrder++;
+                    } else if (!recordMatches(batch[i], received)) {
+                        corrupted++;
+                    }
+                    received = batch[i].timestamp + 1;
+                }
+            }
+            if (done) {
+                return;
+            }
+            if (periodMs) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(periodMs));
+            }
+        }
+    }
+};
+
+static void test_full_ring_drops_new() {
+    AdvRingBuffer<AdvRecord, 4> ring;
+    AdvRecord record;
+    for (uint32_t seq = 0; seq < 4; seq++) {
+        fillRecord(record, seq);
+        TEST_ASSERT_TRUE(ring.push(record));
+    }
+    fillRecord(record, 4);
+    TEST_ASSERT_FALSE(ring.push(record));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(4, ring.pushedCount());
+
+    // Les enregistrements déjà en file sont intacts, dans l'ordre
+    for (uint32_t seq = 0; seq < 4; seq++) {
+        TEST_ASSERT_TRUE(ring.pop(record));
+        TEST_ASSERT_TRUE(recordMatches(record, seq));
+    }
+    TEST_ASSERT_FALSE(ring.pop(record));
+
+    // Une case libérée est réutilisable
+    fillRecord(record, 5);
+    TEST_ASSERT_TRUE(ring.push(record));
+    TEST_ASSERT_EQUAL_size_t(1, ring.size());
+}
+
+// 1000 annonces/s pendant 3 s (un scan actif avec ~500 tags à 2 annonces/s),
+// tâche de suivi réveillée toutes les TRACKER_TICK ms : aucune perte
+static void test_1000_adv_per_second_no_loss() {
+    static AdvRingBuffer<AdvRecord, ADV_RING_SIZE> ring;
+    const uint32_t total = 3000;
+    std::atomic<bool> producerDone(false);
+    Consumer<ADV_RING_SIZE> consumer{ring, TRACKER_TICK, producerDone};
+    std::thread consumerThread(&Consumer<ADV_RING_SIZE>::run, &consumer);
+
+    auto next = std::chrono::steady_clock::now();
+    AdvRecord record;
+    for (uint32_t seq = 0; seq < total; seq++) {
+        next += std::chrono::microseconds(1000);
+        std::this_thread::sleep_until(next);
+        fillRecord(record, seq);
+        ring.push(record);
+    }
+    producerDone.store(true);
+    consumerThread.join();
+
+    char line[128];
+    snprintf(line, sizeof(line), "1000 annonces/s : %lu reçues, %lu perdues, file max %lu/%lu",
+             (unsigned long)consumer.received, (unsigned long)ring.droppedCount(),
+             (unsigned long)consumer.maxDepth, (unsigned long)ADV_RING_SIZE);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(total, consumer.received);
+    TEST_ASSERT_EQUAL_UINT32(0, consumer.outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, consumer.corrupted);
+}
+
+// Producteur et consommateur en continu : débit maximal de la file, et aucun
+// enregistrement déchiré ni désordonné quand elle est sans cesse pleine
+static void test_saturated_throughput() {
+    static AdvRingBuffer<AdvRecord, ADV_RING_SIZE> ring;
+    const uint32_t total = 100000;
+    std::atomic<bool> producerDone(false);
+    Consumer<ADV_RING_SIZE> consumer{ring, 0, producerDone};
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumerThread(&Consumer<ADV_RING_SIZE>::run, &consumer);
+    AdvRecord record;
+    for (uint32_t seq = 0; seq < total; seq++) {
+        fillRecord(record, seq);
+        while (!ring.push(record)) {
+            std::this_thread::yield();
+        }
+    }
+    producerDone.store(true);
+    consumerThread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char line[128];
+    snprintf(line, sizeof(line), "Saturée : %lu annonces en %.2f s (%.0f/s), %lu refus",
+             (unsigned long)consumer.received, seconds, consumer.received / seconds,
+             (unsigned long)ring.droppedCount());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(total, consumer.received);
+    TEST_ASSERT_EQUAL_UINT32(total, ring.pushedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, consumer.outOfOrder);
+    TEST_ASSERT_EQUAL_UINT32(0, consumer.corrupted);
+    TEST_ASSERT_GREATER_THAN(1000.0, consumer.received / seconds);
+}
+
+// Une rafale que la tâche de suivi ne lit pas : chaque annonce de la radio
+// est comptée une fois, mise en file, écartée comme doublon ou perdue
+static void test_tracker_counts_every_advertisement() {
+    static SendEvents sender;
+    static BeaconTracker tracker(sender);
+    const uint32_t total = ADV_RING_SIZE + 50;
+    AdvRecord record;
+    for (uint32_t seq = 0; seq < total; seq++) {
+        fillRecord(record, seq);
+        tracker.onAdvertisement(record);
+        tracker.onAdvertisement(record);
+    }
+    TEST_ASSERT_EQUAL_UINT32(total, tracker.advertisementsSuppressed());
+    TEST_ASSERT_EQUAL_UINT32(50, tracker.advertisementsDropped());
+    TEST_ASSERT_EQUAL_UINT32(2 * total, tracker.advertisementsReceived());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_ring_drops_new);
+    RUN_TEST(test_1000_adv_per_second_no_loss);
+    RUN_TEST(test_saturated_throughput);
+    RUN_TEST(test_tracker_counts_every_advertisement);
+    return UNITY_END();
+}
@@ -0,0 +1,542 @@
+// Corps de GET /beacons?since= (streamBeacons, BeaconTracker::readChanges),
+// écrit dans un tampon puis relu par un lecteur JSON strict : instantané
+// complet sur plusieurs lectures de BEACON_STREAM_CHUNK entrées,
+// modifications après since, numéros croissants, reset pour un since
+// inconnu (futur ou trop ancien pour les suppressions retenues), entrées
+// supprimées, échappement du nom annoncé, et complete:false quand la
+// tâche de suivi cesse de répondre en cours de route.
+// pio test -e native -f test_beacon_stream
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BeaconStream.h"
+#include "EventPush.h"
+#include "Hal.h"
+#include "Presence.h"
+#include "SendEvents.h"
+#include "sim/SimHal.h"
+
+static SendEvents sender;
+static BeaconTracker* tracker;
+
+// Morceaux reçus par le writer
+static std::string body;
+static size_t writes;
+static size_t largestWrite;
+
+static void capture(const char* data, size_t length) {
+    body.append(data, length);
+    writes++;
+    largestWrite = length > largestWrite ? length : largestWrite;
+}
+
+void setUp() {
+    delete tracker;
+    tracker = new BeaconTracker(sender);
+    body.clear();
+    writes = 0;
+    largestWrite = 0;
+}
+
+void tearDown() {}
+
+// Valeur JSON, juste ce que produit streamBeacons
+struct Json {
+    enum Kind { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } kind = NONE;
+    bool flag = false;
+    uint32_t number = 0;
+    std::string text;
+    std::vector<Json> items;
+    std::map<std::string, Json> fields;
+
+    const Json& operator[](const char* key) const {
+        static const Json none;
+        auto found = fields.find(key);
+        return found == fields.end() ? none : found->second;
+    }
+};
+
+// Lecteur strict : échoue sur un octet de contrôle brut dans une chaîne,
+// une clé en double ou du texte après la valeur
+class JsonReader {
+private:
+    const char* start;
+    const char* p;
+    const char* end;
+
+    void fail(const char* what) {
+        char message[96];
+        snprintf(message, sizeof(message), "JSON invalide à l'octet %ld : %s", (long)(p - start), what);
+        TEST_FAIL_MESSAGE(message);
+    }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    void expect(char c) {
+        skipSpace();
+        if (p >= end || *p != c) {
+            char what[32];
+            snprintf(what, sizeof(what), "'%c' attendu", c);
+            fail(what);
+        }
+        p++;
+    }
+
+    bool literal(const char* word) {
+        size_t length = strlen(word);
+        if ((size_t)(end - p) >= length && memcmp(p, word, length) == 0) {
+            p += length;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string() {
+        static const char escapes[] = "\"\\/bfnrt";
+        static const char decoded[] = "\"\\/\b\f\n\r\t";
+        expect('"');
+        std::string out;
+        while (p < end && *p != '"') {
+            unsigned char c = (unsigned char)*p++;
+            if (c < 0x20) {
+                fail("octet de contrôle non échappé");
+            }
+            if (c != '\\') {
+                out += (char)c;
+                continue;
+            }
+            const char* simple = p < end && *p ? strchr(escapes, *p) : nullptr;
+            if (simple) {
+                out += decoded[simple - escapes];
+                p++;
+            } else if (p < end && *p == 'u' && end - p >= 5) {
+                char hex[5] = {p[1], p[2], p[3], p[4], 0};
+                char* last;
+                unsigned long code = strtoul(hex, &last, 16);
+                if (last != hex + 4 || code >= 0x80) {
+                    fail("\\u hors ASCII");
+                }
+                out += (char)code;
+                p += 5;
+            } else {
+                fail("échappement inconnu");
+            }
+        }
+        expect('"');
+        return out;
+    }
+
+public:
+    explicit JsonReader(const std::string& text)
+        : start(text.c_str()), p(text.c_str()), end(text.c_str() + text.size()) {}
+
+    Json value() {
+        Json result;
+        skipSpace();
+        if (p >= end) {
+            fail("fin du texte");
+        } else if (*p == '{') {
+            result.kind = Json::OBJECT;
+            p++;
+            skipSpace();
+            if (p < end && *p == '}') {
+                p++;
+                return result;
+            }
+            do {
+                std::string key = string();
+                expect(':');
+                if (result.fields.count(key)) {
+                    fail("clé en double");
+                }
+                result.fields[key] = value();
+                skipSpace();
+            } while (p < end && *p == ',' && p++);
+            expect('}');
+        } else if (*p == '[') {
+            result.kind = Json::ARRAY;
+            p++;
+            skipSpace();
+            if (p < end && *p == ']') {
+                p++;
+                return result;
+            }
+            do {
+                result.items.push_back(value());
+                skipSpace();
+            } while (p < end && *p == ',' && p++);
+            expect(']');
+        } else if (*p == '"') {
+            result.kind = Json::STRING;
+            result.text = string();
+        } else if (literal("true")) {
+            result.kind = Json::BOOLEAN;
+            result.flag = true;
+        } else if (literal("false")) {
+            result.kind = Json::BOOLEAN;
+        } else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+            result.kind = Json::NUMBER;
+            char* last;
+            result.number = (uint32_t)strtol(p, &last, 10);
+            p = last;
+        } else {
+            fail("valeur attendue");
+        }
+        return result;
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return p == end;
+    }
+};
+
+static Json parse(const std::string& text) {
+    JsonReader reader(text);
+    Json root = reader.value();
+    TEST_ASSERT_TRUE_MESSAGE(reader.atEnd(), "texte après la réponse");
+    TEST_ASSERT_EQUAL_INT(Json::OBJECT, root.kind);
+    TEST_ASSERT_EQUAL_INT(Json::NUMBER, root["seq"].kind);
+    TEST_ASSERT_EQUAL_INT(Json::BOOLEAN, root["reset"].kind);
+    TEST_ASSERT_EQUAL_INT(Json::ARRAY, root["beacons"].kind);
+    TEST_ASSERT_EQUAL_INT(Json::BOOLEAN, root["complete"].kind);
+    return root;
+}
+
+// Annonce du beacon n, avec un nom (AD 0x09) s'il est donné
+static AdvRecord advertisement(uint32_t n, const char* name, int8_t rssi) {
+    AdvRecord record;
+    memset(&record, 0, sizeof(record));
+    record.address[0] = 0xC0;
+    record.address[1] = 0xDE;
+    record.address[4] = (uint8_t)(n >> 8);
+    record.address[5] = (uint8_t)n;
+    record.rssi = rssi;
+    record.timestamp = halMillis();
+    uint8_t* p = record.payload;
+    *p++ = 0x02;
+    *p++ = 0x01;
+    *p++ = 0x06;
+    if (name) {
+        size_t length = strlen(name);
+        *p++ = (uint8_t)(length + 1);
+        *p++ = 0x09;
+        memcpy(p, name, length);
+        p += length;
+    }
+    record.payloadLength = (uint8_t)(p - record.payload);
+    return record;
+}
+
+static void advertise(uint32_t n, const char* name = nullptr, int8_t rssi = -70) {
+    tracker->onAdvertisement(advertisement(n, name, rssi));
+    tracker->processAdvertisements();
+}
+
+static std::string beaconId(uint32_t n) {
+    char id[24];
+    snprintf(id, sizeof(id), "c0:de:00:00:%02x:%02x", (unsigned)(n >> 8), (unsigned)(n & 0xFF));
+    return id;
+}
+
+struct Response {
+    int count;
+    uint32_t seq;
+    bool reset;
+    bool complete;
+    std::map<std::string, Json> beacons;
+};
+
+// Une requête relue, entrées appliquées dans l'ordre ; chaque entrée porte
+// un numéro dans ]since, seq] (au plus seq après un reset)
+static Response request(uint32_t since) {
+    body.clear();
+    writes = 0;
+    largestWrite = 0;
+    Response response;
+    response.count = streamBeacons(*tracker, since, capture);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, response.count);
+
+    Json root = parse(body);
+    response.seq = root["seq"].number;
+    response.reset = root["reset"].flag;
+    response.complete = root["complete"].flag;
+    for (const Json& item : root["beacons"].items) {
+        const std::string& id = item["beaconId"].text;
+        // Un beacon libéré puis revenu : sa suppression vient d'abord
+        auto previous = response.beacons.find(id);
+        TEST_ASSERT_TRUE_MESSAGE(previous == response.beacons.end() ||
+                                     (previous->second["status"].text == "removed" && item["status"].text != "removed"),
+                                 id.c_str());
+        TEST_ASSERT_EQUAL_INT(Json::NUMBER, item["seq"].kind);
+        TEST_ASSERT_LESS_OR_EQUAL(response.seq, item["seq"].number);
+        TEST_ASSERT_TRUE_MESSAGE(response.reset || item["seq"].number > since, id.c_str());
+        response.beacons[id] = item;
+    }
+    TEST_ASSERT_EQUAL_INT((int)root["beacons"].items.size(), response.count);
+    TEST_ASSERT_TRUE(response.reset || response.seq >= since);
+    TEST_ASSERT_LESS_OR_EQUAL(BEACON_STREAM_BUFFER, largestWrite);
+    return response;
+}
+
+// Plus de trois lectures de BEACON_STREAM_CHUNK entrées
+static void test_snapshot_spans_chunks() {
+    Response empty = request(0);
+    TEST_ASSERT_TRUE(empty.reset);
+    TEST_ASSERT_TRUE(empty.complete);
+    TEST_ASSERT_EQUAL_INT(0, empty.count);
+    TEST_ASSERT_EQUAL_UINT32(0, empty.seq);
+
+    const uint32_t beacons = 3 * BEACON_STREAM_CHUNK + 5;
+    for (uint32_t n = 0; n < beacons; n++) {
+        advertise(n, "Tag");
+    }
+    Response response = request(0);
+    TEST_ASSERT_TRUE(response.reset);
+    TEST_ASSERT_TRUE(response.complete);
+    TEST_ASSERT_EQUAL_INT(beacons, response.count);
+    TEST_ASSERT_GREATER_THAN(1, writes);
+    uint32_t highest = 0;
+    for (uint32_t n = 0; n < beacons; n++) {
+        const Json& item = response.beacons[beaconId(n)];
+        TEST_ASSERT_EQUAL_STRING("Tag", item["name"].text.c_str());
+        highest = item["seq"].number > highest ? item["seq"].number : highest;
+    }
+    TEST_ASSERT_EQUAL_UINT32(highest, response.seq);
+    TEST_ASSERT_EQUAL_UINT32(beacons, response.seq);
+}
+
+// Un client qui applique les modifications reste identique à l'instantané
+static void test_deltas_follow_changes() {
+    const uint32_t beacons = 3 * BEACON_STREAM_CHUNK;
+    for (uint32_t n = 0; n < beacons; n++) {
+        advertise(n, "Tag");
+    }
+    Response snapshot = request(0);
+    std::map<std::string, Json> copy = snapshot.beacons;
+    uint32_t seq = snapshot.seq;
+
+    Response same = request(seq);
+    TEST_ASSERT_FALSE(same.reset);
+    TEST_ASSERT_EQUAL_INT(0, same.count);
+    TEST_ASSERT_EQUAL_UINT32(seq, same.seq);
+
+    uint32_t state = 7;
+    for (int round = 0; round < 200; round++) {
+        // Jusqu'à deux morceaux de modifications par requête
+        uint32_t changes = (uint32_t)round % (2 * BEACON_STREAM_CHUNK + 3);
+        std::set<std::string> changed;
+        for (uint32_t i = 0; i < changes; i++) {
+            state = state * 1103515245u + 12345u;
+            uint32_t n = (state >> 8) % beacons;
+            char name[16];
+            snprintf(name, sizeof(name), "Tag-%d-%lu", round, (unsigned long)i);
+            advertise(n, name);
+            changed.insert(beaconId(n));
+        }
+        Response delta = request(seq);
+        TEST_ASSERT_FALSE(delta.reset);
+        TEST_ASSERT_TRUE(delta.complete);
+        TEST_ASSERT_EQUAL_size_t(changed.size(), delta.beacons.size());
+        TEST_ASSERT_EQUAL_UINT32(seq + changes, delta.seq);
+        for (const auto& item : delta.beacons) {
+            TEST_ASSERT_TRUE_MESSAGE(changed.count(item.first) == 1, item.first.c_str());
+            copy[item.first] = item.second;
+        }
+        seq = delta.seq;
+    }
+
+    Response final = request(0);
+    TEST_ASSERT_EQUAL_UINT32(seq, final.seq);
+    TEST_ASSERT_EQUAL_size_t(final.beacons.size(), copy.size());
+    for (const auto& item : final.beacons) {
+        TEST_ASSERT_EQUAL_STRING(item.second["name"].text.c_str(), copy[item.first]["name"].text.c_str());
+        TEST_ASSERT_EQUAL_UINT32(item.second["seq"].number, copy[item.first]["seq"].number);
+    }
+}
+
+// since postérieur au dernier numéro (redémarrage de la passerelle)
+static void test_future_since_resets() {
+    for (uint32_t n = 0; n < 5; n++) {
+        advertise(n);
+    }
+    Response response = request(1000);
+    TEST_ASSERT_TRUE(response.reset);
+    TEST_ASSERT_EQUAL_INT(5, response.count);
+    TEST_ASSERT_EQUAL_UINT32(5, response.seq);
+    TEST_ASSERT_FALSE(request(5).reset);
+    TEST_ASSERT_TRUE(request(6).reset);
+}
+
+// Les beacons de keep émettent pendant durationMs, les autres se taisent
+static void runFor(uint32_t durationMs, const std::set<uint32_t>& keep) {
+    uint32_t end = halMillis() + durationMs;
+    while ((int32_t)(halMillis() - end) < 0) {
+        simAdvanceTo(halMillis() + 1000);
+        for (uint32_t n : keep) {
+            advertise(n);
+        }
+        tracker->checkForDepartedBeacons();
+    }
+}
+
+// Libère les beacons absents depuis BEACON_RECLAIM_GRACE
+static void reclaimAllBut(const std::set<uint32_t>& keep) {
+    runFor(BEACON_RECLAIM_GRACE + 60000, keep);
+}
+
+// Suppressions signalées avec leur numéro ; au-delà de BEACON_TOMBSTONES
+// suppressions, un since antérieur donne un instantané complet
+static void test_removed_entries_then_too_old() {
+    std::set<uint32_t> keep;
+    for (uint32_t n = 0; n < 10; n++) {
+        advertise(n);
+        if (n >= 4) {
+            keep.insert(n);
+        }
+    }
+    // Arrivée des beacons gardés : plus rien ne change pour eux
+    runFor(PRESENCE_ENTER_DWELL + 1000, keep);
+    uint32_t before = request(0).seq;
+    uint32_t reclaimedBefore = tracker->reclaimed();
+    reclaimAllBut(keep);
+    TEST_ASSERT_EQUAL_UINT32(reclaimedBefore + 4, tracker->reclaimed());
+
+    Response delta = request(before);
+    TEST_ASSERT_FALSE(delta.reset);
+    TEST_ASSERT_EQUAL_INT(4, delta.count);
+    for (uint32_t n = 0; n < 4; n++) {
+        const Json& item = delta.beacons[beaconId(n)];
+        TEST_ASSERT_EQUAL_STRING("removed", item["status"].text.c_str());
+        TEST_ASSERT_EQUAL_INT(Json::NONE, item["name"].kind);
+    }
+    TEST_ASSERT_EQUAL_INT(6, request(0).count);
+
+    // Un beacon libéré qui revient : sa nouvelle entrée suit sa suppression
+    advertise(1);
+    Response back = request(delta.seq);
+    TEST_ASSERT_EQUAL_INT(1, back.count);
+    TEST_ASSERT_EQUAL_STRING("Inconnu", back.beacons[beaconId(1)]["name"].text.c_str());
+    Response both = request(before);
+    TEST_ASSERT_EQUAL_INT(5, both.count);
+    TEST_ASSERT_EQUAL_size_t(4, both.beacons.size());
+    TEST_ASSERT_EQUAL_STRING("absent", both.beacons[beaconId(1)]["status"].text.c_str());
+
+    // BEACON_TOMBSTONES autres suppressions : les premières sont oubliées
+    for (uint32_t n = 100; n < 100 + BEACON_TOMBSTONES; n++) {
+        advertise(n);
+    }
+    keep.insert(1);
+    runFor(PRESENCE_ENTER_DWELL + 1000, keep);
+    uint32_t lastKnown = request(0).seq;
+    reclaimAllBut(keep);
+    Response old = request(before);
+    TEST_ASSERT_TRUE(old.reset);
+    TEST_ASSERT_EQUAL_INT(keep.size(), old.count);
+    Response recent = request(lastKnown);
+    TEST_ASSERT_FALSE(recent.reset);
+    TEST_ASSERT_EQUAL_INT(BEACON_TOMBSTONES, recent.count);
+    for (const auto& item : recent.beacons) {
+        TEST_ASSERT_EQUAL_STRING("removed", item.second["status"].text.c_str());
+    }
+}
+
+// Guillemets, barre oblique inverse et octets de contrôle du nom annoncé ;
+// l'UTF-8 passe tel quel
+static void test_name_is_escaped() {
+    const char* name = "A\"B\\C\nD\x01\x1f/\xc3\xa9";
+    advertise(1, name);
+    Response response = request(0);
+    TEST_ASSERT_EQUAL_STRING(name, response.beacons[beaconId(1)]["name"].text.c_str());
+    TEST_ASSERT_NOT_NULL(strstr(body.c_str(), "\"name\":\"A\\\"B\\\\C\\u000aD\\u0001\\u001f/\xc3\xa9\""));
+
+    // Nom de BEACON_NAME_MAX caractères, tous à échapper, et nom tronqué
+    std::string quotes(BEACON_NAME_MAX, '"');
+    advertise(2, quotes.c_str());
+    std::string controls(BEACON_NAME_MAX + 5, '\x02');
+    advertise(3, controls.c_str());
+    response = request(0);
+    TEST_ASSERT_EQUAL_STRING(quotes.c_str(), response.beacons[beaconId(2)]["name"].text.c_str());
+    TEST_ASSERT_EQUAL_STRING(controls.substr(0, BEACON_NAME_MAX).c_str(),
+                             response.beacons[beaconId(3)]["name"].text.c_str());
+}
+
+// La tâche de suivi se bloque dans le réveil du serveur web (EventPush)
+// tant que stallReleased n'est pas posé
+static std::atomic<bool> stalled(false);
+static std::atomic<bool> stallReleased(false);
+
+static void stallTracker() {
+    stalled.store(true);
+    while (!stallReleased.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Tâche de suivi démarrée, puis bloquée après le premier morceau : la
+// réponse se termine par complete:false, avec son numéro et ce morceau
+static void test_incomplete_when_tracker_stops_answering() {
+    const uint32_t beacons = 2 * BEACON_STREAM_CHUNK;
+    for (uint32_t n = 0; n < beacons; n++) {
+        advertise(n);
+    }
+    uint32_t seq = request(0).seq;
+
+    static EventPush push;
+    push.setNotify(stallTracker);
+    sender.setPush(push);
+    simStartThreads(10.0);
+    TEST_ASSERT_TRUE(tracker->startTask(3600000));
+    TEST_ASSERT_TRUE(request(0).complete);
+
+    body.clear();
+    int count = streamBeacons(*tracker, 0, [](const char* data, size_t length) {
+        capture(data, length);
+        if (push.subscriberTotal() > 0) {
+            return;
+        }
+        // Un nouveau beacon fort jusqu'à son arrivée, que la tâche de
+        // suivi diffuse : elle ne répond plus
+        push.subscribe(1);
+        for (int i = 0; i < 1000 && !stalled.load(); i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "%d", i);
+            tracker->onAdvertisement(advertisement(1000, name, -50));
+            halDelay(50);
+        }
+    });
+    stallReleased.store(true);
+    TEST_ASSERT_TRUE(stalled.load());
+
+    Json root = parse(body);
+    TEST_ASSERT_EQUAL_INT(BEACON_STREAM_CHUNK, count);
+    TEST_ASSERT_FALSE(root["complete"].flag);
+    TEST_ASSERT_TRUE(root["reset"].flag);
+    TEST_ASSERT_EQUAL_UINT32(seq, root["seq"].number);
+    TEST_ASSERT_EQUAL_size_t(BEACON_STREAM_CHUNK, root["beacons"].items.size());
+}
+
+int main() {
+    sender.init();
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_spans_chunks);
+    RUN_TEST(test_deltas_follow_changes);
+    RUN_TEST(test_future_since_resets);
+    RUN_TEST(test_removed_entries_then_too_old);
+    RUN_TEST(test_name_is_escaped);
+    RUN_TEST(test_incomplete_when_tracker_stops_answering); // En dernier : passe en multi-thread
+    return UNITY_END();
+}
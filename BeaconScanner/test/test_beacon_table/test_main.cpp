@@ -0,0 +1,462 @@
+// Table des beacons (BeaconTable) : insertion, recherche, suppression par
+// décalage arrière, recyclage quand elle est pleine, échéances de la roue
+// temporelle (plusieurs tours, passées, chaînes d'une case, passage de
+// millis() par zéro, longues pauses), et coût d'une recherche comparé à
+// l'ancienne std::map indexée par l'identifiant texte, puis d'un tour de
+// roue quand toute la table attend une échéance lointaine.
+// pio test -e native -f test_beacon_table
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "BeaconTable.h"
+#include "sim/Bench.h"
+
+static BeaconTable table;
+
+void setUp() {
+    table.clear();
+}
+
+void tearDown() {}
+
+static void makeAddress(uint32_t n, uint8_t* address) {
+    address[0] = 0xC0;
+    address[1] = 0xDE;
+    address[2] = (uint8_t)(n >> 24);
+    address[3] = (uint8_t)(n >> 16);
+    address[4] = (uint8_t)(n >> 8);
+    address[5] = (uint8_t)n;
+}
+
+static BeaconInfo* insert(uint32_t n, bool* isNewOut = nullptr, BeaconInfo* evicted = nullptr) {
+    uint8_t address[6];
+    makeAddress(n, address);
+    bool isNew = false;
+    BeaconInfo* beacon = table.findOrInsert(address, nullptr, isNew, evicted);
+    if (isNewOut) {
+        *isNewOut = isNew;
+    }
+    return beacon;
+}
+
+static BeaconInfo* lookup(uint32_t n) {
+    uint8_t address[6];
+    makeAddress(n, address);
+    return table.find(address, nullptr);
+}
+
+// Adresses dont la clé tombe dans la même case de l'index que home
+// (INDEX_SIZE vaut 1024 pour la capacité par défaut de 384)
+static const size_t INDEX_MASK = 1023;
+
+static size_t collidingAddresses(size_t home, uint32_t* out, size_t count) {
+    size_t found = 0;
+    for (uint32_t n = 0; found < count; n++) {
+        uint8_t address[6];
+        makeAddress(n, address);
+        if ((BeaconTable::hashKey(address, nullptr) & INDEX_MASK) == home) {
+            out[found++] = n;
+        }
+    }
+    return found;
+}
+
+static void test_insert_and_find() {
+    bool isNew = false;
+    BeaconInfo* beacon = insert(1, &isNew);
+    TEST_ASSERT_NOT_NULL(beacon);
+    TEST_ASSERT_TRUE(isNew);
+    TEST_ASSERT_EQUAL_UINT8(0xC0, beacon->address[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, beacon->address[5]);
+    TEST_ASSERT_FALSE(beacon->isIBeacon);
+
+    beacon->rssi = -60;
+    TEST_ASSERT_EQUAL_PTR(beacon, insert(1, &isNew));
+    TEST_ASSERT_FALSE(isNew);
+    TEST_ASSERT_EQUAL_PTR(beacon, lookup(1));
+    TEST_ASSERT_EQUAL_INT8(-60, lookup(1)->rssi);
+    TEST_ASSERT_NULL(lookup(2));
+    TEST_ASSERT_EQUAL_size_t(1, table.size());
+}
+
+// Un iBeacon est identifié par son adresse et son UUID de proximité
+static void test_ibeacon_key_includes_uuid() {
+    uint8_t address[6];
+    makeAddress(7, address);
+    uint8_t uuidA[16], uuidB[16];
+    memset(uuidA, 0xAA, sizeof(uuidA));
+    memset(uuidB, 0xBB, sizeof(uuidB));
+
+    bool isNew = false;
+    BeaconInfo* plain = table.findOrInsert(address, nullptr, isNew);
+    BeaconInfo* a = table.findOrInsert(address, uuidA, isNew);
+    TEST_ASSERT_TRUE(isNew);
+    BeaconInfo* b = table.findOrInsert(address, uuidB, isNew);
+    TEST_ASSERT_TRUE(isNew);
+    TEST_ASSERT_TRUE(a != plain && b != plain && a != b);
+    TEST_ASSERT_TRUE(a->isIBeacon);
+    TEST_ASSERT_EQUAL_MEMORY(uuidA, a->proximityUUID, 16);
+
+    TEST_ASSERT_EQUAL_PTR(a, table.find(address, uuidA));
+    TEST_ASSERT_EQUAL_PTR(plain, table.find(address, nullptr));
+    TEST_ASSERT_EQUAL_size_t(3, table.size());
+}
+
+static void test_remove() {
+    for (uint32_t n = 0; n < 10; n++) {
+        insert(n);
+    }
+    table.remove(lookup(3));
+    TEST_ASSERT_NULL(lookup(3));
+    TEST_ASSERT_EQUAL_size_t(9, table.size());
+    for (uint32_t n = 0; n < 10; n++) {
+        if (n != 3) {
+            TEST_ASSERT_NOT_NULL(lookup(n));
+        }
+    }
+
+    // La clé supprimée peut revenir, comme une nouvelle entrée
+    bool isNew = false;
+    insert(3, &isNew);
+    TEST_ASSERT_TRUE(isNew);
+    TEST_ASSERT_EQUAL_size_t(10, table.size());
+}
+
+// Une suite de sondage qui déborde de la dernière case de l'index sur la
+// première : supprimer en tête ou au milieu doit laisser les suivantes
+// accessibles, sans pierre tombale
+static void test_backward_shift_across_wrap() {
+    uint32_t tail[4];
+    uint32_t head[2];
+    collidingAddresses(INDEX_MASK, tail, 4);   // Cases 1023, 0, 1, 2
+    collidingAddresses(0, head, 2);            // Case d'origine 0, rangées en 3 et 4
+    for (uint32_t n : tail) {
+        insert(n);
+    }
+    for (uint32_t n : head) {
+        insert(n);
+    }
+
+    table.remove(lookup(tail[0]));
+    TEST_ASSERT_NULL(lookup(tail[0]));
+    for (size_t i = 1; i < 4; i++) {
+        TEST_ASSERT_NOT_NULL(lookup(tail[i]));
+    }
+    table.remove(lookup(tail[2]));
+    TEST_ASSERT_NOT_NULL(lookup(tail[1]));
+    TEST_ASSERT_NOT_NULL(lookup(tail[3]));
+    TEST_ASSERT_NOT_NULL(lookup(head[0]));
+    TEST_ASSERT_NOT_NULL(lookup(head[1]));
+    table.remove(lookup(head[0]));
+    TEST_ASSERT_NOT_NULL(lookup(head[1]));
+    TEST_ASSERT_EQUAL_size_t(3, table.size());
+}
+
+// Insertions, recherches et suppressions aléatoires, comparées à une
+// std::map de référence, jusqu'à la capacité de la table
+static void test_random_operations_match_reference() {
+    std::mt19937 rng(12345);
+    std::map<uint32_t, int8_t> reference;
+    const uint32_t keys = BEACON_TABLE_CAPACITY * 2;
+
+    for (int op = 0; op < 200000; op++) {
+        uint32_t n = rng() % keys;
+        BeaconInfo* found = lookup(n);
+        auto it = reference.find(n);
+        TEST_ASSERT_EQUAL((it != reference.end()), (found != nullptr));
+        if (found) {
+            TEST_ASSERT_EQUAL_INT8(it->second, found->rssi);
+        }
+
+        if (rng() % 2 && found) {
+            table.remove(found);
+            reference.erase(it);
+        } else if (!found && reference.size() < BEACON_TABLE_CAPACITY) {
+            bool isNew = false;
+            BeaconInfo* beacon = insert(n, &isNew);
+            TEST_ASSERT_TRUE(isNew);
+            beacon->rssi = (int8_t)-(int)(op % 100);
+            reference[n] = beacon->rssi;
+        }
+        TEST_ASSERT_EQUAL_size_t(reference.size(), table.size());
+    }
+    for (const auto& item : reference) {
+        TEST_ASSERT_NOT_NULL(lookup(item.first));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, table.evictionCount());
+}
+
+// Table pleine : le beacon absent le moins récent est recyclé avant tout
+// beacon présent, puis le moins récent de tous
+static void test_eviction_prefers_absent() {
+    for (uint32_t n = 0; n < BEACON_TABLE_CAPACITY; n++) {
+        insert(n)->isPresent = true;
+    }
+    lookup(5)->isPresent = false;
+    lookup(9)->isPresent = false;
+    TEST_ASSERT_EQUAL_UINT8(5, table.evictionCandidate()->address[5]);
+
+    BeaconInfo evicted;
+    bool isNew = false;
+    insert(1000, &isNew, &evicted);
+    TEST_ASSERT_TRUE(isNew);
+    TEST_ASSERT_EQUAL_UINT8(5, evicted.address[5]);
+    TEST_ASSERT_FALSE(evicted.isPresent);
+    TEST_ASSERT_NULL(lookup(5));
+    TEST_ASSERT_EQUAL_UINT32(1, table.evictionCount());
+
+    // 9 est vu à nouveau : il devient le plus récent, hors de la zone examinée
+    insert(9);
+    TEST_ASSERT_TRUE(table.evictionCandidate()->isPresent);
+    insert(1001, &isNew, &evicted);
+    TEST_ASSERT_EQUAL_UINT8(0, evicted.address[5]);
+    TEST_ASSERT_TRUE(evicted.isPresent);
+    TEST_ASSERT_EQUAL_size_t(BEACON_TABLE_CAPACITY, table.size());
+}
+
+// Échéances atteintes, dans l'ordre des appels à expire()
+static std::vector<uint32_t> fired;
+
+static void expireAt(uint32_t now) {
+    table.expire(now, [](BeaconInfo& beacon) {
+        fired.push_back((uint32_t)beacon.address[4] << 8 | beacon.address[5]);
+    });
+}
+
+// Avance par pas de step ms jusqu'à la première échéance atteinte ;
+// rend l'heure de l'appel qui l'a signalée (end si aucune)
+static uint32_t advanceUntilFired(uint32_t& now, uint32_t end, uint32_t step) {
+    fired.clear();
+    while (now != end) {
+        now += step;
+        expireAt(now);
+        if (!fired.empty()) {
+            return now;
+        }
+    }
+    return end;
+}
+
+static void test_timer_beyond_one_lap() {
+    const uint32_t lap = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK;
+    const uint32_t delays[] = {TIMER_WHEEL_TICK / 2, lap - 1, lap + 250, 3 * lap + 70,
+                               TIMER_WHEEL_SLOTS * lap + 30, 3 * TIMER_WHEEL_SLOTS * lap + 5};
+    uint32_t now = 12345;
+    expireAt(now);
+    for (uint32_t delay : delays) {
+        uint32_t deadline = now + delay;
+        table.schedule(insert(1), deadline);
+        uint32_t at = advanceUntilFired(now, deadline + 10 * TIMER_WHEEL_TICK, 10);
+        TEST_ASSERT_EQUAL_size_t(1, fired.size());
+        TEST_ASSERT_GREATER_OR_EQUAL(deadline, at);
+        TEST_ASSERT_LESS_OR_EQUAL(deadline + TIMER_WHEEL_TICK + 10, at);
+    }
+}
+
+// Échéance déjà passée : rangée dans la prochaine case traitée
+static void test_past_deadline_fires_on_next_tick() {
+    uint32_t now = 50000;
+    expireAt(now);
+    table.schedule(insert(1), 1000);
+    table.schedule(insert(2), now - 1);
+    uint32_t at = advanceUntilFired(now, now + 10 * TIMER_WHEEL_TICK, 1);
+    TEST_ASSERT_EQUAL_size_t(2, fired.size());
+    TEST_ASSERT_LESS_OR_EQUAL(50000 + TIMER_WHEEL_TICK, at);
+}
+
+// Trois entrées dans la même case (chaînée en tête la dernière armée) :
+// réarmer ou supprimer la tête, le milieu ou la queue laisse les autres
+// à leur échéance
+static void test_slot_chain_reschedule_and_unlink() {
+    for (int position = 0; position < 3; position++) {
+        for (int removeIt = 0; removeIt < 2; removeIt++) {
+            table.clear();
+            uint32_t now = 1000;
+            expireAt(now);
+            for (uint32_t n = 0; n < 3; n++) {
+                table.schedule(insert(n), 5050);
+            }
+            uint32_t moved = 2 - position;  // Tête, milieu, queue
+            if (removeIt) {
+                table.remove(lookup(moved));
+            } else {
+                table.schedule(lookup(moved), 9000);
+            }
+
+            advanceUntilFired(now, 7000, 10);
+            TEST_ASSERT_EQUAL_size_t(2, fired.size());
+            for (uint32_t n : fired) {
+                TEST_ASSERT_TRUE(n != moved);
+            }
+            TEST_ASSERT_TRUE(now >= 5050 && now <= 5050 + TIMER_WHEEL_TICK);
+            uint32_t at = advanceUntilFired(now, 12000, 10);
+            if (removeIt) {
+                TEST_ASSERT_TRUE(fired.empty());
+            } else {
+                TEST_ASSERT_EQUAL_size_t(1, fired.size());
+                TEST_ASSERT_EQUAL_UINT32(moved, fired[0]);
+                TEST_ASSERT_TRUE(at >= 9000 && at <= 9000 + TIMER_WHEEL_TICK);
+            }
+        }
+    }
+}
+
+// Échéances de part et d'autre du passage de millis() par zéro
+static void test_timer_across_millis_wrap() {
+    uint32_t now = 0xFFFFFFFFu - 20000;
+    expireAt(now);
+    const uint32_t deadlines[] = {0xFFFFFFFFu - 5000, 0xFFFFFFFFu, 3000,
+                                  TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK * 2 + 500};
+    for (uint32_t n = 0; n < 4; n++) {
+        table.schedule(insert(n), deadlines[n]);
+    }
+    for (uint32_t n = 0; n < 4; n++) {
+        uint32_t at = advanceUntilFired(now, deadlines[3] + 10 * TIMER_WHEEL_TICK, 10);
+        TEST_ASSERT_EQUAL_size_t(1, fired.size());
+        TEST_ASSERT_EQUAL_UINT32(n, fired[0]);
+        TEST_ASSERT_TRUE((int32_t)(at - deadlines[n]) >= 0);
+        TEST_ASSERT_TRUE(at - deadlines[n] <= TIMER_WHEEL_TICK + 10);
+    }
+}
+
+// Armements, réarmements, suppressions et pauses aléatoires (jusqu'à
+// plusieurs tours du second niveau), en partant juste avant le passage par
+// zéro : une entrée n'est jamais signalée avant son échéance, ni plus de
+// TIMER_WHEEL_TICK ms après (après son armement pour une échéance passée),
+// et toujours une seule fois
+static void test_random_timers_match_reference() {
+    std::mt19937 rng(4242);
+    std::map<uint32_t, uint32_t> deadlines;
+    std::map<uint32_t, uint32_t> latest;  // Signalée au plus tard TIMER_WHEEL_TICK ms après
+    const uint32_t keys = BEACON_TABLE_CAPACITY;
+    const uint32_t lap = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK;
+    uint32_t now = 0xFFFFFFFFu - 3 * lap;
+    uint32_t firedCount = 0;
+    expireAt(now);
+
+    for (int op = 0; op < 300000; op++) {
+        uint32_t n = rng() % keys;
+        uint32_t choice = rng() % 16;
+        if (choice < 8) {
+            uint32_t delay = rng() % 4 == 0 ? rng() % (4 * TIMER_WHEEL_SLOTS * lap) : rng() % (3 * lap);
+            uint32_t deadline = rng() % 16 == 0 ? now - rng() % 5000 : now + delay;
+            table.schedule(insert(n), deadline);
+            deadlines[n] = deadline;
+            latest[n] = (int32_t)(deadline - now) < 0 ? now : deadline;
+        } else if (choice < 10 && lookup(n)) {
+            table.remove(lookup(n));
+            deadlines.erase(n);
+            latest.erase(n);
+        } else {
+            now += rng() % 1000 == 0 ? rng() % (2 * TIMER_WHEEL_SLOTS * lap) : rng() % 150;
+            fired.clear();
+            expireAt(now);
+            for (uint32_t id : fired) {
+                auto it = deadlines.find(id);
+                TEST_ASSERT_TRUE_MESSAGE(it != deadlines.end(), "échéance signalée deux fois");
+                TEST_ASSERT_TRUE_MESSAGE((int32_t)(now - it->second) >= 0, "échéance signalée trop tôt");
+                deadlines.erase(it);
+                latest.erase(id);
+                firedCount++;
+            }
+            for (const auto& item : latest) {
+                TEST_ASSERT_TRUE_MESSAGE((int32_t)(now - item.second) < (int32_t)TIMER_WHEEL_TICK,
+                                         "échéance manquée");
+            }
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(10000, firedCount);
+}
+
+// Coût d'une annonce d'un beacon connu : findOrInsert() contre l'ancien
+// chemin, identifiant texte "mac" formaté puis recherché dans une
+// std::map<std::string, BeaconInfo>
+static void test_lookup_benchmark() {
+    const uint32_t beacons = 200;
+    const uint32_t lookups = 1000000;
+    std::map<std::string, BeaconInfo> reference;
+    for (uint32_t n = 0; n < beacons; n++) {
+        BeaconInfo* beacon = insert(n);
+        char id[BEACON_ID_TEXT];
+        formatBeaconId(*beacon, id);
+        reference[id] = *beacon;
+    }
+
+    uint32_t sink = 0;
+    uint64_t start = benchNanos();
+    for (uint32_t i = 0; i < lookups; i++) {
+        sink += insert((i * 7919) % beacons)->address[5];
+    }
+    double tableNs = (double)(benchNanos() - start) / lookups;
+
+    start = benchNanos();
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint8_t address[6];
+        makeAddress((i * 7919) % beacons, address);
+        char id[BEACON_ID_TEXT];
+        snprintf(id, sizeof(id), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 address[0], address[1], address[2], address[3], address[4], address[5]);
+        sink += reference[id].address[5];
+    }
+    double mapNs = (double)(benchNanos() - start) / lookups;
+
+    char line[128];
+    snprintf(line, sizeof(line), "%lu beacons : BeaconTable %.1f ns, std::map<std::string> %.1f ns par annonce (%lu)",
+             (unsigned long)beacons, tableNs, mapNs, (unsigned long)(sink & 1));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(tableNs < mapNs);
+}
+
+// Un tour de roue (expire() toutes les TIMER_WHEEL_TICK ms) quand la table
+// entière attend l'échéance lointaine d'un beacon absent
+// (BEACON_RECLAIM_GRACE, 600 s), comparé à une table vide : ces échéances
+// attendent au second niveau sans être visitées à chaque tour
+static void test_wheel_lap_benchmark() {
+    const uint32_t grace = 600000;
+    const uint32_t laps = 40;
+    double ns[2];
+    for (int full = 0; full < 2; full++) {
+        table.clear();
+        uint32_t now = 1000;
+        for (uint32_t n = 0; full && n < BEACON_TABLE_CAPACITY; n++) {
+            table.schedule(insert(n), now + grace);
+        }
+        fired.clear();
+        uint64_t start = benchNanos();
+        for (uint32_t i = 0; i < laps * TIMER_WHEEL_SLOTS; i++) {
+            now += TIMER_WHEEL_TICK;
+            expireAt(now);
+        }
+        ns[full] = (double)(benchNanos() - start) / laps;
+        TEST_ASSERT_TRUE(fired.empty());
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "Tour de roue : %.0f ns vide, %.0f ns avec %lu échéances à 600 s", ns[0], ns[1],
+             (unsigned long)BEACON_TABLE_CAPACITY);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(ns[1] < 2 * ns[0] + 1000);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_and_find);
+    RUN_TEST(test_ibeacon_key_includes_uuid);
+    RUN_TEST(test_remove);
+    RUN_TEST(test_backward_shift_across_wrap);
+    RUN_TEST(test_random_operations_match_reference);
+    RUN_TEST(test_eviction_prefers_absent);
+    RUN_TEST(test_timer_beyond_one_lap);
+    RUN_TEST(test_past_deadline_fires_on_next_tick);
+    RUN_TEST(test_slot_chain_reschedule_and_unlink);
+    RUN_TEST(test_timer_across_millis_wrap);
+    RUN_TEST(test_random_timers_match_reference);
+    RUN_TEST(test_lookup_benchmark);
+    RUN_TEST(test_wheel_lap_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// Transfert Block1 de CoapTransport : un lot de plusieurs blocs, chacun
+// acquitté (2.31 Continue) avant le suivant, puis la réponse finale ;
+// retransmissions quand des datagrammes sont perdus ; mode NON ; statut
+// d'erreur du serveur. Contre le serveur CoAP intégré à la simulation, et
+// contre Backend/CoapServer.js si COAP_SERVER=hôte:port est défini :
+//   node Backend/CoapServer.js &
+//   COAP_SERVER=127.0.0.1:5683 pio test -e native -f test_coap_block1
+// pio test -e native -f test_coap_block1
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CoapTransport.h"
+#include "../TransportFixture.h"
+
+// Assez d'événements pour dépasser trois blocs de COAP_BLOCK_SIZE
+static const size_t EVENTS = 20;
+static const uint8_t DEVICE_MAC[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+
+static PendingEvent events[EVENTS];
+
+void setUp() {
+    simUseRealCoapServer(false);
+    setUpNetwork(20);
+    fillEvents(events, EVENTS);
+}
+
+void tearDown() {}
+
+// Un lot en plusieurs blocs est acquitté une seule fois par le serveur,
+// qui répond 4.08 à un bloc hors séquence
+static void test_block1_transfer_is_acknowledged() {
+    CoapTransport transport("127.0.0.1", 5683);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000001");
+    SimNetworkStats before = simNetworkStats();
+
+    TEST_ASSERT_EQUAL_INT(204, transport.send(events, EVENTS));
+    TEST_ASSERT_EQUAL_UINT32(before.posts + 1, simNetworkStats().posts);
+    TEST_ASSERT_GREATER_OR_EQUAL(before.datagrams + 3, simNetworkStats().datagrams);
+    TEST_ASSERT_EQUAL_UINT32(0, transport.retransmissionCount());
+
+    // Un seul bloc : pas d'option Block1, même acquittement
+    TEST_ASSERT_EQUAL_INT(204, transport.send(events, 1));
+    TEST_ASSERT_EQUAL_UINT32(before.posts + 2, simNetworkStats().posts);
+}
+
+// Perte de datagrammes dans les deux sens : les blocs ou leurs ACK perdus
+// sont retransmis, et un bloc rejoué reçoit la même réponse
+static void test_lost_blocks_are_retransmitted() {
+    simNetworkConfig().datagramLossPercent = 20;
+    CoapTransport transport("127.0.0.1", 5683);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000001");
+    SimNetworkStats before = simNetworkStats();
+
+    int delivered = 0;
+    for (int i = 0; i < 5; i++) {
+        delivered += transport.send(events, EVENTS) == 204 ? 1 : 0;
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "20 %% de pertes : %d lots sur 5 acquittés, %lu retransmissions", delivered,
+             (unsigned long)transport.retransmissionCount());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_INT(5, delivered);
+    TEST_ASSERT_EQUAL_UINT32(before.posts + 5, simNetworkStats().posts);
+    TEST_ASSERT_GREATER_THAN(0, transport.retransmissionCount());
+}
+
+// Mode NON : les blocs partent à la suite, sans attendre le serveur
+static void test_non_confirmable_sends_all_blocks() {
+    CoapTransport transport("127.0.0.1", 5683, false);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000001");
+    SimNetworkStats before = simNetworkStats();
+    uint32_t start = halMillis();
+
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, EVENTS));
+    TEST_ASSERT_EQUAL_UINT32(start, halMillis());
+    TEST_ASSERT_GREATER_OR_EQUAL(before.datagrams + 3, simNetworkStats().datagrams);
+    TEST_ASSERT_EQUAL_UINT32(before.posts + 1, simNetworkStats().posts);
+}
+
+// Statut d'erreur du serveur sur le dernier bloc, rendu tel quel
+static void test_server_error_is_returned() {
+    simNetworkConfig().statusCode = 503;
+    CoapTransport transport("127.0.0.1", 5683);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000001");
+    TEST_ASSERT_EQUAL_INT(503, transport.send(events, EVENTS));
+}
+
+// Même transfert contre CoapServer.js (bibliothèque coap de Node), qui
+// reconstitue le lot avant de répondre
+static void test_block1_against_coap_server_js() {
+    const char* server = getenv("COAP_SERVER");
+    if (!server) {
+        TEST_IGNORE_MESSAGE("COAP_SERVER non défini (node Backend/CoapServer.js, puis COAP_SERVER=127.0.0.1:5683)");
+    }
+    static char host[64];
+    strncpy(host, server, sizeof(host) - 1);
+    char* colon = strrchr(host, ':');
+    uint16_t port = 5683;
+    if (colon) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+
+    simUseRealCoapServer(true);
+    CoapTransport transport(host, port);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000001");
+    int status = transport.send(events, EVENTS);
+    simUseRealCoapServer(false);
+    char line[96];
+    snprintf(line, sizeof(line), "%s : statut %d, %lu retransmissions", server, status,
+             (unsigned long)transport.retransmissionCount());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(status >= 200 && status < 300);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_block1_transfer_is_acknowledged);
+    RUN_TEST(test_lost_blocks_are_retransmitted);
+    RUN_TEST(test_non_confirmable_sends_all_blocks);
+    RUN_TEST(test_server_error_is_returned);
+    RUN_TEST(test_block1_against_coap_server_js);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+// Rejet des doublons (DuplicateFilter) : une annonce inchangée est écartée
+// pendant l'intervalle de rafraîchissement, transmise de nouveau ensuite
+// (défaut ou intervalle propre au beacon), et dès que son contenu ou sa
+// tranche de RSSI change. Deux beacons dans la même entrée du cache
+// s'écrasent sans jamais s'écarter l'un l'autre ; vérifié aussi sur un flux
+// aléatoire de beacons bien plus nombreux que les entrées.
+// pio test -e native -f test_duplicate_filter
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "DuplicateFilter.h"
+
+static DuplicateFilter* filter;
+
+void setUp() {
+    delete filter;
+    filter = new DuplicateFilter();
+}
+
+void tearDown() {}
+
+static AdvRecord record(uint32_t beacon, uint8_t content, int8_t rssi, uint32_t timestamp) {
+    AdvRecord result;
+    memset(&result, 0, sizeof(result));
+    result.address[0] = 0xC0;
+    result.address[1] = 0xDE;
+    result.address[2] = (uint8_t)(beacon >> 24);
+    result.address[3] = (uint8_t)(beacon >> 16);
+    result.address[4] = (uint8_t)(beacon >> 8);
+    result.address[5] = (uint8_t)beacon;
+    result.rssi = rssi;
+    result.timestamp = timestamp;
+    const uint8_t payload[] = {0x02, 0x01, 0x06, 0x03, 0xFF, 0x59, content};
+    memcpy(result.payload, payload, sizeof(payload));
+    result.payloadLength = sizeof(payload);
+    return result;
+}
+
+static void test_duplicate_is_suppressed_until_refresh() {
+    if (!ADV_DEDUP) {
+        TEST_IGNORE_MESSAGE("ADV_DEDUP=0 : aucune annonce écartée");
+    }
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 1000)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 1001)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 1000 + ADV_DEDUP_REFRESH - 1)));
+    TEST_ASSERT_EQUAL_UINT32(2, filter->suppressedCount());
+
+    // L'intervalle repart de la dernière annonce transmise
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 1000 + ADV_DEDUP_REFRESH)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 1000 + 2 * ADV_DEDUP_REFRESH - 1)));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 1000 + 2 * ADV_DEDUP_REFRESH)));
+    TEST_ASSERT_EQUAL_UINT32(3, filter->suppressedCount());
+
+    // Passage de millis() par zéro
+    uint32_t late = 0xFFFFFFFFu - ADV_DEDUP_REFRESH / 2;
+    TEST_ASSERT_TRUE(filter->accept(record(2, 0, -70, late)));
+    TEST_ASSERT_FALSE(filter->accept(record(2, 0, -70, late + ADV_DEDUP_REFRESH - 1)));
+    TEST_ASSERT_TRUE(filter->accept(record(2, 0, -70, late + ADV_DEDUP_REFRESH)));
+}
+
+static void test_refresh_interval_override() {
+    if (!ADV_DEDUP) {
+        TEST_IGNORE_MESSAGE("ADV_DEDUP=0 : aucune annonce écartée");
+    }
+    AdvRecord first = record(1, 0, -70, 0);
+    TEST_ASSERT_TRUE(filter->setRefreshInterval(first.address, 5000));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 1000)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 1000 + ADV_DEDUP_REFRESH)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 5999)));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 6000)));
+
+    // Une trame déjà en cache reprend le nouvel intervalle
+    TEST_ASSERT_TRUE(filter->accept(record(3, 0, -70, 1000)));
+    AdvRecord third = record(3, 0, -70, 0);
+    TEST_ASSERT_TRUE(filter->setRefreshInterval(third.address, 200));
+    TEST_ASSERT_FALSE(filter->accept(record(3, 0, -70, 1199)));
+    TEST_ASSERT_TRUE(filter->accept(record(3, 0, -70, 1200)));
+
+    // 0 : rien n'est écarté pour ce beacon, les autres gardent le défaut
+    TEST_ASSERT_TRUE(filter->setRefreshInterval(first.address, 0));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 6000)));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 6000)));
+    TEST_ASSERT_TRUE(filter->accept(record(4, 0, -70, 6000)));
+    TEST_ASSERT_FALSE(filter->accept(record(4, 0, -70, 6001)));
+
+    // Table des intervalles pleine
+    for (uint32_t beacon = 100; beacon < 100 + ADV_DEDUP_OVERRIDES - 2; beacon++) {
+        TEST_ASSERT_TRUE(filter->setRefreshInterval(record(beacon, 0, 0, 0).address, 300));
+    }
+    TEST_ASSERT_FALSE(filter->setRefreshInterval(record(999, 0, 0, 0).address, 300));
+    TEST_ASSERT_TRUE(filter->setRefreshInterval(first.address, 100));
+}
+
+static void test_changed_payload_or_rssi_bucket_is_admitted() {
+    if (!ADV_DEDUP) {
+        TEST_IGNORE_MESSAGE("ADV_DEDUP=0 : aucune annonce écartée");
+    }
+    TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, 1000)));
+    TEST_ASSERT_TRUE(filter->accept(record(1, 1, -70, 1001)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 0, -70, 1002)));
+    TEST_ASSERT_FALSE(filter->accept(record(1, 1, -70, 1003)));
+
+    // Tranches de ADV_DEDUP_RSSI_STEP dB à partir de -128
+    int8_t low = (int8_t)(-128 + 14 * ADV_DEDUP_RSSI_STEP);
+    int8_t high = (int8_t)(low + ADV_DEDUP_RSSI_STEP - 1);
+    TEST_ASSERT_TRUE(filter->accept(record(2, 0, low, 1000)));
+    TEST_ASSERT_FALSE(filter->accept(record(2, 0, high, 1001)));
+    TEST_ASSERT_TRUE(filter->accept(record(2, 0, (int8_t)(high + 1), 1002)));
+    TEST_ASSERT_TRUE(filter->accept(record(2, 0, high, 1003)));
+    TEST_ASSERT_FALSE(filter->accept(record(2, 0, low, 1004)));
+
+    // Même contenu, autre longueur
+    AdvRecord shorter = record(1, 0, -70, 1005);
+    shorter.payloadLength--;
+    TEST_ASSERT_TRUE(filter->accept(shorter));
+}
+
+// Même FNV-1a que DuplicateFilter.cpp, pour trouver l'entrée d'une trame
+static uint32_t hashBytes(const uint8_t* data, size_t length, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static size_t slotOf(const AdvRecord& rec) {
+    uint32_t addressHash = hashBytes(rec.address, sizeof(rec.address));
+    return ((hashBytes(rec.payload, rec.payloadLength, addressHash) | 1) >> 1) & (ADV_DEDUP_SLOTS - 1);
+}
+
+// Deux beacons dans la même entrée : chacun écrase l'autre et reste transmis
+static void test_slot_collision_never_suppresses_another_beacon() {
+    uint32_t other = 2;
+    while (slotOf(record(other, 0, -70, 0)) != slotOf(record(1, 0, -70, 0))) {
+        other++;
+    }
+    for (uint32_t t = 1000; t < 1000 + ADV_DEDUP_REFRESH; t += 50) {
+        TEST_ASSERT_TRUE(filter->accept(record(1, 0, -70, t)));
+        TEST_ASSERT_TRUE(filter->accept(record(other, 0, -70, t)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, filter->suppressedCount());
+
+    // Seul, il est de nouveau écarté
+    TEST_ASSERT_TRUE(!ADV_DEDUP || !filter->accept(record(other, 0, -70, 1000 + ADV_DEDUP_REFRESH)));
+}
+
+static uint32_t randomState = 1;
+
+// xorshift32
+static uint32_t nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+// 4096 beacons à deux trames pour 256 entrées : une annonce n'est écartée
+// que si exactement la même (adresse, contenu, tranche) a été transmise
+// moins de ADV_DEDUP_REFRESH ms plus tôt
+static void test_random_stream_only_suppresses_true_duplicates() {
+    struct Forwarded {
+        uint32_t at;
+        int bucket;
+    };
+    std::map<std::string, Forwarded> lastForwarded;
+    uint32_t now = 0, suppressed = 0;
+    const uint32_t rounds = 2000000;
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        now += nextRandom() % 3;
+        uint32_t beacon = nextRandom() % (nextRandom() % 8 == 0 ? 4096 : 64);
+        AdvRecord rec = record(beacon, (uint8_t)(nextRandom() % 2), (int8_t)(-70 - (int)(nextRandom() % 3)), now);
+        std::string key((const char*)rec.address, 6);
+        key.append((const char*)rec.payload, rec.payloadLength);
+        int bucket = (rec.rssi + 128) / ADV_DEDUP_RSSI_STEP;
+
+        if (filter->accept(rec)) {
+            lastForwarded[key] = {now, bucket};
+        } else {
+            auto found = lastForwarded.find(key);
+            bool duplicate = found != lastForwarded.end() && found->second.bucket == bucket &&
+                             now - found->second.at < ADV_DEDUP_REFRESH;
+            if (!duplicate) {
+                char message[96];
+                snprintf(message, sizeof(message), "annonce %lu du beacon %lu écartée à tort", (unsigned long)i,
+                         (unsigned long)beacon);
+                TEST_FAIL_MESSAGE(message);
+            }
+            suppressed++;
+        }
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu annonces, %lu écartées", (unsigned long)rounds, (unsigned long)suppressed);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(suppressed, filter->suppressedCount());
+    TEST_ASSERT_TRUE(!ADV_DEDUP || suppressed > rounds / 2);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicate_is_suppressed_until_refresh);
+    RUN_TEST(test_refresh_interval_override);
+    RUN_TEST(test_changed_payload_or_rssi_bucket_is_admitted);
+    RUN_TEST(test_slot_collision_never_suppresses_another_beacon);
+    RUN_TEST(test_random_stream_only_suppresses_true_duplicates);
+    return UNITY_END();
+}
@@ -0,0 +1,235 @@
+// Encodeur du format binaire des lots (EventCodec) contre les vecteurs
+// partagés avec le décodeur du backend (test/vectors/event_codec.txt,
+// relus par Backend/eventCodec.test.js) : octet pour octet, et heures
+// réelles attendues de chaque événement.
+// pio test -e native -f test_event_codec
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "EventCodec.h"
+
+// Fichier des vecteurs, à côté du dossier de ce test
+#ifndef EVENT_CODEC_VECTORS
+static std::string vectorsPath() {
+    std::string path = __FILE__;
+    size_t slash = path.find_last_of('/');
+    path = slash == std::string::npos ? "." : path.substr(0, slash);
+    return path + "/../vectors/event_codec.txt";
+}
+#else
+static std::string vectorsPath() {
+    return EVENT_CODEC_VECTORS;
+}
+#endif
+
+struct ExpectedTimes {
+    uint64_t enqueuedAt;
+    uint64_t receivedAt;
+};
+
+struct CodecVector {
+    std::string name;
+    bool decodeOnly = false;
+    uint8_t device[6] = {};
+    TraceClock clock = {0, 0};
+    std::vector<PendingEvent> events;
+    std::vector<ExpectedTimes> times;
+    std::vector<uint8_t> bytes;
+};
+
+static std::vector<CodecVector> vectors;
+
+void setUp() {}
+void tearDown() {}
+
+static void parseHex(const char* text, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        char pair[3] = {text[2 * i], text[2 * i + 1], '\0'};
+        out[i] = (uint8_t)strtoul(pair, nullptr, 16);
+    }
+}
+
+// "c0:de:00:00:00:01" ou "e2c56db5-dffb-..." : séparateurs ignorés
+static void parseSeparatedHex(const char* text, uint8_t* out, size_t count) {
+    std::string digits;
+    for (const char* c = text; *c; c++) {
+        if (*c != ':' && *c != '-') {
+            digits += *c;
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(2 * count, digits.size());
+    parseHex(digits.c_str(), out, count);
+}
+
+static uint8_t frameType(const char* name) {
+    static const char* const names[] = {"none", "ibeacon", "altbeacon", "eddystone-uid", "eddystone-url",
+                                        "eddystone-tlm"};
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(names[i], name) == 0) {
+            return i;
+        }
+    }
+    TEST_FAIL_MESSAGE(name);
+    return 0;
+}
+
+static void parseEvent(char* fields, CodecVector& vector) {
+    PendingEvent event;
+    memset(&event, 0, sizeof(event));
+    ExpectedTimes times = {0, 0};
+    char* type = strtok(fields, " \t\r\n");
+    event.eventType = strcmp(type, "departure") == 0 ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+
+    for (char* field = strtok(nullptr, " \t\r\n"); field; field = strtok(nullptr, " \t\r\n")) {
+        char* value = strchr(field, '=');
+        TEST_ASSERT_NOT_NULL_MESSAGE(value, field);
+        *value++ = '\0';
+        BeaconInfo& beacon = event.beacon;
+        if (strcmp(field, "address") == 0) {
+            parseSeparatedHex(value, beacon.address, 6);
+        } else if (strcmp(field, "uuid") == 0) {
+            parseSeparatedHex(value, beacon.proximityUUID, 16);
+            beacon.isIBeacon = true;
+        } else if (strcmp(field, "frame") == 0) {
+            beacon.frameType = frameType(value);
+        } else if (strcmp(field, "major") == 0) {
+            beacon.major = (uint16_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(field, "minor") == 0) {
+            beacon.minor = (uint16_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(field, "rssi") == 0) {
+            beacon.rssi = (int8_t)strtol(value, nullptr, 10);
+        } else if (strcmp(field, "tx") == 0) {
+            beacon.txPower = (int8_t)strtol(value, nullptr, 10);
+        } else if (strcmp(field, "timestamp") == 0) {
+            event.timestamp = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(field, "received") == 0) {
+            event.receivedAt = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(field, "trace") == 0) {
+            event.traceId = (uint32_t)strtoul(value, nullptr, 16);
+        } else if (strcmp(field, "epoch") == 0) {
+            event.epoch = strcmp(value, "unknown") == 0 ? EVENT_EPOCH_UNKNOWN : strtoull(value, nullptr, 10);
+        } else if (strcmp(field, "enqueuedAt") == 0) {
+            times.enqueuedAt = strtoull(value, nullptr, 10);
+        } else if (strcmp(field, "receivedAt") == 0) {
+            times.receivedAt = strtoull(value, nullptr, 10);
+        } else {
+            TEST_FAIL_MESSAGE(field);
+        }
+    }
+    vector.events.push_back(event);
+    vector.times.push_back(times);
+}
+
+static void loadVectors() {
+    FILE* file = fopen(vectorsPath().c_str(), "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, vectorsPath().c_str());
+    char line[512];
+    CodecVector current;
+    while (fgets(line, sizeof(line), file)) {
+        char* keyword = strtok(line, " \t\r\n");
+        char* rest = strtok(nullptr, "\r\n");
+        if (!keyword || keyword[0] == '#') {
+            continue;
+        }
+        if (strcmp(keyword, "vector") == 0) {
+            current = CodecVector();
+            current.name = rest ? rest : "";
+        } else if (strcmp(keyword, "decode-only") == 0) {
+            current.decodeOnly = true;
+        } else if (strcmp(keyword, "device") == 0) {
+            parseHex(rest, current.device, 6);
+        } else if (strcmp(keyword, "clock") == 0) {
+            unsigned long millis = 0;
+            unsigned long long epoch = 0;
+            TEST_ASSERT_EQUAL_INT(2, sscanf(rest, "%lu %llu", &millis, &epoch));
+            current.clock.millis = (uint32_t)millis;
+            current.clock.epoch = epoch;
+        } else if (strcmp(keyword, "event") == 0) {
+            parseEvent(rest, current);
+        } else if (strcmp(keyword, "bytes") == 0) {
+            std::string digits;
+            for (const char* c = rest ? rest : ""; *c; c++) {
+                if (*c != ' ' && *c != '\t') {
+                    digits += *c;
+                }
+            }
+            size_t offset = current.bytes.size();
+            current.bytes.resize(offset + digits.size() / 2);
+            parseHex(digits.c_str(), current.bytes.data() + offset, digits.size() / 2);
+        } else if (strcmp(keyword, "end") == 0) {
+            vectors.push_back(current);
+        }
+    }
+    fclose(file);
+}
+
+static std::string toHex(const uint8_t* data, size_t length) {
+    std::string text;
+    char pair[3];
+    for (size_t i = 0; i < length; i++) {
+        snprintf(pair, sizeof(pair), "%02x", data[i]);
+        text += pair;
+    }
+    return text;
+}
+
+static void test_vectors_are_loaded() {
+    loadVectors();
+    TEST_ASSERT_GREATER_THAN(4, vectors.size());
+    size_t encoded = 0;
+    for (const CodecVector& vector : vectors) {
+        TEST_ASSERT_FALSE_MESSAGE(vector.events.empty(), vector.name.c_str());
+        TEST_ASSERT_FALSE_MESSAGE(vector.bytes.empty(), vector.name.c_str());
+        encoded += vector.decodeOnly ? 0 : 1;
+    }
+    TEST_ASSERT_GREATER_THAN(3, encoded);
+}
+
+// Octet pour octet ; en cas d'écart, les octets produits sont affichés
+static void test_encoder_matches_vectors() {
+    for (const CodecVector& vector : vectors) {
+        if (vector.decodeOnly) {
+            continue;
+        }
+        size_t count = vector.events.size();
+        std::vector<uint8_t> out(encodedSizeBound(count));
+        size_t length = encodeEvents(vector.device, vector.events.data(), count, vector.clock, out.data(), out.size());
+        std::string actual = toHex(out.data(), length);
+        std::string expected = toHex(vector.bytes.data(), vector.bytes.size());
+        if (actual != expected) {
+            std::string message = vector.name + " : " + actual;
+            TEST_MESSAGE(message.c_str());
+        }
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected.c_str(), actual.c_str(), vector.name.c_str());
+
+        // Trop petit d'un octet : rien n'est écrit
+        TEST_ASSERT_EQUAL_size_t(0, encodeEvents(vector.device, vector.events.data(), count, vector.clock,
+                                                 out.data(), length - 1));
+    }
+}
+
+// Heures réelles que le décodeur doit retrouver, vues côté firmware
+static void test_trace_times_match_vectors() {
+    for (const CodecVector& vector : vectors) {
+        if (vector.decodeOnly) {
+            continue;
+        }
+        for (size_t i = 0; i < vector.events.size(); i++) {
+            const PendingEvent& event = vector.events[i];
+            TEST_ASSERT_TRUE_MESSAGE(vector.times[i].enqueuedAt == vector.clock.enqueuedAt(event), vector.name.c_str());
+            TEST_ASSERT_TRUE_MESSAGE(vector.times[i].receivedAt == vector.clock.receivedAt(event), vector.name.c_str());
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_vectors_are_loaded);
+    RUN_TEST(test_encoder_matches_vectors);
+    RUN_TEST(test_trace_times_match_vectors);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// Diffusion /ws (EventPush) contre un serveur web factice : abonnement,
+// désabonnement, retrait d'un abonné dont l'envoi échoue, et file vidée
+// quand le dernier abonné s'en va.
+// pio test -e native -f test_event_push
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "EventPush.h"
+
+// Serveur web factice : garde les messages reçus par chaque abonné et
+// refuse les envois vers failing
+struct Delivery {
+    int subscriber;
+    std::string message;
+};
+
+static std::vector<Delivery> deliveries;
+static int failing;
+static int notifications;
+
+static bool fakeSend(int subscriber, const char* data, size_t length) {
+    if (subscriber == failing) {
+        return false;
+    }
+    deliveries.push_back({subscriber, std::string(data, length)});
+    return true;
+}
+
+static void countNotify() {
+    notifications++;
+}
+
+static EventPush* push;
+
+void setUp() {
+    static EventPush instances[8];
+    static size_t next;
+    TEST_ASSERT_LESS_THAN(8, next);
+    push = &instances[next++];
+    push->setNotify(countNotify);
+    push->setDeviceId("ESP32_TEST");
+    deliveries.clear();
+    failing = -1;
+    notifications = 0;
+}
+
+void tearDown() {}
+
+static void publish(uint32_t traceId) {
+    PendingEvent event;
+    memset(&event, 0, sizeof(event));
+    event.eventType = EVENT_ARRIVAL;
+    event.beacon.address[0] = 0xC0;
+    event.beacon.address[5] = (uint8_t)traceId;
+    strcpy(event.beacon.uuid, "N/A");
+    event.beacon.rssi = -70;
+    event.traceId = traceId;
+    push->publish(event);
+}
+
+// Messages reçus par un abonné, par traceId, dans l'ordre
+static std::vector<uint32_t> receivedBy(int subscriber) {
+    std::vector<uint32_t> traceIds;
+    for (const Delivery& delivery : deliveries) {
+        if (delivery.subscriber != subscriber) {
+            continue;
+        }
+        const char* field = strstr(delivery.message.c_str(), "\"traceId\":\"");
+        TEST_ASSERT_NOT_NULL_MESSAGE(field, delivery.message.c_str());
+        traceIds.push_back((uint32_t)strtoul(field + 11, nullptr, 16));
+    }
+    return traceIds;
+}
+
+static void assertReceived(int subscriber, std::vector<uint32_t> expected) {
+    std::vector<uint32_t> actual = receivedBy(subscriber);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i], actual[i]);
+    }
+}
+
+// Chaque abonné reçoit chaque événement, un seul réveil jusqu'au drain()
+static void test_every_subscriber_receives_events() {
+    TEST_ASSERT_TRUE(push->subscribe(10));
+    TEST_ASSERT_TRUE(push->subscribe(11));
+    publish(1);
+    publish(2);
+    TEST_ASSERT_EQUAL_INT(1, notifications);
+
+    TEST_ASSERT_EQUAL_size_t(2, push->drain(fakeSend));
+    assertReceived(10, {1, 2});
+    assertReceived(11, {1, 2});
+    TEST_ASSERT_EQUAL_UINT32(2, push->messages());
+    TEST_ASSERT_NOT_NULL(strstr(deliveries[0].message.c_str(), "\"deviceId\":\"ESP32_TEST\""));
+
+    publish(3);
+    TEST_ASSERT_EQUAL_INT(2, notifications);
+}
+
+// Sans abonné, publish() ne met rien en file et ne réveille personne
+static void test_no_subscriber_no_queue() {
+    publish(1);
+    TEST_ASSERT_EQUAL_INT(0, notifications);
+    TEST_ASSERT_TRUE(push->subscribe(10));
+    TEST_ASSERT_EQUAL_size_t(0, push->drain(fakeSend));
+    TEST_ASSERT_EQUAL_size_t(0, deliveries.size());
+}
+
+// Liste pleine : l'abonné de trop est refusé et compté
+static void test_full_subscriber_list_rejects() {
+    for (int i = 0; i < EVENT_PUSH_SUBSCRIBERS; i++) {
+        TEST_ASSERT_TRUE(push->subscribe(10 + i));
+    }
+    TEST_ASSERT_FALSE(push->subscribe(99));
+    TEST_ASSERT_EQUAL_UINT32(1, push->rejected());
+    TEST_ASSERT_EQUAL_UINT32(EVENT_PUSH_SUBSCRIBERS, push->subscriberTotal());
+}
+
+// Un abonné désinscrit ne reçoit plus rien, les autres continuent
+static void test_unsubscribe_stops_delivery() {
+    push->subscribe(10);
+    push->subscribe(11);
+    push->subscribe(12);
+    publish(1);
+    push->drain(fakeSend);
+    push->unsubscribe(10);
+    publish(2);
+    push->drain(fakeSend);
+
+    assertReceived(10, {1});
+    assertReceived(11, {1, 2});
+    assertReceived(12, {1, 2});
+    TEST_ASSERT_EQUAL_UINT32(2, push->subscriberTotal());
+}
+
+// L'abonné dont l'envoi échoue est retiré ; celui qui prend sa place dans
+// la liste reçoit quand même le message en cours
+static void test_failed_send_removes_subscriber() {
+    push->subscribe(10);
+    push->subscribe(11);
+    push->subscribe(12);
+    publish(1);
+    failing = 10;
+    TEST_ASSERT_EQUAL_size_t(1, push->drain(fakeSend));
+    failing = -1;
+    publish(2);
+    push->drain(fakeSend);
+
+    assertReceived(10, {});
+    assertReceived(11, {1, 2});
+    assertReceived(12, {1, 2});
+    TEST_ASSERT_EQUAL_UINT32(2, push->subscriberTotal());
+}
+
+// Le dernier abonné part avant le drain() : le suivant ne reçoit pas ces
+// événements, seulement ceux publiés après sa connexion
+static void test_last_unsubscribe_empties_queue() {
+    push->subscribe(10);
+    publish(1);
+    publish(2);
+    push->unsubscribe(10);
+    publish(3);  // Personne : ignoré
+
+    push->subscribe(11);
+    publish(4);
+    TEST_ASSERT_EQUAL_size_t(1, push->drain(fakeSend));
+    assertReceived(10, {});
+    assertReceived(11, {4});
+    TEST_ASSERT_EQUAL_UINT32(1, push->messages());
+}
+
+// Le dernier abonné est retiré sur un échec au milieu du drain() : le
+// reste de la file est abandonné, ni compté ni gardé pour le suivant
+static void test_last_failed_send_empties_queue() {
+    push->subscribe(10);
+    publish(1);
+    publish(2);
+    publish(3);
+    failing = 10;
+    TEST_ASSERT_EQUAL_size_t(0, push->drain(fakeSend));
+    TEST_ASSERT_EQUAL_UINT32(0, push->subscriberTotal());
+    TEST_ASSERT_EQUAL_UINT32(0, push->messages());
+
+    failing = -1;
+    push->subscribe(11);
+    TEST_ASSERT_EQUAL_size_t(0, push->drain(fakeSend));
+    publish(4);
+    push->drain(fakeSend);
+    assertReceived(11, {4});
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_subscriber_receives_events);
+    RUN_TEST(test_no_subscriber_no_queue);
+    RUN_TEST(test_full_subscriber_list_rejects);
+    RUN_TEST(test_unsubscribe_stops_delivery);
+    RUN_TEST(test_failed_send_removes_subscriber);
+    RUN_TEST(test_last_unsubscribe_empties_queue);
+    RUN_TEST(test_last_failed_send_empties_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,391 @@
+// Spool des événements (EventSpool) sur la partition simulée de l'hôte
+// (fichier STORAGE_ROOT/test_spool.bin, mêmes règles d'effacement et
+// d'écriture que la flash) : reprise après redémarrage, écriture
+// interrompue, CRC faux, tour complet de la partition, acquittement (y
+// compris après des ajouts concurrents) et alternance des secteurs de
+// métadonnées.
+// pio test -e native -f test_event_spool
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "EventSpool.h"
+#include "Hal.h"
+
+#define TEST_PARTITION "test_spool"
+
+static const uint32_t RECORDS_PER_SECTOR = SPOOL_SECTOR_SIZE / sizeof(SpoolRecord);
+static const uint32_t SLOTS = (SPOOL_HOST_PARTITION_SIZE / SPOOL_SECTOR_SIZE - 2) * RECORDS_PER_SECTOR;
+static const uint32_t META_ENTRIES = SPOOL_SECTOR_SIZE / 8;
+
+// Support qui refuse les écritures à la demande (flash défaillante)
+class FailingStorage : public SpoolStorage {
+public:
+    SpoolStorage& inner;
+    bool failWrites = false;
+
+    explicit FailingStorage(SpoolStorage& inner) : inner(inner) {}
+    size_t size() const override { return inner.size(); }
+    bool readAt(uint32_t offset, void* data, size_t length) override { return inner.readAt(offset, data, length); }
+    bool writeAt(uint32_t offset, const void* data, size_t length) override {
+        return !failWrites && inner.writeAt(offset, data, length);
+    }
+    bool erase(uint32_t offset, size_t length) override { return !failWrites && inner.erase(offset, length); }
+};
+
+void setUp() {
+    remove(STORAGE_ROOT "/" TEST_PARTITION ".bin");
+}
+
+void tearDown() {
+    remove(STORAGE_ROOT "/" TEST_PARTITION ".bin");
+}
+
+static PendingEvent makeEvent(uint32_t n) {
+    PendingEvent event;
+    memset(&event, 0, sizeof(event));
+    event.eventType = n % 2 ? EVENT_DEPARTURE : EVENT_ARRIVAL;
+    event.timestamp = 1000 + n;
+    event.receivedAt = 900 + n;
+    event.traceId = n;
+    event.epoch = 1700000000000ULL + n;
+    event.beacon.address[0] = 0xC0;
+    event.beacon.address[5] = (uint8_t)n;
+    event.beacon.rssi = -70;
+    event.beacon.major = (uint16_t)n;
+    snprintf(event.beacon.name, sizeof(event.beacon.name), "Tag-%03u-abcdefghijkl", (unsigned)(n % 1000));
+    return event;
+}
+
+static void appendRange(EventSpool& spool, uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        TEST_ASSERT_TRUE(spool.append(makeEvent(n)));
+    }
+    TEST_ASSERT_TRUE(spool.flush());
+}
+
+// Position d'une séquence sur la partition (deux secteurs de métadonnées)
+static uint32_t offsetOf(uint32_t sequence) {
+    uint32_t slot = sequence % SLOTS;
+    return (2 + slot / RECORDS_PER_SECTOR) * SPOOL_SECTOR_SIZE + (slot % RECORDS_PER_SECTOR) * sizeof(SpoolRecord);
+}
+
+// Retire tout le spool en vérifiant que les traceId se suivent
+static uint32_t drain(EventSpool& spool, uint32_t expectedFirst, uint32_t* skipped = nullptr) {
+    PendingEvent batch[16];
+    uint32_t count = 0;
+    uint32_t next = expectedFirst;
+    size_t got;
+    while ((got = spool.peek(batch, 16)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            if (skipped && batch[i].traceId != next) {
+                *skipped += batch[i].traceId - next;
+            } else {
+                TEST_ASSERT_EQUAL_UINT32(next, batch[i].traceId);
+            }
+            next = batch[i].traceId + 1;
+            count++;
+        }
+        spool.consume(got);
+    }
+    TEST_ASSERT_TRUE(spool.empty());
+    return count;
+}
+
+static void test_roundtrip_keeps_fields() {
+    PartitionSpoolStorage storage;
+    TEST_ASSERT_TRUE(storage.open(TEST_PARTITION));
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    TEST_ASSERT_EQUAL_size_t(SLOTS - RECORDS_PER_SECTOR, spool.capacity());
+    TEST_ASSERT_TRUE(spool.empty());
+
+    TEST_ASSERT_TRUE(spool.append(makeEvent(7)));
+    PendingEvent out;
+    TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));  // Encore en RAM
+    TEST_ASSERT_TRUE(spool.flush());
+    TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));  // Relu de la flash
+
+    PendingEvent in = makeEvent(7);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_DEPARTURE, out.eventType);
+    TEST_ASSERT_EQUAL_UINT32(in.timestamp, out.timestamp);
+    TEST_ASSERT_EQUAL_UINT32(in.receivedAt, out.receivedAt);
+    TEST_ASSERT_EQUAL_UINT32(7, out.traceId);
+    TEST_ASSERT_TRUE(out.epoch == in.epoch);
+    TEST_ASSERT_EQUAL_MEMORY(in.beacon.address, out.beacon.address, 6);
+    TEST_ASSERT_EQUAL_UINT16(7, out.beacon.major);
+    TEST_ASSERT_EQUAL_STRING(in.beacon.name, out.beacon.name);
+    TEST_ASSERT_EQUAL_STRING("N/A", out.beacon.uuid);
+}
+
+// Champs de suivi resserrés : réception plafonnée à 65,535 s avant la mise
+// en file, heure réelle inconnue gardée à 0 pendant ce démarrage
+static void test_packed_trace_fields() {
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+
+    PendingEvent in = makeEvent(1);
+    in.timestamp = 200000;
+    in.receivedAt = 100000;
+    in.epoch = 0;
+    TEST_ASSERT_TRUE(spool.append(in));
+    TEST_ASSERT_TRUE(spool.flush());
+
+    PendingEvent out;
+    TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));
+    TEST_ASSERT_EQUAL_UINT32(200000 - 65535, out.receivedAt);
+    TEST_ASSERT_EQUAL_UINT32(out.receivedAt, out.beacon.lastSeen);
+    TEST_ASSERT_TRUE(out.epoch == 0);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_DEPARTURE, out.eventType);
+}
+
+// Redémarrage : les événements non acquittés sont retrouvés, dans l'ordre
+static void test_restart_restores_head_and_tail() {
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        appendRange(spool, 0, 100);
+        PendingEvent batch[30];
+        TEST_ASSERT_EQUAL_size_t(30, spool.peek(batch, 30));
+        spool.consume(30);
+        // Ajouté mais jamais écrit : perdu à la coupure
+        TEST_ASSERT_TRUE(spool.append(makeEvent(100)));
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    TEST_ASSERT_EQUAL_size_t(70, spool.size());
+
+    // Les suivants prennent la suite sans écraser les anciens
+    appendRange(spool, 100, 10);
+    TEST_ASSERT_EQUAL_UINT32(80, drain(spool, 30));
+}
+
+// Coupure pendant l'écriture d'un enregistrement : ignoré au démarrage, et
+// la case entamée n'est pas réutilisée
+static void test_torn_write_is_skipped() {
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        appendRange(spool, 0, 10);
+        // Moitié de l'enregistrement suivant (séquence 11)
+        SpoolRecord partial;
+        memset(&partial, 0, sizeof(partial) / 2);
+        memset(reinterpret_cast<uint8_t*>(&partial) + sizeof(partial) / 2, 0xFF, sizeof(partial) - sizeof(partial) / 2);
+        TEST_ASSERT_TRUE(storage.writeAt(offsetOf(11), &partial, sizeof(partial)));
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    appendRange(spool, 10, 5);
+
+    {
+        // Encore une fois : les 15 événements sont relus intacts
+        PartitionSpoolStorage again;
+        again.open(TEST_PARTITION);
+        EventSpool reopened(again);
+        TEST_ASSERT_TRUE(reopened.begin());
+        TEST_ASSERT_EQUAL_UINT32(15, drain(reopened, 0));
+    }
+}
+
+// CRC faux au milieu du spool : l'enregistrement est écarté, les autres
+// sont renvoyés dans l'ordre
+static void test_bad_crc_is_dropped() {
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        appendRange(spool, 0, 40);
+        uint8_t zero = 0;
+        // Un octet du nom de la séquence 21 (traceId 20)
+        TEST_ASSERT_TRUE(storage.writeAt(offsetOf(21) + offsetof(SpoolRecord, name), &zero, 1));
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    uint32_t skipped = 0;
+    TEST_ASSERT_EQUAL_UINT32(39, drain(spool, 0, &skipped));
+    TEST_ASSERT_EQUAL_UINT32(1, skipped);
+}
+
+// Plus d'événements que la partition n'en contient : les plus anciens sont
+// effacés secteur par secteur et comptés, la tête reboucle
+static void test_wrap_overwrites_oldest_sector() {
+    const uint32_t total = SLOTS * 2 + RECORDS_PER_SECTOR / 2;
+    uint32_t overwritten;
+    size_t size;
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        appendRange(spool, 0, total);
+        overwritten = spool.overwritten();
+        size = spool.size();
+        TEST_ASSERT_EQUAL_UINT32(total, overwritten + size);
+        TEST_ASSERT_GREATER_OR_EQUAL(spool.capacity(), size);
+        TEST_ASSERT_LESS_OR_EQUAL(SLOTS, size);
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    TEST_ASSERT_EQUAL_size_t(size, spool.size());
+    TEST_ASSERT_EQUAL_UINT32(size, drain(spool, overwritten));
+}
+
+// La queue est ajoutée à la suite dans un secteur de métadonnées, puis
+// dans l'autre quand il est plein ; une case entamée est ignorée
+static void test_ack_survives_meta_sector_switch() {
+    const uint32_t acks = META_ENTRIES + META_ENTRIES / 2;
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        appendRange(spool, 0, acks + 20);
+        PendingEvent out;
+        for (uint32_t i = 0; i < acks; i++) {
+            TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));
+            spool.consume(1);
+        }
+    }
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        uint32_t first, second;
+        storage.readAt(0, &first, sizeof(first));
+        storage.readAt(SPOOL_SECTOR_SIZE, &second, sizeof(second));
+        TEST_ASSERT_TRUE(first != 0xFFFFFFFF && second != 0xFFFFFFFF);
+
+        EventSpool spool(storage);
+        TEST_ASSERT_TRUE(spool.begin());
+        TEST_ASSERT_EQUAL_size_t(20, spool.size());
+
+        // Coupure pendant l'écriture de la queue suivante
+        uint32_t torn = 0x12345678;
+        TEST_ASSERT_TRUE(storage.writeAt(SPOOL_SECTOR_SIZE + (acks - META_ENTRIES) * 8, &torn, sizeof(torn)));
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    TEST_ASSERT_EQUAL_size_t(20, spool.size());
+    PendingEvent out;
+    TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));
+    TEST_ASSERT_EQUAL_UINT32(acks, out.traceId);
+    spool.consume(1);
+    {
+        PartitionSpoolStorage again;
+        again.open(TEST_PARTITION);
+        EventSpool reopened(again);
+        TEST_ASSERT_TRUE(reopened.begin());
+        TEST_ASSERT_EQUAL_size_t(19, reopened.size());
+    }
+}
+
+// Flash en échec : les enregistrements restent en RAM, le spool refuse
+// les suivants une fois son tampon plein, puis tout est écrit au retour
+static void test_flush_failure_keeps_records_in_ram() {
+    PartitionSpoolStorage file;
+    file.open(TEST_PARTITION);
+    FailingStorage storage(file);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+
+    storage.failWrites = true;
+    for (uint32_t n = 0; n < SPOOL_WRITE_BUFFER; n++) {
+        TEST_ASSERT_TRUE(spool.append(makeEvent(n)));
+    }
+    TEST_ASSERT_FALSE(spool.append(makeEvent(SPOOL_WRITE_BUFFER)));
+    TEST_ASSERT_FALSE(spool.flush());
+    TEST_ASSERT_EQUAL_size_t(SPOOL_WRITE_BUFFER, spool.pendingWrites());
+    PendingEvent out;
+    TEST_ASSERT_EQUAL_size_t(1, spool.peek(&out, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, out.traceId);
+
+    storage.failWrites = false;
+    TEST_ASSERT_TRUE(spool.flush());
+    TEST_ASSERT_EQUAL_size_t(0, spool.pendingWrites());
+
+    PartitionSpoolStorage again;
+    again.open(TEST_PARTITION);
+    EventSpool reopened(again);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL_UINT32(SPOOL_WRITE_BUFFER, drain(reopened, 0));
+}
+
+// Ajouts entre peek() et consume() (débordement de la file pendant un
+// envoi) : seuls les événements rendus par peek() sont retirés, et un tour
+// complet entre-temps ne fait pas reculer la queue
+static void test_consume_after_concurrent_append() {
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    appendRange(spool, 0, 20);
+    PendingEvent batch[10];
+    TEST_ASSERT_EQUAL_size_t(10, spool.peek(batch, 10));
+    appendRange(spool, 20, 5);
+    spool.consume(10);
+    TEST_ASSERT_EQUAL_size_t(15, spool.size());
+
+    TEST_ASSERT_EQUAL_size_t(10, spool.peek(batch, 10));
+    TEST_ASSERT_EQUAL_UINT32(10, batch[0].traceId);
+    appendRange(spool, 25, SLOTS);
+    size_t remaining = spool.size();
+    spool.consume(10);
+    TEST_ASSERT_EQUAL_size_t(remaining, spool.size());
+    TEST_ASSERT_EQUAL_UINT32(remaining, drain(spool, 25 + SLOTS - remaining));
+}
+
+// Partition écrite par un autre usage (système de fichiers) : effacée
+static void test_foreign_partition_is_erased() {
+    {
+        PartitionSpoolStorage storage;
+        storage.open(TEST_PARTITION);
+        uint8_t junk[256];
+        memset(junk, 0x5A, sizeof(junk));
+        for (uint32_t offset = 0; offset < SPOOL_HOST_PARTITION_SIZE; offset += 4096) {
+            storage.writeAt(offset, junk, sizeof(junk));
+        }
+    }
+    PartitionSpoolStorage storage;
+    storage.open(TEST_PARTITION);
+    EventSpool spool(storage);
+    TEST_ASSERT_TRUE(spool.begin());
+    TEST_ASSERT_TRUE(spool.empty());
+    appendRange(spool, 0, 3);
+
+    PartitionSpoolStorage again;
+    again.open(TEST_PARTITION);
+    EventSpool reopened(again);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL_UINT32(3, drain(reopened, 0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_keeps_fields);
+    RUN_TEST(test_packed_trace_fields);
+    RUN_TEST(test_restart_restores_head_and_tail);
+    RUN_TEST(test_torn_write_is_skipped);
+    RUN_TEST(test_bad_crc_is_dropped);
+    RUN_TEST(test_wrap_overwrites_oldest_sector);
+    RUN_TEST(test_ack_survives_meta_sector_switch);
+    RUN_TEST(test_flush_failure_keeps_records_in_ram);
+    RUN_TEST(test_consume_after_concurrent_append);
+    RUN_TEST(test_foreign_partition_is_erased);
+    return UNITY_END();
+}
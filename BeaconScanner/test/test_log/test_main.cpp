@@ -0,0 +1,142 @@
+// Journal différé (Log.h) : les valeurs capturées sont formatées à
+// l'écriture comme par printf, les chaînes trop longues sont tronquées, un
+// enregistrement qui ne trouve pas de place dans la file est perdu et
+// compté. Enfin, coût de la capture d'une ligne d'arrivée (sans formatage)
+// comparé au snprintf qu'elle remplace.
+// pio test -e native -f test_log
+
+#include <unity.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include "Log.h"
+#include "sim/Bench.h"
+
+static const char* CAPTURE_PATH = "test_log.txt";
+
+void setUp() {
+    Serial.enabled = true;
+    logBegin();
+    logFlush();
+}
+
+void tearDown() {}
+
+// Sortie de logFlush(), lue depuis la sortie standard redirigée
+static std::string flushed() {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int capture = open(CAPTURE_PATH, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    dup2(capture, STDOUT_FILENO);
+    close(capture);
+
+    logFlush();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    std::string text;
+    FILE* file = fopen(CAPTURE_PATH, "r");
+    char buffer[256];
+    size_t length;
+    while (file && (length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, length);
+    }
+    if (file) {
+        fclose(file);
+    }
+    remove(CAPTURE_PATH);
+    return text;
+}
+
+// Texte d'une ligne, sans le niveau ni l'heure
+static std::string message(const std::string& line) {
+    size_t start = line.find("] ");
+    return start == std::string::npos ? line : line.substr(start + 2, line.find('\n') - start - 2);
+}
+
+static void test_values_are_formatted_on_flush() {
+    char name[16];
+    strcpy(name, "Tag-1");
+    LOG_WARN("Arrivée %s : %d dBm, %.1f m, %lu annonces, %04x, 100%%", name, -70, 1.25, (unsigned long)42, 0xBEu);
+    name[0] = 'X'; // Copiée à la capture
+    std::string out = flushed();
+    TEST_ASSERT_EQUAL_CHAR('W', out[1]);
+    TEST_ASSERT_EQUAL_STRING("Arrivée Tag-1 : -70 dBm, 1.2 m, 42 annonces, 00be, 100%", message(out).c_str());
+}
+
+// Chaînes au-delà de LOG_TEXT_SIZE : la dernière est tronquée, les
+// suivantes sont vides
+static void test_long_text_is_truncated() {
+    std::string longText(LOG_TEXT_SIZE + 20, 'a');
+    LOG_INFO("[%s][%s]", longText.c_str(), "b");
+    std::string text = message(flushed());
+    std::string expected = "[" + std::string(LOG_TEXT_SIZE - 1, 'a') + "][]";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), text.c_str());
+}
+
+// File pleine : les enregistrements en trop sont perdus et comptés, ceux
+// déjà déposés sont tous écrits
+static void test_full_queue_drops_and_counts() {
+    uint32_t dropped = logDropped();
+    for (uint32_t i = 0; i < LOG_QUEUE_LENGTH + 5; i++) {
+        LOG_INFO("ligne %lu", (unsigned long)i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(dropped + 5, logDropped());
+
+    std::string out = flushed();
+    size_t lines = 0;
+    for (char c : out) {
+        lines += c == '\n' ? 1 : 0;
+    }
+    TEST_ASSERT_EQUAL_size_t(LOG_QUEUE_LENGTH, lines);
+    TEST_ASSERT_TRUE(out.find("ligne 0\n") != std::string::npos);
+    char last[32];
+    snprintf(last, sizeof(last), "ligne %lu\n", (unsigned long)(LOG_QUEUE_LENGTH - 1));
+    TEST_ASSERT_TRUE(out.find(last) != std::string::npos);
+}
+
+// Ligne d'arrivée : capture et dépôt dans la file, contre le formatage
+// complet de l'ancien Serial.printf
+static void test_capture_benchmark() {
+    const uint32_t rounds = 200000;
+    const char* id = "c0:de:00:00:00:01_e2c56db5-dffb-48d2-b060-d0f5a71096e0";
+    Serial.enabled = false;
+
+    uint64_t captureNs = 0;
+    for (uint32_t done = 0; done < rounds; done += LOG_QUEUE_LENGTH) {
+        uint64_t start = benchNanos();
+        for (uint32_t i = 0; i < LOG_QUEUE_LENGTH; i++) {
+            LOG_INFO("Arrivée %s RSSI %d dBm, %.1f m", id, -70 - (int)(i % 20), 1.5);
+        }
+        captureNs += benchNanos() - start;
+        logFlush();
+    }
+
+    char line[192];
+    size_t sink = 0;
+    uint64_t start = benchNanos();
+    for (uint32_t i = 0; i < rounds; i++) {
+        sink += (size_t)snprintf(line, sizeof(line), "Arrivée %s RSSI %d dBm, %.1f m", id, -70 - (int)(i % 20), 1.5);
+    }
+    double formatNs = (double)(benchNanos() - start) / rounds;
+    double perLine = (double)captureNs / rounds;
+
+    char text[128];
+    snprintf(text, sizeof(text), "Ligne d'arrivée : capture %.0f ns, snprintf %.0f ns (%lu)", perLine, formatNs,
+             (unsigned long)(sink & 1));
+    TEST_MESSAGE(text);
+    Serial.enabled = true;
+    TEST_ASSERT_TRUE(perLine < formatNs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_values_are_formatted_on_flush);
+    RUN_TEST(test_long_text_is_truncated);
+    RUN_TEST(test_full_queue_drops_and_counts);
+    RUN_TEST(test_capture_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+// Publication MQTT (MqttTransport, MqttClient) : un lot plus grand que la
+// fenêtre QoS 1 entièrement acquitté, keep-alive (PINGREQ/PINGRESP) sur une
+// connexion inactive, session persistante retrouvée après une coupure WiFi,
+// connexion refusée. Contre le courtier intégré à la simulation, et contre
+// un vrai courtier si MQTT_BROKER=hôte:port est défini :
+//   mosquitto -p 1883 &
+//   MQTT_BROKER=127.0.0.1:1883 pio test -e native -f test_mqtt_transport
+// pio test -e native -f test_mqtt_transport
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "MqttTransport.h"
+#include "../TransportFixture.h"
+
+// Plus de deux fenêtres de MQTT_INFLIGHT_WINDOW
+static const size_t EVENTS = 20;
+static const uint8_t DEVICE_MAC[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+static PendingEvent events[EVENTS];
+
+void setUp() {
+    simUseRealBroker(false);
+    setUpNetwork(20);
+    fillEvents(events, EVENTS);
+}
+
+void tearDown() {}
+
+// Chaque PUBLISH est acquitté ; la connexion sert au lot suivant
+static void test_batch_is_acknowledged() {
+    MqttTransport transport("127.0.0.1", 1883);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000002");
+    SimNetworkStats before = simNetworkStats();
+
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, EVENTS));
+    TEST_ASSERT_EQUAL_UINT32(before.publishes + EVENTS, simNetworkStats().publishes);
+    TEST_ASSERT_EQUAL_UINT32(before.brokerConnects + 1, simNetworkStats().brokerConnects);
+
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, 3));
+    TEST_ASSERT_EQUAL_UINT32(before.publishes + EVENTS + 3, simNetworkStats().publishes);
+    TEST_ASSERT_EQUAL_UINT32(before.brokerConnects + 1, simNetworkStats().brokerConnects);
+}
+
+// Connexion inactive pendant trois keep-alive : poll() envoie les PINGREQ
+// à leur échéance et reçoit les PINGRESP, la connexion reste ouverte
+static void test_idle_connection_is_kept_alive() {
+    MqttTransport transport("127.0.0.1", 1883);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000002");
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, 1));
+    SimNetworkStats before = simNetworkStats();
+
+    uint32_t end = halMillis() + 3 * MQTT_KEEP_ALIVE * 1000;
+    uint32_t polls = 0;
+    while ((int32_t)(halMillis() - end) < 0) {
+        uint32_t due = transport.poll(halMillis());
+        TEST_ASSERT_TRUE_MESSAGE(due != UPLINK_IDLE, "connexion fermée pendant le keep-alive");
+        halDelay(due > 0 && due < 1000 ? due : 1000);
+        polls++;
+    }
+    TEST_ASSERT_GREATER_THAN(3, polls);
+
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, 1));
+    TEST_ASSERT_EQUAL_UINT32(before.brokerConnects, simNetworkStats().brokerConnects);
+}
+
+// Coupure WiFi : le lot échoue, puis la connexion est rouverte et la
+// session (cleanSession à 0) retrouvée par le courtier
+static void test_session_is_resumed_after_outage() {
+    MqttClient client(halStream());
+    TEST_ASSERT_EQUAL_INT(MQTT_OK, client.connect("127.0.0.1", 1883, "ESP32_SESSION", false, MQTT_KEEP_ALIVE));
+    TEST_ASSERT_FALSE(client.sessionResumed());
+
+    SimNetworkConfig& config = simNetworkConfig();
+    config.outageStartMs = halMillis();
+    config.outageEndMs = halMillis() + 100000;
+    halDelay(10);
+    TEST_ASSERT_FALSE(client.poll(halMillis()));
+    TEST_ASSERT_FALSE(client.connected());
+
+    MqttTransport transport("127.0.0.1", 1883);
+    transport.begin(DEVICE_MAC, "ESP32_SESSION");
+    TEST_ASSERT_TRUE(transport.send(events, EVENTS) < 0);
+
+    halDelay(100000);
+    halNetwork().connect("ssid", "password");
+    halDelay(1);
+    TEST_ASSERT_TRUE(halNetwork().connected());
+    TEST_ASSERT_EQUAL_INT(MQTT_OK, client.connect("127.0.0.1", 1883, "ESP32_SESSION", false, MQTT_KEEP_ALIVE));
+    TEST_ASSERT_TRUE(client.sessionResumed());
+    client.disconnect();
+
+    TEST_ASSERT_EQUAL_INT(200, transport.send(events, EVENTS));
+
+    // Session propre : rien n'est retrouvé
+    TEST_ASSERT_EQUAL_INT(MQTT_OK, client.connect("127.0.0.1", 1883, "ESP32_SESSION", true, MQTT_KEEP_ALIVE));
+    TEST_ASSERT_FALSE(client.sessionResumed());
+    client.disconnect();
+}
+
+// CONNACK avec un code de refus (--status 503 dans la simulation)
+static void test_refused_connection() {
+    simNetworkConfig().statusCode = 503;
+    MqttTransport transport("127.0.0.1", 1883);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000002");
+    TEST_ASSERT_EQUAL_INT(MQTT_ERROR_REFUSED, transport.send(events, EVENTS));
+}
+
+// Même lot contre un vrai courtier (mosquitto), par les sockets de l'hôte
+static void test_batch_against_real_broker() {
+    const char* broker = getenv("MQTT_BROKER");
+    if (!broker) {
+        TEST_IGNORE_MESSAGE("MQTT_BROKER non défini (mosquitto -p 1883, puis MQTT_BROKER=127.0.0.1:1883)");
+    }
+    static char host[64];
+    strncpy(host, broker, sizeof(host) - 1);
+    char* colon = strrchr(host, ':');
+    uint16_t port = 1883;
+    if (colon) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+
+    simUseRealBroker(true);
+    MqttTransport transport(host, port);
+    transport.begin(DEVICE_MAC, "ESP32_246F28000002");
+    int status = transport.send(events, EVENTS);
+    simUseRealBroker(false);
+    char line[96];
+    snprintf(line, sizeof(line), "%s : statut %d", broker, status);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_INT(200, status);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_is_acknowledged);
+    RUN_TEST(test_idle_connection_is_kept_alive);
+    RUN_TEST(test_session_is_resumed_after_outage);
+    RUN_TEST(test_refused_connection);
+    RUN_TEST(test_batch_against_real_broker);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// Détection de présence (Presence.h) : hystérésis et temps de maintien,
+// amortissement des beacons qui oscillent, puis nombre d'arrivées et de
+// départs sur une population synthétique en limite de portée (évanouissement
+// de 4 dB), comparé à l'ancienne règle (une annonce suffit, départ après
+// BEACON_TIMEOUT de silence). Le trafic montant correspondant se mesure avec
+// la simulation : voir le commentaire de test_fading_population_churn.
+// pio test -e native -f test_presence
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include "BeaconTracker.h"
+#include "Presence.h"
+#include "sim/AdvSource.h"
+
+static const uint32_t STEP = 100; // Intervalle d'annonce (ms)
+
+static BeaconInfo beacon;
+static uint32_t now;
+
+void setUp() {
+    memset(&beacon, 0, sizeof(beacon));
+    now = 1000;
+    presenceReset(beacon, -100);
+}
+
+void tearDown() {}
+
+// Annonces au RSSI constant pendant durationMs ; rend la première transition
+// et signale les transitions comme BeaconTracker (isPresent, pénalité)
+static PresenceTransition feed(int8_t rssi, uint32_t durationMs) {
+    for (uint32_t end = now + durationMs; now < end;) {
+        now += STEP;
+        PresenceTransition transition = presenceUpdate(beacon, rssi, STEP, now);
+        if (transition != PRESENCE_NONE) {
+            beacon.isPresent = transition == PRESENCE_ARRIVAL;
+            presenceFlap(beacon, now);
+            return transition;
+        }
+    }
+    return PRESENCE_NONE;
+}
+
+// Arrivée après PRESENCE_ENTER_DWELL au-dessus du seuil d'entrée ; une
+// pointe isolée ne suffit pas
+static void test_arrival_needs_enter_dwell() {
+    TEST_ASSERT_EQUAL_INT(PRESENCE_NONE, feed(-60, STEP));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_NONE, feed(-100, 20000));
+    TEST_ASSERT_FALSE(beacon.dwelling);
+
+    uint32_t start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_GREATER_OR_EQUAL(PRESENCE_ENTER_DWELL, now - start);
+    TEST_ASSERT_TRUE(beacon.isPresent);
+}
+
+// Entre les deux seuils, un beacon présent reste présent ; il ne part
+// qu'après PRESENCE_EXIT_DWELL sous le seuil de sortie
+static void test_departure_needs_exit_dwell() {
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_NONE, feed((PRESENCE_ENTER_RSSI + PRESENCE_EXIT_RSSI) / 2, 120000));
+
+    uint32_t start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_DEPARTURE, feed(-110, 120000));
+    TEST_ASSERT_GREATER_OR_EQUAL(PRESENCE_EXIT_DWELL, now - start);
+    TEST_ASSERT_FALSE(beacon.isPresent);
+}
+
+// Un départ puis un retour rapides : la pénalité atteint le seuil, le
+// départ suivant attend qu'elle retombe, puis le retour en limite de portée
+// qui suit aussi ; chacun est signalé dès qu'elle est repassée sous le seuil
+static void test_flapping_beacon_is_held_until_penalty_decays() {
+    if (PRESENCE_FLAP_SUPPRESS <= 0) {
+        TEST_IGNORE_MESSAGE("PRESENCE_FLAP_SUPPRESS=0 : pas d'amortissement");
+    }
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_DEPARTURE, feed(-110, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_TRUE(presenceFlapPenalty(beacon, now) >= PRESENCE_FLAP_SUPPRESS);
+
+    // Présent : un RSSI faible ne le fait pas repartir
+    uint32_t start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_NONE, feed(-110, PRESENCE_FLAP_HALF_LIFE / 4));
+    TEST_ASSERT_TRUE(beacon.isPresent);
+    TEST_ASSERT_TRUE(beacon.dwelling);
+    TEST_ASSERT_EQUAL_INT(PRESENCE_DEPARTURE, feed(-110, 4 * PRESENCE_FLAP_HALF_LIFE));
+    uint32_t heldDeparture = now - start;
+
+    // Absent : de retour en limite de portée, il n'arrive pas
+    const int8_t edge = PRESENCE_ENTER_RSSI + PRESENCE_FLAP_MARGIN / 2;
+    start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_NONE, feed(edge, PRESENCE_FLAP_HALF_LIFE / 4));
+    TEST_ASSERT_FALSE(beacon.isPresent);
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(edge, 4 * PRESENCE_FLAP_HALF_LIFE));
+    uint32_t heldArrival = now - start;
+
+    char line[96];
+    snprintf(line, sizeof(line), "Départ retenu %lu s, retour retenu %lu s", (unsigned long)(heldDeparture / 1000),
+             (unsigned long)(heldArrival / 1000));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL(PRESENCE_FLAP_HALF_LIFE, heldDeparture);
+    TEST_ASSERT_LESS_OR_EQUAL(PRESENCE_FLAP_HALF_LIFE, heldArrival);
+}
+
+// Même pénalité, mais retour en pleine portée : signalé sans attendre
+static void test_clear_return_is_not_held() {
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_DEPARTURE, feed(-110, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    beacon.isPresent = false; // Départ sur silence
+    presenceFlap(beacon, now);
+    presenceReset(beacon, -110);
+    TEST_ASSERT_TRUE(PRESENCE_FLAP_SUPPRESS <= 0 || presenceFlapPenalty(beacon, now) >= PRESENCE_FLAP_SUPPRESS);
+
+    uint32_t start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(PRESENCE_ENTER_RSSI + 2 * PRESENCE_FLAP_MARGIN, 60000));
+    TEST_ASSERT_LESS_THAN(PRESENCE_ENTER_DWELL + 30000, now - start);
+}
+
+// Un beacon stable n'est jamais retenu : un départ puis un retour isolés
+// restent signalés immédiatement
+static void test_single_round_trip_is_not_held() {
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_EQUAL_INT(PRESENCE_DEPARTURE, feed(-110, 60000));
+    uint32_t start = now;
+    TEST_ASSERT_EQUAL_INT(PRESENCE_ARRIVAL, feed(-70, 60000));
+    TEST_ASSERT_LESS_THAN(PRESENCE_ENTER_DWELL + 10000, now - start);
+}
+
+struct Track {
+    BeaconInfo info;
+    bool known;
+};
+
+// 200 beacons pendant une heure, RSSI moyen entre -50 et -100 dBm,
+// évanouissement de 4 dB : le même flux d'annonces passe par l'ancienne
+// règle et par Presence.h, avec le départ sur silence de BeaconTracker.
+// Le trafic montant (POST, octets) de ces deux règles se compare avec la
+// simulation, compilée une fois telle quelle et une fois avec les options
+// de l'ancienne règle données en tête de Presence.h, puis lancée avec :
+//   --quiet --beacons 200 --duration 3600 --churn 0 --fading 4
+static void test_fading_population_churn() {
+    SyntheticConfig config = {200, 3600000, 100, 4, 0, 10, 4, 1};
+    SyntheticAdvSource source(config);
+    std::map<uint32_t, Track> raw, filtered;
+    uint32_t rawEvents = 0, filteredEvents = 0;
+
+    AdvRecord record;
+    while (source.next(record)) {
+        uint32_t key = (uint32_t)record.address[3] << 16 | record.address[4] << 8 | record.address[5];
+
+        // Ancienne règle : présent à chaque annonce, absent après le silence
+        Track& old = raw[key];
+        if (old.known && old.info.isPresent && record.timestamp - old.info.lastSeen > BEACON_TIMEOUT) {
+            old.info.isPresent = false;
+            rawEvents++;
+        }
+        if (!old.info.isPresent) {
+            old.info.isPresent = true;
+            rawEvents++;
+        }
+        old.known = true;
+        old.info.lastSeen = record.timestamp;
+
+        // Presence.h, appelé comme dans BeaconTracker::handleAdvertisement
+        Track& track = filtered[key];
+        BeaconInfo& info = track.info;
+        uint32_t elapsed = record.timestamp - info.lastSeen;
+        if (track.known && info.isPresent && elapsed > BEACON_TIMEOUT) {
+            info.isPresent = false;
+            info.dwelling = false;
+            presenceFlap(info, info.lastSeen);
+            filteredEvents++;
+        }
+        if (!track.known || (!info.isPresent && elapsed > BEACON_TIMEOUT)) {
+            presenceReset(info, record.rssi);
+            elapsed = 0;
+        }
+        track.known = true;
+        PresenceTransition transition = presenceUpdate(info, record.rssi, elapsed, record.timestamp);
+        info.lastSeen = record.timestamp;
+        if (transition != PRESENCE_NONE) {
+            info.isPresent = transition == PRESENCE_ARRIVAL;
+            presenceFlap(info, info.lastSeen);
+            filteredEvents++;
+        }
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "Arrivées et départs en 1 h : %lu avec l'ancienne règle, %lu avec Presence.h",
+             (unsigned long)rawEvents, (unsigned long)filteredEvents);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(rawEvents / 2, filteredEvents);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_arrival_needs_enter_dwell);
+    RUN_TEST(test_departure_needs_exit_dwell);
+    RUN_TEST(test_flapping_beacon_is_held_until_penalty_decays);
+    RUN_TEST(test_clear_return_is_not_held);
+    RUN_TEST(test_single_round_trip_is_not_held);
+    RUN_TEST(test_fading_population_churn);
+    return UNITY_END();
+}
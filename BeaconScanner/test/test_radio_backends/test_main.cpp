@@ -0,0 +1,129 @@
+// Comportement commun aux deux piles radio (HalEsp32.cpp) : ordre des
+// octets de l'adresse (NimBLE la remet octet de poids faible en tête),
+// filtre des doublons du contrôleur (BLE_DUPLICATE_FILTER, NimBLE) et durée
+// des scans à la milliseconde. La conversion est celle des callbacks
+// onResult (fillAdvRecord) ; filtre et durée passent par la radio simulée,
+// qui suit le même contrat que HalRadio sur l'ESP32.
+// pio test -e native -f test_radio_backends
+
+#include <unity.h>
+#include <string.h>
+#include "AdvRecord.h"
+#include "Hal.h"
+#include "sim/SimHal.h"
+
+static uint32_t delivered;
+static AdvRecord lastRecord;
+
+static void onAdvertisement(const AdvRecord& record) {
+    delivered++;
+    lastRecord = record;
+}
+
+void setUp() {
+    delivered = 0;
+    memset(&lastRecord, 0, sizeof(lastRecord));
+    halRadio().begin(onAdvertisement);
+    // Fenêtre égale à l'intervalle : seule la durée du scan limite l'écoute
+    halRadio().configure(100, 100, true);
+    simSetDuplicateFilter(false);
+}
+
+void tearDown() {}
+
+static const uint8_t DISPLAY_ADDRESS[6] = {0xC0, 0xDE, 0x01, 0x02, 0x03, 0x04};
+
+static AdvRecord makeRecord(uint8_t last, uint32_t timestamp) {
+    AdvRecord record;
+    uint8_t address[6];
+    memcpy(address, DISPLAY_ADDRESS, sizeof(address));
+    address[5] = last;
+    uint8_t payload[3] = {0x02, 0x01, 0x06};
+    fillAdvRecord(record, address, ADV_ADDRESS_DISPLAY_ORDER, -60, payload, sizeof(payload), timestamp);
+    return record;
+}
+
+// Même appareil vu par les deux piles : même enregistrement, même clé
+static void test_address_order_matches_between_backends() {
+    uint8_t lsbFirst[6];
+    for (size_t i = 0; i < 6; i++) {
+        lsbFirst[i] = DISPLAY_ADDRESS[5 - i];
+    }
+    uint8_t payload[ADV_MAX_PAYLOAD + 10];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)i;
+    }
+
+    AdvRecord bluedroid, nimble;
+    fillAdvRecord(bluedroid, DISPLAY_ADDRESS, ADV_ADDRESS_DISPLAY_ORDER, -71, payload, 30, 1234);
+    fillAdvRecord(nimble, lsbFirst, ADV_ADDRESS_LSB_FIRST, -71, payload, 30, 1234);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(DISPLAY_ADDRESS, bluedroid.address, 6);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(DISPLAY_ADDRESS, nimble.address, 6);
+    TEST_ASSERT_EQUAL_INT8(-71, nimble.rssi);
+    TEST_ASSERT_EQUAL_UINT32(1234, nimble.timestamp);
+    TEST_ASSERT_EQUAL_UINT8(30, nimble.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(bluedroid.payload, nimble.payload, 30);
+
+    // Annonce plus longue que la case : tronquée, sans débordement
+    fillAdvRecord(nimble, lsbFirst, ADV_ADDRESS_LSB_FIRST, -71, payload, sizeof(payload), 1234);
+    TEST_ASSERT_EQUAL_UINT8(ADV_MAX_PAYLOAD, nimble.payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(payload, nimble.payload, ADV_MAX_PAYLOAD);
+}
+
+// Bluedroid (filtre désactivé) : chaque annonce est remise
+static void test_without_duplicate_filter_every_advertisement_is_delivered() {
+    uint32_t start = halMillis();
+    simStartScan(1000);
+    for (uint32_t i = 0; i < 5; i++) {
+        simDeliverAdvertisement(makeRecord(1, start + 10 * i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, delivered);
+}
+
+// NimBLE (filtre du contrôleur) : une annonce par adresse et par scan, le
+// cache étant vidé au début du scan suivant
+static void test_duplicate_filter_delivers_once_per_scan() {
+    simSetDuplicateFilter(true);
+    uint32_t duplicatesBefore = simDuplicateAdvertisements();
+    uint32_t start = halMillis();
+    simStartScan(1000);
+    for (uint32_t i = 0; i < 5; i++) {
+        simDeliverAdvertisement(makeRecord(1, start + 10 * i));
+    }
+    simDeliverAdvertisement(makeRecord(2, start + 60));
+    TEST_ASSERT_EQUAL_UINT32(2, delivered);
+    TEST_ASSERT_EQUAL_UINT32(4, simDuplicateAdvertisements() - duplicatesBefore);
+    TEST_ASSERT_EQUAL_UINT8(2, lastRecord.address[5]);
+
+    simAdvanceTo(start + 1000);
+    simStartScan(1000);
+    simDeliverAdvertisement(makeRecord(1, start + 1010));
+    TEST_ASSERT_EQUAL_UINT32(3, delivered);
+}
+
+// scan(durationMs) dure durationMs, sans arrondi à la seconde : une annonce
+// reçue juste après la fin n'est plus entendue
+static void test_scan_lasts_requested_milliseconds() {
+    const uint32_t durations[] = {250, 1200, 1999};
+    for (uint32_t durationMs : durations) {
+        uint32_t start = halMillis();
+        halRadio().scan(durationMs);
+        TEST_ASSERT_EQUAL_UINT32(durationMs, halMillis() - start);
+
+        uint32_t missedBefore = simMissedAdvertisements();
+        uint32_t deliveredBefore = delivered;
+        simDeliverAdvertisement(makeRecord(3, start + durationMs - 1));
+        simDeliverAdvertisement(makeRecord(3, start + durationMs));
+        TEST_ASSERT_EQUAL_UINT32(deliveredBefore + 1, delivered);
+        TEST_ASSERT_EQUAL_UINT32(missedBefore + 1, simMissedAdvertisements());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_address_order_matches_between_backends);
+    RUN_TEST(test_without_duplicate_filter_every_advertisement_is_delivered);
+    RUN_TEST(test_duplicate_filter_delivers_once_per_scan);
+    RUN_TEST(test_scan_lasts_requested_milliseconds);
+    return UNITY_END();
+}
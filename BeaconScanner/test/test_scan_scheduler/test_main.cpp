@@ -0,0 +1,218 @@
+// Partage de la radio (ScanScheduler::plan) : paramètres choisis pour des
+// débits d'annonces et des files d'attente synthétiques. Veille après
+// SCAN_QUIET_AFTER de calme, quittée dès qu'un beacon arrive ou que le
+// débit dépasse SCAN_QUIET_RATE ; scan passif en zone dense, avec son
+// hystérésis ; fenêtre réduite et pause WiFi tant que des événements
+// attendent ; débit estimé indépendant du mode ; paramètres fixes avec
+// SCAN_ADAPTIVE=0.
+// pio test -e native -f test_scan_scheduler
+
+#include <unity.h>
+#include <stdio.h>
+#include "ScanScheduler.h"
+
+static ScanScheduler* scheduler;
+static uint32_t now;
+static uint32_t advertisements;
+static ScanPlan last;
+
+void setUp() {
+    delete scheduler;
+    scheduler = new ScanScheduler(true);
+    now = 5000;
+    advertisements = 0;
+    last = {SCAN_MODE_FIXED, 0, 0, false, 0, 0};
+}
+
+void tearDown() {}
+
+// Un cycle : les annonces reçues pendant le cycle précédent suivent le
+// débit dans l'air (annonces/s) et le temps d'écoute de ce cycle
+static ScanPlan cycle(uint32_t airRate, uint32_t beacons, uint32_t pendingEvents) {
+    if (last.intervalMs > 0) {
+        advertisements += airRate * (last.scanMs * last.windowMs / last.intervalMs) / 1000;
+        now += last.scanMs + last.pauseMs;
+    }
+    last = scheduler->plan(now, advertisements, beacons, pendingEvents);
+    return last;
+}
+
+// Cycles jusqu'à durationMs ; rend le dernier plan
+static ScanPlan runFor(uint32_t durationMs, uint32_t airRate, uint32_t beacons, uint32_t pendingEvents) {
+    uint32_t end = now + durationMs;
+    ScanPlan plan = cycle(airRate, beacons, pendingEvents);
+    while ((int32_t)(now - end) < 0) {
+        plan = cycle(airRate, beacons, pendingEvents);
+    }
+    return plan;
+}
+
+static void assertPlan(ScanMode mode, uint16_t intervalMs, uint16_t windowMs, bool active, uint32_t scanMs,
+                       uint32_t pauseMs, const ScanPlan& plan) {
+    TEST_ASSERT_EQUAL_STRING(ScanScheduler::modeName(mode), ScanScheduler::modeName(plan.mode));
+    TEST_ASSERT_EQUAL_UINT16(intervalMs, plan.intervalMs);
+    TEST_ASSERT_EQUAL_UINT16(windowMs, plan.windowMs);
+    TEST_ASSERT_EQUAL(active, plan.active);
+    TEST_ASSERT_EQUAL_UINT32(scanMs, plan.scanMs);
+    TEST_ASSERT_EQUAL_UINT32(pauseMs, plan.pauseMs);
+}
+
+static void assertNormal(const ScanPlan& plan) {
+    assertPlan(SCAN_MODE_NORMAL, SCAN_INTERVAL, SCAN_WINDOW, true, SCAN_CYCLE, 0, plan);
+}
+
+static void assertQuiet(const ScanPlan& plan) {
+    assertPlan(SCAN_MODE_QUIET, SCAN_QUIET_INTERVAL, SCAN_QUIET_WINDOW, false, SCAN_QUIET_CYCLE, 0, plan);
+}
+
+static void assertDense(const ScanPlan& plan) {
+    assertPlan(SCAN_MODE_DENSE, SCAN_INTERVAL, SCAN_WINDOW, false, SCAN_CYCLE, 0, plan);
+}
+
+// Scan actif au démarrage, veille après SCAN_QUIET_AFTER sans beacon ni
+// débit notable, et pas avant
+static void test_quiet_after_calm_period() {
+    assertNormal(cycle(0, 0, 0));
+    assertNormal(runFor(SCAN_QUIET_AFTER - 2 * SCAN_CYCLE, SCAN_QUIET_RATE / 2, 0, 0));
+    ScanPlan plan = runFor(2 * SCAN_CYCLE, SCAN_QUIET_RATE / 2, 0, 0);
+    assertQuiet(plan);
+    TEST_ASSERT_EQUAL_UINT32(SCAN_QUIET_WINDOW * 1000 / SCAN_QUIET_INTERVAL, scheduler->dutyPerMille());
+    TEST_ASSERT_FALSE(scheduler->activeScan());
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler->cycleCount(SCAN_MODE_QUIET));
+
+    // Un beacon présent relance le calme à zéro
+    assertQuiet(runFor(60000, 0, 0, 0));
+    assertNormal(cycle(0, 1, 0));
+    assertNormal(runFor(SCAN_QUIET_AFTER - 2 * SCAN_CYCLE, 0, 0, 0));
+    assertQuiet(runFor(2 * SCAN_CYCLE, 0, 0, 0));
+}
+
+// Débit au-dessus de SCAN_QUIET_RATE : la veille est quittée dès le plan
+// suivant, et n'est reprise qu'après un nouveau SCAN_QUIET_AFTER de calme
+static void test_quiet_left_on_rising_rate() {
+    assertQuiet(runFor(SCAN_QUIET_AFTER + SCAN_CYCLE, 0, 0, 0));
+    // Annonces du dernier cycle de veille : estimation lissée à la moitié
+    assertNormal(cycle(4 * SCAN_QUIET_RATE, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(2 * SCAN_QUIET_RATE, scheduler->advertisementRate());
+
+    // Le débit lissé redescend sous le seuil en quelques cycles
+    ScanPlan plan = runFor(SCAN_QUIET_AFTER - 2 * SCAN_CYCLE, 0, 0, 0);
+    assertNormal(plan);
+    assertQuiet(runFor(5 * SCAN_CYCLE, 0, 0, 0));
+}
+
+// Le même débit dans l'air donne la même estimation en veille (10 %
+// d'écoute) et en scan normal (90 %)
+static void test_rate_is_per_listen_second() {
+    runFor(SCAN_QUIET_AFTER + SCAN_CYCLE, SCAN_QUIET_RATE - 5, 0, 0);
+    TEST_ASSERT_EQUAL_INT(SCAN_MODE_QUIET, scheduler->mode());
+    runFor(20000, SCAN_QUIET_RATE - 5, 0, 0);
+    TEST_ASSERT_UINT32_WITHIN(1, SCAN_QUIET_RATE - 5, scheduler->advertisementRate());
+
+    setUp();
+    runFor(20000, SCAN_QUIET_RATE - 5, 1, 0);
+    TEST_ASSERT_EQUAL_INT(SCAN_MODE_NORMAL, scheduler->mode());
+    TEST_ASSERT_UINT32_WITHIN(1, SCAN_QUIET_RATE - 5, scheduler->advertisementRate());
+}
+
+// Zone dense par le nombre de beacons, quittée sous les trois quarts
+static void test_dense_by_beacons_with_hysteresis() {
+    assertNormal(cycle(100, SCAN_DENSE_BEACONS - 1, 0));
+    assertDense(cycle(100, SCAN_DENSE_BEACONS, 0));
+    assertDense(runFor(10000, 100, SCAN_DENSE_BEACONS * 3 / 4, 0));
+    assertNormal(cycle(100, SCAN_DENSE_BEACONS * 3 / 4 - 1, 0));
+    assertNormal(cycle(100, SCAN_DENSE_BEACONS - 1, 0));
+}
+
+// Zone dense par le débit seul, même sans beacon présent
+static void test_dense_by_rate_with_hysteresis() {
+    assertNormal(cycle(0, 0, 0));
+    // Le débit lissé atteint SCAN_DENSE_RATE en quelques cycles
+    ScanPlan plan = runFor(5 * SCAN_CYCLE, 2 * SCAN_DENSE_RATE, 0, 0);
+    assertDense(plan);
+    TEST_ASSERT_GREATER_OR_EQUAL(SCAN_DENSE_RATE, scheduler->advertisementRate());
+
+    // Entre les trois quarts et le seuil : reste dense
+    assertDense(runFor(20000, SCAN_DENSE_RATE * 7 / 8, 0, 0));
+    // Sous les trois quarts : scan actif
+    assertNormal(runFor(20000, SCAN_DENSE_RATE / 2, 0, 0));
+    assertNormal(runFor(20000, SCAN_DENSE_RATE * 7 / 8, 0, 0));
+}
+
+// Des événements attendent : fenêtre réduite et SCAN_TX_WINDOW ms de WiFi
+// après chaque cycle, scan passif si la zone est dense ; même en veille
+static void test_uplink_window_when_events_pending() {
+    assertPlan(SCAN_MODE_UPLINK, SCAN_INTERVAL, SCAN_UPLINK_WINDOW, true, SCAN_CYCLE, SCAN_TX_WINDOW,
+               cycle(100, 5, 3));
+    TEST_ASSERT_EQUAL_UINT32(SCAN_TX_WINDOW, scheduler->wifiWindowTimeMs());
+    TEST_ASSERT_EQUAL_UINT32(SCAN_CYCLE * SCAN_UPLINK_WINDOW / SCAN_INTERVAL, scheduler->listenTimeMs());
+    assertNormal(cycle(100, 5, 0));
+
+    assertPlan(SCAN_MODE_UPLINK, SCAN_INTERVAL, SCAN_UPLINK_WINDOW, false, SCAN_CYCLE, SCAN_TX_WINDOW,
+               cycle(100, SCAN_DENSE_BEACONS, 1));
+    assertDense(cycle(100, SCAN_DENSE_BEACONS, 0));
+
+    setUp();
+    assertQuiet(runFor(SCAN_QUIET_AFTER + SCAN_CYCLE, 0, 0, 0));
+    ScanPlan plan = cycle(0, 0, 1);
+    TEST_ASSERT_EQUAL_INT(SCAN_MODE_UPLINK, plan.mode);
+    TEST_ASSERT_EQUAL_UINT32(SCAN_TX_WINDOW, plan.pauseMs);
+    // Le calme n'est pas interrompu par l'envoi
+    assertQuiet(cycle(0, 0, 0));
+}
+
+// Compteurs de /metrics : un cycle par plan, temps d'écoute et de WiFi
+// cumulés
+static void test_counters_follow_plans() {
+    runFor(60000, 0, 0, 0);
+    runFor(10000, 100, 50, 0);
+    runFor(10000, 100, 5, 2);
+    uint32_t total = 0, listen = 0;
+    for (int mode = 0; mode < SCAN_MODE_COUNT; mode++) {
+        total += scheduler->cycleCount((ScanMode)mode);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler->cycleCount(SCAN_MODE_FIXED));
+    TEST_ASSERT_GREATER_THAN(0, scheduler->cycleCount(SCAN_MODE_QUIET));
+    TEST_ASSERT_GREATER_THAN(0, scheduler->cycleCount(SCAN_MODE_DENSE));
+    listen = scheduler->cycleCount(SCAN_MODE_QUIET) * (SCAN_QUIET_CYCLE * SCAN_QUIET_WINDOW / SCAN_QUIET_INTERVAL) +
+             (scheduler->cycleCount(SCAN_MODE_NORMAL) + scheduler->cycleCount(SCAN_MODE_DENSE)) *
+                 (SCAN_CYCLE * SCAN_WINDOW / SCAN_INTERVAL) +
+             scheduler->cycleCount(SCAN_MODE_UPLINK) * (SCAN_CYCLE * SCAN_UPLINK_WINDOW / SCAN_INTERVAL);
+    TEST_ASSERT_EQUAL_UINT32(listen, scheduler->listenTimeMs());
+    TEST_ASSERT_EQUAL_UINT32(scheduler->cycleCount(SCAN_MODE_UPLINK) * SCAN_TX_WINDOW, scheduler->wifiWindowTimeMs());
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu cycles, %lu ms d'écoute", (unsigned long)total, (unsigned long)listen);
+    TEST_MESSAGE(line);
+}
+
+// Passage de millis() par zéro pendant le calme
+static void test_quiet_across_millis_wrap() {
+    now = 0xFFFFFFFFu - SCAN_QUIET_AFTER / 2;
+    assertNormal(cycle(0, 0, 0));
+    assertNormal(runFor(SCAN_QUIET_AFTER - 2 * SCAN_CYCLE, 0, 0, 0));
+    assertQuiet(runFor(2 * SCAN_CYCLE, 0, 0, 0));
+}
+
+// SCAN_ADAPTIVE=0 : paramètres d'origine, quel que soit l'environnement
+static void test_fixed_parameters() {
+    scheduler->setAdaptive(false);
+    assertPlan(SCAN_MODE_FIXED, 100, 99, true, 5000, 0, cycle(0, 0, 0));
+    assertPlan(SCAN_MODE_FIXED, 100, 99, true, 5000, 0, runFor(60000, 1000, 100, 10));
+    TEST_ASSERT_EQUAL_UINT32(990, scheduler->dutyPerMille());
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler->wifiWindowTimeMs());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_quiet_after_calm_period);
+    RUN_TEST(test_quiet_left_on_rising_rate);
+    RUN_TEST(test_rate_is_per_listen_second);
+    RUN_TEST(test_dense_by_beacons_with_hysteresis);
+    RUN_TEST(test_dense_by_rate_with_hysteresis);
+    RUN_TEST(test_uplink_window_when_events_pending);
+    RUN_TEST(test_counters_follow_plans);
+    RUN_TEST(test_quiet_across_millis_wrap);
+    RUN_TEST(test_fixed_parameters);
+    return UNITY_END();
+}
@@ -0,0 +1,195 @@
+// Pipeline d'envoi (SendEvents) contre un transport factice, la tâche
+// réseau étant remplacée par des appels à service() : ordre des événements
+// quand la file déborde dans le spool pendant un envoi qui échoue, le lot
+// en cours étant plus ancien que ce qui vient d'y être versé ; clearQueue()
+// sur les trois étages (file, lot, spool).
+// pio test -e native -f test_send_events
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "EventSpool.h"
+#include "Hal.h"
+#include "SendEvents.h"
+
+// Transport factice : garde l'ordre des beacons reçus, refuse les
+// failures prochains lots, et appelle duringSend au premier envoi (la
+// tâche de suivi qui continue pendant le POST)
+class FakeTransport : public EventTransport {
+public:
+    std::vector<uint32_t> received;
+    int failures = 0;
+    void (*duringSend)() = nullptr;
+
+    const char* name() const override { return "fake"; }
+    void begin(const uint8_t deviceMac[6], const char* deviceId) override {
+        (void)deviceMac;
+        (void)deviceId;
+    }
+    int send(const PendingEvent* events, size_t count) override {
+        if (duringSend) {
+            void (*hook)() = duringSend;
+            duringSend = nullptr;
+            hook();
+        }
+        if (failures > 0) {
+            failures--;
+            return 503;
+        }
+        for (size_t i = 0; i < count; i++) {
+            received.push_back((uint32_t)events[i].beacon.address[4] << 8 | events[i].beacon.address[5]);
+        }
+        return 200;
+    }
+    const char* errorToString(int code) override {
+        (void)code;
+        return "fake";
+    }
+};
+
+static FakeTransport transport;
+static SendEvents sender;
+static uint32_t nextBeacon;
+
+// Arrivée d'un beacon jamais vu : pas de regroupement dans le lot
+static void arrival() {
+    BeaconInfo beacon;
+    memset(&beacon, 0, sizeof(beacon));
+    beacon.address[0] = 0xC0;
+    beacon.address[4] = (uint8_t)(nextBeacon >> 8);
+    beacon.address[5] = (uint8_t)nextBeacon;
+    nextBeacon++;
+    sender.sendBeaconArrival(beacon);
+}
+
+// La tâche réseau jusqu'à ce que tout soit acquitté (ou durationMs)
+static void runUplink(uint32_t durationMs) {
+    uint32_t end = halMillis() + durationMs;
+    while ((int32_t)(halMillis() - end) < 0) {
+        uint32_t wait = sender.service();
+        if (wait == UPLINK_IDLE && sender.getQueueSize() == 0) {
+            return;
+        }
+        halDelay(wait == 0 ? 0 : (wait < 10 ? wait : 10));
+    }
+}
+
+void setUp() {
+    runUplink(60000);
+    TEST_ASSERT_EQUAL_INT(0, sender.getQueueSize());
+    transport.received.clear();
+    transport.failures = 0;
+    nextBeacon = 0;
+}
+
+void tearDown() {}
+
+static void assertReceivedInOrder(uint32_t count) {
+    TEST_ASSERT_EQUAL_size_t(count, transport.received.size());
+    for (uint32_t i = 0; i < count; i++) {
+        if (transport.received[i] != i) {
+            char message[64];
+            snprintf(message, sizeof(message), "beacon %lu reçu en position %lu", (unsigned long)transport.received[i],
+                     (unsigned long)i);
+            TEST_FAIL_MESSAGE(message);
+        }
+    }
+}
+
+static void overflowQueue() {
+    for (uint32_t i = 0; i < EVENT_QUEUE_LENGTH + 10; i++) {
+        arrival();
+    }
+}
+
+// Le lot échoue après que la file a débordé dans le spool : il repart
+// avant les événements versés pendant son envoi
+static void test_failed_batch_stays_ahead_of_spilled_events() {
+    UplinkStats before = sender.getStats();
+    for (int i = 0; i < 5; i++) {
+        arrival();
+    }
+    transport.duringSend = overflowQueue;
+    transport.failures = 1;
+    runUplink(60000);
+
+    UplinkStats after = sender.getStats();
+    TEST_ASSERT_GREATER_THAN(before.spilled, after.spilled);
+    TEST_ASSERT_EQUAL_UINT32(before.failedPosts + 1, after.failedPosts);
+    TEST_ASSERT_EQUAL_UINT32(before.dropped, after.dropped);
+    assertReceivedInOrder(nextBeacon);
+}
+
+// Plusieurs échecs de suite, et d'autres événements pendant l'attente
+static void test_repeated_failures_keep_order() {
+    for (int i = 0; i < 5; i++) {
+        arrival();
+    }
+    transport.duringSend = overflowQueue;
+    transport.failures = 3;
+    runUplink(EVENT_FLUSH_INTERVAL + UPLINK_RETRY_MIN / 2);
+    for (int i = 0; i < 20; i++) {
+        arrival();
+    }
+    runUplink(120000);
+    assertReceivedInOrder(nextBeacon);
+}
+
+// Sans débordement, le lot refusé passe par le spool, toujours en tête
+static void test_failed_batch_without_spill() {
+    for (int i = 0; i < 5; i++) {
+        arrival();
+    }
+    transport.failures = 2;
+    runUplink(EVENT_FLUSH_INTERVAL + 10);
+    TEST_ASSERT_EQUAL_INT(5, sender.getQueueSize());
+    for (int i = 0; i < 30; i++) {
+        arrival();
+    }
+    runUplink(120000);
+    assertReceivedInOrder(nextBeacon);
+}
+
+// Un lot gardé en RAM, le spool et la file : clearQueue() vide les trois,
+// rien n'est envoyé ensuite hormis les nouveaux événements
+static void test_clear_queue_empties_every_stage() {
+    for (int i = 0; i < 5; i++) {
+        arrival();
+    }
+    transport.duringSend = overflowQueue;
+    transport.failures = 1;
+    runUplink(EVENT_FLUSH_INTERVAL + UPLINK_RETRY_MIN / 2);
+    for (int i = 0; i < 3; i++) {
+        arrival();
+    }
+    UplinkStats stats = sender.getStats();
+    TEST_ASSERT_GREATER_THAN(0, stats.batched);
+    TEST_ASSERT_GREATER_THAN(0, stats.spooled);
+    TEST_ASSERT_GREATER_THAN(0, stats.queued);
+
+    uint32_t sent = stats.sent;
+    sender.clearQueue();
+    TEST_ASSERT_EQUAL_INT(0, sender.getQueueSize());
+    runUplink(120000);
+    TEST_ASSERT_EQUAL_size_t(0, transport.received.size());
+    TEST_ASSERT_EQUAL_UINT32(sent, sender.getStats().sent);
+
+    uint32_t first = nextBeacon;
+    arrival();
+    runUplink(120000);
+    TEST_ASSERT_EQUAL_size_t(1, transport.received.size());
+    TEST_ASSERT_EQUAL_UINT32(first, transport.received[0]);
+}
+
+int main() {
+    remove(STORAGE_ROOT "/" SPOOL_PARTITION ".bin");
+    sender.setTransport(transport);
+    sender.init();
+    UNITY_BEGIN();
+    RUN_TEST(test_failed_batch_stays_ahead_of_spilled_events);
+    RUN_TEST(test_repeated_failures_keep_order);
+    RUN_TEST(test_failed_batch_without_spill);
+    RUN_TEST(test_clear_queue_empties_every_stage);
+    return UNITY_END();
+}